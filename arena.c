@@ -0,0 +1,58 @@
+//
+//  arena.c
+//  PL/0
+//
+
+#include "arena.h"
+#include <string.h>
+#include "macros.h"
+
+
+/* Default size of each chunk, larger allocations get a chunk of their own */
+#define ARENA_CHUNK_SIZE 4096
+
+struct ArenaChunk {
+	ArenaChunk* prev;
+	union {
+		long double ld;
+		long long ll;
+		void* ptr;
+	} data[];
+};
+
+
+void* arena_alloc(Arena* arena, size_t size, size_t align) {
+	uintptr_t cur = ((uintptr_t)arena->cur + (align - 1)) & ~(uintptr_t)(align - 1);
+	if(arena->cur == NULL || cur + size > (uintptr_t)arena->end) {
+		/* Start a new chunk */
+		size_t chunk_size = MAX(ARENA_CHUNK_SIZE, size + align);
+		ArenaChunk* chunk = malloc_ff(sizeof(*chunk) + chunk_size);
+		chunk->prev = arena->chunks;
+		arena->chunks = chunk;
+		arena->end = (char*)chunk->data + chunk_size;
+		cur = ((uintptr_t)chunk->data + (align - 1)) & ~(uintptr_t)(align - 1);
+	}
+	
+	arena->cur = (char*)(cur + size);
+	return (void*)cur;
+}
+
+Slice arena_copySlice(Arena* arena, Slice slice) {
+	char* copy = arena_alloc(arena, slice.length + 1, 1);
+	memcpy(copy, slice.text, slice.length);
+	copy[slice.length] = '\0';
+	return SLICE(copy, slice.length);
+}
+
+void arena_destroy(Arena* arena) {
+	ArenaChunk* chunk = arena->chunks;
+	while(chunk != NULL) {
+		ArenaChunk* prev = chunk->prev;
+		free(chunk);
+		chunk = prev;
+	}
+	
+	arena->chunks = NULL;
+	arena->cur = NULL;
+	arena->end = NULL;
+}
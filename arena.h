@@ -0,0 +1,49 @@
+//
+//  arena.h
+//  PL/0
+//
+
+#ifndef PL0_ARENA_H
+#define PL0_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "slice.h"
+
+typedef struct ArenaChunk ArenaChunk;
+
+/*! Bump allocator that hands out memory from large chunks and frees it all at once.
+ A zero-initialized Arena is empty and ready to use.
+ */
+typedef struct Arena {
+	/*! Most recently allocated chunk, which links to the ones before it */
+	ArenaChunk* chunks;
+	
+	/*! Next free byte in the current chunk */
+	char* cur;
+	
+	/*! End of the current chunk */
+	char* end;
+} Arena;
+
+/*! Allocate memory from an arena. The memory is not zero-filled
+ @param size Number of bytes to allocate
+ @param align Required alignment of the allocation (must be a power of 2)
+ @return Pointer to the allocated memory, which lives until the arena is destroyed
+ */
+void* arena_alloc(Arena* arena, size_t size, size_t align);
+
+/*! Copy a slice into an arena
+ @param slice Text to copy
+ @return Slice viewing the copy, which is also null-terminated
+ */
+Slice arena_copySlice(Arena* arena, Slice slice);
+
+/*! Free every allocation made from an arena, leaving it empty and ready for reuse */
+void arena_destroy(Arena* arena);
+
+/*! Allocate an object of the given type from an arena */
+#define arena_new(arena, type) ((type*)arena_alloc((arena), sizeof(type), __alignof__(type)))
+
+
+#endif /* PL0_ARENA_H */
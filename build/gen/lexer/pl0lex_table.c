@@ -0,0 +1,139 @@
+/* Generated by tools/lexgen from PL0_addTokens in lexer/pl0spec.c. Do not edit! */
+
+#include "lexer/pl0spec.h"
+#include "lexer/keywords.h"
+
+const uint8_t PL0_keywordTable[KEYWORD_TABLE_SIZE] = {
+	0, 0, 9, 0, 10, 14, 5, 0, 6, 0, 0, 0, 0, 12, 0, 0,
+	0, 13, 0, 4, 0, 2, 11, 0, 0, 0, 3, 0, 0, 7, 8, 1,
+};
+
+static const uint8_t char_class[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 1, 0, 0, 2, 3, 4, 5, 6, 7, 8, 9,
+	10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 12, 13, 14, 15, 0,
+	0, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+	16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 0, 0, 0, 0, 0,
+	0, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+	16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const uint8_t next[23 * 17] = {
+	/*  0 */ 255,   5,   9,  10,   3,   1,  11,   2,  13,   4,  16,  14,  12,   7,   6,   8,  15,
+	/*  1 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/*  2 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/*  3 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/*  4 */ 255, 255, 255, 255,  17, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/*  5 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/*  6 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/*  7 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  19,  18, 255,
+	/*  8 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  20, 255, 255,
+	/*  9 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 10 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 11 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 12 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 13 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 14 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  21, 255, 255,
+	/* 15 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  15, 255, 255, 255, 255, 255,  15,
+	/* 16 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,  16, 255, 255, 255, 255, 255,  22,
+	/* 17 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 18 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 19 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 20 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 21 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	/* 22 */ 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+};
+
+static const LexTableState states[23] = {
+	/*  0 */ {false, -1, 0, SCAN_NONE},
+	/*  1 */ {true, -1, 4, SCAN_NONE},
+	/*  2 */ {true, -1, 5, SCAN_NONE},
+	/*  3 */ {true, -1, 6, SCAN_NONE},
+	/*  4 */ {true, -1, 7, SCAN_NONE},
+	/*  5 */ {true, -1, 34, SCAN_NONE},
+	/*  6 */ {true, -1, 9, SCAN_NONE},
+	/*  7 */ {true, -1, 11, SCAN_NONE},
+	/*  8 */ {true, -1, 13, SCAN_NONE},
+	/*  9 */ {true, -1, 15, SCAN_NONE},
+	/* 10 */ {true, -1, 16, SCAN_NONE},
+	/* 11 */ {true, -1, 17, SCAN_NONE},
+	/* 12 */ {true, -1, 18, SCAN_NONE},
+	/* 13 */ {true, -1, 19, SCAN_NONE},
+	/* 14 */ {false, -1, 0, SCAN_NONE},
+	/* 15 */ {true, 1, 0, SCAN_ALNUM},
+	/* 16 */ {true, 2, 0, SCAN_DIGITS},
+	/* 17 */ {true, 0, 0, SCAN_NONE},
+	/* 18 */ {true, -1, 10, SCAN_NONE},
+	/* 19 */ {true, -1, 12, SCAN_NONE},
+	/* 20 */ {true, -1, 14, SCAN_NONE},
+	/* 21 */ {true, -1, 20, SCAN_NONE},
+	/* 22 */ {true, 3, 0, SCAN_NONE},
+};
+
+static const char graph[] =
+	"\t<s0> [label = <START>, shape = circle];\n"
+	"\t<s1> [label = <+>, shape = doublecircle];\n"
+	"\t<s0> -> <s1> [label = < +>];\n"
+	"\t<s2> [label = <->, shape = doublecircle];\n"
+	"\t<s0> -> <s2> [label = < ->];\n"
+	"\t<s3> [label = <*>, shape = doublecircle];\n"
+	"\t<s0> -> <s3> [label = < *>];\n"
+	"\t<s4> [label = </>, shape = doublecircle];\n"
+	"\t<s17> [label = <COMMENT>, shape = doublecircle];\n"
+	"\t<s4> -> <s17> [label = < *>];\n"
+	"\t<s0> -> <s4> [label = < />];\n"
+	"\t<s5> [label = <%>, shape = doublecircle];\n"
+	"\t<s0> -> <s5> [label = < %>];\n"
+	"\t<s6> [label = <=>, shape = doublecircle];\n"
+	"\t<s0> -> <s6> [label = < =>];\n"
+	"\t<s7> [label = <&lt;>, shape = doublecircle];\n"
+	"\t<s18> [label = <&lt;&gt;>, shape = doublecircle];\n"
+	"\t<s7> -> <s18> [label = < &gt;>];\n"
+	"\t<s19> [label = <&lt;=>, shape = doublecircle];\n"
+	"\t<s7> -> <s19> [label = < =>];\n"
+	"\t<s0> -> <s7> [label = < &lt;>];\n"
+	"\t<s8> [label = <&gt;>, shape = doublecircle];\n"
+	"\t<s20> [label = <&gt;=>, shape = doublecircle];\n"
+	"\t<s8> -> <s20> [label = < =>];\n"
+	"\t<s0> -> <s8> [label = < &gt;>];\n"
+	"\t<s9> [label = <(>, shape = doublecircle];\n"
+	"\t<s0> -> <s9> [label = < (>];\n"
+	"\t<s10> [label = <)>, shape = doublecircle];\n"
+	"\t<s0> -> <s10> [label = < )>];\n"
+	"\t<s11> [label = <,>, shape = doublecircle];\n"
+	"\t<s0> -> <s11> [label = < ,>];\n"
+	"\t<s12> [label = <;>, shape = doublecircle];\n"
+	"\t<s0> -> <s12> [label = < ;>];\n"
+	"\t<s13> [label = <.>, shape = doublecircle];\n"
+	"\t<s0> -> <s13> [label = < .>];\n"
+	"\t<s14> [label = < >, shape = circle];\n"
+	"\t<s21> [label = <:=>, shape = doublecircle];\n"
+	"\t<s14> -> <s21> [label = < =>];\n"
+	"\t<s0> -> <s14> [label = < :>];\n"
+	"\t<s15> [label = <ID>, shape = doublecircle];\n"
+	"\t<s15> -> <s15> [label = < [a-zA-Z0-9]> style = dashed];\n"
+	"\t<s0> -> <s15> [label = < [a-zA-Z]>];\n"
+	"\t<s16> [label = <NUMBER>, shape = doublecircle];\n"
+	"\t<s16> -> <s16> [label = < [0-9]> style = dashed];\n"
+	"\t<s22> [label = <INVALID>, shape = doublecircle];\n"
+	"\t<s16> -> <s22> [label = < [a-zA-Z]>];\n"
+	"\t<s0> -> <s16> [label = < [0-9]>];\n";
+
+const LexTable PL0_lexTable = {
+	.state_count = 23,
+	.class_count = 17,
+	.char_class = char_class,
+	.next = next,
+	.states = states,
+	.acceptors = PL0_acceptors,
+	.graph = graph
+};
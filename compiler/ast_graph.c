@@ -10,18 +10,31 @@
 #include "config.h"
 
 
+/* Nodes don't have addresses of their own, so each one is identified by its element of types */
+#define NODE_PTR(ast, node) ((void*)&(ast)->types.elems[node])
+
+
 /* Forward declarations */
-static void Ident_drawGraph(char* ident, Graphviz* gv);
-static void Number_drawGraph(Word* pvalue, Graphviz* gv);
-static void Stmt_Assign_drawGraph(AST_Stmt* self, Graphviz* gv);
-static void Stmt_Call_drawGraph(AST_Stmt* self, Graphviz* gv);
-static void Stmt_Begin_drawGraph(AST_Stmt* self, Graphviz* gv);
-static void Stmt_If_drawGraph(AST_Stmt* self, Graphviz* gv);
-static void Stmt_While_drawGraph(AST_Stmt* self, Graphviz* gv);
-static void Stmt_Read_drawGraph(AST_Stmt* self, Graphviz* gv);
-static void Stmt_Write_drawGraph(AST_Stmt* self, Graphviz* gv);
+static void Ident_drawGraph(AST* ast, uint32_t ident, Graphviz* gv);
+static void Number_drawGraph(uint32_t* pvalue, Graphviz* gv);
+static void ConstDecls_drawGraph(AST* ast, AST_Block* block, Graphviz* gv);
+static void VarDecls_drawGraph(AST* ast, AST_Block* block, Graphviz* gv);
+static void ProcDecls_drawGraph(AST* ast, AST_Block* block, Graphviz* gv);
+static void ParamDecls_drawGraph(AST* ast, AST_Proc* proc, Graphviz* gv);
+static void ParamList_drawGraph(AST* ast, AST_Node call, Graphviz* gv);
+static void Stmt_Assign_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
+static void Stmt_Call_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
+static void Stmt_Begin_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
+static void Stmt_If_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
+static void Stmt_While_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
+static void Stmt_Read_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
+static void Stmt_Write_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
 
 
+void AST_drawGraph(AST* self, Graphviz* gv) {
+	AST_Block_drawGraph(self, self->program, gv);
+}
+
 /*! Example:
  
  @code
@@ -33,27 +46,25 @@ static void Stmt_Write_drawGraph(AST_Stmt* self, Graphviz* gv);
  consts vars  procs  stmt
  @endcode
  */
-void AST_Block_drawGraph(AST_Block* self, Graphviz* gv) {
+void AST_Block_drawGraph(AST* ast, uint32_t block, Graphviz* gv) {
+	AST_Block* self = &ast->blocks.elems[block];
 	Graphviz_drawPtrNode(gv, self, "<font " FACE_NONTERMINAL ">block</font>");
 	
-	if(self->consts != NULL) {
-		AST_ConstDecls_drawGraph(self->consts, gv);
-		Graphviz_drawPtrEdge(gv, self, self->consts);
+	if(self->consts.count > 0) {
+		ConstDecls_drawGraph(ast, self, gv);
 	}
 	
-	if(self->vars != NULL) {
-		AST_VarDecls_drawGraph(self->vars, gv);
-		Graphviz_drawPtrEdge(gv, self, self->vars);
+	if(self->vars.count > 0) {
+		VarDecls_drawGraph(ast, self, gv);
 	}
 	
-	if(self->procs != NULL && self->procs->procs.count > 0) {
-		AST_ProcDecls_drawGraph(self->procs, gv);
-		Graphviz_drawPtrEdge(gv, self, self->procs);
+	if(AST_procCount(ast, block) > 0) {
+		ProcDecls_drawGraph(ast, self, gv);
 	}
 	
-	if(self->stmt != NULL) {
-		AST_Stmt_drawGraph(self->stmt, gv);
-		Graphviz_drawPtrEdge(gv, self, self->stmt);
+	if(self->stmt != AST_NONE) {
+		AST_Stmt_drawGraph(ast, self->stmt, gv);
+		Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, self->stmt));
 	}
 }
 
@@ -69,24 +80,28 @@ void AST_Block_drawGraph(AST_Block* self, Graphviz* gv) {
  a   4  b   9  c   0
  @endcode
  */
-void AST_ConstDecls_drawGraph(AST_ConstDecls* self, Graphviz* gv) {
-	char* node_id = ptos(self);
+static void ConstDecls_drawGraph(AST* ast, AST_Block* block, Graphviz* gv) {
+	char* block_id = ptos(block);
+	char* node_id = rsprintf_ff("%p(consts)", block);
 	Graphviz_drawNode(gv, node_id, "<font " FACE_NONTERMINAL ">const-decls</font>");
+	Graphviz_drawEdge(gv, block_id, node_id);
 	
-	foreach(&self->consts, pconst) {
+	for(uint32_t i = 0; i < block->consts.count; i++) {
+		/* Each constant is an ident index followed by its value */
+		uint32_t* pconst = &ast->extra.elems[block->consts.start + 2 * i];
 		char* const_id = rsprintf_ff("%p", pconst);
 		
 		Graphviz_drawNode(gv, const_id, "<font " FACE_TERMINAL ">=</font>");
 		Graphviz_drawEdge(gv, node_id, const_id);
 		
-		char* name_id = ptos(pconst->ident);
-		Ident_drawGraph(pconst->ident, gv);
+		char* name_id = ptos(&ast->idents.elems[pconst[0]]);
+		Ident_drawGraph(ast, pconst[0], gv);
 		
 		Graphviz_drawEdge(gv, const_id, name_id);
 		destroy(&name_id);
 		
-		char* value_id = ptos(&pconst->value);
-		Number_drawGraph(&pconst->value, gv);
+		char* value_id = ptos(&pconst[1]);
+		Number_drawGraph(&pconst[1], gv);
 		
 		Graphviz_drawEdge(gv, const_id, value_id);
 		destroy(&value_id);
@@ -94,15 +109,24 @@ void AST_ConstDecls_drawGraph(AST_ConstDecls* self, Graphviz* gv) {
 	}
 	
 	destroy(&node_id);
+	destroy(&block_id);
 }
 
-void AST_ParamDecls_drawGraph(AST_ParamDecls* self, Graphviz* gv) {
-	Graphviz_drawPtrNode(gv, self, "<font " FACE_NONTERMINAL ">parameter-block</font>");
+static void ParamDecls_drawGraph(AST* ast, AST_Proc* proc, Graphviz* gv) {
+	char* proc_id = ptos(proc);
+	char* node_id = rsprintf_ff("%p(params)", proc);
+	Graphviz_drawNode(gv, node_id, "<font " FACE_NONTERMINAL ">parameter-block</font>");
+	Graphviz_drawEdge(gv, proc_id, node_id);
 	
-	foreach(&self->params, pparam) {
-		Ident_drawGraph(*pparam, gv);
-		Graphviz_drawPtrEdge(gv, self, *pparam);
+	for(uint32_t i = 0; i < proc->params.count; i++) {
+		char* param_id = ptos(&ast->idents.elems[proc->params.start + i]);
+		Ident_drawGraph(ast, proc->params.start + i, gv);
+		Graphviz_drawEdge(gv, node_id, param_id);
+		destroy(&param_id);
 	}
+	
+	destroy(&node_id);
+	destroy(&proc_id);
 }
 
 /*! Example: var x, y;
@@ -115,13 +139,21 @@ void AST_ParamDecls_drawGraph(AST_ParamDecls* self, Graphviz* gv) {
     x     y
  @endcode
  */
-void AST_VarDecls_drawGraph(AST_VarDecls* self, Graphviz* gv) {
-	Graphviz_drawPtrNode(gv, self, "<font " FACE_NONTERMINAL ">var-decls</font>");
+static void VarDecls_drawGraph(AST* ast, AST_Block* block, Graphviz* gv) {
+	char* block_id = ptos(block);
+	char* node_id = rsprintf_ff("%p(vars)", block);
+	Graphviz_drawNode(gv, node_id, "<font " FACE_NONTERMINAL ">var-decls</font>");
+	Graphviz_drawEdge(gv, block_id, node_id);
 	
-	foreach(&self->vars, pvar) {
-		Ident_drawGraph(*pvar, gv);
-		Graphviz_drawPtrEdge(gv, self, *pvar);
+	for(uint32_t i = 0; i < block->vars.count; i++) {
+		char* var_id = ptos(&ast->idents.elems[block->vars.start + i]);
+		Ident_drawGraph(ast, block->vars.start + i, gv);
+		Graphviz_drawEdge(gv, node_id, var_id);
+		destroy(&var_id);
 	}
+	
+	destroy(&node_id);
+	destroy(&block_id);
 }
 
 /*! Example:
@@ -137,13 +169,23 @@ void AST_VarDecls_drawGraph(AST_VarDecls* self, Graphviz* gv) {
     A       B
  @endcode
  */
-void AST_ProcDecls_drawGraph(AST_ProcDecls* self, Graphviz* gv) {
-	Graphviz_drawPtrNode(gv, self, "<font " FACE_NONTERMINAL ">proc-decls</font>");
+static void ProcDecls_drawGraph(AST* ast, AST_Block* block, Graphviz* gv) {
+	char* block_id = ptos(block);
+	char* node_id = rsprintf_ff("%p(procs)", block);
+	Graphviz_drawNode(gv, node_id, "<font " FACE_NONTERMINAL ">proc-decls</font>");
+	Graphviz_drawEdge(gv, block_id, node_id);
 	
-	foreach(&self->procs, pproc) {
-		AST_Proc_drawGraph(*pproc, gv);
-		Graphviz_drawPtrEdge(gv, self, *pproc);
+	uint32_t count = AST_listCount(ast, block->procs);
+	for(uint32_t i = 0; i < count; i++) {
+		uint32_t proc = AST_listItem(ast, block->procs, i);
+		char* proc_id = ptos(&ast->procs.elems[proc]);
+		AST_Proc_drawGraph(ast, proc, gv);
+		Graphviz_drawEdge(gv, node_id, proc_id);
+		destroy(&proc_id);
 	}
+	
+	destroy(&node_id);
+	destroy(&block_id);
 }
 
 /*! Example:
@@ -161,57 +203,57 @@ void AST_ProcDecls_drawGraph(AST_ProcDecls* self, Graphviz* gv) {
        block
  @endcode
  */
-void AST_Proc_drawGraph(AST_Proc* self, Graphviz* gv) {
+void AST_Proc_drawGraph(AST* ast, uint32_t proc, Graphviz* gv) {
+	AST_Proc* self = &ast->procs.elems[proc];
 	Graphviz_drawPtrNode(gv, self,
 		"<font " FACE_TERMINAL ">procedure <font " COLOR_PROC ">%s</font></font>",
-		self->ident);
+		AST_ident(ast, self->ident));
 	
 	/* param-decls */
-	if(self->param_decls != NULL && self->param_decls->params.count > 0) {
-		AST_ParamDecls_drawGraph(self->param_decls, gv);
-		Graphviz_drawPtrEdge(gv, self, self->param_decls);
+	if(self->params.count > 0) {
+		ParamDecls_drawGraph(ast, self, gv);
 	}
 	
 	/* block */
-	AST_Block_drawGraph(self->body, gv);
-	Graphviz_drawPtrEdge(gv, self, self->body);
+	AST_Block_drawGraph(ast, self->body, gv);
+	Graphviz_drawPtrEdge(gv, self, &ast->blocks.elems[self->body]);
 }
 
-void AST_Stmt_drawGraph(AST_Stmt* self, Graphviz* gv) {
-	if(!self) {
+void AST_Stmt_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	if(stmt == AST_NONE) {
 		return;
 	}
 	
 	/* Draw the actual statement nodes and then add an edge to the subtree */
-	switch(self->type) {
+	switch(ast->types.elems[stmt]) {
 		case STMT_ASSIGN:
-			Stmt_Assign_drawGraph(self, gv);
+			Stmt_Assign_drawGraph(ast, stmt, gv);
 			break;
-			
+		
 		case STMT_CALL:
-			Stmt_Call_drawGraph(self, gv);
+			Stmt_Call_drawGraph(ast, stmt, gv);
 			break;
-			
+		
 		case STMT_BEGIN:
-			Stmt_Begin_drawGraph(self, gv);
+			Stmt_Begin_drawGraph(ast, stmt, gv);
 			break;
-			
+		
 		case STMT_IF:
-			Stmt_If_drawGraph(self, gv);
+			Stmt_If_drawGraph(ast, stmt, gv);
 			break;
-			
+		
 		case STMT_WHILE:
-			Stmt_While_drawGraph(self, gv);
+			Stmt_While_drawGraph(ast, stmt, gv);
 			break;
-			
+		
 		case STMT_READ:
-			Stmt_Read_drawGraph(self, gv);
+			Stmt_Read_drawGraph(ast, stmt, gv);
 			break;
-			
+		
 		case STMT_WRITE:
-			Stmt_Write_drawGraph(self, gv);
+			Stmt_Write_drawGraph(ast, stmt, gv);
 			break;
-			
+		
 		default:
 			ASSERT(!"Invalid statement type");
 	}
@@ -231,10 +273,12 @@ void AST_Stmt_drawGraph(AST_Stmt* self, Graphviz* gv) {
         b   4
  @endcode
  */
-void AST_Cond_drawGraph(AST_Cond* self, Graphviz* gv) {
+void AST_Cond_drawGraph(AST* ast, AST_Node cond, Graphviz* gv) {
+	COND_TYPE type = ast->types.elems[cond];
+	
 	/* Get HTML-safe label for conditional operator */
 	const char* op_str = NULL;
-	switch(self->type) {
+	switch(type) {
 		case COND_ODD: op_str = "odd";      break;
 		case COND_EQ:  op_str = "=";        break;
 		case COND_GE:  op_str = "&gt;=";    break;
@@ -247,49 +291,38 @@ void AST_Cond_drawGraph(AST_Cond* self, Graphviz* gv) {
 	}
 	
 	/* Draw relational operator node */
+	void* self = NODE_PTR(ast, cond);
 	Graphviz_drawPtrNode(gv, self, "<font " FACE_TERMINAL ">%s</font>", op_str);
 	
-	switch(self->type) {
-		case COND_ODD: {
-			/* Draw expression */
-			AST_Expr_drawGraph(self->values.operand, gv);
-			Graphviz_drawPtrEdge(gv, self, self->values.operand);
-			break;
-		}
-		
-		case COND_EQ:
-		case COND_NE:
-		case COND_LT:
-		case COND_LE:
-		case COND_GT:
-		case COND_GE: {
-			/* Draw expression a */
-			AST_Expr_drawGraph(self->values.binop.left, gv);
-			Graphviz_drawPtrEdge(gv, self, self->values.binop.left);
-			
-			/* Draw expression b */
-			AST_Expr_drawGraph(self->values.binop.right, gv);
-			Graphviz_drawPtrEdge(gv, self, self->values.binop.right);
-			break;
-		}
-		
-		default:
-			ASSERT(!"Invalid condition type");
+	/* Draw expression a, which is the only operand of "odd" */
+	AST_Node left = ast->lhs.elems[cond];
+	AST_Expr_drawGraph(ast, left, gv);
+	Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, left));
+	
+	/* Draw expression b */
+	if(type != COND_ODD) {
+		AST_Node right = ast->rhs.elems[cond];
+		AST_Expr_drawGraph(ast, right, gv);
+		Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, right));
 	}
 }
 
-void AST_Expr_drawGraph(AST_Expr* self, Graphviz* gv) {
-	switch(self->type) {
+void AST_Expr_drawGraph(AST* ast, AST_Node expr, Graphviz* gv) {
+	void* self = NODE_PTR(ast, expr);
+	uint32_t lhs = ast->lhs.elems[expr];
+	uint32_t rhs = ast->rhs.elems[expr];
+	
+	switch(ast->types.elems[expr]) {
 		case EXPR_VAR:
 			Graphviz_drawPtrNode(gv, self,
 				"<font " FACE_TERMINAL " " COLOR_VAR ">%s</font>",
-				self->values.ident);
+				AST_ident(ast, lhs));
 			break;
 		
 		case EXPR_NUM:
 			Graphviz_drawPtrNode(gv, self,
 				"<font " FACE_TERMINAL " " COLOR_NUM ">%d</font>",
-				self->values.num);
+				(Word)lhs);
 			break;
 		
 		case EXPR_NEG:
@@ -297,8 +330,8 @@ void AST_Expr_drawGraph(AST_Expr* self, Graphviz* gv) {
 			Graphviz_drawPtrNode(gv, self, "<font " FACE_TERMINAL ">-</font>");
 			
 			/* Draw operand */
-			AST_Expr_drawGraph(self->values.operand, gv);
-			Graphviz_drawPtrEdge(gv, self, self->values.operand);
+			AST_Expr_drawGraph(ast, lhs, gv);
+			Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, lhs));
 			break;
 		
 		case EXPR_ADD:
@@ -308,7 +341,7 @@ void AST_Expr_drawGraph(AST_Expr* self, Graphviz* gv) {
 		case EXPR_MOD: {
 			/* Draw binary operator */
 			const char* op_str;
-			switch(self->type) {
+			switch(ast->types.elems[expr]) {
 				case EXPR_ADD: op_str = "+"; break;
 				case EXPR_SUB: op_str = "-"; break;
 				case EXPR_MUL: op_str = "*"; break;
@@ -322,96 +355,106 @@ void AST_Expr_drawGraph(AST_Expr* self, Graphviz* gv) {
 				"<font " FACE_TERMINAL ">%s</font>", op_str);
 			
 			/* Draw expr a */
-			AST_Expr_drawGraph(self->values.binop.left, gv);
-			Graphviz_drawPtrEdge(gv, self, self->values.binop.left);
+			AST_Expr_drawGraph(ast, lhs, gv);
+			Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, lhs));
 			
 			/* Draw expr b */
-			AST_Expr_drawGraph(self->values.binop.right, gv);
-			Graphviz_drawPtrEdge(gv, self, self->values.binop.right);
+			AST_Expr_drawGraph(ast, rhs, gv);
+			Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, rhs));
 			break;
 		}
 		
-		case EXPR_CALL: {
+		case EXPR_CALL:
 			/* Draw procedure name */
 			Graphviz_drawPtrNode(gv, self,
 				"<font " FACE_TERMINAL ">call <font " COLOR_PROC ">%s</font></font>",
-				self->values.call.ident);
-			
-			/* Draw each parameter from the list as a direct child */
-			AST_ParamList* param_list = self->values.call.param_list;
-			if(param_list != NULL) {
-				foreach(&param_list->params, pparam) {
-					AST_Expr_drawGraph(*pparam, gv);
-					Graphviz_drawPtrEdge(gv, self, *pparam);
-				}
-			}
+				AST_ident(ast, lhs));
+			ParamList_drawGraph(ast, expr, gv);
 			break;
-		}
 		
 		default:
 			ASSERT(!"Invalid expression type");
 	}
 }
 
-static void Ident_drawGraph(char* ident, Graphviz* gv) {
-	Graphviz_drawPtrNode(gv, ident,
+static void Ident_drawGraph(AST* ast, uint32_t ident, Graphviz* gv) {
+	/* Interned names are shared, so use the address of the reference to the name as the node ID */
+	Graphviz_drawPtrNode(gv, &ast->idents.elems[ident],
 		"<font " FACE_TERMINAL " " COLOR_VAR ">%s</font>",
-		ident);
+		AST_ident(ast, ident));
 }
 
-static void Number_drawGraph(Word* pvalue, Graphviz* gv) {
+static void Number_drawGraph(uint32_t* pvalue, Graphviz* gv) {
 	Graphviz_drawPtrNode(gv, pvalue,
 		"<font " FACE_TERMINAL " " COLOR_NUM ">%u</font>",
 		*pvalue);
 }
 
-static void Stmt_Assign_drawGraph(AST_Stmt* self, Graphviz* gv) {
+static void ParamList_drawGraph(AST* ast, AST_Node call, Graphviz* gv) {
+	uint32_t param_list = ast->rhs.elems[call];
+	if(param_list == AST_NONE) {
+		return;
+	}
+	
+	/* Draw each parameter from the list as a direct child */
+	uint32_t count = AST_listCount(ast, param_list);
+	for(uint32_t i = 0; i < count; i++) {
+		AST_Node param = AST_listItem(ast, param_list, i);
+		AST_Expr_drawGraph(ast, param, gv);
+		Graphviz_drawPtrEdge(gv, NODE_PTR(ast, call), NODE_PTR(ast, param));
+	}
+}
+
+static void Stmt_Assign_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	void* self = NODE_PTR(ast, stmt);
+	uint32_t ident = ast->lhs.elems[stmt];
+	AST_Node value = ast->rhs.elems[stmt];
+	
 	/* Draw assignment node */
 	Graphviz_drawPtrNode(gv, self, "<font " FACE_TERMINAL ">:=</font>");
 	
 	/* Draw identifier */
-	Ident_drawGraph(self->stmt.assign.ident, gv);
-	Graphviz_drawPtrEdge(gv, self, self->stmt.assign.ident);
+	Ident_drawGraph(ast, ident, gv);
+	Graphviz_drawPtrEdge(gv, self, &ast->idents.elems[ident]);
 	
 	/* Draw expression */
-	AST_Expr_drawGraph(self->stmt.assign.value, gv);
-	Graphviz_drawPtrEdge(gv, self, self->stmt.assign.value);
+	AST_Expr_drawGraph(ast, value, gv);
+	Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, value));
 }
 
-static void Stmt_Call_drawGraph(AST_Stmt* self, Graphviz* gv) {
-	Graphviz_drawPtrNode(gv, self,
+static void Stmt_Call_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	Graphviz_drawPtrNode(gv, NODE_PTR(ast, stmt),
 		"<font " FACE_TERMINAL ">call <font " COLOR_PROC ">%s</font></font>",
-		self->stmt.call.ident);
-	
-	/* Draw each parameter from the list as a direct child */
-	AST_ParamList* param_list = self->stmt.call.param_list;
-	if(param_list != NULL) {
-		foreach(&param_list->params, pparam) {
-			AST_Expr_drawGraph(*pparam, gv);
-			Graphviz_drawPtrEdge(gv, self, *pparam);
-		}
-	}
+		AST_ident(ast, ast->lhs.elems[stmt]));
+	ParamList_drawGraph(ast, stmt, gv);
 }
 
-static void Stmt_Begin_drawGraph(AST_Stmt* self, Graphviz* gv) {
+static void Stmt_Begin_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	void* self = NODE_PTR(ast, stmt);
 	Graphviz_drawPtrNode(gv, self, "<font " FACE_TERMINAL ">begin</font>");
 	
-	foreach(&self->stmt.begin.stmts, pstmt) {
-		if(*pstmt != NULL) {
-			AST_Stmt_drawGraph(*pstmt, gv);
-			Graphviz_drawPtrEdge(gv, self, *pstmt);
-		}
+	uint32_t stmts = ast->lhs.elems[stmt];
+	uint32_t count = AST_listCount(ast, stmts);
+	for(uint32_t i = 0; i < count; i++) {
+		AST_Node child = AST_listItem(ast, stmts, i);
+		AST_Stmt_drawGraph(ast, child, gv);
+		Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, child));
 	}
 }
 
-static void Stmt_If_drawGraph(AST_Stmt* self, Graphviz* gv) {
+static void Stmt_If_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	void* self = NODE_PTR(ast, stmt);
+	AST_Node cond = ast->lhs.elems[stmt];
+	AST_Node then_stmt = ast->extra.elems[ast->rhs.elems[stmt]];
+	AST_Node else_stmt = ast->extra.elems[ast->rhs.elems[stmt] + 1];
+	
 	/* Draw if node */
 	char* node_id = ptos(self);
 	Graphviz_drawPtrNode(gv, self, "<font " FACE_TERMINAL ">if</font>");
 	
 	/* Draw cond */
-	char* cond_id = ptos(self->stmt.if_stmt.cond);
-	AST_Cond_drawGraph(self->stmt.if_stmt.cond, gv);
+	char* cond_id = ptos(NODE_PTR(ast, cond));
+	AST_Cond_drawGraph(ast, cond, gv);
 	Graphviz_drawEdge(gv, node_id, cond_id);
 	destroy(&cond_id);
 	
@@ -421,26 +464,24 @@ static void Stmt_If_drawGraph(AST_Stmt* self, Graphviz* gv) {
 	Graphviz_drawEdge(gv, node_id, then_id);
 	
 	/* Draw then statement */
-	AST_Stmt* then_stmt = self->stmt.if_stmt.then_stmt;
-	if(then_stmt != NULL) {
-		char* then_stmt_id = ptos(then_stmt);
-		AST_Stmt_drawGraph(then_stmt, gv);
+	if(then_stmt != AST_NONE) {
+		char* then_stmt_id = ptos(NODE_PTR(ast, then_stmt));
+		AST_Stmt_drawGraph(ast, then_stmt, gv);
 		Graphviz_drawEdge(gv, then_id, then_stmt_id);
 		destroy(&then_stmt_id);
-		destroy(&then_id);
 	}
+	destroy(&then_id);
 	
 	/* Does this if statement have an else branch? */
-	AST_Stmt* else_stmt = self->stmt.if_stmt.else_stmt;
-	if(else_stmt != NULL) {
+	if(else_stmt != AST_NONE) {
 		/* Draw else node */
 		char* else_id = rsprintf_ff("%p(else)", self);
 		Graphviz_drawNode(gv, else_id, "<font " FACE_TERMINAL ">else</font>");
 		Graphviz_drawEdge(gv, node_id, else_id);
 		
 		/* Draw else statement */
-		char* else_stmt_id = ptos(else_stmt);
-		AST_Stmt_drawGraph(else_stmt, gv);
+		char* else_stmt_id = ptos(NODE_PTR(ast, else_stmt));
+		AST_Stmt_drawGraph(ast, else_stmt, gv);
 		Graphviz_drawEdge(gv, else_id, else_stmt_id);
 		destroy(&else_stmt_id);
 		destroy(&else_id);
@@ -449,32 +490,36 @@ static void Stmt_If_drawGraph(AST_Stmt* self, Graphviz* gv) {
 	destroy(&node_id);
 }
 
-static void Stmt_While_drawGraph(AST_Stmt* self, Graphviz* gv) {
+static void Stmt_While_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	void* self = NODE_PTR(ast, stmt);
 	Graphviz_drawPtrNode(gv, self, "<font " FACE_TERMINAL ">while</font>");
 	
 	/* Draw while condition */
-	AST_Cond_drawGraph(self->stmt.while_stmt.cond, gv);
-	Graphviz_drawPtrEdge(gv, self, self->stmt.while_stmt.cond);
+	AST_Node cond = ast->lhs.elems[stmt];
+	AST_Cond_drawGraph(ast, cond, gv);
+	Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, cond));
 	
 	/* Does this while statement have a non-null do statement? */
-	AST_Stmt* do_stmt = self->stmt.while_stmt.do_stmt;
-	if(do_stmt != NULL) {
-		AST_Stmt_drawGraph(do_stmt, gv);
-		Graphviz_drawPtrEdge(gv, self, do_stmt);
+	AST_Node do_stmt = ast->rhs.elems[stmt];
+	if(do_stmt != AST_NONE) {
+		AST_Stmt_drawGraph(ast, do_stmt, gv);
+		Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, do_stmt));
 	}
 }
 
-static void Stmt_Read_drawGraph(AST_Stmt* self, Graphviz* gv) {
-	Graphviz_drawPtrNode(gv, self,
+static void Stmt_Read_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	Graphviz_drawPtrNode(gv, NODE_PTR(ast, stmt),
 		"<font " FACE_TERMINAL ">read <font " COLOR_VAR ">%s</font></font>",
-		self->stmt.read.ident);
+		AST_ident(ast, ast->lhs.elems[stmt]));
 }
 
-static void Stmt_Write_drawGraph(AST_Stmt* self, Graphviz* gv) {
+static void Stmt_Write_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv) {
+	void* self = NODE_PTR(ast, stmt);
 	Graphviz_drawPtrNode(gv, self,
 		"<font " FACE_TERMINAL ">write</font>");
 	
 	/* Draw expression to be written */
-	AST_Expr_drawGraph(self->stmt.write.value, gv);
-	Graphviz_drawPtrEdge(gv, self, self->stmt.write.value);
+	AST_Node value = ast->lhs.elems[stmt];
+	AST_Expr_drawGraph(ast, value, gv);
+	Graphviz_drawPtrEdge(gv, self, NODE_PTR(ast, value));
 }
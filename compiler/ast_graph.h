@@ -12,16 +12,11 @@
 #include "ast_nodes.h"
 #include "graphviz.h"
 
-void AST_Block_drawGraph(AST_Block* self, Graphviz* gv);
-void AST_ConstDecls_drawGraph(AST_ConstDecls* self, Graphviz* gv);
-void AST_VarDecls_drawGraph(AST_VarDecls* self, Graphviz* gv);
-void AST_ProcDecls_drawGraph(AST_ProcDecls* self, Graphviz* gv);
-void AST_Proc_drawGraph(AST_Proc* self, Graphviz* gv);
-void AST_ParamDecls_drawGraph(AST_ParamDecls* self, Graphviz* gv);
-void AST_Stmt_drawGraph(AST_Stmt* self, Graphviz* gv);
-void AST_Cond_drawGraph(AST_Cond* self, Graphviz* gv);
-void AST_Expr_drawGraph(AST_Expr* self, Graphviz* gv);
-void AST_Term_drawGraph(AST_Term* self, Graphviz* gv);
-void AST_Factor_drawGraph(AST_Factor* self, Graphviz* gv);
+void AST_drawGraph(AST* self, Graphviz* gv);
+void AST_Block_drawGraph(AST* ast, uint32_t block, Graphviz* gv);
+void AST_Proc_drawGraph(AST* ast, uint32_t proc, Graphviz* gv);
+void AST_Stmt_drawGraph(AST* ast, AST_Node stmt, Graphviz* gv);
+void AST_Cond_drawGraph(AST* ast, AST_Node cond, Graphviz* gv);
+void AST_Expr_drawGraph(AST* ast, AST_Node expr, Graphviz* gv);
 
 #endif /* PL0_AST_GRAPH_H */
@@ -6,349 +6,186 @@
 //  Copyright © 2015 Kevin Colley. All rights reserved.
 //
 
-/****************************************************************************************\
- * Just a bunch of boilerplate code to make AST node objects that manage memory nicely. *
- * Should be fairly straightforward, hence the lack of commenting.                      *
-\****************************************************************************************/
-
 #include "ast_nodes.h"
-#include <assert.h>
 
 
-Destroyer(AST_Block) {
-	release(&self->consts);
-	release(&self->vars);
-	release(&self->procs);
-	release(&self->stmt);
+Destroyer(AST) {
+	array_clear(&self->types);
+	array_clear(&self->lhs);
+	array_clear(&self->rhs);
+	array_clear(&self->lines);
+	array_clear(&self->extra);
+	array_clear(&self->idents);
+	array_clear(&self->syms);
+	array_clear(&self->blocks);
+	array_clear(&self->procs);
+	array_clear(&self->pending);
 }
-DEF(AST_Block);
+DEF(AST);
 
-Destroyer(AST_ConstDecls) {
-	foreach(&self->consts, pconst) {
-		destroy(&pconst->ident);
-	}
-	array_clear(&self->consts);
-}
-DEF(AST_ConstDecls);
 
-Destroyer(AST_ParamDecls) {
-	array_destroy(&self->params);
+AST_Node AST_addNode(AST* self, int type, uint32_t lhs, uint32_t rhs) {
+	ASSERT(self->types.count < AST_NONE);
+	array_append(&self->types, (uint8_t)type);
+	array_append(&self->lhs, lhs);
+	array_append(&self->rhs, rhs);
+	array_append(&self->lines, 0);
+	return (AST_Node)(self->types.count - 1);
 }
-DEF(AST_ParamDecls);
 
-Destroyer(AST_VarDecls) {
-	foreach(&self->vars, pvar) {
-		destroy(pvar);
-	}
-	array_clear(&self->vars);
+uint32_t AST_addIdent(AST* self, const char* ident) {
+	array_append(&self->idents, ident);
+	return (uint32_t)(self->idents.count - 1);
 }
-DEF(AST_VarDecls);
 
-Destroyer(AST_ProcDecls) {
-	foreach(&self->procs, pproc) {
-		release(pproc);
-	}
-	array_clear(&self->procs);
+void AST_addConst(AST* self, const char* ident, Word value) {
+	AST_addPair(self, AST_addIdent(self, ident), (uint32_t)value);
 }
-DEF(AST_ProcDecls);
 
-Destroyer(AST_Proc) {
-	destroy(&self->ident);
-	release(&self->body);
+uint32_t AST_addBlock(AST* self, const AST_Block* block) {
+	array_append(&self->blocks, *block);
+	return (uint32_t)(self->blocks.count - 1);
 }
-DEF(AST_Proc);
 
-Destroyer(AST_Stmt) {
-	switch(self->type) {
-		case STMT_UNINITIALIZED:
-			break;
-		
-		case STMT_ASSIGN:
-			destroy(&self->stmt.assign.ident);
-			release(&self->stmt.assign.value);
-			break;
-		
-		case STMT_CALL:
-			destroy(&self->stmt.call.ident);
-			release(&self->stmt.call.param_list);
-			break;
-		
-		case STMT_BEGIN: {
-			array_release(&self->stmt.begin.stmts);
-			break;
-		}
-		
-		case STMT_IF:
-			release(&self->stmt.if_stmt.cond);
-			release(&self->stmt.if_stmt.then_stmt);
-			release(&self->stmt.if_stmt.else_stmt);
-			break;
-		
-		case STMT_WHILE:
-			release(&self->stmt.while_stmt.cond);
-			release(&self->stmt.while_stmt.do_stmt);
-			break;
-		
-		case STMT_READ:
-			destroy(&self->stmt.read.ident);
-			break;
-		
-		case STMT_WRITE:
-			release(&self->stmt.write.value);
-			break;
-		
-		default:
-			ASSERT(!"Invalid statement type");
-	}
+uint32_t AST_addProc(AST* self, const AST_Proc* proc) {
+	array_append(&self->procs, *proc);
+	return (uint32_t)(self->procs.count - 1);
 }
-DEF(AST_Stmt);
 
-Destroyer(AST_Cond) {
-	switch(self->type) {
-		case COND_UNINITIALIZED:
-			break;
-		
-		case COND_ODD:
-			release(&self->values.operand);
-			break;
-		
-		case COND_EQ:
-		case COND_NE:
-		case COND_LT:
-		case COND_LE:
-		case COND_GT:
-		case COND_GE:
-			release(&self->values.binop.left);
-			release(&self->values.binop.right);
-			break;
-		
-		default:
-			ASSERT(!"Invalid condition type");
-	}
+uint32_t AST_addPair(AST* self, uint32_t first, uint32_t second) {
+	array_append(&self->extra, first);
+	array_append(&self->extra, second);
+	return (uint32_t)(self->extra.count - 2);
 }
-DEF(AST_Cond);
 
-Destroyer(AST_Expr) {
-	switch(self->type) {
-		case EXPR_UNINITIALIZED:
-			break;
-		
-		case EXPR_VAR:
-			destroy(&self->values.ident);
-			break;
-		
-		case EXPR_NUM:
-			break;
-		
-		case EXPR_NEG:
-			release(&self->values.operand);
-			break;
-		
-		case EXPR_ADD:
-		case EXPR_SUB:
-		case EXPR_MUL:
-		case EXPR_DIV:
-		case EXPR_MOD:
-			release(&self->values.binop.left);
-			release(&self->values.binop.right);
-			break;
-		
-		case EXPR_CALL:
-			destroy(&self->values.call.ident);
-			release(&self->values.call.param_list);
-			break;
-		
-		default:
-			ASSERT(!"Invalid expression type");
-	}
+uint32_t AST_beginList(AST* self) {
+	return (uint32_t)self->pending.count;
 }
-DEF(AST_Expr);
 
-Destroyer(AST_ParamList) {
-	array_release(&self->params);
+void AST_listAppend(AST* self, uint32_t item) {
+	array_append(&self->pending, item);
 }
-DEF(AST_ParamList);
 
-
-/*! Create an AST node for a block with the provided child nodes
- @param consts List of constant declarations
- @param vars List of variable declarations
- @param procs List of procedure declarations
- @param stmt Body of the block
- @return AST node for a block
- */
-AST_Block* AST_Block_create(AST_ConstDecls* consts, AST_VarDecls* vars, AST_ProcDecls* procs, AST_Stmt* stmt) {
-	AST_Block* ret = AST_Block_new();
-	ret->consts = consts;
-	ret->vars = vars;
-	ret->procs = procs;
-	ret->stmt = stmt;
-	return ret;
+uint32_t AST_endList(AST* self, uint32_t mark) {
+	ASSERT(mark <= self->pending.count);
+	uint32_t count = (uint32_t)(self->pending.count - mark);
+	uint32_t list = (uint32_t)self->extra.count;
+	array_append(&self->extra, count);
+	array_extend(&self->extra, &self->pending.elems[mark], count);
+	self->pending.count = mark;
+	return list;
 }
 
-/*! Append a constant declaration to a list
- @param ident Name of constant
- @param value Value of constant
- @return self
- */
-AST_ConstDecls* AST_ConstDecls_append(AST_ConstDecls* self, char* ident, Word value) {
-	/* Allow self to be NULL by allocating a new instance */
-	if(!self) {
-		self = AST_ConstDecls_new();
+AST_Node AST_addBegin(AST* self, uint32_t mark) {
+	/* A begin statement without any statements is an empty statement itself */
+	if(self->pending.count == mark) {
+		return AST_NONE;
 	}
 	
-	/* Append value */
-	element_type(self->consts) newConst = {
-		.ident = ident,
-		.value = value
-	};
-	array_append(&self->consts, newConst);
-	return self;
+	return AST_addNode(self, STMT_BEGIN, AST_endList(self, mark), AST_NONE);
 }
 
-/*! Append a variable declaration to a list
- @param ident Name of variable
- @return self
- */
-AST_VarDecls* AST_VarDecls_append(AST_VarDecls* self, char* ident) {
-	/* Allow self to be NULL by allocating a new instance */
-	if(!self) {
-		self = AST_VarDecls_new();
+AST_Node AST_applyUnaryOperator(AST* self, AST_Node expr, EXPR_TYPE unary_op) {
+	switch(unary_op) {
+		case EXPR_ADD:
+			return expr;
+		
+		case EXPR_SUB:
+			return AST_addNode(self, EXPR_NEG, expr, AST_NONE);
+		
+		default:
+			ASSERT(!"Unexpected expression type");
 	}
-	
-	/* Append variable */
-	array_append(&self->vars, ident);
-	return self;
 }
 
-/*! Append a procedure declaration to a list
- @param ident Name of procedure
- @param param_decls List of parameter declarations
- @param body Block making up the procedure's body
- @return self
- */
-AST_ProcDecls* AST_ProcDecls_append(AST_ProcDecls* self, char* ident, AST_ParamDecls* param_decls, AST_Block* body) {
-	/* Allow self to be NULL by allocating a new instance */
-	if(!self) {
-		self = AST_ProcDecls_new();
+void AST_clearSymbols(AST* self) {
+	while(self->syms.cap < self->idents.count) {
+		array_expand(&self->syms);
+	}
+	self->syms.count = self->idents.count;
+	if(self->syms.count != 0) {
+		memset(self->syms.elems, 0, self->syms.count * sizeof(*self->syms.elems));
 	}
-	
-	/* Build proc object */
-	AST_Proc* proc = AST_Proc_new();
-	proc->ident = ident;
-	proc->param_decls = param_decls;
-	proc->body = body;
-	
-	/* Append procedure declaration object */
-	array_append(&self->procs, proc);
-	return self;
 }
 
-/*! Append a parameter declaration to a list
- @param ident Name of parameter
- @return self
- */
-AST_ParamDecls* AST_ParamDecls_append(AST_ParamDecls* self, char* ident) {
-	/* Allow self to be NULL by allocating a new instance */
-	if(!self) {
-		self = AST_ParamDecls_new();
+
+/*! Shift an index that was copied from another AST, leaving AST_NONE alone */
+static inline uint32_t relocate(uint32_t index, uint32_t offset) {
+	return index == AST_NONE ? AST_NONE : index + offset;
+}
+
+/*! Shift every item of a list that was copied from another AST */
+static void relocateList(AST* self, uint32_t list, uint32_t offset) {
+	uint32_t count = AST_listCount(self, list);
+	for(uint32_t i = 0; i < count; i++) {
+		uint32_t* pitem = &self->extra.elems[list + 1 + i];
+		*pitem = relocate(*pitem, offset);
 	}
-	
-	/* Append parameter */
-	array_append(&self->params, ident);
-	return self;
 }
 
-/*! Create an AST node for a statement with the provided type and child nodes
- @param type Statement type
- @note Further parameters depend on the statement type
- @return AST node for a statement
- */
-AST_Stmt* AST_Stmt_create(STMT_TYPE type, ...) {
-	VARIADIC(type, ap, {
-		AST_Stmt* ret = AST_Stmt_new();
-		ret->type = type;
+uint32_t AST_adopt(AST* self, const AST* other) {
+	ASSERT(other->pending.count == 0);
+	uint32_t node_off = (uint32_t)self->types.count;
+	uint32_t extra_off = (uint32_t)self->extra.count;
+	uint32_t ident_off = (uint32_t)self->idents.count;
+	uint32_t block_off = (uint32_t)self->blocks.count;
+	uint32_t proc_off = (uint32_t)self->procs.count;
+	
+	array_extend(&self->types, other->types.elems, other->types.count);
+	array_extend(&self->lhs, other->lhs.elems, other->lhs.count);
+	array_extend(&self->rhs, other->rhs.elems, other->rhs.count);
+	array_extend(&self->lines, other->lines.elems, other->lines.count);
+	array_extend(&self->extra, other->extra.elems, other->extra.count);
+	array_extend(&self->idents, other->idents.elems, other->idents.count);
+	array_extend(&self->blocks, other->blocks.elems, other->blocks.count);
+	array_extend(&self->procs, other->procs.elems, other->procs.count);
+	
+	/* Every list in extra belongs to exactly one node, block, or procedure, so each is shifted once */
+	for(size_t i = node_off; i < self->types.count; i++) {
+		uint32_t* plhs = &self->lhs.elems[i];
+		uint32_t* prhs = &self->rhs.elems[i];
 		
-		switch(type) {
+		switch(self->types.elems[i]) {
 			case STMT_ASSIGN:
-				VA_POP(ap, ret->stmt.assign.ident);
-				VA_POP(ap, ret->stmt.assign.value);
+				*plhs += ident_off;
+				*prhs += node_off;
 				break;
 			
 			case STMT_CALL:
-				VA_POP(ap, ret->stmt.call.ident);
-				VA_POP(ap, ret->stmt.call.param_list);
+			case EXPR_CALL:
+				*plhs += ident_off;
+				if(*prhs != AST_NONE) {
+					*prhs += extra_off;
+					relocateList(self, *prhs, node_off);
+				}
 				break;
 			
 			case STMT_BEGIN:
-				/* Nothing to do */
+				*plhs += extra_off;
+				relocateList(self, *plhs, node_off);
 				break;
 			
 			case STMT_IF:
-				VA_POP(ap, ret->stmt.if_stmt.cond);
-				VA_POP(ap, ret->stmt.if_stmt.then_stmt);
-				VA_POP(ap, ret->stmt.if_stmt.else_stmt);
+				*plhs += node_off;
+				*prhs += extra_off;
+				self->extra.elems[*prhs] = relocate(self->extra.elems[*prhs], node_off);
+				self->extra.elems[*prhs + 1] = relocate(self->extra.elems[*prhs + 1], node_off);
 				break;
 			
 			case STMT_WHILE:
-				VA_POP(ap, ret->stmt.while_stmt.cond);
-				VA_POP(ap, ret->stmt.while_stmt.do_stmt);
+				*plhs += node_off;
+				*prhs = relocate(*prhs, node_off);
 				break;
 			
 			case STMT_READ:
-				VA_POP(ap, ret->stmt.read.ident);
+			case EXPR_VAR:
+				*plhs += ident_off;
 				break;
 			
 			case STMT_WRITE:
-				VA_POP(ap, ret->stmt.write.value);
-				break;
-			
-			default:
-				ASSERT(!"Invalid statement type");
-		}
-		
-		return ret;
-	});
-}
-
-/*! Append a statement to a begin statement
- @param self Statement of type STMT_BEGIN (will be checked with an assertion in debug builds)
- @param stmt Statement to append to this begin statement
- @return self
- */
-AST_Stmt* AST_Stmt_append(AST_Stmt* self, AST_Stmt* stmt) {
-	/* Don't bother appending empty statements */
-	if(!stmt) {
-		return self;
-	}
-	
-	/* Allow self to be NULL by allocating a new instance */
-	if(!self) {
-		self = AST_Stmt_new();
-		self->type = STMT_BEGIN;
-	}
-	
-	/* Must be a begin statement */
-	ASSERT(self->type == STMT_BEGIN);
-	
-	/* Append statement to array */
-	array_append(&self->stmt.begin.stmts, stmt);
-	return self;
-}
-
-/*! Create an AST node for a condition with the provided type and child nodes
- @param type Condition type
- @note Further parameters depend on the condition type
- @return AST node for a condition
- */
-AST_Cond* AST_Cond_create(COND_TYPE type, ...) {
-	VARIADIC(type, ap, {
-		AST_Cond* ret = AST_Cond_new();
-		ret->type = type;
-		
-		switch(type) {
 			case COND_ODD:
-				VA_POP(ap, ret->values.operand);
+			case EXPR_NEG:
+				*plhs += node_off;
 				break;
 			
 			case COND_EQ:
@@ -357,94 +194,41 @@ AST_Cond* AST_Cond_create(COND_TYPE type, ...) {
 			case COND_LE:
 			case COND_GT:
 			case COND_GE:
-				VA_POP(ap, ret->values.binop.left);
-				VA_POP(ap, ret->values.binop.right);
-				break;
-			
-			default:
-				ASSERT(!"Invalid condition type");
-		}
-		
-		return ret;
-	});
-}
-
-/*! Create an AST node for an expression with the provided type and child nodes
- @param type Expression type
- @note Further parameters depend on the expression type
- @return AST node for an expression
- */
-AST_Expr* AST_Expr_create(EXPR_TYPE type, ...) {
-	VARIADIC(type, ap, {
-		AST_Expr* ret = AST_Expr_new();
-		ret->type = type;
-		
-		switch(type) {
-			case EXPR_VAR:
-				VA_POP(ap, ret->values.ident);
-				break;
-			
-			case EXPR_NUM: {
-				int tmp;
-				VA_POP(ap, tmp);
-				ret->values.num = tmp;
-				break;
-			}
-			
-			case EXPR_NEG:
-				VA_POP(ap, ret->values.operand);
-				break;
-			
 			case EXPR_ADD:
 			case EXPR_SUB:
 			case EXPR_MUL:
 			case EXPR_DIV:
 			case EXPR_MOD:
-				VA_POP(ap, ret->values.binop.left);
-				VA_POP(ap, ret->values.binop.right);
+				*plhs += node_off;
+				*prhs += node_off;
 				break;
 			
-			case EXPR_CALL:
-				VA_POP(ap, ret->values.call.ident);
-				VA_POP(ap, ret->values.call.param_list);
+			case EXPR_NUM:
 				break;
 			
 			default:
-				ASSERT(!"Invalid expression type");
+				ASSERT(!"Invalid node type");
 		}
-		
-		return ret;
-	});
-}
-
-/*! Applies a unary operator (+/-) to an expression
- @param unary_op Either EXPR_ADD (+) or EXPR_SUB (-)
- @return New EXPR_NEG object if unary_op was EXPR_SUB, otherwise just self
- */
-AST_Expr* AST_Expr_applyUnaryOperator(AST_Expr* self, EXPR_TYPE unary_op) {
-	switch(unary_op) {
-		case EXPR_ADD:
-			return self;
-		
-		case EXPR_SUB:
-			return AST_Expr_create(EXPR_NEG, self);
-		
-		default:
-			ASSERT(!"Unexpected expression type");
 	}
-}
-
-/*! Append an expression to a parameter list
- @param expr Expression to compute the parameter value
- @return self
- */
-AST_ParamList* AST_ParamList_append(AST_ParamList* self, AST_Expr* expr) {
-	/* Allow self to be NULL by allocating a new instance */
-	if(!self) {
-		self = AST_ParamList_new();
+	
+	for(size_t i = block_off; i < self->blocks.count; i++) {
+		AST_Block* block = &self->blocks.elems[i];
+		block->consts.start += extra_off;
+		for(uint32_t j = 0; j < block->consts.count; j++) {
+			self->extra.elems[block->consts.start + 2 * j] += ident_off;
+		}
+		block->vars.start += ident_off;
+		block->procs += extra_off;
+		relocateList(self, block->procs, proc_off);
+		block->stmt = relocate(block->stmt, node_off);
+	}
+	
+	for(size_t i = proc_off; i < self->procs.count; i++) {
+		AST_Proc* proc = &self->procs.elems[i];
+		proc->ident += ident_off;
+		proc->params.start += ident_off;
+		proc->body += block_off;
 	}
 	
-	/* Append expression to array */
-	array_append(&self->params, expr);
-	return self;
+	return proc_off;
 }
@@ -6,15 +6,11 @@
 //  Copyright © 2015 Kevin Colley. All rights reserved.
 //
 
-/****************************************************************************************\
- * Just a bunch of boilerplate code to make AST node objects that manage memory nicely. *
- * Should be fairly straightforward, hence the lack of commenting.                      *
-\****************************************************************************************/
-
 #ifndef PL0_AST_NODES_H
 #define PL0_AST_NODES_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include "object.h"
 #include "config.h"
@@ -25,20 +21,15 @@ typedef enum COND_TYPE COND_TYPE;
 typedef enum EXPR_TYPE EXPR_TYPE;
 
 /* Forward declarations */
+typedef struct AST AST;
 typedef struct AST_Block AST_Block;
-typedef struct AST_ConstDecls AST_ConstDecls;
-typedef struct AST_VarDecls AST_VarDecls;
-typedef struct AST_ProcDecls AST_ProcDecls;
 typedef struct AST_Proc AST_Proc;
-typedef struct AST_ParamDecls AST_ParamDecls;
-typedef struct AST_Stmt AST_Stmt;
-typedef struct AST_Cond AST_Cond;
-typedef struct AST_Expr AST_Expr;
-typedef struct AST_Term AST_Term;
-typedef struct AST_Factor AST_Factor;
-typedef struct AST_ParamList AST_ParamList;
+struct Symbol;
 
 
+/* Statement, condition, and expression types don't overlap, so the type of a node is enough to
+ tell which kind of node it is
+ */
 enum STMT_TYPE {
 	STMT_UNINITIALIZED = 0,
 	STMT_ASSIGN = 1,
@@ -52,7 +43,7 @@ enum STMT_TYPE {
 
 enum COND_TYPE {
 	COND_UNINITIALIZED = 0,
-	COND_ODD = 1,
+	COND_ODD = STMT_WRITE + 1,
 	COND_EQ,
 	COND_NE,
 	COND_LT,
@@ -63,7 +54,7 @@ enum COND_TYPE {
 
 enum EXPR_TYPE {
 	EXPR_UNINITIALIZED = 0,
-	EXPR_VAR = 1,
+	EXPR_VAR = COND_GE + 1,
 	EXPR_NUM,
 	EXPR_NEG,
 	EXPR_ADD,
@@ -75,211 +66,217 @@ enum EXPR_TYPE {
 };
 
 
-/* AST node structures */
+/*! Index of a statement, condition, or expression node in an AST */
+typedef uint32_t AST_Node;
 
-struct AST_Block {
-	OBJECT_BASE;
+/*! Marks a missing node or list, such as an empty statement or a call without a parameter list */
+#define AST_NONE UINT32_MAX
 
-	AST_ConstDecls* consts;             /*!< Optional */
-	AST_VarDecls* vars;                 /*!< Optional */
-	AST_ProcDecls* procs;               /*!< Optional */
-	AST_Stmt* stmt;                     /*!< Optional */
-};
-DECL(AST_Block);
+/*! Consecutive elements of one of the arrays in an AST */
+typedef struct AST_Range {
+	uint32_t start;
+	uint32_t count;
+} AST_Range;
 
-struct AST_ConstDecls {
-	OBJECT_BASE;
+struct AST_Block {
+	AST_Range consts;                   /*!< Pairs of an ident index and a value in extra */
+	AST_Range vars;                     /*!< Names in idents */
+	uint32_t procs;                     /*!< List in extra of the indices of the procedure declarations */
+	AST_Node stmt;                      /*!< Optional */
 	
-	dynamic_array(struct {
-		char* ident;
-		Word value;
-	}) consts;                          /*!< At least one required */
+	size_t stmt_first_token;            /*!< Index of the statement's first token (recursive descent parser only) */
+	size_t stmt_end_token;              /*!< Index just past the statement (recursive descent parser only) */
 };
-DECL(AST_ConstDecls);
 
-struct AST_VarDecls {
-	OBJECT_BASE;
+struct AST_Proc {
+	uint32_t ident;                     /*!< Index of the name in idents */
+	AST_Range params;                   /*!< Names in idents */
+	uint32_t body;                      /*!< Index of the procedure's block in blocks */
 	
-	dynamic_array(char*) vars;          /*!< At least one required */
+	size_t first_token;                 /*!< Index of the "procedure" token (recursive descent parser only) */
+	size_t end_token;                   /*!< Index just past the final ";" (recursive descent parser only) */
 };
-DECL(AST_VarDecls);
 
-struct AST_ProcDecls {
+/*! AST of a whole program, stored in a few contiguous arrays rather than as a tree of separately
+ allocated nodes. Statements, conditions, and expressions are nodes, which are one element each
+ of types, lhs, and rhs. The operands of each type of node are:
+ @code
+ STMT_ASSIGN   lhs: ident index         rhs: value expression
+ STMT_CALL     lhs: ident index         rhs: parameter list, or AST_NONE
+ STMT_BEGIN    lhs: statement list
+ STMT_IF       lhs: condition           rhs: index in extra of the then and else statements
+ STMT_WHILE    lhs: condition           rhs: body statement
+ STMT_READ     lhs: ident index
+ STMT_WRITE    lhs: value expression
+ COND_ODD      lhs: operand
+ COND_EQ, ...  lhs: left operand        rhs: right operand
+ EXPR_VAR      lhs: ident index
+ EXPR_NUM      lhs: value
+ EXPR_NEG      lhs: operand
+ EXPR_ADD, ... lhs: left operand        rhs: right operand
+ EXPR_CALL     lhs: ident index         rhs: parameter list, or AST_NONE
+ @endcode
+ A list is an index in extra, which holds the number of items followed by the items. Empty
+ statements are AST_NONE, a begin statement only lists the statements that aren't empty, and
+ one without any of those is an empty statement itself.
+ */
+struct AST {
 	OBJECT_BASE;
 	
-	dynamic_array(AST_Proc*) procs;     /*!< At least one required */
-};
-DECL(AST_ProcDecls);
-
-struct AST_Proc {
-	OBJECT_BASE;
+	/*! Type of each node */
+	dynamic_array(uint8_t) types;
 	
-	char* ident;                        /*!< Required */
-	AST_ParamDecls* param_decls;        /*!< Required */
-	AST_Block* body;                    /*!< Required */
-};
-DECL(AST_Proc);
-
-struct AST_ParamDecls {
-	OBJECT_BASE;
+	/*! First operand of each node */
+	dynamic_array(uint32_t) lhs;
 	
-	dynamic_array(char*) params;        /*!< Zero or more */
-};
-DECL(AST_ParamDecls);
-
-struct AST_Stmt {
-	OBJECT_BASE;
+	/*! Second operand of each node */
+	dynamic_array(uint32_t) rhs;
 	
-	STMT_TYPE type;
-	union {
-		struct {
-			char* ident;
-			AST_Expr* value;
-		} assign;                       /*!< STMT_ASSIGN */
-		struct {
-			char* ident;
-			AST_ParamList* param_list;
-		} call;                         /*!< STMT_CALL */
-		struct {
-			dynamic_array(AST_Stmt*) stmts;
-		} begin;                        /*!< STMT_BEGIN */
-		struct {
-			AST_Cond* cond;
-			AST_Stmt* then_stmt;
-			AST_Stmt* else_stmt;
-		} if_stmt;                      /*!< STMT_IF */
-		struct {
-			AST_Cond* cond;
-			AST_Stmt* do_stmt;
-		} while_stmt;                   /*!< STMT_WHILE */
-		struct {
-			char* ident;
-		} read;                         /*!< STMT_READ */
-		struct {
-			AST_Expr* value;
-		} write;                        /*!< STMT_WRITE */
-	} stmt;                             /*!< Required */
-};
-DECL(AST_Stmt);
-
-struct AST_Cond {
-	OBJECT_BASE;
+	/*! Line where each statement starts, or 0 for other nodes and when it isn't known (recursive descent parser only) */
+	dynamic_array(uint32_t) lines;
 	
-	COND_TYPE type;
-	union {
-		AST_Expr* operand;              /*!< COND_ODD (unary operator) */
-		struct {
-			AST_Expr* left;
-			AST_Expr* right;
-		} binop;                        /*!< COND_{EQ,NE,LT,LE,GT,GE} (binary operators) */
-	} values;                           /*!< Required */
-};
-DECL(AST_Cond);
-
-struct AST_Expr {
-	OBJECT_BASE;
+	/*! Lists and other operands that don't fit in lhs and rhs */
+	dynamic_array(uint32_t) extra;
 	
-	EXPR_TYPE type;
-	union {
-		char* ident;                    /*!< EXPR_VAR (variable name) */
-		Word num;                       /*!< EXPR_NUM (integer literal) */
-		AST_Expr* operand;              /*!< EXPR_NEG (unary operator) */
-		struct {
-			AST_Expr* left;
-			AST_Expr* right;
-		} binop;                        /*!< EXPR_{ADD,SUB,MUL,DIV} (binary operators) */
-		struct {
-			char* ident;
-			AST_ParamList* param_list;
-		} call;                         /*!< EXPR_CALL (procedure call) */
-	} values;                           /*!< Required */
-};
-DECL(AST_Expr);
-
-struct AST_ParamList {
-	OBJECT_BASE;
+	/*! Interned identifiers, one for each place that a name appears in the program */
+	dynamic_array(const char*) idents;
 	
-	dynamic_array(AST_Expr*) params;    /*!< Zero or more */
+	/*! Symbol that each identifier refers to, or NULL if it couldn't be resolved (set by the binding pass) */
+	dynamic_array(struct Symbol*) syms;
+	
+	/*! Every block in the program */
+	dynamic_array(AST_Block) blocks;
+	
+	/*! Every procedure declaration in the program */
+	dynamic_array(AST_Proc) procs;
+	
+	/*! Index of the main block */
+	uint32_t program;
+	
+	/*! Items of the lists that are still being built, innermost last */
+	dynamic_array(uint32_t) pending;
 };
-DECL(AST_ParamList);
+DECL(AST);
 
 
-/* Additional AST helper methods */
+/*! Add a node
+ @param type STMT_TYPE, COND_TYPE, or EXPR_TYPE of the node
+ @param lhs First operand of the node
+ @param rhs Second operand of the node
+ @return Index of the new node
+ */
+AST_Node AST_addNode(AST* self, int type, uint32_t lhs, uint32_t rhs);
 
-/*! Create an AST node for a block with the provided child nodes
- @param consts List of constant declarations
- @param vars List of variable declarations
- @param procs List of procedure declarations
- @param stmt Body of the block
- @return AST node for a block
+/*! Add an identifier
+ @param ident Interned name
+ @return Index of the identifier in idents
  */
-AST_Block* AST_Block_create(AST_ConstDecls* consts, AST_VarDecls* vars, AST_ProcDecls* procs, AST_Stmt* stmt);
+uint32_t AST_addIdent(AST* self, const char* ident);
 
-/*! Append a constant declaration to a list
- @param ident Name of constant
- @param value Value of constant
- @return self
+/*! Add a constant declaration to the end of extra. The constants of a block are added one after another
+ @param ident Interned name of the constant
+ @param value Value of the constant
  */
-AST_ConstDecls* AST_ConstDecls_append(AST_ConstDecls* self, char* ident, Word value);
+void AST_addConst(AST* self, const char* ident, Word value);
 
-/*! Append a variable declaration to a list
- @param ident Name of variable
- @return self
+/*! Add a block
+ @param block Block to copy into the AST
+ @return Index of the block in blocks
  */
-AST_VarDecls* AST_VarDecls_append(AST_VarDecls* self, char* ident);
+uint32_t AST_addBlock(AST* self, const AST_Block* block);
 
-/*! Append a procedure declaration to a list
- @param ident Name of procedure
- @param param_decls List of parameter declarations
- @param body Block making up the procedure's body
- @return self
+/*! Add a procedure declaration
+ @param proc Procedure declaration to copy into the AST
+ @return Index of the procedure declaration in procs
  */
-AST_ProcDecls* AST_ProcDecls_append(AST_ProcDecls* self, char* ident, AST_ParamDecls* param_decls, AST_Block* body);
+uint32_t AST_addProc(AST* self, const AST_Proc* proc);
 
-/*! Append a parameter declaration to a list
- @param ident Name of parameter
- @return self
+/*! Add two values to the end of extra
+ @return Index in extra of the first value
  */
-AST_ParamDecls* AST_ParamDecls_append(AST_ParamDecls* self, char* ident);
+uint32_t AST_addPair(AST* self, uint32_t first, uint32_t second);
 
-/*! Create an AST node for a statement with the provided type and child nodes
- @param type Statement type
- @note Further parameters depend on the statement type
- @return AST node for a statement
+/*! Start building a list. Lists can be nested, as long as the inner list ends first
+ @return Marker to pass to AST_endList
  */
-AST_Stmt* AST_Stmt_create(STMT_TYPE type, ...);
+uint32_t AST_beginList(AST* self);
 
-/*! Append a statement to a begin statement
- @param self Statement of type STMT_BEGIN (will be checked with an assertion in debug builds)
- @param stmt Statement to append to this begin statement
- @return self
+/*! Append an item to the innermost list that is being built
+ @param item Node or other index to append
  */
-AST_Stmt* AST_Stmt_append(AST_Stmt* self, AST_Stmt* stmt);
+void AST_listAppend(AST* self, uint32_t item);
 
-/*! Create an AST node for a condition with the provided type and child nodes
- @param type Condition type
- @note Further parameters depend on the condition type
- @return AST node for a condition
+/*! Finish building a list, moving its items into extra
+ @param mark Marker returned by AST_beginList when the list was started
+ @return Index of the list in extra
  */
-AST_Cond* AST_Cond_create(COND_TYPE type, ...);
+uint32_t AST_endList(AST* self, uint32_t mark);
 
-/*! Create an AST node for an expression with the provided type and child nodes
- @param type Expression type
- @note Further parameters depend on the expression type
- @return AST node for an expression
+/*! Finish a begin statement whose statements were appended to a list
+ @param mark Marker returned by AST_beginList before the first statement was appended
+ @return New STMT_BEGIN node, or AST_NONE if no statements were appended
  */
-AST_Expr* AST_Expr_create(EXPR_TYPE type, ...);
+AST_Node AST_addBegin(AST* self, uint32_t mark);
 
-/*! Applies a unary operator (+/-) to an expression
+/*! Apply a unary operator (+/-) to an expression
+ @param expr Expression the operator applies to
  @param unary_op Either EXPR_ADD (+) or EXPR_SUB (-)
- @return New EXPR_NEG object if unary_op was EXPR_SUB, otherwise just self
+ @return New EXPR_NEG node if unary_op was EXPR_SUB, otherwise just expr
  */
-AST_Expr* AST_Expr_applyUnaryOperator(AST_Expr* self, EXPR_TYPE unary_op);
+AST_Node AST_applyUnaryOperator(AST* self, AST_Node expr, EXPR_TYPE unary_op);
 
-/*! Append an expression to a parameter list
- @param expr Expression to compute the parameter value
- @return self
+/*! Move everything from another AST to the end of this one, fixing up the indices it holds
+ @param other AST to copy, which must not have any lists that are still being built
+ @return Index in this AST's procs of the first procedure declaration that came from other
+ */
+uint32_t AST_adopt(AST* self, const AST* other);
+
+/*! Make room to bind every identifier to a symbol, setting each to NULL */
+void AST_clearSymbols(AST* self);
+
+/*! Get the number of items in a list
+ @param list Index of the list in extra
+ */
+static inline uint32_t AST_listCount(const AST* self, uint32_t list) {
+	return self->extra.elems[list];
+}
+
+/*! Get an item of a list
+ @param list Index of the list in extra
+ @param index Which item to get
+ */
+static inline uint32_t AST_listItem(const AST* self, uint32_t list, uint32_t index) {
+	return self->extra.elems[list + 1 + index];
+}
+
+/*! Get the name of an identifier
+ @param ident Index of the identifier in idents
+ */
+static inline const char* AST_ident(const AST* self, uint32_t ident) {
+	return self->idents.elems[ident];
+}
+
+/*! Get the symbol that an identifier was bound to
+ @param ident Index of the identifier in idents
+ */
+static inline struct Symbol* AST_symbol(const AST* self, uint32_t ident) {
+	return self->syms.elems[ident];
+}
+
+/*! Get the number of procedures declared in a block
+ @param block Index of the block in blocks
+ */
+static inline uint32_t AST_procCount(const AST* self, uint32_t block) {
+	return AST_listCount(self, self->blocks.elems[block].procs);
+}
+
+/*! Get a procedure declared in a block
+ @param block Index of the block in blocks
+ @param index Which of the block's procedures to get
+ @return Index of the procedure declaration in procs
  */
-AST_ParamList* AST_ParamList_append(AST_ParamList* self, AST_Expr* expr);
+static inline uint32_t AST_procAt(const AST* self, uint32_t block, uint32_t index) {
+	return AST_listItem(self, self->blocks.elems[block].procs, index);
+}
 
 #endif /* PL0_AST_NODES_H */
@@ -0,0 +1,230 @@
+//
+//  binder.c
+//  PL/0
+//
+
+#include "binder.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+
+static void vSemanticError(const char* fmt, va_list ap);
+static void semanticError(const char* fmt, ...);
+static bool bindBlock(SymTree* scope, AST* ast, uint32_t block);
+static bool bindStmt(SymTree* scope, AST* ast, AST_Node statement);
+static bool bindCond(SymTree* scope, AST* ast, AST_Node condition);
+static bool bindExpr(SymTree* scope, AST* ast, AST_Node expression);
+static bool bindParamList(SymTree* scope, AST* ast, uint32_t param_list);
+
+/* Look up the procedure named in a call. Parameters are bound separately */
+static Symbol* bindCall(SymTree* scope, AST* ast, uint32_t ident);
+
+/* Look up a symbol whose value is used, which can't be a procedure */
+static Symbol* bindLoad(SymTree* scope, AST* ast, uint32_t ident);
+
+/* Look up a symbol that is assigned to, which has to be a variable */
+static Symbol* bindStore(SymTree* scope, AST* ast, uint32_t ident);
+
+
+static void vSemanticError(const char* fmt, va_list ap) {
+	printf("Semantic Error: ");
+	vprintf(fmt, ap);
+	printf("\n");
+}
+
+static void semanticError(const char* fmt, ...) {
+	VARIADIC(fmt, ap, {
+		vSemanticError(fmt, ap);
+	});
+}
+
+
+bool bind_program(SymTree* scope, AST* prog) {
+	/* Don't leave behind a symbol from an earlier binding of the same tree */
+	AST_clearSymbols(prog);
+	return bindBlock(scope, prog, prog->program);
+}
+
+static bool bindBlock(SymTree* scope, AST* ast, uint32_t block) {
+	uint32_t count = AST_procCount(ast, block);
+	for(uint32_t i = 0; i < count; i++) {
+		/* Subprocedures are bound first, just like their code is generated first */
+		AST_Proc* proc = &ast->procs.elems[AST_procAt(ast, block, i)];
+		Symbol* sym = SymTree_findSymbol(scope, AST_ident(ast, proc->ident));
+		ast->syms.elems[proc->ident] = sym;
+		if(!bindBlock(sym->value.procedure.body->symtree, ast, proc->body)) {
+			return false;
+		}
+	}
+	
+	return bindStmt(scope, ast, ast->blocks.elems[block].stmt);
+}
+
+static bool bindStmt(SymTree* scope, AST* ast, AST_Node statement) {
+	/* Empty statement */
+	if(statement == AST_NONE) {
+		return true;
+	}
+	
+	uint32_t lhs = ast->lhs.elems[statement];
+	uint32_t rhs = ast->rhs.elems[statement];
+	switch(ast->types.elems[statement]) {
+		case STMT_ASSIGN:
+			/* The value is generated before the store */
+			if(!bindExpr(scope, ast, rhs)) {
+				return false;
+			}
+			return bindStore(scope, ast, lhs) != NULL;
+		
+		case STMT_CALL:
+			if(bindCall(scope, ast, lhs) == NULL) {
+				return false;
+			}
+			
+			/* The code generator keeps going after an error in a parameter, so this does too */
+			if(rhs != AST_NONE) {
+				bindParamList(scope, ast, rhs);
+			}
+			return true;
+		
+		case STMT_BEGIN: {
+			uint32_t count = AST_listCount(ast, lhs);
+			for(uint32_t i = 0; i < count; i++) {
+				if(!bindStmt(scope, ast, AST_listItem(ast, lhs, i))) {
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		case STMT_IF:
+			return bindCond(scope, ast, lhs)
+				&& bindStmt(scope, ast, ast->extra.elems[rhs])
+				&& bindStmt(scope, ast, ast->extra.elems[rhs + 1]);
+		
+		case STMT_WHILE:
+			return bindCond(scope, ast, lhs)
+				&& bindStmt(scope, ast, rhs);
+		
+		case STMT_READ:
+			return bindStore(scope, ast, lhs) != NULL;
+		
+		case STMT_WRITE:
+			return bindExpr(scope, ast, lhs);
+		
+		default:
+			ASSERT(!"Unknown statement type");
+	}
+}
+
+static bool bindCond(SymTree* scope, AST* ast, AST_Node condition) {
+	if(ast->types.elems[condition] == COND_ODD) {
+		return bindExpr(scope, ast, ast->lhs.elems[condition]);
+	}
+	
+	return bindExpr(scope, ast, ast->lhs.elems[condition])
+		&& bindExpr(scope, ast, ast->rhs.elems[condition]);
+}
+
+static bool bindExpr(SymTree* scope, AST* ast, AST_Node expression) {
+	uint32_t lhs = ast->lhs.elems[expression];
+	uint32_t rhs = ast->rhs.elems[expression];
+	switch(ast->types.elems[expression]) {
+		case EXPR_VAR:
+			return bindLoad(scope, ast, lhs) != NULL;
+		
+		case EXPR_NUM:
+			return true;
+		
+		case EXPR_NEG:
+			return bindExpr(scope, ast, lhs);
+		
+		case EXPR_ADD:
+		case EXPR_SUB:
+		case EXPR_MUL:
+		case EXPR_DIV:
+		case EXPR_MOD:
+			return bindExpr(scope, ast, lhs)
+				&& bindExpr(scope, ast, rhs);
+		
+		case EXPR_CALL:
+			if(bindCall(scope, ast, lhs) == NULL) {
+				return false;
+			}
+			
+			/* Same as for a call statement */
+			if(rhs != AST_NONE) {
+				bindParamList(scope, ast, rhs);
+			}
+			return true;
+		
+		default:
+			ASSERT(!"Unknown expression type");
+	}
+}
+
+static bool bindParamList(SymTree* scope, AST* ast, uint32_t param_list) {
+	uint32_t count = AST_listCount(ast, param_list);
+	for(uint32_t i = 0; i < count; i++) {
+		if(!bindExpr(scope, ast, AST_listItem(ast, param_list, i))) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+static Symbol* bindCall(SymTree* scope, AST* ast, uint32_t ident) {
+	const char* name = AST_ident(ast, ident);
+	Symbol* sym = SymTree_findSymbol(scope, name);
+	if(sym == NULL) {
+		semanticError("Tried to call procedure \"%s\" which isn't declared at this scope", name);
+	}
+	
+	ast->syms.elems[ident] = sym;
+	return sym;
+}
+
+static Symbol* bindLoad(SymTree* scope, AST* ast, uint32_t ident) {
+	const char* name = AST_ident(ast, ident);
+	Symbol* sym = SymTree_findSymbol(scope, name);
+	if(sym == NULL) {
+		semanticError("Symbol \"%s\" used but not declared", name);
+		return NULL;
+	}
+	
+	if(sym->type == SYM_PROC) {
+		semanticError("Symbol \"%s\" was used like a variable but is a procedure", name);
+		return NULL;
+	}
+	
+	ast->syms.elems[ident] = sym;
+	return sym;
+}
+
+static Symbol* bindStore(SymTree* scope, AST* ast, uint32_t ident) {
+	const char* name = AST_ident(ast, ident);
+	Symbol* sym = SymTree_findSymbol(scope, name);
+	if(sym == NULL) {
+		semanticError("Tried to modify variable \"%s\" before it was declared", name);
+		return NULL;
+	}
+	
+	/* Only variables are allowed, but handle each type for better error messages */
+	switch(sym->type) {
+		case SYM_CONST:
+			semanticError("Tried to modify \"%s\", but it is a constant", name);
+			return NULL;
+		
+		case SYM_PROC:
+			semanticError("Tried to modify \"%s\", but it is a procedure", name);
+			return NULL;
+		
+		case SYM_VAR:
+			ast->syms.elems[ident] = sym;
+			return sym;
+		
+		default:
+			ASSERT(!"Unknown symbol type");
+	}
+}
@@ -0,0 +1,25 @@
+//
+//  binder.h
+//  PL/0
+//
+
+#ifndef PL0_BINDER_H
+#define PL0_BINDER_H
+
+#include <stdbool.h>
+#include "symtree.h"
+#include "compiler/ast_nodes.h"
+
+
+/*! Resolve every identifier used in a program to its symbol once, before any code is generated.
+ The symbols are stored in the AST's syms, and an identifier that isn't declared or can't be used
+ where it appears is left with a NULL symbol after printing a semantic error. Identifiers are
+ visited in the same order that code is generated, so the same errors are printed.
+ @param scope Root of the symbol tree that was built from the program
+ @param prog AST of the whole program
+ @return True on success or false on error
+ */
+bool bind_program(SymTree* scope, AST* prog);
+
+
+#endif /* PL0_BINDER_H */
@@ -32,11 +32,11 @@ Destroyer(Codegen) {
 }
 DEF(Codegen);
 
-Codegen* Codegen_initWithAST(Codegen* self, AST_Block* prog, CODEGEN_TYPE cgType) {
+Codegen* Codegen_initWithAST(Codegen* self, AST* prog, CODEGEN_TYPE cgType, Profile* profile) {
 	if((self = Codegen_init(self))) {
 		switch(cgType) {
 			case CODEGEN_PM0:
-				self->cg.pm0 = GenPM0_initWithAST(GenPM0_alloc(), prog);
+				self->cg.pm0 = GenPM0_initWithAST(GenPM0_alloc(), prog, profile);
 				if(self->cg.pm0 == NULL) {
 					release(&self);
 					return NULL;
@@ -107,3 +107,35 @@ void Codegen_emit(Codegen* self, FILE* fp) {
 			ASSERT(!"Unknown codegen type");
 	}
 }
+
+bool Codegen_writeBlockMap(Codegen* self, FILE* fp) {
+	switch(self->cgType) {
+		case CODEGEN_PM0:
+			GenPM0_writeBlockMap(self->cg.pm0, fp);
+			return true;
+			
+#if WITH_LLVM
+		case CODEGEN_LLVM:
+			return false;
+#endif /* WITH_LLVM */
+			
+		default:
+			ASSERT(!"Unknown codegen type");
+	}
+}
+
+bool Codegen_emitInsns(Codegen* self, InsnArray* code) {
+	switch(self->cgType) {
+		case CODEGEN_PM0:
+			GenPM0_emitInsns(self->cg.pm0, code);
+			return true;
+			
+#if WITH_LLVM
+		case CODEGEN_LLVM:
+			return false;
+#endif /* WITH_LLVM */
+			
+		default:
+			ASSERT(!"Unknown codegen type");
+	}
+}
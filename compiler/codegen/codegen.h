@@ -50,8 +50,9 @@ DECL(Codegen);
 /*! Initialize a codegen object from the program's AST
  @param prog AST that makes up the entire program
  @param cgType Codegen emitter to use
+ @param profile Profile of an earlier compilation of the program, or NULL. Only used by CODEGEN_PM0
  */
-Codegen* Codegen_initWithAST(Codegen* self, AST_Block* prog, CODEGEN_TYPE cgType);
+Codegen* Codegen_initWithAST(Codegen* self, AST* prog, CODEGEN_TYPE cgType, Profile* profile);
 
 /*! Draw procedure CFGs to fp */
 void Codegen_drawGraph(Codegen* self, FILE* fp);
@@ -66,5 +67,18 @@ void Codegen_writeSymbolTable(Codegen* self, FILE* fp);
  */
 void Codegen_emit(Codegen* self, FILE* fp);
 
+/*! Writes which basic block is at each code address so that a profile of the program can be used
+ to optimize it the next time it is compiled. Must be called after the code has been emitted
+ @param fp Output file stream where the block map should be written
+ @return True on success, or false if this code generator doesn't produce PM/0 code
+ */
+bool Codegen_writeBlockMap(Codegen* self, FILE* fp);
+
+/*! Emits the PM/0 instructions for the program to the end of an instruction array
+ @param code Array where instructions should be appended
+ @return True on success, or false if this code generator doesn't produce PM/0 code
+ */
+bool Codegen_emitInsns(Codegen* self, InsnArray* code);
+
 
 #endif /* PL0_CODEGEN_H */
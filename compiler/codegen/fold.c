@@ -0,0 +1,479 @@
+//
+//  fold.c
+//  PL/0
+//
+
+#include "fold.h"
+#include <stdio.h>
+#include <stdint.h>
+#include "symbol.h"
+#include "dynamic_array.h"
+
+
+typedef dynamic_array(Symbol*) SymbolArray;
+
+static AST_Proc* findProc(AST* ast, Symbol* sym);
+static void foldStmt(AST* ast, SymbolArray* called, AST_Node statement);
+static void foldCond(AST* ast, SymbolArray* called, AST_Node condition, size_t line);
+static void foldExpr(AST* ast, SymbolArray* called, AST_Node expr, size_t line);
+static void foldParamList(AST* ast, SymbolArray* called, uint32_t param_list, size_t line);
+
+/* Remember that code which might run calls a procedure, so that it gets folded too */
+static void markCalled(SymbolArray* called, Symbol* sym);
+
+/* Compute the result of a binary operator on two numbers the same way that the VM does. Fails
+ for a division that the VM would reject, which is left in the code for the VM to report if it runs
+ */
+static bool evaluate(EXPR_TYPE type, Word left, Word right, Word* result);
+
+/* Warn about a division that the VM will reject if it runs, which can't be folded
+ @param line Line of the statement holding the division, or 0 if it isn't known
+ */
+static void checkDivision(EXPR_TYPE type, bool constant_left, Word left, Word right, size_t line);
+
+/* Compute the result of a comparison the same way that the VM does */
+static bool compare(COND_TYPE type, Word left, Word right);
+
+/* Turn an expression into a number, dropping its operands */
+static void setNumber(AST* ast, AST_Node expr, Word value);
+
+/* Replace an expression with one of its operands by copying the operand's node over it */
+static void replaceExpr(AST* ast, AST_Node expr, AST_Node with);
+
+/* Whether an expression is a number with the given value */
+static bool isNumber(const AST* ast, AST_Node expr, Word value);
+
+/* Whether an expression can be left out without changing what the program does. Calls might
+ have side effects, and a division might fail unless its divisor is known to be safe.
+ */
+static bool isPure(const AST* ast, AST_Node expr);
+
+/* Whether two pure expressions always have the same value */
+static bool sameExpr(const AST* ast, AST_Node a, AST_Node b);
+
+
+void fold_program(AST* prog) {
+	SymbolArray called = {0};
+	foldStmt(prog, &called, prog->blocks.elems[prog->program].stmt);
+	
+	/* Each procedure is folded once code that might run calls it, which can find more calls */
+	for(size_t i = 0; i < called.count; i++) {
+		AST_Proc* proc = findProc(prog, called.elems[i]);
+		if(proc != NULL) {
+			foldStmt(prog, &called, prog->blocks.elems[proc->body].stmt);
+		}
+	}
+	
+	array_clear(&called);
+}
+
+bool fold_condition(const AST* ast, AST_Node condition, bool* value) {
+	AST_Node left = ast->lhs.elems[condition];
+	if(ast->types.elems[condition] == COND_ODD) {
+		if(ast->types.elems[left] != EXPR_NUM) {
+			return false;
+		}
+		
+		*value = (((Word)ast->lhs.elems[left]) & 1) != 0;
+		return true;
+	}
+	
+	AST_Node right = ast->rhs.elems[condition];
+	if(ast->types.elems[left] != EXPR_NUM || ast->types.elems[right] != EXPR_NUM) {
+		return false;
+	}
+	
+	*value = compare(ast->types.elems[condition], (Word)ast->lhs.elems[left], (Word)ast->lhs.elems[right]);
+	return true;
+}
+
+static AST_Proc* findProc(AST* ast, Symbol* sym) {
+	/* Only procedures that were bound have a symbol, so a replaced declaration never matches */
+	foreach(&ast->procs, pproc) {
+		if(AST_symbol(ast, pproc->ident) == sym) {
+			return pproc;
+		}
+	}
+	
+	return NULL;
+}
+
+static void foldStmt(AST* ast, SymbolArray* called, AST_Node statement) {
+	/* Empty statement */
+	if(statement == AST_NONE) {
+		return;
+	}
+	
+	uint32_t lhs = ast->lhs.elems[statement];
+	uint32_t rhs = ast->rhs.elems[statement];
+	size_t line = ast->lines.elems[statement];
+	switch(ast->types.elems[statement]) {
+		case STMT_ASSIGN:
+			foldExpr(ast, called, rhs, line);
+			break;
+		
+		case STMT_CALL:
+			markCalled(called, AST_symbol(ast, lhs));
+			if(rhs != AST_NONE) {
+				foldParamList(ast, called, rhs, line);
+			}
+			break;
+		
+		case STMT_BEGIN: {
+			uint32_t count = AST_listCount(ast, lhs);
+			for(uint32_t i = 0; i < count; i++) {
+				foldStmt(ast, called, AST_listItem(ast, lhs, i));
+			}
+			break;
+		}
+		
+		case STMT_IF: {
+			/* A branch that a constant condition skips is left alone, as no code is generated for it */
+			AST_Node then_stmt = ast->extra.elems[rhs];
+			AST_Node else_stmt = ast->extra.elems[rhs + 1];
+			foldCond(ast, called, lhs, line);
+			bool value;
+			if(fold_condition(ast, lhs, &value)) {
+				foldStmt(ast, called, value ? then_stmt : else_stmt);
+			}
+			else {
+				foldStmt(ast, called, then_stmt);
+				foldStmt(ast, called, else_stmt);
+			}
+			break;
+		}
+		
+		case STMT_WHILE: {
+			foldCond(ast, called, lhs, line);
+			bool value;
+			if(!fold_condition(ast, lhs, &value) || value) {
+				foldStmt(ast, called, rhs);
+			}
+			break;
+		}
+		
+		case STMT_READ:
+			break;
+		
+		case STMT_WRITE:
+			foldExpr(ast, called, lhs, line);
+			break;
+		
+		default:
+			ASSERT(!"Unknown statement type");
+	}
+}
+
+static void foldCond(AST* ast, SymbolArray* called, AST_Node condition, size_t line) {
+	if(ast->types.elems[condition] == COND_ODD) {
+		foldExpr(ast, called, ast->lhs.elems[condition], line);
+		return;
+	}
+	
+	foldExpr(ast, called, ast->lhs.elems[condition], line);
+	foldExpr(ast, called, ast->rhs.elems[condition], line);
+}
+
+static void foldExpr(AST* ast, SymbolArray* called, AST_Node expr, size_t line) {
+	EXPR_TYPE type = ast->types.elems[expr];
+	switch(type) {
+		case EXPR_VAR: {
+			/* Constants are replaced by their values */
+			Symbol* sym = AST_symbol(ast, ast->lhs.elems[expr]);
+			if(sym != NULL && sym->type == SYM_CONST) {
+				setNumber(ast, expr, sym->value.number);
+			}
+			return;
+		}
+		
+		case EXPR_NUM:
+			return;
+		
+		case EXPR_NEG: {
+			AST_Node operand = ast->lhs.elems[expr];
+			foldExpr(ast, called, operand, line);
+			
+			if(ast->types.elems[operand] == EXPR_NUM) {
+				/* Negating WORD_MIN wraps around, just like it does in the VM */
+				setNumber(ast, expr, (Word)(0 - ast->lhs.elems[operand]));
+			}
+			else if(ast->types.elems[operand] == EXPR_NEG) {
+				/* -(-x) -> x */
+				replaceExpr(ast, expr, ast->lhs.elems[operand]);
+			}
+			return;
+		}
+		
+		case EXPR_ADD:
+		case EXPR_SUB:
+		case EXPR_MUL:
+		case EXPR_DIV:
+		case EXPR_MOD:
+			break;
+		
+		case EXPR_CALL:
+			markCalled(called, AST_symbol(ast, ast->lhs.elems[expr]));
+			if(ast->rhs.elems[expr] != AST_NONE) {
+				foldParamList(ast, called, ast->rhs.elems[expr], line);
+			}
+			return;
+		
+		default:
+			ASSERT(!"Unknown expression type");
+	}
+	
+	/* Only binary operators get here. Fold the operands in the order they're evaluated */
+	AST_Node left = ast->lhs.elems[expr];
+	AST_Node right = ast->rhs.elems[expr];
+	foldExpr(ast, called, left, line);
+	foldExpr(ast, called, right, line);
+	
+	bool constant_left = ast->types.elems[left] == EXPR_NUM;
+	if(ast->types.elems[right] == EXPR_NUM && (type == EXPR_DIV || type == EXPR_MOD)) {
+		checkDivision(type, constant_left, (Word)ast->lhs.elems[left], (Word)ast->lhs.elems[right], line);
+	}
+	
+	if(constant_left && ast->types.elems[right] == EXPR_NUM) {
+		/* A division that would fail stays in the code, so the VM reports it only if it runs */
+		Word result;
+		if(evaluate(type, (Word)ast->lhs.elems[left], (Word)ast->lhs.elems[right], &result)) {
+			setNumber(ast, expr, result);
+		}
+		return;
+	}
+	
+	/* Simplify identities. Anything that's dropped must be pure, since it would have been evaluated */
+	switch(type) {
+		case EXPR_ADD:
+			if(isNumber(ast, right, 0)) {
+				/* x+0 -> x */
+				replaceExpr(ast, expr, left);
+			}
+			else if(isNumber(ast, left, 0)) {
+				/* 0+x -> x */
+				replaceExpr(ast, expr, right);
+			}
+			break;
+		
+		case EXPR_SUB:
+			if(isNumber(ast, right, 0)) {
+				/* x-0 -> x */
+				replaceExpr(ast, expr, left);
+			}
+			else if(isNumber(ast, left, 0)) {
+				if(ast->types.elems[right] == EXPR_NEG) {
+					/* 0-(-x) -> x */
+					replaceExpr(ast, expr, ast->lhs.elems[right]);
+				}
+				else {
+					/* 0-x -> -x */
+					ast->types.elems[expr] = EXPR_NEG;
+					ast->lhs.elems[expr] = right;
+					ast->rhs.elems[expr] = AST_NONE;
+				}
+			}
+			else if(isPure(ast, left) && sameExpr(ast, left, right)) {
+				/* x-x -> 0 */
+				setNumber(ast, expr, 0);
+			}
+			break;
+		
+		case EXPR_MUL:
+			if(isNumber(ast, right, 1)) {
+				/* x*1 -> x */
+				replaceExpr(ast, expr, left);
+			}
+			else if(isNumber(ast, left, 1)) {
+				/* 1*x -> x */
+				replaceExpr(ast, expr, right);
+			}
+			else if((isNumber(ast, right, 0) && isPure(ast, left)) || (isNumber(ast, left, 0) && isPure(ast, right))) {
+				/* x*0 -> 0 */
+				setNumber(ast, expr, 0);
+			}
+			break;
+		
+		case EXPR_DIV:
+			if(isNumber(ast, right, 1)) {
+				/* x/1 -> x */
+				replaceExpr(ast, expr, left);
+			}
+			break;
+		
+		case EXPR_MOD:
+			if(isNumber(ast, right, 1) && isPure(ast, left)) {
+				/* x%1 -> 0 */
+				setNumber(ast, expr, 0);
+			}
+			break;
+		
+		default:
+			break;
+	}
+}
+
+static void foldParamList(AST* ast, SymbolArray* called, uint32_t param_list, size_t line) {
+	uint32_t count = AST_listCount(ast, param_list);
+	for(uint32_t i = 0; i < count; i++) {
+		foldExpr(ast, called, AST_listItem(ast, param_list, i), line);
+	}
+}
+
+static void markCalled(SymbolArray* called, Symbol* sym) {
+	if(sym == NULL || sym->type != SYM_PROC) {
+		return;
+	}
+	
+	foreach(called, pcur) {
+		if(*pcur == sym) {
+			return;
+		}
+	}
+	
+	array_append(called, sym);
+}
+
+static bool evaluate(EXPR_TYPE type, Word left, Word right, Word* result) {
+	/* Arithmetic is done on unsigned values so that overflow wraps around like it does in the VM */
+	switch(type) {
+		case EXPR_ADD:
+			*result = (Word)((uint32_t)left + (uint32_t)right);
+			return true;
+		
+		case EXPR_SUB:
+			*result = (Word)((uint32_t)left - (uint32_t)right);
+			return true;
+		
+		case EXPR_MUL:
+			*result = (Word)((uint32_t)left * (uint32_t)right);
+			return true;
+		
+		case EXPR_DIV:
+			if(right == 0 || (left == WORD_MIN && right == -1)) {
+				return false;
+			}
+			*result = left / right;
+			return true;
+		
+		case EXPR_MOD:
+			if(right == 0 || (left == WORD_MIN && right == -1)) {
+				return false;
+			}
+			*result = left % right;
+			return true;
+		
+		default:
+			ASSERT(!"Unknown expression type");
+	}
+}
+
+static void checkDivision(EXPR_TYPE type, bool constant_left, Word left, Word right, size_t line) {
+	const char* reason;
+	if(right == 0) {
+		reason = "by zero";
+	}
+	else if(constant_left && left == WORD_MIN && right == -1) {
+		reason = "WORD_MIN by -1";
+	}
+	else {
+		return;
+	}
+	
+	/* Worded like the runtime error that the VM reports */
+	const char* verb = type == EXPR_DIV ? "divide" : "mod";
+	if(line != 0) {
+		printf("Warning on line %zu: This will try to %s %s when it runs\n", line, verb, reason);
+	}
+	else {
+		printf("Warning: This will try to %s %s when it runs\n", verb, reason);
+	}
+}
+
+static bool compare(COND_TYPE type, Word left, Word right) {
+	switch(type) {
+		case COND_EQ: return left == right;
+		case COND_NE: return left != right;
+		case COND_LT: return left < right;
+		case COND_LE: return left <= right;
+		case COND_GT: return left > right;
+		case COND_GE: return left >= right;
+		
+		default:
+			ASSERT(!"Unknown condition type");
+	}
+}
+
+static void setNumber(AST* ast, AST_Node expr, Word value) {
+	/* The operands are left behind unused */
+	ast->types.elems[expr] = EXPR_NUM;
+	ast->lhs.elems[expr] = (uint32_t)value;
+	ast->rhs.elems[expr] = AST_NONE;
+}
+
+static void replaceExpr(AST* ast, AST_Node expr, AST_Node with) {
+	/* Nothing else refers to the operand, so its node can just be copied over the expression */
+	ast->types.elems[expr] = ast->types.elems[with];
+	ast->lhs.elems[expr] = ast->lhs.elems[with];
+	ast->rhs.elems[expr] = ast->rhs.elems[with];
+}
+
+static bool isNumber(const AST* ast, AST_Node expr, Word value) {
+	return ast->types.elems[expr] == EXPR_NUM && (Word)ast->lhs.elems[expr] == value;
+}
+
+static bool isPure(const AST* ast, AST_Node expr) {
+	switch(ast->types.elems[expr]) {
+		case EXPR_VAR:
+		case EXPR_NUM:
+			return true;
+		
+		case EXPR_NEG:
+			return isPure(ast, ast->lhs.elems[expr]);
+		
+		case EXPR_ADD:
+		case EXPR_SUB:
+		case EXPR_MUL:
+			return isPure(ast, ast->lhs.elems[expr]) && isPure(ast, ast->rhs.elems[expr]);
+		
+		case EXPR_DIV:
+		case EXPR_MOD: {
+			/* Only a known divisor other than 0 and -1 can't fail */
+			AST_Node right = ast->rhs.elems[expr];
+			return ast->types.elems[right] == EXPR_NUM && !isNumber(ast, right, 0) && !isNumber(ast, right, -1)
+				&& isPure(ast, ast->lhs.elems[expr]);
+		}
+		
+		default:
+			return false;
+	}
+}
+
+static bool sameExpr(const AST* ast, AST_Node a, AST_Node b) {
+	if(ast->types.elems[a] != ast->types.elems[b]) {
+		return false;
+	}
+	
+	switch(ast->types.elems[a]) {
+		case EXPR_VAR: {
+			Symbol* sym = AST_symbol(ast, ast->lhs.elems[a]);
+			return sym != NULL && sym == AST_symbol(ast, ast->lhs.elems[b]);
+		}
+		
+		case EXPR_NUM:
+			return ast->lhs.elems[a] == ast->lhs.elems[b];
+		
+		case EXPR_NEG:
+			return sameExpr(ast, ast->lhs.elems[a], ast->lhs.elems[b]);
+		
+		case EXPR_ADD:
+		case EXPR_SUB:
+		case EXPR_MUL:
+		case EXPR_DIV:
+		case EXPR_MOD:
+			return sameExpr(ast, ast->lhs.elems[a], ast->lhs.elems[b])
+				&& sameExpr(ast, ast->rhs.elems[a], ast->rhs.elems[b]);
+		
+		default:
+			return false;
+	}
+}
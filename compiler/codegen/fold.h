@@ -0,0 +1,35 @@
+//
+//  fold.h
+//  PL/0
+//
+
+#ifndef PL0_FOLD_H
+#define PL0_FOLD_H
+
+#include <stdbool.h>
+#include "config.h"
+#include "compiler/ast_nodes.h"
+
+
+/*! Fold constant expressions and simplify arithmetic identities throughout a program, rewriting
+ its AST in place. Constants are replaced by their values, operators on numbers are evaluated,
+ and identities such as x+0, x*1, x*0, x-x, and -(-x) are simplified whenever that doesn't skip
+ a call or an operation that could fail at runtime. A division that the VM would reject, like
+ dividing by zero, is left as it is so the VM reports it if it runs, and a warning is printed for
+ it. Only code that might run is folded, so branches that a constant condition skips and
+ procedures that aren't called from such code are left alone, and they don't get any warnings.
+ Must be run after the binding pass.
+ @param prog AST of the whole program
+ */
+void fold_program(AST* prog);
+
+/*! Check whether a condition of a folded program always has the same result
+ @param ast AST of a program that has already been folded
+ @param condition Condition node from that program
+ @param value Set to the result of the condition if it is constant
+ @return True if the condition is constant
+ */
+bool fold_condition(const AST* ast, AST_Node condition, bool* value);
+
+
+#endif /* PL0_FOLD_H */
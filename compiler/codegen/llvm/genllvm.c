@@ -14,14 +14,14 @@
 #define ENUM_TO_BIT(val) (1 << ((val) - 1))
 typedef uint32_t STMT_TYPE_MASK;
 
-typedef int stmt_callback(AST_Stmt* stmt, void* cookie);
+typedef int stmt_callback(const AST* ast, AST_Node stmt, void* cookie);
 
 static LLVMTypeRef getWordTy(void);
-static int foreachStmt(AST_Stmt* stmt, STMT_TYPE_MASK filter_types, stmt_callback* stmt_cb, void* cookie);
-static int checkAssignsToReturn(AST_Stmt* stmt, void* cookie);
-static bool genProg(AST_Block* prog, LLVMModuleRef* pModule);
-static bool genProc(SymTree* scope, LLVMModuleRef module, AST_Proc* proc);
-static bool genStmt(SymTree* scope, LLVMBuilderRef builder, AST_Stmt* stmt);
+static int foreachStmt(const AST* ast, AST_Node stmt, STMT_TYPE_MASK filter_types, stmt_callback* stmt_cb, void* cookie);
+static int checkAssignsToReturn(const AST* ast, AST_Node stmt, void* cookie);
+static bool genProg(AST* prog, LLVMModuleRef* pModule);
+static bool genProc(SymTree* scope, LLVMModuleRef module, const AST* ast, AST_Proc* proc);
+static bool genStmt(SymTree* scope, LLVMBuilderRef builder, const AST* ast, AST_Node stmt);
 
 
 Destroyer(GenLLVM) {
@@ -30,10 +30,10 @@ Destroyer(GenLLVM) {
 DEF(GenLLVM);
 
 
-GenLLVM* GenLLVM_initWithAST(GenLLVM* self, AST_Block* prog) {
+GenLLVM* GenLLVM_initWithAST(GenLLVM* self, AST* prog) {
 	if((self = GenLLVM_init(self))) {
 		/* Build the symbol tree */
-		SymTree* scope = SymTree_initWithAST(SymTree_alloc(), NULL, prog, 0);
+		SymTree* scope = SymTree_initWithAST(SymTree_alloc(), NULL, prog, (AST_Range){0}, prog->program, 0);
 		if(scope == NULL) {
 			/* Codegen error occurred, so destroy self and return NULL */
 			release(&self);
@@ -80,24 +80,27 @@ static LLVMTypeRef getWordTy(void) {
 	return LLVMInt32Type();
 }
 
-static bool genProg(AST_Block* prog, LLVMModuleRef* pModule) {
+static bool genProg(AST* prog, LLVMModuleRef* pModule) {
 	*pModule = LLVMModuleCreateWithName("pl0");
 	LLVMTypeRef wordType = getWordTy();
+	AST_Block* block = &prog->blocks.elems[prog->program];
 	
 	/* Generate constants */
-	foreach(&prog->consts->consts, pconst) {
-		LLVMValueRef constValue = LLVMConstInt(wordType, pconst->value, true);
+	for(uint32_t i = 0; i < block->consts.count; i++) {
+		Word value = (Word)prog->extra.elems[block->consts.start + 2 * i + 1];
+		LLVMValueRef constValue = LLVMConstInt(wordType, value, true);
 		
 	}
 	
 	/* Generate global variables */
-	foreach(&prog->vars->vars, pvar) {
-		LLVMAddGlobal(*pModule, wordType, *pvar);
+	for(uint32_t i = 0; i < block->vars.count; i++) {
+		LLVMAddGlobal(*pModule, wordType, AST_ident(prog, block->vars.start + i));
 	}
 	
 	/* Generate procedures */
-	foreach(&prog->procs->procs, pproc) {
-		if(!genProc(*pModule, *pproc) {
+	uint32_t count = AST_procCount(prog, prog->program);
+	for(uint32_t i = 0; i < count; i++) {
+		if(!genProc(*pModule, prog, &prog->procs.elems[AST_procAt(prog, prog->program, i)]) {
 			return false;
 		}
 	}
@@ -106,25 +109,28 @@ static bool genProg(AST_Block* prog, LLVMModuleRef* pModule) {
 	
 }
 
-static int foreachStmt(AST_Stmt* stmt, STMT_TYPE_MASK filter_types, stmt_callback* stmt_cb, void* cookie) {
+static int foreachStmt(const AST* ast, AST_Node stmt, STMT_TYPE_MASK filter_types, stmt_callback* stmt_cb, void* cookie) {
 	int ret = 0;
-	if(stmt == NULL) {
+	if(stmt == AST_NONE) {
 		return ret;
 	}
 	
 	/* Is this statment type one that the caller is interested in? */
-	if(filter_types & ENUM_TO_BIT(stmt->type)) {
-		ret = stmt_cb(stmt, cookie);
+	uint32_t lhs = ast->lhs.elems[stmt];
+	uint32_t rhs = ast->rhs.elems[stmt];
+	if(filter_types & ENUM_TO_BIT(ast->types.elems[stmt])) {
+		ret = stmt_cb(ast, stmt, cookie);
 		if(ret != 0) {
 			return ret;
 		}
 	}
 	
-	switch(stmt->type) {
+	switch(ast->types.elems[stmt]) {
 		case STMT_BEGIN: {
 			/* Recurse for each statement in the list */
-			foreach(&stmt->stmt.begin.stmts, pstmt) {
-				ret = foreachStmt(*pstmt, filter_types, stmt_cb, cookie);
+			uint32_t count = AST_listCount(ast, lhs);
+			for(uint32_t i = 0; i < count; i++) {
+				ret = foreachStmt(ast, AST_listItem(ast, lhs, i), filter_types, stmt_cb, cookie);
 				if(ret != 0) {
 					return ret;
 				}
@@ -134,11 +140,11 @@ static int foreachStmt(AST_Stmt* stmt, STMT_TYPE_MASK filter_types, stmt_callbac
 			
 		case STMT_IF:
 			/* Recurse for the then and else branches */
-			ret = foreachStmt(stmt->stmt.if_stmt.then_stmt, filter_types, stmt_cb, cookie);
+			ret = foreachStmt(ast, ast->extra.elems[rhs], filter_types, stmt_cb, cookie);
 			if(ret != 0) {
 				return ret;
 			}
-			ret = foreachStmt(stmt->stmt.if_stmt.else_stmt, filter_types, stmt_cb, cookie);
+			ret = foreachStmt(ast, ast->extra.elems[rhs + 1], filter_types, stmt_cb, cookie);
 			if(ret != 0) {
 				return ret;
 			}
@@ -146,7 +152,7 @@ static int foreachStmt(AST_Stmt* stmt, STMT_TYPE_MASK filter_types, stmt_callbac
 			
 		case STMT_WHILE:
 			/* Recurse for the loop body */
-			ret = foreachStmt(stmt->stmt.while_stmt.do_stmt, filter_types, stmt_cb, cookie);
+			ret = foreachStmt(ast, rhs, filter_types, stmt_cb, cookie);
 			if(ret != 0) {
 				return ret;
 			}
@@ -160,24 +166,25 @@ static int foreachStmt(AST_Stmt* stmt, STMT_TYPE_MASK filter_types, stmt_callbac
 	return ret;
 }
 
-static int checkAssignsToReturn(AST_Stmt* stmt, void* cookie) {
+static int checkAssignsToReturn(const AST* ast, AST_Node stmt, void* cookie) {
 	bool* doesReturn = cookie;
-	ASSERT(stmt->type == STMT_ASSIGN);
+	ASSERT(ast->types.elems[stmt] == STMT_ASSIGN);
 	
-	if(strcmp(stmt->stmt.assign.ident, "assign") == 0) {
+	if(strcmp(AST_ident(ast, ast->lhs.elems[stmt]), "assign") == 0) {
 		*doesReturn = true;
 		return 1;
 	}
 }
 
-static bool genProc(LLVMModuleRef module, AST_Proc* proc) {
+static bool genProc(LLVMModuleRef module, const AST* ast, AST_Proc* proc) {
 	/* Find the return type (which right now is either Word or void) */
 	bool doesReturn = false;
-	foreachStmt(proc->body->stmt, ENUM_TO_BIT(STMT_ASSIGN), checkAssignsToReturn, &doesReturn);
+	AST_Node body = ast->blocks.elems[proc->body].stmt;
+	foreachStmt(ast, body, ENUM_TO_BIT(STMT_ASSIGN), checkAssignsToReturn, &doesReturn);
 	LLVMTypeRef returnType = doesReturn ? getWordTy() : LLVMVoidType();
 	
 	/* Build the parameter type list */
-	unsigned paramCount = (unsigned)proc->param_decls->params.count;
+	unsigned paramCount = (unsigned)proc->params.count;
 	LLVMTypeRef paramTypes[paramCount];
 	unsigned i;
 	for(i = 0; i < paramCount; i++) {
@@ -188,7 +195,7 @@ static bool genProc(LLVMModuleRef module, AST_Proc* proc) {
 	LLVMTypeRef procType = LLVMFunctionType(returnType, paramTypes, paramCount, false);
 	
 	/* Create and add the function for this procedure to the module */
-	LLVMValueRef procValue = LLVMAddFunction(module, proc->ident, procType);
+	LLVMValueRef procValue = LLVMAddFunction(module, AST_ident(ast, proc->ident), procType);
 	
 	/* Generate entrypoint to this procedure */
 	LLVMBasicBlockRef entrypoint = LLVMAppendBasicBlock(procValue, "entry");
@@ -199,15 +206,15 @@ static bool genProc(LLVMModuleRef module, AST_Proc* proc) {
 	
 	//TODO
 	
-	if(!genStmt(builder, proc->body->stmt)) {
+	if(!genStmt(builder, ast, body)) {
 		return false;
 	}
 	
 	//TODO
 }
 
-static bool genStmt(LLVMBuilderRef builder, AST_Stmt* stmt) {
-	switch(stmt->type) {
+static bool genStmt(LLVMBuilderRef builder, const AST* ast, AST_Node stmt) {
+	switch(ast->types.elems[stmt]) {
 		case STMT_ASSIGN:
 			//TODO
 			/* Generate code to evaluate the expression */
@@ -224,10 +231,11 @@ static bool genStmt(LLVMBuilderRef builder, AST_Stmt* stmt) {
 			return genCall(scope, code, statement->stmt.call.ident, statement->stmt.call.param_list);
 			
 		case STMT_BEGIN: {
-			size_t i;
-			for(i = 0; i < stmt->stmt.begin.stmt_count; i++) {
+			uint32_t list = ast->lhs.elems[stmt];
+			uint32_t count = AST_listCount(ast, list);
+			for(uint32_t i = 0; i < count; i++) {
 				/* Generate the code for each statement */
-				if(!genStmt(builder, stmt->stmt.begin.stmts[i])) {
+				if(!genStmt(builder, ast, AST_listItem(ast, list, i))) {
 					return false;
 				}
 			}
@@ -343,24 +351,24 @@ static bool genStmt(LLVMBuilderRef builder, AST_Stmt* stmt) {
 }
 
 
-static bool genExpr(LLVMBuilderRef builder, AST_Expr* expr, LLVMValueRef* pResult) {
+static bool genExpr(LLVMBuilderRef builder, const AST* ast, AST_Node expr, LLVMValueRef* pResult) {
 	/* Used for binary operations */
 	LLVMOpcode opType;
 	
-	switch(expr->type) {
+	switch(ast->types.elems[expr]) {
 		case EXPR_VAR:
 			//TODO
 			return genLoadIdent(scope, code, expression->values.ident);
 			
 		case EXPR_NUM:
-			*pResult = LLVMConstInt(getWordTy(), expr->values.num, true);
+			*pResult = LLVMConstInt(getWordTy(), (Word)ast->lhs.elems[expr], true);
 			return true;
 			
 		case EXPR_NEG: {
 			LLVMValueRef val;
 			
 			/* Evaluate inner expression */
-			if(!genExpr(builder, expr->values.operand, &val)) {
+			if(!genExpr(builder, ast, ast->lhs.elems[expr], &val)) {
 				return false;
 			}
 			
@@ -393,12 +401,12 @@ static bool genExpr(LLVMBuilderRef builder, AST_Expr* expr, LLVMValueRef* pResul
 	LLVMValueRef left, right;
 	
 	/* Generate left expression value */
-	if(!genExpr(builder, expr->values.binop.left, &left)) {
+	if(!genExpr(builder, ast, ast->lhs.elems[expr], &left)) {
 		return false;
 	}
 	
 	/* Generate right expression value */
-	if(!genExpr(builder, expr->values.binop.right, &right)) {
+	if(!genExpr(builder, ast, ast->rhs.elems[expr], &right)) {
 		return false;
 	}
 	
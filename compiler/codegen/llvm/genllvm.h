@@ -25,9 +25,9 @@ struct GenLLVM {
 DECL(GenLLVM);
 
 /*! Initialize the LLVM code generator using the program's full AST
- @param prog AST for the top-level block
+ @param prog AST of the whole program
  */
-GenLLVM* GenLLVM_initWithAST(GenLLVM* self, AST_Block* prog);
+GenLLVM* GenLLVM_initWithAST(GenLLVM* self, AST* prog);
 
 /*! Draw a code flow graph and write the Graphviz code to a file
  @param fp Output file where the Graphviz code should be written
@@ -7,14 +7,22 @@
 //
 
 #include "basicblock.h"
+#include <stdlib.h>
 #include "gvnode.h"
+#include "peephole.h"
 
 
 static void BasicBlock_invalidateTail(BasicBlock* self);
-static void BasicBlock_removeInsn(BasicBlock* self, size_t index);
+static void BasicBlock_dropXref(BasicBlock* self, BasicBlock* from);
+static void BasicBlock_removeCondition(BasicBlock* self);
 static void BasicBlock_genTail(BasicBlock* self, uint16_t level);
+static BasicBlock* BasicBlock_findReturn(BasicBlock* self);
+static Word BasicBlock_getReturnAddress(BasicBlock* self);
 static void BasicBlock_tailCallOptimize(BasicBlock* self, Block* scope);
+static bool BasicBlock_usesReturn(Block* proc, bool stores);
 static void BasicBlock_appendLine(char** label, const char* line);
+static void BasicBlock_markReachable(BasicBlock* self);
+static int compareEdits(const void* a, const void* b);
 
 
 Destroyer(BasicBlock) {
@@ -26,6 +34,7 @@ Destroyer(BasicBlock) {
 
 DEF_CUSTOM(BasicBlock) {
 	self->code_addr = ADDR_UND;
+	self->index = BB_NONE;
 	return self;
 }
 
@@ -38,7 +47,7 @@ BasicBlock* BasicBlock_createNext(BasicBlock** bb) {
 	
 	/* Invalidate tail index */
 	BasicBlock_invalidateTail(*bb);
-	
+
 #if DEBUG
 	foreach(&(*bb)->insns, pinsn) {
 		ASSERT(pinsn->op != OP_BREAK);
@@ -61,6 +70,16 @@ void BasicBlock_markSymbol(BasicBlock* self, Symbol* sym) {
 	array_append(&self->symrefs, symref);
 }
 
+Symbol* BasicBlock_findSymbol(BasicBlock* self, size_t index) {
+	foreach(&self->symrefs, symref) {
+		if(symref->index == index) {
+			return symref->sym;
+		}
+	}
+	
+	return NULL;
+}
+
 static void BasicBlock_invalidateTail(BasicBlock* self) {
 	/* If this basic block doesn't have a tail, there's nothing to do */
 	if(!(self->flags & BB_HAS_TAIL)) {
@@ -93,13 +112,17 @@ bool BasicBlock_isEmptyProc(BasicBlock* self) {
 }
 
 void BasicBlock_setTarget(BasicBlock* self, BasicBlock* target) {
-	/* Remove the reference to the previous target */
-	BasicBlock_removeXref(self->target, self);
-	
-	/* Let the new target know that we're now referencing it */
+	/* Let the new target know that we're now referencing it. This comes first, because removing
+	 the last reference to the previous target frees it, which could also drop the last reference
+	 to the new target when that's where the previous target went.
+	 */
+	BasicBlock* old_target = self->target;
 	self->target = target;
 	BasicBlock_addXref(target, self);
 	
+	/* Remove the reference to the previous target */
+	BasicBlock_removeXref(old_target, self);
+	
 	/* Invalidate tail */
 	BasicBlock_invalidateTail(self);
 }
@@ -107,13 +130,14 @@ void BasicBlock_setTarget(BasicBlock* self, BasicBlock* target) {
 void BasicBlock_setFalseTarget(BasicBlock* self, BasicBlock* false_target) {
 	self->flags |= BB_HAS_CONDITION;
 	
-	/* Remove the reference to the previous target */
-	BasicBlock_removeXref(self->ztarget, self);
-	
-	/* Let the new target know that we're now referencing it */
+	/* Let the new target know that we're now referencing it before removing the previous one */
+	BasicBlock* old_target = self->ztarget;
 	self->ztarget = false_target;
 	BasicBlock_addXref(false_target, self);
 	
+	/* Remove the reference to the previous target */
+	BasicBlock_removeXref(old_target, self);
+	
 	/* Invalidate tail */
 	BasicBlock_invalidateTail(self);
 }
@@ -127,11 +151,7 @@ void BasicBlock_addXref(BasicBlock* self, BasicBlock* from) {
 	array_append(&self->coderefs, from);
 }
 
-void BasicBlock_removeXref(BasicBlock* self, BasicBlock* from) {
-	if(self == NULL) {
-		return;
-	}
-	
+static void BasicBlock_dropXref(BasicBlock* self, BasicBlock* from) {
 	/* Number of xrefs will almost always be small, so O(n) is fine */
 	foreach(&self->coderefs, pxref) {
 		if(*pxref == from) {
@@ -140,6 +160,14 @@ void BasicBlock_removeXref(BasicBlock* self, BasicBlock* from) {
 			break;
 		}
 	}
+}
+
+void BasicBlock_removeXref(BasicBlock* self, BasicBlock* from) {
+	if(self == NULL) {
+		return;
+	}
+	
+	BasicBlock_dropXref(self, from);
 	
 	/* No xrefs and not the first basic block means this can be removed */
 	if(self->prev != NULL && self->coderefs.count == 0) {
@@ -193,7 +221,7 @@ void BasicBlock_resolve(BasicBlock* self, Block* scope) {
 				pinsn->lvl = scope->symtree->level - sym->level;
 				pinsn->imm = sym->value.frame_offset;
 				break;
-				
+			
 			case SYM_PROC: {
 				/* Find the address of the procedure being called */
 				Block* blk = sym->value.procedure.body;
@@ -220,7 +248,37 @@ void BasicBlock_resolve(BasicBlock* self, Block* scope) {
 	}
 }
 
-static void BasicBlock_removeInsn(BasicBlock* self, size_t index) {
+void BasicBlock_replaceInsn(BasicBlock* self, size_t index, Insn insn) {
+	self->insns.elems[index] = insn;
+	
+	/* The new instruction is already resolved, so forget any symbol the old one referenced */
+	enumerate(&self->symrefs, i, symref) {
+		if(symref->index == index) {
+			array_removeIndex(&self->symrefs, i--);
+		}
+	}
+}
+
+void BasicBlock_insertInsn(BasicBlock* self, size_t index, Insn insn) {
+	array_insert(&self->insns, index, &insn);
+	
+	/* Every instruction from the insertion point onward moved back by one */
+	foreach(&self->symrefs, symref) {
+		if(symref->index >= index) {
+			++symref->index;
+		}
+	}
+	
+	if(self->cond_index >= index) {
+		++self->cond_index;
+	}
+	
+	if(self->tail_index >= index) {
+		++self->tail_index;
+	}
+}
+
+void BasicBlock_removeInsn(BasicBlock* self, size_t index) {
 	/* Remove the instruction from the instructions array */
 	array_removeIndex(&self->insns, index);
 	
@@ -247,7 +305,60 @@ static void BasicBlock_removeInsn(BasicBlock* self, size_t index) {
 	}
 }
 
-void BasicBlock_optimize(BasicBlock* self, Block* scope) {
+void BasicBlock_applyEdits(BasicBlock* self, BBEditArray* edits) {
+	if(edits->count > 1) {
+		qsort(edits->elems, edits->count, sizeof(*edits->elems), &compareEdits);
+	}
+	
+	foreach(edits, edit) {
+		ASSERT(edit->start <= edit->end && edit->count <= BB_EDIT_MAX_INSNS);
+		
+		/* Overwrite the run where it can be, then insert or remove whatever is left over */
+		size_t length = edit->end - edit->start;
+		for(size_t i = 0; i < edit->count; i++) {
+			if(i < length) {
+				BasicBlock_replaceInsn(self, edit->start + i, edit->insns[i]);
+			}
+			else {
+				BasicBlock_insertInsn(self, edit->start + i, edit->insns[i]);
+			}
+		}
+		for(size_t i = edit->count; i < length; i++) {
+			BasicBlock_removeInsn(self, edit->start + edit->count);
+		}
+		
+		/* The symbol is resolved later like any other, and symbol references stay in code order */
+		if(edit->sym != NULL) {
+			ASSERT(edit->count != 0);
+			size_t pos = 0;
+			while(pos < self->symrefs.count && self->symrefs.elems[pos].index < edit->start) {
+				++pos;
+			}
+			
+			element_type(self->symrefs) symref = {edit->sym, edit->start};
+			array_insert(&self->symrefs, pos, &symref);
+		}
+	}
+}
+
+StackValue StackValue_combine(const StackValue* operands, size_t count, size_t index) {
+	StackValue result = {BB_NONE, BB_NONE, index + 1, 1};
+	bool adjacent = true;
+	for(size_t i = 0; i < count; i++) {
+		size_t next = i + 1 < count ? operands[i + 1].start : index;
+		if(operands[i].start == BB_NONE || operands[i].end != next) {
+			adjacent = false;
+		}
+		result.weight += operands[i].weight;
+	}
+	
+	if(count != 0 && adjacent) {
+		result.start = operands[0].start;
+	}
+	return result;
+}
+
+void BasicBlock_optimize(BasicBlock* self, Block* scope, size_t* code_budget) {
 	/* Need to rebuild the tail after any optimizations */
 	BasicBlock_invalidateTail(self);
 	
@@ -257,11 +368,21 @@ void BasicBlock_optimize(BasicBlock* self, Block* scope) {
 			Block* blk = symref->sym->value.procedure.body;
 			
 			/* Optimize the procedure */
-			Block_optimize(blk);
+			Block_optimize(blk, code_budget);
 			
 			/* Is the call even required any more? */
 			if(Block_isEmpty(blk)) {
-				BasicBlock_removeInsn(self, symref->index);
+				/* A call used as a value still has to produce the zero that CAL would have returned */
+				size_t index = symref->index;
+				Insn inc1 = MAKE_INC(1);
+				if(index + 1 < self->insns.count
+				   && memcmp(&self->insns.elems[index + 1], &inc1, sizeof(inc1)) == 0) {
+					BasicBlock_replaceInsn(self, index, MAKE_LIT(0));
+					BasicBlock_removeInsn(self, index + 1);
+				}
+				else {
+					BasicBlock_removeInsn(self, index);
+				}
 				--i;
 			}
 		}
@@ -278,24 +399,128 @@ void BasicBlock_optimize(BasicBlock* self, Block* scope) {
 			BasicBlock_setFalseTarget(self, self->ztarget->target);
 		}
 		
-#if 0
 		/* Is the condition even required any more? */
 		if(self->target == self->ztarget) {
-			/* Both branches have the same target, so remove the condition code */
-			BasicBlock_setFalseTarget(self, NULL);
-			self->conditional = false;
-			
-			/* Keep chopping off the condition one instruction at a time until there's nothing left */
-			while(self->insn_count > self->cond_index) {
-				BasicBlock_removeInsn(self, self->insn_count - 1);
-			}
-			self->cond_index = -1;
+			BasicBlock_removeCondition(self);
 		}
-#endif
 	}
 	
 	/* Try to perform tail call optimization */
 	BasicBlock_tailCallOptimize(self, scope);
+	
+	/* Clean up instruction sequences that do nothing. This is done after tail call optimization,
+	 which looks for the exact INC instruction that it generates
+	 */
+	peephole_optimize(self);
+}
+
+static void BasicBlock_removeCondition(BasicBlock* self) {
+	/* Both branches have the same target, so this basic block doesn't need to branch at all */
+	BasicBlock_removeXref(self->ztarget, self);
+	self->ztarget = NULL;
+	self->flags &= ~BB_HAS_CONDITION;
+	
+	/* The condition code can only be dropped if it doesn't call anything, possibly fail, or have any
+	 other side effects, which an inlined procedure can have
+	 */
+	bool pure = true;
+	for(size_t i = self->cond_index; i < self->insns.count; i++) {
+		Insn insn = self->insns.elems[i];
+		if(insn.op == OP_CAL || insn.op == OP_STO || insn.op == OP_SIO
+		   || (insn.op == OP_OPR && (insn.imm == ALU_DIV || insn.imm == ALU_MOD))) {
+			pure = false;
+			break;
+		}
+	}
+	
+	if(pure) {
+		/* Keep chopping off the condition one instruction at a time until there's nothing left */
+		while(self->insns.count > self->cond_index) {
+			BasicBlock_removeInsn(self, self->insns.count - 1);
+		}
+	}
+	else {
+		/* Still evaluate the condition, but pop its result because no JPC will */
+		BasicBlock_addInsn(self, MAKE_INC(-1));
+	}
+}
+
+static void BasicBlock_markReachable(BasicBlock* self) {
+	ASSERT(self->prev == NULL);
+	
+	/* Mark every basic block that can be reached from the start of the procedure */
+	BBArray worklist = {0};
+	self->flags |= BB_REACHABLE;
+	array_append(&worklist, self);
+	while(worklist.count != 0) {
+		BasicBlock* cur = worklist.elems[--worklist.count];
+		BasicBlock* targets[2] = {cur->target, (cur->flags & BB_HAS_CONDITION) ? cur->ztarget : NULL};
+		for(size_t i = 0; i < 2; i++) {
+			if(targets[i] != NULL && !(targets[i]->flags & BB_REACHABLE)) {
+				targets[i]->flags |= BB_REACHABLE;
+				array_append(&worklist, targets[i]);
+			}
+		}
+	}
+	array_clear(&worklist);
+}
+
+void BasicBlock_findReachable(BasicBlock* self, BBArray* blocks) {
+	BasicBlock_markReachable(self);
+	
+	/* Collect them in code order, which puts the entry first */
+	ASSERT(blocks->count == 0);
+	for(BasicBlock* cur = self; cur != NULL; cur = cur->next) {
+		if(cur->flags & BB_REACHABLE) {
+			cur->flags &= ~BB_REACHABLE;
+			cur->index = blocks->count;
+			array_append(blocks, cur);
+		}
+		else {
+			cur->index = BB_NONE;
+		}
+	}
+}
+
+void BasicBlock_removeUnreachable(BasicBlock* self) {
+	BasicBlock_markReachable(self);
+	
+	/* Unhook the branches out of unreachable basic blocks first. Otherwise, removing the last
+	 reference to one of them would free it while it's still in the list being walked below.
+	 */
+	for(BasicBlock* cur = self; cur != NULL; cur = cur->next) {
+		if(!(cur->flags & BB_REACHABLE)) {
+			if(cur->target != NULL) {
+				BasicBlock_dropXref(cur->target, cur);
+				cur->target = NULL;
+			}
+			if(cur->ztarget != NULL) {
+				BasicBlock_dropXref(cur->ztarget, cur);
+				cur->ztarget = NULL;
+			}
+		}
+	}
+	
+	/* Now the unreachable basic blocks can be unlinked and freed one at a time */
+	BasicBlock* cur = self;
+	while(cur != NULL) {
+		BasicBlock* next = cur->next;
+		if(cur->flags & BB_REACHABLE) {
+			cur->flags &= ~BB_REACHABLE;
+		}
+		else {
+			/* Skip over this node in the doubly linked list */
+			cur->prev->next = next;
+			if(next != NULL) {
+				next->prev = cur->prev;
+			}
+			
+			/* Make sure not to release more basic blocks than this one */
+			cur->next = NULL;
+			release(&cur);
+		}
+		cur = next;
+	}
 }
 
 #define ADD_INSN(insn) array_append(&self->insns, insn)
@@ -319,43 +544,45 @@ static void BasicBlock_genTail(BasicBlock* self, uint16_t level) {
 		Insn last = self->insns.elems[self->tail_index - 1];
 		
 		/* Conditionally execute either target or ztarget */
+		/* Another basic block of this procedure that returns can be the target of a conditional return */
+		BasicBlock* ret_bb = BasicBlock_findReturn(self);
+		
 		if(self->target == NULL) {
 			/* Case 1: True branch is a RET */
-#if FIXME
-			if(self->ztarget == self->next) {
+			if(ret_bb != NULL && self->ztarget == self->next && last.imm != ALU_ODD) {
 				/* Case 1a: Produce a jmp-true to a RET */
+				self->flags |= BB_INVERT_CONDITION;
+				ADD_INSN(MAKE_JPC(BasicBlock_getReturnAddress(ret_bb)));
 			}
-			else /* ztarget != next */ {
-#endif
+			else {
 				/* Case 1b: Produce a jmp-false to ztarget, then add RET */
 				ADD_INSN(MAKE_JPC(self->ztarget->code_addr));
 				ADD_INSN(ret);
-#if FIXME
 			}
-#endif
 		}
 		else if(self->ztarget == NULL) {
 			/* Case 2a: False branch is a RET */
-#if FIXME
-			if(self->target == self->next) {
+			if(ret_bb != NULL) {
 				/* Case 2a.1: Produce a jmp-false to a RET */
-			}
-			else /* target != next */ {
-				/* Case 2a.2: Produce a jmp-false to a RET followed by a JMP to target */
-			}
-#else
-			/* Temporary solution: Produce a jmp-true to target followed by a RET */
-			if(last.imm == ALU_ODD) {
-				/* Invert ODD to EVEN by comparing its result to zero (ODD == 0) */
-				ADD_INSN(MAKE_LIT(0));
-				ADD_INSN(MAKE_EQL());
+				ADD_INSN(MAKE_JPC(BasicBlock_getReturnAddress(ret_bb)));
+				if(self->target != self->next) {
+					/* Case 2a.2: Followed by a JMP to target */
+					ADD_INSN(MAKE_JMP(self->target->code_addr));
+				}
 			}
 			else {
-				self->flags |= BB_INVERT_CONDITION;
+				/* Case 2a.3: Without a RET to jump to, produce a jmp-true to target followed by a RET */
+				if(last.imm == ALU_ODD) {
+					/* Invert ODD to EVEN by comparing its result to zero (ODD == 0) */
+					ADD_INSN(MAKE_LIT(0));
+					ADD_INSN(MAKE_EQL());
+				}
+				else {
+					self->flags |= BB_INVERT_CONDITION;
+				}
+				ADD_INSN(MAKE_JPC(self->target->code_addr));
+				ADD_INSN(ret);
 			}
-			ADD_INSN(MAKE_JPC(self->target->code_addr));
-			ADD_INSN(ret);
-#endif
 		}
 		else /* target != NULL && ztarget != NULL */ {
 			/* Case 2b: Neither branch is a RET */
@@ -397,6 +624,33 @@ static void BasicBlock_genTail(BasicBlock* self, uint16_t level) {
 }
 #undef ADD_INSN
 
+static BasicBlock* BasicBlock_findReturn(BasicBlock* self) {
+	/* Find the first basic block of the procedure */
+	BasicBlock* cur = self;
+	while(cur->prev != NULL) {
+		cur = cur->prev;
+	}
+	
+	/* Its tail is only the RET, so it can't have a condition or have been tail call optimized */
+	for(; cur != NULL; cur = cur->next) {
+		if(cur->target == NULL && !HAS_ANY_FLAGS(cur->flags, BB_HAS_CONDITION | BB_TAIL_CALL_OPTIMIZED)) {
+			return cur;
+		}
+	}
+	
+	return NULL;
+}
+
+static Word BasicBlock_getReturnAddress(BasicBlock* self) {
+	if(self->code_addr == ADDR_UND) {
+		return ADDR_UND;
+	}
+	
+	/* The RET is the first instruction of the tail, whether or not the tail has been built yet */
+	size_t index = (self->flags & BB_HAS_TAIL) ? self->tail_index : self->insns.count;
+	return self->code_addr + (Word)index;
+}
+
 static void BasicBlock_tailCallOptimize(BasicBlock* self, Block* scope) {
 	/* Check whether this basic block has already been tail call optimized */
 	if(self->flags & BB_TAIL_CALL_OPTIMIZED) {
@@ -404,11 +658,12 @@ static void BasicBlock_tailCallOptimize(BasicBlock* self, Block* scope) {
 	}
 	
 	/* Only operate on terminating basic blocks */
-	if(self->insns.count < 1) {
+	if(self->target != NULL || self->insns.count < 1) {
 		return;
 	}
 	
 	bool isTailCall = false;
+	bool storesResult = false;
 	Insn callInsn = MAKE_BREAK(-1);
 	size_t callIndex = 0;
 	
@@ -443,10 +698,23 @@ static void BasicBlock_tailCallOptimize(BasicBlock* self, Block* scope) {
 		Insn thirdFromLastInsn = self->insns.elems[self->insns.count - 3];
 		
 		bool lastInsnIsStoReturn = memcmp(&lastInsn, &stoReturn, sizeof(stoReturn)) == 0;
+		
+		/* Every STO is still "STO 0 0" before symbols are resolved, so check what it stores to */
+		if(lastInsnIsStoReturn) {
+			lastInsnIsStoReturn = false;
+			foreach(&self->symrefs, xref) {
+				if(xref->index == self->insns.count - 1) {
+					Symbol* sym = xref->sym;
+					lastInsnIsStoReturn = sym->type == SYM_VAR && sym->level == scope->symtree->level
+						&& sym->value.frame_offset == 0;
+				}
+			}
+		}
 		bool secondToLastInsnIsInc1 = memcmp(&secondToLastInsn, &inc1, sizeof(inc1)) == 0;
 		bool thirdFromLastInsnIsCall = thirdFromLastInsn.op == OP_CAL;
 		if(lastInsnIsStoReturn && secondToLastInsnIsInc1 && thirdFromLastInsnIsCall) {
 			isTailCall = true;
+			storesResult = true;
 			callInsn = thirdFromLastInsn;
 			callIndex = self->insns.count - 3;
 		}
@@ -508,6 +776,13 @@ static void BasicBlock_tailCallOptimize(BasicBlock* self, Block* scope) {
 		return;
 	}
 	
+	/* The callee runs in this procedure's frame, so it finds this procedure's return value instead of
+	 0 there. Without the store of its result, whatever it returns is also returned from here
+	 */
+	if(BasicBlock_usesReturn(callee->value.procedure.body, !storesResult)) {
+		return;
+	}
+	
 	/* Cannot perform TCO when calling a child procedure */
 	Word callLevel = scope->symtree->level - callee->value.procedure.body->symtree->level;
 	if(callLevel < 0) {
@@ -525,7 +800,8 @@ static void BasicBlock_tailCallOptimize(BasicBlock* self, Block* scope) {
 	/* Trim additional INC -(4 + someProc.paramCount) if exists */
 	Insn incBeforeCall = MAKE_INC(-(4 + paramCount));
 	Word stackOffset = 0;
-	if(memcmp(&self->insns.elems[self->insns.count - 1], &incBeforeCall, sizeof(incBeforeCall)) == 0) {
+	if(self->insns.count != 0
+	   && memcmp(&self->insns.elems[self->insns.count - 1], &incBeforeCall, sizeof(incBeforeCall)) == 0) {
 		BasicBlock_removeInsn(self, self->insns.count - 1);
 		stackOffset = 4 + paramCount;
 	}
@@ -569,7 +845,31 @@ static void BasicBlock_tailCallOptimize(BasicBlock* self, Block* scope) {
 	self->flags |= BB_TAIL_CALL_OPTIMIZED;
 }
 
-void BasicBlock_emit(BasicBlock* self, FILE* fp, uint16_t level) {
+static bool BasicBlock_usesReturn(Block* proc, bool stores) {
+	/* Look for loads of the procedure's return value, and for stores to it if asked */
+	for(BasicBlock* bb = proc->code; bb != NULL; bb = bb->next) {
+		/* A tail call hands the return value to another procedure, which might do either */
+		if(bb->flags & BB_TAIL_CALL_OPTIMIZED) {
+			return true;
+		}
+		
+		foreach(&bb->symrefs, xref) {
+			Symbol* sym = xref->sym;
+			if(sym->type != SYM_VAR || sym->level != proc->symtree->level || sym->value.frame_offset != 0) {
+				continue;
+			}
+			
+			Opcode op = bb->insns.elems[xref->index].op;
+			if(op == OP_LOD || (stores && op == OP_STO)) {
+				return true;
+			}
+		}
+	}
+	
+	return false;
+}
+
+void BasicBlock_emit(BasicBlock* self, InsnArray* code, uint16_t level) {
 	ASSERT(self->code_addr != ADDR_UND);
 	
 	/* Generate the code for the tail of this basic block to handle control flow */
@@ -579,10 +879,52 @@ void BasicBlock_emit(BasicBlock* self, FILE* fp, uint16_t level) {
 	enumerate(&self->insns, i, pinsn) {
 		/* Invert the condition instruction directly before the tail if the flag is set */
 		if(HAS_ALL_FLAGS(self->flags, BB_INVERT_CONDITION | BB_HAS_TAIL) && i == self->tail_index - 1) {
-			Insn_emit(MAKE_INV(*pinsn), fp);
+			array_append(code, MAKE_INV(*pinsn));
 		}
 		else {
-			Insn_emit(*pinsn, fp);
+			array_append(code, *pinsn);
+		}
+	}
+}
+
+void BasicBlock_applyProfile(BasicBlock* self, Profile* profile) {
+	if(self->origin == NULL) {
+		return;
+	}
+	
+	const char* proc = SymTree_getName(self->origin);
+	if(Profile_getBlockCount(profile, proc, self->ordinal, &self->exec_count)) {
+		self->flags |= BB_PROFILED;
+	}
+	Profile_getBranchCounts(profile, proc, self->ordinal, &self->true_count, &self->false_count);
+}
+
+void BasicBlock_writeBlockMap(BasicBlock* self, FILE* fp, uint16_t level) {
+	if(self->origin == NULL) {
+		return;
+	}
+	
+	/* A basic block without any instructions shares its address with the next one */
+	BasicBlock_genTail(self, level);
+	if(self->insns.count == 0) {
+		return;
+	}
+	
+	const char* proc = SymTree_getName(self->origin);
+	fprintf(fp, "block %"PRIdWORD" %s %zu\n", self->code_addr, proc, self->ordinal);
+	if(!(self->flags & BB_HAS_TAIL)) {
+		return;
+	}
+	
+	for(size_t i = self->tail_index; i < self->insns.count; i++) {
+		if(self->insns.elems[i].op == OP_JPC) {
+			/* The JPC jumps when the condition is false, unless the condition was inverted. That's
+			 either done by the flag or by comparing the result of ODD to zero before the JPC
+			 */
+			bool when_true = (self->flags & BB_INVERT_CONDITION) || i != self->tail_index;
+			fprintf(fp, "branch %"PRIdWORD" %s %zu %s\n",
+			        self->code_addr + (Word)i, proc, self->ordinal, when_true ? "true" : "false");
+			break;
 		}
 	}
 }
@@ -700,3 +1042,14 @@ static void BasicBlock_appendLine(char** label, const char* line) {
 	destroy(label);
 	*label = tmp;
 }
+
+static int compareEdits(const void* a, const void* b) {
+	const BBEdit* ea = a;
+	const BBEdit* eb = b;
+	
+	/* Last edit first. At the same index, replace the run before inserting in front of it */
+	if(ea->start != eb->start) {
+		return ea->start > eb->start ? -1 : 1;
+	}
+	return (ea->end < eb->end) - (ea->end > eb->end);
+}
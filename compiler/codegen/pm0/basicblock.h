@@ -9,6 +9,7 @@
 #ifndef PL0_BASICBLOCK_H
 #define PL0_BASICBLOCK_H
 
+#include <stdio.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -19,12 +20,16 @@ const static BBFlags BB_HAS_CONDITION       = 1<<0;
 const static BBFlags BB_HAS_TAIL            = 1<<1;
 const static BBFlags BB_INVERT_CONDITION    = 1<<2;
 const static BBFlags BB_TAIL_CALL_OPTIMIZED = 1<<3;
+const static BBFlags BB_REACHABLE           = 1<<4;
+const static BBFlags BB_PROFILED            = 1<<5;
 
 #include "object.h"
 #include "config.h"
 #include "instruction.h"
 #include "compiler/codegen/symbol.h"
 #include "block.h"
+#include "profile.h"
+#include "compiler/codegen/symtree.h"
 #include "graphviz.h"
 
 struct BasicBlock {
@@ -65,9 +70,58 @@ struct BasicBlock {
 	
 	/*! Flags for this basic block */
 	BBFlags flags;
+	
+	/*! Procedure whose code created this basic block, or NULL if an optimization created it */
+	SymTree* origin;
+	
+	/*! Which basic block of the origin procedure this is, counting in the order they were created */
+	size_t ordinal;
+	
+	/*! Position of this basic block in the array BasicBlock_findReachable last collected it into, or
+	 BB_NONE if it wasn't reachable then
+	 */
+	size_t index;
+	
+	/*! Number of times this basic block ran in the profile, if BB_PROFILED is set */
+	uint64_t exec_count;
+	
+	/*! Number of times the condition at the end of this basic block was true in the profile */
+	uint64_t true_count;
+	
+	/*! Number of times the condition at the end of this basic block was false in the profile */
+	uint64_t false_count;
 };
 DECL(BasicBlock);
 
+/*! Array of basic blocks */
+typedef dynamic_array(BasicBlock*) BBArray;
+
+/*! Marks a missing index, like that of a basic block that isn't reachable or the run of
+ instructions of a value that no single run can be replaced by
+ */
+#define BB_NONE SIZE_MAX
+
+/*! A value on a simulated operand stack, along with the run of instructions that computed it */
+typedef struct StackValue {
+	size_t value;       /*!< Number that the pass simulating the stack gave this value */
+	size_t start;       /*!< First instruction of the run, or BB_NONE */
+	size_t end;         /*!< Index just past the last instruction of the run */
+	size_t weight;      /*!< Number of instructions and static link hops it takes to compute the value */
+} StackValue;
+
+/*! Most instructions that an edit can put in place of a run */
+#define BB_EDIT_MAX_INSNS 2
+
+/*! A change to a run of instructions in a basic block */
+typedef struct BBEdit {
+	size_t start;       /*!< First instruction of the run */
+	size_t end;         /*!< Index just past the last instruction of the run, or start to only insert */
+	size_t count;       /*!< Number of new instructions, or zero to only remove the run */
+	Insn insns[BB_EDIT_MAX_INSNS];
+	Symbol* sym;        /*!< Symbol referenced by the first new instruction, or NULL */
+} BBEdit;
+typedef dynamic_array(BBEdit) BBEditArray;
+
 
 /*! Create and return a basic block that follows this one linearly, and update the pointer
  @return A newly created basic block that follows this one linearly in the code segment
@@ -82,6 +136,12 @@ void BasicBlock_markCondition(BasicBlock* self);
  */
 void BasicBlock_markSymbol(BasicBlock* self, Symbol* sym);
 
+/*! Look up the symbol that an instruction references
+ @param index Index of the instruction
+ @return Symbol referenced by the instruction, or NULL if it doesn't reference one
+ */
+Symbol* BasicBlock_findSymbol(BasicBlock* self, size_t index);
+
 /*! Used to determine whether a basic block is empty of code
  @return True if the basic block contains no code instructions
  */
@@ -119,6 +179,41 @@ void BasicBlock_removeXref(BasicBlock* self, BasicBlock* from);
  */
 void BasicBlock_addInsn(BasicBlock* self, Insn insn);
 
+/*! Overwrite an instruction in the basic block with one that doesn't reference a symbol
+ @param index Index of the instruction to replace
+ @param insn New instruction
+ */
+void BasicBlock_replaceInsn(BasicBlock* self, size_t index, Insn insn);
+
+/*! Insert an instruction that doesn't reference a symbol into the basic block. The instruction
+ becomes part of the same code (body, condition, or tail) as the instruction before it
+ @param index Index the new instruction will have
+ @param insn Instruction to insert
+ */
+void BasicBlock_insertInsn(BasicBlock* self, size_t index, Insn insn);
+
+/*! Remove an instruction from the basic block, keeping symbol references and the condition and
+ tail indices pointed at the same instructions
+ @param index Index of the instruction to remove
+ */
+void BasicBlock_removeInsn(BasicBlock* self, size_t index);
+
+/*! Apply changes to runs of instructions that were all found before any of them were made. They
+ are applied from the end of the basic block backwards so the indices stay correct, and an
+ insertion at the start of a run that is replaced ends up before the replacement
+ @param edits Edits to apply, which get sorted and must not overlap each other
+ */
+void BasicBlock_applyEdits(BasicBlock* self, BBEditArray* edits);
+
+/*! Compute the run and weight of an operation's result from its operands. The result only has a
+ run when every operand has one and they are right next to each other and to the operation
+ @param operands Operands in the order they were pushed
+ @param count Number of operands
+ @param index Index of the operation's instruction
+ @return Result of the operation, whose value is left for the caller to set
+ */
+StackValue StackValue_combine(const StackValue* operands, size_t count, size_t index);
+
 /*! Gets the code address of the current basic block
  @return Code address of this basic block
  */
@@ -136,14 +231,39 @@ void BasicBlock_resolve(BasicBlock* self, Block* scope);
 
 /*! Performs optimizations on a basic block
  @param scope Scope of the code this basic block was generated from
+ @param code_budget Number of instructions that optimizations may still add to the program
+ */
+void BasicBlock_optimize(BasicBlock* self, Block* scope, size_t* code_budget);
+
+/*! Removes every basic block that can't be reached by following branches from this one
+ @note This must be the first basic block of a procedure
+ */
+void BasicBlock_removeUnreachable(BasicBlock* self);
+
+/*! Collect every basic block that can be reached by following branches from this one, and set the
+ index of each basic block in the procedure to its position in the array, or to BB_NONE
+ @param blocks Empty array to append the basic blocks to, in code order starting with this one
+ @note This must be the first basic block of a procedure
+ */
+void BasicBlock_findReachable(BasicBlock* self, BBArray* blocks);
+
+/*! Emits the instructions in this basic block to the end of an instruction array
+ @param code Array to append PM/0 machine code to
+ @param level Lexical level that this code belongs to
+ */
+void BasicBlock_emit(BasicBlock* self, InsnArray* code, uint16_t level);
+
+/*! Look up how often this basic block and its condition ran in a profile of an earlier compilation
+ @param profile Profile of the program, which sets BB_PROFILED if it has this basic block
  */
-void BasicBlock_optimize(BasicBlock* self, Block* scope);
+void BasicBlock_applyProfile(BasicBlock* self, Profile* profile);
 
-/*! Emits the instructions in this basic block to the output file stream specified
- @param fp File stream to write PM/0 machine code to
+/*! Writes the address of this basic block and of its conditional jump along with the origin and
+ ordinal that identify them, so a profile of the program can be matched up with its basic blocks
+ @param fp Output file stream where the block map should be written
  @param level Lexical level that this code belongs to
  */
-void BasicBlock_emit(BasicBlock* self, FILE* fp, uint16_t level);
+void BasicBlock_writeBlockMap(BasicBlock* self, FILE* fp, uint16_t level);
 
 /*! Count the number of instructions in this basic block including trailing jumps */
 size_t BasicBlock_getInstructionCount(BasicBlock* self);
@@ -8,11 +8,18 @@
 
 #include "block.h"
 #include "genpm0.h"
+#include "genssa.h"
 #include "gvnode.h"
+#include "layout.h"
+#include "licm.h"
+#include "lvn.h"
+#include "ssalower.h"
+#include "ssaopt.h"
 
 
 static size_t Block_getCodeLength(Block* self);
 static void Block_resolve(Block* self);
+static void Block_resizeFrame(Block* self, Word old_size);
 static Block* Block_getLast(Block* self);
 static void Block_setNext(Block* self, Block* next);
 
@@ -31,30 +38,66 @@ Block* Block_initWithScope(Block* self, SymTree* symtree) {
 	return self;
 }
 
-bool Block_generate(Block* self, AST_Block* ast) {
-	if(ast->procs != NULL) {
-		foreach(&ast->procs->procs, pproc) {
-			/* Generate the code for all subprocedures of this procedure */
-			Symbol* sym = SymTree_findSymbol(self->symtree, (*pproc)->ident);
-			if(!Block_generate(sym->value.procedure.body, (*pproc)->body)) {
-				return false;
-			}
+bool Block_generate(Block* self, const AST* ast, uint32_t block) {
+	uint32_t count = AST_procCount(ast, block);
+	for(uint32_t i = 0; i < count; i++) {
+		/* Generate the code for all subprocedures of this procedure */
+		AST_Proc* proc = &ast->procs.elems[AST_procAt(ast, block, i)];
+		Symbol* sym = AST_symbol(ast, proc->ident);
+		if(!Block_generate(sym->value.procedure.body, ast, proc->body)) {
+			return false;
 		}
 	}
 	
-	/* Generate the code for this block into a new empty basic block */
-	BasicBlock* code = BasicBlock_new();
-	self->code = code;
-	return GenPM0_genBlock(self->symtree, &code, ast);
+	/* Build the block in SSA form, optimize it there, then lower it into its code graph */
+	SSAProc proc;
+	SSAProc_init(&proc, self);
+	bool success = GenSSA_genBlock(&proc, ast, block);
+	if(success) {
+		ssa_optimize(&proc);
+		ssa_lower(&proc);
+	}
+	
+	SSAProc_clear(&proc);
+	return success;
+}
+
+void Block_applyProfile(Block* self, Profile* profile) {
+	for(BasicBlock* bb = self->code; bb != NULL; bb = bb->next) {
+		BasicBlock_applyProfile(bb, profile);
+	}
+	
+	foreach(&self->symtree->syms, psym) {
+		if((*psym)->type == SYM_PROC) {
+			Block_applyProfile((*psym)->value.procedure.body, profile);
+		}
+	}
 }
 
-void Block_optimize(Block* self) {
+void Block_optimize(Block* self, size_t* code_budget) {
 	/* Make sure we don't do this again due to recursive calls */
 	if(self->optimized) {
 		return;
 	}
 	self->optimized = true;
 	
+	/* Compute values that don't change in a loop before the loop starts */
+	Word frame_size = self->symtree->frame_size;
+	self->symtree->frame_size += (Word)licm_optimize(self, frame_size, code_budget);
+	
+	/* Compute repeated values only once. Basic blocks can share temporary slots, as none of them
+	 reads a slot before storing to it
+	 */
+	size_t temp_count = 0;
+	for(BasicBlock* bb = self->code; bb != NULL; bb = bb->next) {
+		size_t used = lvn_optimize(bb, self, self->symtree->frame_size);
+		if(used > temp_count) {
+			temp_count = used;
+		}
+	}
+	self->symtree->frame_size += (Word)temp_count;
+	Block_resizeFrame(self, frame_size);
+	
 	/* Find last basic block */
 	BasicBlock* cur = self->code;
 	while(cur->next != NULL) {
@@ -67,9 +110,41 @@ void Block_optimize(Block* self) {
 		BasicBlock* prev = cur->prev;
 		
 		/* Optimize referenced blocks (this might destroy cur!) */
-		BasicBlock_optimize(cur, self);
+		BasicBlock_optimize(cur, self, code_budget);
 		cur = prev;
 	}
+	
+	/* Drop code that can never run. Procedures only called from there won't be laid out either */
+	BasicBlock_removeUnreachable(self->code);
+	
+	/* Order the remaining basic blocks so the most common branches fall through */
+	layout_optimize(self);
+}
+
+size_t Block_getProgramLength(Block* self) {
+	size_t length = Block_getCodeLength(self);
+	foreach(&self->symtree->syms, psym) {
+		if((*psym)->type == SYM_PROC) {
+			length += Block_getProgramLength((*psym)->value.procedure.body);
+		}
+	}
+	return length;
+}
+
+static void Block_resizeFrame(Block* self, Word old_size) {
+	Word frame_size = self->symtree->frame_size;
+	if(frame_size == old_size) {
+		return;
+	}
+	
+	/* The first instruction of a block reserves its stack frame, unless the frame was empty */
+	if(old_size != 0) {
+		ASSERT(self->code->insns.count != 0 && self->code->insns.elems[0].op == OP_INC);
+		self->code->insns.elems[0].imm = frame_size;
+	}
+	else {
+		BasicBlock_insertInsn(self->code, 0, MAKE_INC(frame_size));
+	}
 }
 
 bool Block_isEmpty(Block* self) {
@@ -139,13 +214,13 @@ void Block_append(Block* self, Block* last) {
 	self->last = last;
 }
 
-void Block_emit(Block* self, FILE* fp) {
+void Block_emit(Block* self, InsnArray* code) {
 	Block* blk = self;
 	while(blk != NULL) {
 		/* Emit the code for each basic block in the code graph */
 		BasicBlock* cur = blk->code;
 		while(cur != NULL) {
-			BasicBlock_emit(cur, fp, blk->symtree->level);
+			BasicBlock_emit(cur, code, blk->symtree->level);
 			cur = cur->next;
 		}
 		
@@ -153,6 +228,15 @@ void Block_emit(Block* self, FILE* fp) {
 	}
 }
 
+void Block_writeBlockMap(Block* self, FILE* fp) {
+	/* Walk the blocks in the same order they were emitted */
+	for(Block* blk = self; blk != NULL; blk = blk->next) {
+		for(BasicBlock* cur = blk->code; cur != NULL; cur = cur->next) {
+			BasicBlock_writeBlockMap(cur, fp, blk->symtree->level);
+		}
+	}
+}
+
 void Block_drawGraph(Block* self, Graphviz* gv) {
 	/* Draw this block's CFG */
 	BasicBlock* cur = self->code;
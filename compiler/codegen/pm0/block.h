@@ -18,6 +18,7 @@ typedef struct Block Block;
 #include "object.h"
 #include "config.h"
 #include "basicblock.h"
+#include "profile.h"
 #include "compiler/ast_nodes.h"
 #include "compiler/codegen/symtree.h"
 #include "graphviz.h"
@@ -42,6 +43,26 @@ struct Block {
 	
 	/*! Whether this block has been optimized or not */
 	bool optimized;
+	
+	/*! Index of the procedure's body in the program's AST, which is kept to inline it into its callers */
+	uint32_t ast;
+	
+	/*! Number of calls to this procedure in the program */
+	size_t call_count;
+	
+	/*! Whether the procedure calls itself */
+	bool recursive;
+	
+	/*! Estimated number of instructions in the code graph, before it is optimized */
+	size_t estimated_length;
+	
+	/*! Number of stack slots an inlined copy of the procedure needs for its return value, parameters,
+	 and variables
+	 */
+	Word inline_size;
+	
+	/*! Whether calls to this procedure are replaced by a copy of its body */
+	bool inlined;
 };
 DECL(Block);
 
@@ -51,13 +72,31 @@ DECL(Block);
  */
 Block* Block_initWithScope(Block* self, SymTree* symtree);
 
-/*! Generate the code graph from the AST of a block
- @param ast Abstract syntax tree representation of the code comprising this block
+/*! Generate the code graph from the AST of a block, by way of SSA form where its variables are
+ optimized before it's lowered into basic blocks. The code graphs of the procedures declared in the
+ block are generated first
+ @param ast Abstract syntax tree of the whole program
+ @param block Index of the AST block comprising this block
  */
-bool Block_generate(Block* self, AST_Block* ast);
+bool Block_generate(Block* self, const AST* ast, uint32_t block);
 
-/*! Performs basic optimizations on the block's code graph by removing empty basic blocks */
-void Block_optimize(Block* self);
+/*! Look up how often each basic block of this block and of all the procedures declared in it ran
+ in a profile of an earlier compilation, which guides the optimizations that follow
+ @param profile Profile of the program
+ */
+void Block_applyProfile(Block* self, Profile* profile);
+
+/*! Performs basic optimizations on the block's code graph by moving values that don't change out of
+ loops, reusing values that basic blocks compute more than once, removing empty and unreachable
+ basic blocks, and laying out the rest so that loops don't have to jump back to their condition
+ @param code_budget Number of instructions that optimizations may still add to the program
+ */
+void Block_optimize(Block* self, size_t* code_budget);
+
+/*! Counts the instructions in the code graphs of this block and all of the procedures declared in it
+ @return Number of instructions in the program before it is optimized
+ */
+size_t Block_getProgramLength(Block* self);
 
 /*! Used to determine whether a block contains any code
  @return True if the block has no code instructions
@@ -79,10 +118,16 @@ void Block_setAddress(Block* self, Word addr);
  */
 void Block_append(Block* self, Block* last);
 
-/*! Emits this block's machine code to the specified file
- @param fp File stream to output this function's machine code to
+/*! Emits this block's machine code to the end of an instruction array
+ @param code Array to append this function's machine code to
+ */
+void Block_emit(Block* self, InsnArray* code);
+
+/*! Writes the block map of this block's machine code, which identifies the basic blocks at each
+ code address for a profile of the program. Must be called after the block has been emitted
+ @param fp Output file stream where the block map should be written
  */
-void Block_emit(Block* self, FILE* fp);
+void Block_writeBlockMap(Block* self, FILE* fp);
 
 /*! Draws the block's code graph */
 void Block_drawGraph(Block* self, Graphviz* gv);
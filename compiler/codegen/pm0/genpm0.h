@@ -14,6 +14,7 @@ typedef struct GenPM0 GenPM0;
 #include "object.h"
 #include "block.h"
 #include "basicblock.h"
+#include "profile.h"
 #include "compiler/codegen/symtree.h"
 #include "compiler/ast_nodes.h"
 
@@ -27,9 +28,10 @@ DECL(GenPM0);
 
 
 /*! Initialize the PM/0 code generator using the program's full AST
- @param prog AST for the top-level block
+ @param prog AST of the whole program
+ @param profile Profile of an earlier compilation of the program to guide optimizations, or NULL
  */
-GenPM0* GenPM0_initWithAST(GenPM0* self, AST_Block* prog);
+GenPM0* GenPM0_initWithAST(GenPM0* self, AST* prog, Profile* profile);
 
 /*! Draw a code flow graph and write the Graphviz code to a file
  @param fp Output file where the Graphviz code should be written
@@ -46,13 +48,15 @@ void GenPM0_writeSymbolTable(GenPM0* self, FILE* fp);
  */
 void GenPM0_emit(GenPM0* self, FILE* fp);
 
-/*! Generate code for the block given its AST node
- @param scope SymTree node for the block being codegenned
- @param code Active basic block where code should be generated
- @param ast AST node for the block to codegen
- @return True on success, false on failure
+/*! Emits the instructions for the program to the end of an instruction array
+ @param code Array where instructions should be appended
  */
-bool GenPM0_genBlock(SymTree* scope, BasicBlock** code, AST_Block* ast);
+void GenPM0_emitInsns(GenPM0* self, InsnArray* code);
+
+/*! Writes the block map of the program, which must already have been emitted
+ @param fp Output file stream where the block map should be written
+ */
+void GenPM0_writeBlockMap(GenPM0* self, FILE* fp);
 
 
 #endif /* PL0_GENPM0_H */
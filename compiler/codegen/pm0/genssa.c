@@ -0,0 +1,659 @@
+//
+//  genssa.c
+//  PL/0
+//
+
+#include "genssa.h"
+#include <stdlib.h>
+#include "dynamic_array.h"
+#include "compiler/codegen/fold.h"
+
+
+/* State of the procedure being built */
+typedef struct GenSSA {
+	SSAProc* proc;
+	const AST* ast;
+	uint16_t level;                     /* Level of the procedure's own variables */
+	dynamic_array(Word) escapes;        /* Offsets of the procedure's variables that nested procedures use */
+	uint32_t cur;                       /* Basic block that code is being added to */
+} GenSSA;
+
+static void findEscapes(GenSSA* gen, Block* scope);
+static uint32_t createNext(GenSSA* gen, SymTree* scope);
+static bool genStmt(GenSSA* gen, SymTree* scope, AST_Node statement);
+static bool genCond(GenSSA* gen, SymTree* scope, AST_Node condition, SSAValue* value);
+static bool genExpr(GenSSA* gen, SymTree* scope, AST_Node expression, SSAValue* value);
+static bool genCall(GenSSA* gen, SymTree* scope, Symbol* sym, uint32_t param_list, SSAValue* result);
+static bool genParamList(GenSSA* gen, SymTree* scope, uint32_t param_list, SSAValueArray* values);
+static bool canInline(SymTree* scope, Symbol* sym, size_t arg_count);
+static bool genInlineCall(GenSSA* gen, SymTree* scope, Symbol* sym, uint32_t param_list, SSAValue* result);
+static size_t paramCount(const AST* ast, uint32_t param_list);
+static Word inlineEnter(GenSSA* gen, SymTree* scope, Symbol* sym, SSAValueArray* params);
+static void inlineLeave(GenSSA* gen, SymTree* scope, Symbol* sym, Word base, SSAValue* result);
+static bool genLoadIdent(GenSSA* gen, SymTree* scope, Symbol* sym, SSAValue* value);
+static bool genStoreVar(GenSSA* gen, SymTree* scope, Symbol* sym, SSAValue value);
+static SSAValue addInsn(GenSSA* gen, SSAOp op, SSAType type, const SSAValue* args, uint32_t arg_count);
+static SSAValue addLit(GenSSA* gen, Word number);
+
+/* Variables kept as values, using the algorithm from "Simple and Efficient Construction of Static
+ Single Assignment Form" by Braun et al.
+ */
+static uint32_t findVar(GenSSA* gen, SymTree* scope, Symbol* sym);
+static uint32_t findSlotVar(GenSSA* gen, Word slot, Symbol* sym);
+static void writeVar(GenSSA* gen, uint32_t var, uint32_t block, SSAValue value);
+static SSAValue readVar(GenSSA* gen, uint32_t var, uint32_t block);
+static SSAValue readVarRecursive(GenSSA* gen, uint32_t var, uint32_t block);
+static SSAValue addPhi(GenSSA* gen, uint32_t var, uint32_t block);
+static SSAValue addPhiOperands(GenSSA* gen, uint32_t var, SSAValue phi);
+static SSAValue removeTrivialPhi(GenSSA* gen, SSAValue phi);
+static void sealBlock(GenSSA* gen, uint32_t block);
+
+
+bool GenSSA_genBlock(SSAProc* proc, const AST* ast, uint32_t block) {
+	SymTree* scope = proc->scope->symtree;
+	GenSSA gen = {0};
+	gen.proc = proc;
+	gen.ast = ast;
+	gen.level = scope->level;
+	findEscapes(&gen, proc->scope);
+	
+	/* Procedures inlined into this block keep their variables past this block's own */
+	scope->inline_top = scope->frame_size;
+	
+	/* Number the basic blocks of the procedure starting from its entry, which nothing branches to */
+	scope->block_count = 0;
+	gen.cur = SSAProc_addBlock(proc, scope, scope->block_count++);
+	proc->blocks.elems[gen.cur].sealed = true;
+	
+	bool success = genStmt(&gen, scope, ast->blocks.elems[block].stmt);
+	array_clear(&gen.escapes);
+	return success;
+}
+
+static void findEscapes(GenSSA* gen, Block* scope) {
+	/* Nested procedures get to this procedure's variables through their static links */
+	foreach(&scope->symtree->syms, psym) {
+		if((*psym)->type != SYM_PROC) {
+			continue;
+		}
+		
+		Block* body = (*psym)->value.procedure.body;
+		for(BasicBlock* bb = body->code; bb != NULL; bb = bb->next) {
+			foreach(&bb->symrefs, symref) {
+				Symbol* sym = symref->sym;
+				if(sym->type == SYM_VAR && sym->level == gen->level) {
+					array_append(&gen->escapes, (Word)sym->value.frame_offset);
+				}
+			}
+		}
+		findEscapes(gen, body);
+	}
+}
+
+static uint32_t createNext(GenSSA* gen, SymTree* scope) {
+	/* Number the basic blocks of each procedure in the order they're created, which only depends on
+	 the procedure's source. Code inlined from another procedure is numbered as part of that one
+	 */
+	gen->cur = SSAProc_addBlock(gen->proc, scope, scope->block_count++);
+	return gen->cur;
+}
+
+static bool genStmt(GenSSA* gen, SymTree* scope, AST_Node statement) {
+	/* Empty statement, so do nothing and return success */
+	if(statement == AST_NONE) {
+		return true;
+	}
+	
+	const AST* ast = gen->ast;
+	uint32_t lhs = ast->lhs.elems[statement];
+	uint32_t rhs = ast->rhs.elems[statement];
+	switch(ast->types.elems[statement]) {
+		case STMT_ASSIGN: {
+			SSAValue value;
+			return genExpr(gen, scope, rhs, &value) && genStoreVar(gen, scope, AST_symbol(ast, lhs), value);
+		}
+		
+		case STMT_CALL: {
+			Symbol* sym = AST_symbol(ast, lhs);
+			if(canInline(scope, sym, paramCount(ast, rhs))) {
+				return genInlineCall(gen, scope, sym, rhs, NULL);
+			}
+			
+			/* The procedure's result is ignored */
+			return genCall(gen, scope, sym, rhs, NULL);
+		}
+		
+		case STMT_BEGIN: {
+			uint32_t count = AST_listCount(ast, lhs);
+			for(uint32_t i = 0; i < count; i++) {
+				if(!genStmt(gen, scope, AST_listItem(ast, lhs, i))) {
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		case STMT_IF: {
+			/* When the condition is constant, only the branch that is taken needs any code */
+			AST_Node then_stmt = ast->extra.elems[rhs];
+			AST_Node else_stmt = ast->extra.elems[rhs + 1];
+			bool taken;
+			if(fold_condition(ast, lhs, &taken)) {
+				return genStmt(gen, scope, taken ? then_stmt : else_stmt);
+			}
+			
+			SSAValue value;
+			if(!genCond(gen, scope, lhs, &value)) {
+				return false;
+			}
+			uint32_t cond = gen->cur;
+			gen->proc->blocks.elems[cond].cond = value;
+			
+			/* Each branch starts a basic block that only the condition branches to */
+			uint32_t true_branch_begin = createNext(gen, scope);
+			SSAProc_addEdge(gen->proc, cond, 0, true_branch_begin);
+			sealBlock(gen, true_branch_begin);
+			if(!genStmt(gen, scope, then_stmt)) {
+				return false;
+			}
+			uint32_t true_branch_end = gen->cur;
+			
+			uint32_t false_branch_begin = createNext(gen, scope);
+			SSAProc_addEdge(gen->proc, cond, 1, false_branch_begin);
+			
+			/* Without an else statement, the true branch rejoins the false one */
+			if(else_stmt == AST_NONE) {
+				SSAProc_addEdge(gen->proc, true_branch_end, 0, false_branch_begin);
+				sealBlock(gen, false_branch_begin);
+				return true;
+			}
+			
+			sealBlock(gen, false_branch_begin);
+			if(!genStmt(gen, scope, else_stmt)) {
+				return false;
+			}
+			uint32_t false_branch_end = gen->cur;
+			
+			/* Both branches rejoin in a new basic block */
+			uint32_t endif = createNext(gen, scope);
+			SSAProc_addEdge(gen->proc, true_branch_end, 0, endif);
+			SSAProc_addEdge(gen->proc, false_branch_end, 0, endif);
+			sealBlock(gen, endif);
+			return true;
+		}
+		
+		case STMT_WHILE: {
+			/* A loop whose condition is always false never runs, and one that's always true never exits */
+			bool value;
+			bool constant = fold_condition(ast, lhs, &value);
+			if(constant && !value) {
+				return true;
+			}
+			
+			/* The condition isn't sealed until the end of the loop body branches back to it */
+			uint32_t before_cond = gen->cur;
+			uint32_t cond = createNext(gen, scope);
+			SSAProc_addEdge(gen->proc, before_cond, 0, cond);
+			
+			if(!constant) {
+				SSAValue cond_value;
+				if(!genCond(gen, scope, lhs, &cond_value)) {
+					return false;
+				}
+				gen->proc->blocks.elems[gen->cur].cond = cond_value;
+			}
+			
+			/* Inlining a call can split the condition into several basic blocks, and the last one branches */
+			uint32_t cond_end = gen->cur;
+			uint32_t loop_body_begin = createNext(gen, scope);
+			SSAProc_addEdge(gen->proc, cond_end, 0, loop_body_begin);
+			sealBlock(gen, loop_body_begin);
+			if(!genStmt(gen, scope, rhs)) {
+				return false;
+			}
+			
+			SSAProc_addEdge(gen->proc, gen->cur, 0, cond);
+			sealBlock(gen, cond);
+			
+			uint32_t endwhile = createNext(gen, scope);
+			if(!constant) {
+				SSAProc_addEdge(gen->proc, cond_end, 1, endwhile);
+			}
+			sealBlock(gen, endwhile);
+			return true;
+		}
+		
+		case STMT_READ:
+			return genStoreVar(gen, scope, AST_symbol(ast, lhs), addInsn(gen, SSA_READ, SSA_INT, NULL, 0));
+		
+		case STMT_WRITE: {
+			SSAValue value;
+			if(!genExpr(gen, scope, lhs, &value)) {
+				return false;
+			}
+			addInsn(gen, SSA_WRITE, SSA_VOID, &value, 1);
+			return true;
+		}
+		
+		default:
+			ASSERT(!"Unknown statement type");
+	}
+}
+
+static bool genCond(GenSSA* gen, SymTree* scope, AST_Node condition, SSAValue* value) {
+	const AST* ast = gen->ast;
+	Word op;
+	switch(ast->types.elems[condition]) {
+		case COND_ODD: {
+			SSAValue operand;
+			if(!genExpr(gen, scope, ast->lhs.elems[condition], &operand)) {
+				return false;
+			}
+			*value = addInsn(gen, SSA_UNARY, SSA_BOOL, &operand, 1);
+			gen->proc->insns.elems[*value].imm = ALU_ODD;
+			return true;
+		}
+		
+		case COND_EQ: op = ALU_EQL; break;
+		case COND_NE: op = ALU_NEQ; break;
+		case COND_LT: op = ALU_LSS; break;
+		case COND_LE: op = ALU_LEQ; break;
+		case COND_GT: op = ALU_GTR; break;
+		case COND_GE: op = ALU_GEQ; break;
+		
+		default:
+			ASSERT(!"Unknown condition type");
+	}
+	
+	SSAValue operands[2];
+	if(!genExpr(gen, scope, ast->lhs.elems[condition], &operands[0])
+	   || !genExpr(gen, scope, ast->rhs.elems[condition], &operands[1])) {
+		return false;
+	}
+	*value = addInsn(gen, SSA_BINARY, SSA_BOOL, operands, 2);
+	gen->proc->insns.elems[*value].imm = op;
+	return true;
+}
+
+static bool genExpr(GenSSA* gen, SymTree* scope, AST_Node expression, SSAValue* value) {
+	const AST* ast = gen->ast;
+	uint32_t lhs = ast->lhs.elems[expression];
+	uint32_t rhs = ast->rhs.elems[expression];
+	Word op;
+	switch(ast->types.elems[expression]) {
+		case EXPR_VAR:
+			return genLoadIdent(gen, scope, AST_symbol(ast, lhs), value);
+		
+		case EXPR_NUM:
+			*value = addLit(gen, (Word)lhs);
+			return true;
+		
+		case EXPR_NEG: {
+			SSAValue operand;
+			if(!genExpr(gen, scope, lhs, &operand)) {
+				return false;
+			}
+			*value = addInsn(gen, SSA_UNARY, SSA_INT, &operand, 1);
+			gen->proc->insns.elems[*value].imm = ALU_NEG;
+			return true;
+		}
+		
+		case EXPR_ADD: op = ALU_ADD; break;
+		case EXPR_SUB: op = ALU_SUB; break;
+		case EXPR_MUL: op = ALU_MUL; break;
+		case EXPR_DIV: op = ALU_DIV; break;
+		case EXPR_MOD: op = ALU_MOD; break;
+		
+		case EXPR_CALL: {
+			Symbol* sym = AST_symbol(ast, lhs);
+			if(canInline(scope, sym, paramCount(ast, rhs))) {
+				return genInlineCall(gen, scope, sym, rhs, value);
+			}
+			return genCall(gen, scope, sym, rhs, value);
+		}
+		
+		default:
+			ASSERT(!"Unknown expression type");
+	}
+	
+	/* Only binary operators get here */
+	SSAValue operands[2];
+	if(!genExpr(gen, scope, lhs, &operands[0]) || !genExpr(gen, scope, rhs, &operands[1])) {
+		return false;
+	}
+	*value = addInsn(gen, SSA_BINARY, SSA_INT, operands, 2);
+	gen->proc->insns.elems[*value].imm = op;
+	return true;
+}
+
+static bool genCall(GenSSA* gen, SymTree* scope, Symbol* sym, uint32_t param_list, SSAValue* result) {
+	/* The binding pass already reported why the procedure couldn't be resolved */
+	if(sym == NULL) {
+		return false;
+	}
+	
+	/* The call takes the memory as it is after its parameters are computed */
+	SSAValueArray operands = {0};
+	array_append(&operands, SSA_NONE);
+	bool success = genParamList(gen, scope, param_list, &operands);
+	if(success) {
+		operands.elems[0] = readVar(gen, SSA_MEMORY, gen->cur);
+		SSAValue call = addInsn(gen, SSA_CALL, SSA_MEM, operands.elems, (uint32_t)operands.count);
+		gen->proc->insns.elems[call].sym = sym;
+		writeVar(gen, SSA_MEMORY, gen->cur, call);
+		
+		/* The procedure leaves its result just past the top of the stack */
+		if(result != NULL) {
+			*result = addInsn(gen, SSA_RESULT, SSA_INT, &call, 1);
+		}
+	}
+	array_clear(&operands);
+	return success;
+}
+
+static bool genParamList(GenSSA* gen, SymTree* scope, uint32_t param_list, SSAValueArray* values) {
+	size_t count = paramCount(gen->ast, param_list);
+	for(size_t i = 0; i < count; i++) {
+		SSAValue value;
+		if(!genExpr(gen, scope, AST_listItem(gen->ast, param_list, (uint32_t)i), &value)) {
+			return false;
+		}
+		array_append(values, value);
+	}
+	return true;
+}
+
+static bool canInline(SymTree* scope, Symbol* sym, size_t arg_count) {
+	if(sym == NULL || !sym->value.procedure.body->inlined) {
+		return false;
+	}
+	
+	/* Only inline one level deep, so calls within an inlined body stay calls. That also keeps
+	 recursive procedures from being inlined into themselves
+	 */
+	Block* body = sym->value.procedure.body;
+	if(scope->inline_frame != NULL || body->symtree == scope) {
+		return false;
+	}
+	
+	/* A call with the wrong number of parameters can't be mapped onto the procedure's variables */
+	return arg_count == sym->value.procedure.param_count;
+}
+
+static bool genInlineCall(GenSSA* gen, SymTree* scope, Symbol* sym, uint32_t param_list, SSAValue* result) {
+	/* Compute the parameters before any of the callee's variables exist */
+	SSAValueArray params = {0};
+	bool success = genParamList(gen, scope, param_list, &params);
+	if(success) {
+		/* Lower the callee's statement with its variables in this frame */
+		Block* body = sym->value.procedure.body;
+		Word base = inlineEnter(gen, scope, sym, &params);
+		success = genStmt(gen, body->symtree, gen->ast->blocks.elems[body->ast].stmt);
+		inlineLeave(gen, scope, sym, base, success ? result : NULL);
+	}
+	array_clear(&params);
+	return success;
+}
+
+static size_t paramCount(const AST* ast, uint32_t param_list) {
+	return param_list != AST_NONE ? AST_listCount(ast, param_list) : 0;
+}
+
+static Word inlineEnter(GenSSA* gen, SymTree* scope, Symbol* sym, SSAValueArray* params) {
+	/* Reserve slots for the callee's variables past the ones that are in use */
+	Block* body = sym->value.procedure.body;
+	Word base = scope->inline_top;
+	scope->inline_top += body->inline_size;
+	if(scope->inline_top > scope->frame_size) {
+		scope->frame_size = scope->inline_top;
+	}
+	
+	/* The parameters follow the return value */
+	enumerate(params, i, pvalue) {
+		uint32_t var = findSlotVar(gen, base + 1 + (Word)i, NULL);
+		writeVar(gen, var, gen->cur, *pvalue);
+	}
+	
+	/* Like CAL, the return value starts out as zero, even when the call's result isn't used. The
+	 slot may still hold what an earlier callee returned there, which the body could read
+	 */
+	writeVar(gen, findSlotVar(gen, base, NULL), gen->cur, addLit(gen, 0));
+	
+	body->symtree->inline_frame = scope;
+	body->symtree->inline_base = base;
+	
+	/* The inlined statement continues the caller's basic block, so it starts with the callee's second one */
+	body->symtree->block_count = 1;
+	return base;
+}
+
+static void inlineLeave(GenSSA* gen, SymTree* scope, Symbol* sym, Word base, SSAValue* result) {
+	SymTree* callee = sym->value.procedure.body->symtree;
+	callee->inline_frame = NULL;
+	callee->inline_base = 0;
+	
+	/* The result is whatever the callee last assigned to its return value */
+	if(result != NULL) {
+		*result = readVar(gen, findSlotVar(gen, base, NULL), gen->cur);
+	}
+	
+	/* The slots are free again once the callee is done with them */
+	scope->inline_top = base;
+}
+
+static bool genLoadIdent(GenSSA* gen, SymTree* scope, Symbol* sym, SSAValue* value) {
+	/* The binding pass already reported why the symbol couldn't be resolved */
+	if(sym == NULL) {
+		return false;
+	}
+	
+	switch(sym->type) {
+		case SYM_CONST:
+			/* The constant keeps its symbol so that the code it's lowered into refers to it */
+			*value = addInsn(gen, SSA_CONST, SSA_INT, NULL, 0);
+			gen->proc->insns.elems[*value].sym = sym;
+			gen->proc->insns.elems[*value].imm = sym->value.number;
+			return true;
+		
+		case SYM_VAR: {
+			uint32_t var = findVar(gen, scope, sym);
+			if(var != SSA_NONE) {
+				*value = readVar(gen, var, gen->cur);
+				return true;
+			}
+			
+			SSAValue mem = readVar(gen, SSA_MEMORY, gen->cur);
+			*value = addInsn(gen, SSA_LOAD, SSA_INT, &mem, 1);
+			gen->proc->insns.elems[*value].sym = sym;
+			return true;
+		}
+		
+		default:
+			ASSERT(!"Unknown symbol type");
+	}
+}
+
+static bool genStoreVar(GenSSA* gen, SymTree* scope, Symbol* sym, SSAValue value) {
+	/* The binding pass already reported why the variable couldn't be resolved */
+	if(sym == NULL) {
+		return false;
+	}
+	
+	/* The binding pass only resolves assignments to variables */
+	ASSERT(sym->type == SYM_VAR);
+	
+	uint32_t var = findVar(gen, scope, sym);
+	if(var != SSA_NONE) {
+		writeVar(gen, var, gen->cur, value);
+		return true;
+	}
+	
+	SSAValue operands[2] = {readVar(gen, SSA_MEMORY, gen->cur), value};
+	SSAValue store = addInsn(gen, SSA_STORE, SSA_MEM, operands, 2);
+	gen->proc->insns.elems[store].sym = sym;
+	writeVar(gen, SSA_MEMORY, gen->cur, store);
+	return true;
+}
+
+static SSAValue addInsn(GenSSA* gen, SSAOp op, SSAType type, const SSAValue* args, uint32_t arg_count) {
+	return SSAProc_addInsn(gen->proc, gen->cur, op, type, args, arg_count);
+}
+
+static SSAValue addLit(GenSSA* gen, Word number) {
+	SSAValue value = addInsn(gen, SSA_LIT, SSA_INT, NULL, 0);
+	gen->proc->insns.elems[value].imm = number;
+	return value;
+}
+
+static uint32_t findVar(GenSSA* gen, SymTree* scope, Symbol* sym) {
+	/* The callee's own variables live in the caller's frame while it is being inlined, where the
+	 return value is first, followed by the parameters and variables after the three links
+	 */
+	uint32_t offset = sym->value.frame_offset;
+	if(scope->inline_frame != NULL && sym->level == scope->level) {
+		return findSlotVar(gen, scope->inline_base + (offset == 0 ? 0 : (Word)offset - 3), NULL);
+	}
+	
+	/* Anything outside of this procedure's frame is memory, and so is its return value, which the
+	 caller loads after it returns
+	 */
+	if(sym->level != gen->level || (gen->level != 0 && offset == 0)) {
+		return SSA_NONE;
+	}
+	
+	/* So is anything that a nested procedure can change */
+	foreach(&gen->escapes, poffset) {
+		if(*poffset == (Word)offset) {
+			return SSA_NONE;
+		}
+	}
+	return findSlotVar(gen, (Word)offset, sym);
+}
+
+static uint32_t findSlotVar(GenSSA* gen, Word slot, Symbol* sym) {
+	/* Memory is the first variable, which doesn't have a slot */
+	SSAProc* proc = gen->proc;
+	for(size_t var = SSA_MEMORY + 1; var < proc->vars.count; var++) {
+		if(proc->vars.elems[var].slot == slot) {
+			return (uint32_t)var;
+		}
+	}
+	
+	SSAVar var = {.slot = slot, .sym = sym};
+	array_append(&proc->vars, var);
+	return (uint32_t)(proc->vars.count - 1);
+}
+
+static void writeVar(GenSSA* gen, uint32_t var, uint32_t block, SSAValue value) {
+	SSABlock* blk = &gen->proc->blocks.elems[block];
+	while(blk->defs.count <= var) {
+		array_append(&blk->defs, SSA_NONE);
+	}
+	blk->defs.elems[var] = value;
+	
+	/* The first variable that a value is assigned to is where it's kept, if it needs a slot */
+	SSAInsn* insn = SSAProc_insn(gen->proc, value);
+	if(var != SSA_MEMORY && insn->var == SSA_NONE) {
+		insn->var = var;
+	}
+}
+
+static SSAValue readVar(GenSSA* gen, uint32_t var, uint32_t block) {
+	SSABlock* blk = &gen->proc->blocks.elems[block];
+	if(var < blk->defs.count && blk->defs.elems[var] != SSA_NONE) {
+		return SSAProc_find(gen->proc, blk->defs.elems[var]);
+	}
+	return readVarRecursive(gen, var, block);
+}
+
+static SSAValue readVarRecursive(GenSSA* gen, uint32_t var, uint32_t block) {
+	SSAProc* proc = gen->proc;
+	SSABlock* blk = &proc->blocks.elems[block];
+	SSAValue value;
+	if(!blk->sealed) {
+		/* Not every predecessor is known yet, so the phi gets its operands once they are */
+		value = addPhi(gen, var, block);
+		array_append(&proc->blocks.elems[block].incomplete, value);
+	}
+	else if(blk->preds.count == 0) {
+		/* The variable is read before it's assigned, or in code that never runs */
+		SSAType type = var == SSA_MEMORY ? SSA_MEM : SSA_INT;
+		value = SSAProc_addInsn(proc, block, block == 0 ? SSA_ENTRY : SSA_UNDEF, type, NULL, 0);
+		if(block == 0) {
+			proc->insns.elems[value].var = var;
+		}
+	}
+	else if(blk->preds.count == 1) {
+		value = readVar(gen, var, blk->preds.elems[0]);
+	}
+	else {
+		/* Recording the phi first stops the search from going around a loop forever */
+		value = addPhi(gen, var, block);
+		writeVar(gen, var, block, value);
+		value = addPhiOperands(gen, var, value);
+	}
+	
+	writeVar(gen, var, block, value);
+	return value;
+}
+
+static SSAValue addPhi(GenSSA* gen, uint32_t var, uint32_t block) {
+	SSAValue phi = SSAProc_addInsn(gen->proc, block, SSA_PHI, var == SSA_MEMORY ? SSA_MEM : SSA_INT, NULL, 0);
+	gen->proc->insns.elems[phi].var = var;
+	return phi;
+}
+
+static SSAValue addPhiOperands(GenSSA* gen, uint32_t var, SSAValue phi) {
+	/* Reading the operands can add other phis, so their operands are collected before any are added */
+	SSAProc* proc = gen->proc;
+	uint32_t block = proc->insns.elems[phi].block;
+	SSAValueArray operands = {0};
+	for(size_t i = 0; i < proc->blocks.elems[block].preds.count; i++) {
+		array_append(&operands, readVar(gen, var, proc->blocks.elems[block].preds.elems[i]));
+	}
+	
+	SSAInsn* insn = SSAProc_insn(proc, phi);
+	insn->args = (uint32_t)proc->args.count;
+	insn->arg_count = (uint32_t)operands.count;
+	array_extend(&proc->args, operands.elems, operands.count);
+	array_clear(&operands);
+	return removeTrivialPhi(gen, phi);
+}
+
+static SSAValue removeTrivialPhi(GenSSA* gen, SSAValue phi) {
+	/* A phi whose operands are all the same value, or the phi itself, is just that value */
+	SSAProc* proc = gen->proc;
+	SSAValue same = SSA_NONE;
+	for(uint32_t i = 0; i < proc->insns.elems[phi].arg_count; i++) {
+		SSAValue operand = SSAProc_arg(proc, phi, i);
+		if(operand == same || operand == phi) {
+			continue;
+		}
+		if(same != SSA_NONE) {
+			return phi;
+		}
+		same = operand;
+	}
+	
+	/* The phi can only refer to itself in code that never runs */
+	if(same == SSA_NONE) {
+		SSAInsn* insn = SSAProc_insn(proc, phi);
+		same = SSAProc_addInsn(proc, insn->block, SSA_UNDEF, insn->type, NULL, 0);
+	}
+	
+	/* Phis that used this one may have become trivial too, which optimizing the procedure finds */
+	SSAProc_replace(proc, phi, same);
+	return same;
+}
+
+static void sealBlock(GenSSA* gen, uint32_t block) {
+	SSAProc* proc = gen->proc;
+	for(size_t i = 0; i < proc->blocks.elems[block].incomplete.count; i++) {
+		SSAValue phi = proc->blocks.elems[block].incomplete.elems[i];
+		addPhiOperands(gen, proc->insns.elems[phi].var, phi);
+	}
+	
+	SSABlock* blk = &proc->blocks.elems[block];
+	array_clear(&blk->incomplete);
+	blk->sealed = true;
+}
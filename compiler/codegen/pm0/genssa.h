@@ -0,0 +1,30 @@
+//
+//  genssa.h
+//  PL/0
+//
+
+#ifndef PL0_GENSSA_H
+#define PL0_GENSSA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "config.h"
+#include "ssa.h"
+#include "compiler/ast_nodes.h"
+
+
+/*! Lower the AST of a block into SSA form, inlining the calls that the inliner chose. Variables
+ are turned into values as their assignments are found, and each basic block gets a phi for a
+ variable once it's read there before being assigned and its predecessors disagree. The basic
+ blocks are created in the same order and numbered the same way as the code that's lowered from
+ them, so that profiles keep matching. The procedures declared in the block must already have
+ code, as that's where the variables that they use are found
+ @param proc Empty procedure to build, whose scope is the block being lowered
+ @param ast AST of the whole program
+ @param block Index of the AST block to lower
+ @return True on success, false on failure
+ */
+bool GenSSA_genBlock(SSAProc* proc, const AST* ast, uint32_t block);
+
+
+#endif /* PL0_GENSSA_H */
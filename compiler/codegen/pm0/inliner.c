@@ -0,0 +1,236 @@
+//
+//  inliner.c
+//  PL/0
+//
+
+#include "inliner.h"
+#include "compiler/codegen/symbol.h"
+#include "dynamic_array.h"
+#include "block.h"
+
+
+typedef dynamic_array(Symbol*) SymbolArray;
+
+static size_t planBlock(SymbolArray* procs, const AST* ast, uint32_t block);
+static size_t costStmt(const AST* ast, AST_Node statement);
+static size_t costCond(const AST* ast, AST_Node condition);
+static size_t costExpr(const AST* ast, AST_Node expression);
+static size_t costCall(const AST* ast, Symbol* sym, uint32_t param_list);
+static void choose(SymbolArray* procs, size_t total_cost, Profile* profile);
+static void sortByCalls(SymbolArray* procs, Profile* profile);
+static bool getCalls(Profile* profile, Symbol* sym, uint64_t* calls);
+
+/* Instructions needed to call a procedure besides its parameters: INC 4, INC -(4+n), and CAL */
+#define CALL_COST 3
+
+/* Instructions in a procedure besides its statement: the INC for its frame and the RET */
+#define PROC_COST 2
+
+
+void inline_program(AST* prog, Profile* profile) {
+	SymbolArray procs = {0};
+	size_t total_cost = planBlock(&procs, prog, prog->program);
+	choose(&procs, total_cost, profile);
+	array_clear(&procs);
+}
+
+static void choose(SymbolArray* procs, size_t total_cost, Profile* profile) {
+	/* Leave at least half of the free space in the code segment alone, as the costs are only estimates */
+	size_t budget = 0;
+	if(total_cost < MAX_CODE_LENGTH) {
+		budget = (MAX_CODE_LENGTH - total_cost) / 2;
+	}
+	if(budget > INLINE_BUDGET) {
+		budget = INLINE_BUDGET;
+	}
+	
+	/* Give the procedures that are called the most the first pick of the budget */
+	if(profile != NULL) {
+		sortByCalls(procs, profile);
+	}
+	
+	foreach(procs, psym) {
+		Block* body = (*psym)->value.procedure.body;
+		if(body->call_count == 0) {
+			continue;
+		}
+		
+		/* Procedures that are called often are worth inlining even when they're a bit bigger, and
+		 ones that never ran aren't worth making the program any bigger for. Most calls to a
+		 recursive procedure come from itself, and those are never inlined
+		 */
+		size_t small_cost = INLINE_SMALL_COST;
+		uint64_t calls;
+		if(getCalls(profile, *psym, &calls)) {
+			if(calls == 0) {
+				small_cost = 0;
+			}
+			else if(calls >= INLINE_HOT_CALLS && !body->recursive) {
+				small_cost = INLINE_HOT_COST;
+			}
+		}
+		
+		/* With a single call, the inlined copy replaces the procedure instead of adding to the program */
+		size_t cost = body->estimated_length;
+		size_t growth = (body->call_count - 1) * cost;
+		if((body->call_count == 1 && cost <= INLINE_SINGLE_COST)
+		   || (cost <= small_cost && growth <= budget)) {
+			body->inlined = true;
+			budget -= growth;
+		}
+	}
+}
+
+static void sortByCalls(SymbolArray* procs, Profile* profile) {
+	/* Insertion sort keeps procedures with the same number of calls in the order they were declared */
+	for(size_t i = 1; i < procs->count; i++) {
+		Symbol* sym = procs->elems[i];
+		uint64_t calls = 0;
+		getCalls(profile, sym, &calls);
+		
+		size_t j = i;
+		while(j > 0) {
+			uint64_t prev_calls = 0;
+			getCalls(profile, procs->elems[j - 1], &prev_calls);
+			if(prev_calls >= calls) {
+				break;
+			}
+			procs->elems[j] = procs->elems[j - 1];
+			--j;
+		}
+		procs->elems[j] = sym;
+	}
+}
+
+static bool getCalls(Profile* profile, Symbol* sym, uint64_t* calls) {
+	/* Every call runs the first basic block of the procedure, unless it was inlined when profiled */
+	if(profile == NULL) {
+		return false;
+	}
+	
+	SymTree* symtree = sym->value.procedure.body->symtree;
+	return Profile_getBlockCount(profile, SymTree_getName(symtree), 0, calls);
+}
+
+static size_t planBlock(SymbolArray* procs, const AST* ast, uint32_t block) {
+	size_t cost = 0;
+	uint32_t count = AST_procCount(ast, block);
+	for(uint32_t i = 0; i < count; i++) {
+		AST_Proc* proc = &ast->procs.elems[AST_procAt(ast, block, i)];
+		Symbol* sym = AST_symbol(ast, proc->ident);
+		Block* body = sym->value.procedure.body;
+		body->ast = proc->body;
+		
+		/* Any calls to the procedure from its own body make it recursive */
+		size_t call_count = body->call_count;
+		body->estimated_length = planBlock(procs, ast, proc->body);
+		body->recursive = body->call_count != call_count;
+		/* An inlined copy doesn't need the static link, dynamic link, or return address */
+		body->inline_size = body->symtree->frame_size - 3;
+		cost += body->estimated_length;
+		
+		/* Procedures that declare their own procedures can't be inlined, since those need a static link to their frame */
+		if(AST_procCount(ast, proc->body) == 0) {
+			array_append(procs, sym);
+		}
+	}
+	
+	return cost + costStmt(ast, ast->blocks.elems[block].stmt) + PROC_COST;
+}
+
+static size_t costStmt(const AST* ast, AST_Node statement) {
+	if(statement == AST_NONE) {
+		return 0;
+	}
+	
+	uint32_t lhs = ast->lhs.elems[statement];
+	uint32_t rhs = ast->rhs.elems[statement];
+	size_t cost = 0;
+	switch(ast->types.elems[statement]) {
+		case STMT_ASSIGN:
+			return costExpr(ast, rhs) + 1;
+		
+		case STMT_CALL:
+			return costCall(ast, AST_symbol(ast, lhs), rhs);
+		
+		case STMT_BEGIN: {
+			uint32_t count = AST_listCount(ast, lhs);
+			for(uint32_t i = 0; i < count; i++) {
+				cost += costStmt(ast, AST_listItem(ast, lhs, i));
+			}
+			return cost;
+		}
+		
+		case STMT_IF: {
+			/* Conditional jump, plus a jump over the else branch */
+			AST_Node else_stmt = ast->extra.elems[rhs + 1];
+			cost = costCond(ast, lhs) + costStmt(ast, ast->extra.elems[rhs]) + 1;
+			if(else_stmt != AST_NONE) {
+				cost += costStmt(ast, else_stmt) + 1;
+			}
+			return cost;
+		}
+		
+		case STMT_WHILE:
+			/* Conditional jump out of the loop and the jump back to the condition */
+			return costCond(ast, lhs) + costStmt(ast, rhs) + 2;
+		
+		case STMT_READ:
+			return 2;
+		
+		case STMT_WRITE:
+			return costExpr(ast, lhs) + 1;
+		
+		default:
+			ASSERT(!"Unknown statement type");
+	}
+}
+
+static size_t costCond(const AST* ast, AST_Node condition) {
+	if(ast->types.elems[condition] == COND_ODD) {
+		return costExpr(ast, ast->lhs.elems[condition]) + 1;
+	}
+	
+	return costExpr(ast, ast->lhs.elems[condition]) + costExpr(ast, ast->rhs.elems[condition]) + 1;
+}
+
+static size_t costExpr(const AST* ast, AST_Node expression) {
+	uint32_t lhs = ast->lhs.elems[expression];
+	uint32_t rhs = ast->rhs.elems[expression];
+	switch(ast->types.elems[expression]) {
+		case EXPR_VAR:
+		case EXPR_NUM:
+			return 1;
+		
+		case EXPR_NEG:
+			return costExpr(ast, lhs) + 1;
+		
+		case EXPR_ADD:
+		case EXPR_SUB:
+		case EXPR_MUL:
+		case EXPR_DIV:
+		case EXPR_MOD:
+			return costExpr(ast, lhs) + costExpr(ast, rhs) + 1;
+		
+		case EXPR_CALL:
+			/* Plus the INC 1 that pushes the result */
+			return costCall(ast, AST_symbol(ast, lhs), rhs) + 1;
+		
+		default:
+			ASSERT(!"Unknown expression type");
+	}
+}
+
+static size_t costCall(const AST* ast, Symbol* sym, uint32_t param_list) {
+	++sym->value.procedure.body->call_count;
+	
+	size_t cost = CALL_COST;
+	if(param_list != AST_NONE) {
+		uint32_t count = AST_listCount(ast, param_list);
+		for(uint32_t i = 0; i < count; i++) {
+			cost += costExpr(ast, AST_listItem(ast, param_list, i));
+		}
+	}
+	
+	return cost;
+}
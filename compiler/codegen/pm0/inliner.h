@@ -0,0 +1,43 @@
+//
+//  inliner.h
+//  PL/0
+//
+
+#ifndef PL0_INLINER_H
+#define PL0_INLINER_H
+
+#include "config.h"
+#include "compiler/ast_nodes.h"
+#include "profile.h"
+
+/*! Procedures estimated to be at most this many instructions long are inlined at every call */
+#define INLINE_SMALL_COST 16
+
+/*! Procedures with a single call are inlined if they are estimated to be at most this long */
+#define INLINE_SINGLE_COST (MAX_CODE_LENGTH / 4)
+
+/*! Procedures that ran at least this many times in the profile are inlined at every call if they
+ are estimated to be at most INLINE_HOT_COST instructions long
+ */
+#define INLINE_HOT_CALLS 2
+
+/*! Size limit for inlining procedures at every call when the profile shows they're called often */
+#define INLINE_HOT_COST (INLINE_SMALL_COST * 2)
+
+/*! Inlining may grow the program by at most this many instructions */
+#define INLINE_BUDGET (MAX_CODE_LENGTH / 8)
+
+
+/*! Choose which procedures of a program will be inlined into their callers. Procedures are only
+ inlined when they don't declare any procedures of their own, and the code they add has to fit
+ in what's left of the code segment. Must be run after the binding pass and before any code is
+ generated, as this also keeps each procedure's AST for the code generator to inline
+ @param prog AST of the whole program
+ @param profile Profile of an earlier compilation, or NULL. Procedures that were called the most
+                get the first pick of the room in the code segment, and ones that never ran are
+                only inlined when that doesn't add any code
+ */
+void inline_program(AST* prog, Profile* profile);
+
+
+#endif /* PL0_INLINER_H */
@@ -0,0 +1,214 @@
+//
+//  layout.c
+//  PL/0
+//
+
+#include "layout.h"
+#include <stdlib.h>
+#include "dynamic_array.h"
+#include "loops.h"
+
+
+/* A branch that wouldn't need a jump if its target were placed right after it */
+typedef struct Edge {
+	size_t from;
+	size_t to;
+	size_t weight;
+	uint64_t count;     /* Number of times taking the branch would have needed a jump in the profile */
+	bool backward;      /* Set when the branch goes back to the start of a loop */
+	bool fallthrough;   /* Set when the branch already falls through */
+} Edge;
+typedef dynamic_array(Edge) EdgeArray;
+
+static void findLoopDepths(LoopInfo* info, size_t* depths);
+static void findEdges(LoopInfo* info, size_t* depths, EdgeArray* edges);
+static bool invertsOdd(BasicBlock* bb, BasicBlock* to);
+static uint64_t edgeCount(BasicBlock* bb);
+static size_t loopWeight(size_t depth);
+static int compareEdges(const void* a, const void* b);
+
+/* Number of times the body of a loop is assumed to run each time the loop is entered */
+#define LOOP_WEIGHT 8
+
+/* Loops nested deeper than this are all assumed to run as often as each other */
+#define MAX_LOOP_DEPTH 8
+
+
+void layout_optimize(Block* scope) {
+	/* Unreachable basic blocks were already removed, so this numbers every one of them */
+	LoopInfo info = {0};
+	LoopInfo_find(&info, scope->code);
+	BBArray* blocks = &info.blocks;
+	size_t n = blocks->count;
+	
+	size_t* depths = calloc_ff(n, sizeof(*depths));
+	findLoopDepths(&info, depths);
+	
+	EdgeArray edges = {0};
+	findEdges(&info, depths, &edges);
+	if(edges.count > 1) {
+		qsort(edges.elems, edges.count, sizeof(*edges.elems), &compareEdges);
+	}
+	
+	/* Join basic blocks into chains where each one falls through into the next, starting with the
+	 branches that are taken most often
+	 */
+	size_t* succ = malloc_ff(n * sizeof(*succ));
+	size_t* pred = malloc_ff(n * sizeof(*pred));
+	for(size_t i = 0; i < n; i++) {
+		succ[i] = pred[i] = BB_NONE;
+	}
+	foreach(&edges, edge) {
+		/* The entry has to stay first, so nothing can fall through into it */
+		if(succ[edge->from] != BB_NONE || pred[edge->to] != BB_NONE || edge->to == 0) {
+			continue;
+		}
+		
+		/* Joining the end of a chain to its own start would make a cycle */
+		size_t head = edge->from;
+		while(pred[head] != BB_NONE) {
+			head = pred[head];
+		}
+		if(head == edge->to) {
+			continue;
+		}
+		
+		succ[edge->from] = edge->to;
+		pred[edge->to] = edge->from;
+	}
+	
+	/* Relink the basic blocks chain by chain, starting with the chain of the entry and then in the
+	 order of their first basic blocks. Every basic block besides the entry is still referenced by
+	 exactly one other's next pointer, so no references need to change hands.
+	 */
+	BasicBlock* last = NULL;
+	for(size_t i = 0; i < n; i++) {
+		if(pred[i] != BB_NONE) {
+			continue;
+		}
+		
+		for(size_t j = i; j != BB_NONE; j = succ[j]) {
+			BasicBlock* cur = blocks->elems[j];
+			cur->prev = last;
+			if(last != NULL) {
+				last->next = cur;
+			}
+			last = cur;
+		}
+	}
+	last->next = NULL;
+	
+	destroy(&succ);
+	destroy(&pred);
+	destroy(&depths);
+	array_clear(&edges);
+	LoopInfo_clear(&info);
+}
+
+static void findLoopDepths(LoopInfo* info, size_t* depths) {
+	/* A basic block is nested as deep as the number of natural loops whose bodies contain it */
+	BBArray body = {0};
+	for(size_t i = 0; i < info->loops.count; i++) {
+		LoopInfo_findBody(info, i, &body);
+		foreach(&body, pbb) {
+			++depths[(*pbb)->index];
+		}
+		body.count = 0;
+	}
+	array_clear(&body);
+}
+
+static void findEdges(LoopInfo* info, size_t* depths, EdgeArray* edges) {
+	enumerate(&info->blocks, i, pbb) {
+		BasicBlock* bb = *pbb;
+		BasicBlock* targets[2] = {bb->target, (bb->flags & BB_HAS_CONDITION) ? bb->ztarget : NULL};
+		for(size_t k = 0; k < 2; k++) {
+			if(targets[k] == NULL || (k == 1 && targets[1] == targets[0]) || invertsOdd(bb, targets[k])) {
+				continue;
+			}
+			
+			/* A branch is taken as often as the less deeply nested of its two ends runs */
+			size_t to = targets[k]->index;
+			Edge edge = {
+				.from = i,
+				.to = to,
+				.weight = loopWeight(depths[i] < depths[to] ? depths[i] : depths[to]),
+				.count = edgeCount(bb),
+				.backward = LoopInfo_isBackEdge(info, bb, targets[k]),
+				.fallthrough = targets[k] == bb->next
+			};
+			array_append(edges, edge);
+		}
+	}
+}
+
+static bool invertsOdd(BasicBlock* bb, BasicBlock* to) {
+	/* Falling through to the false branch means jumping when the condition is true instead, which
+	 takes two more instructions when the condition is ODD
+	 */
+	if(!(bb->flags & BB_HAS_CONDITION) || bb->target == NULL || bb->target == bb->ztarget || to != bb->ztarget) {
+		return false;
+	}
+	
+	size_t count = (bb->flags & BB_HAS_TAIL) ? bb->tail_index : bb->insns.count;
+	ASSERT(count >= 1);
+	Insn last = bb->insns.elems[count - 1];
+	return last.op == OP_OPR && last.imm == ALU_ODD;
+}
+
+static uint64_t edgeCount(BasicBlock* bb) {
+	if(!(bb->flags & BB_PROFILED)) {
+		return 0;
+	}
+	
+	if(!(bb->flags & BB_HAS_CONDITION) || bb->target == bb->ztarget) {
+		return bb->exec_count;
+	}
+	
+	/* A conditional jump costs the same whether or not it's taken. Placing either target next only
+	 saves the JMP to the true target that would follow it, so both branches count the same
+	 */
+	if(bb->true_count + bb->false_count == 0) {
+		/* Without the outcomes of the condition, assume it was true half the time */
+		return bb->exec_count / 2;
+	}
+	return bb->true_count;
+}
+
+static size_t loopWeight(size_t depth) {
+	size_t weight = 1;
+	for(size_t i = 0; i < depth && i < MAX_LOOP_DEPTH; i++) {
+		weight *= LOOP_WEIGHT;
+	}
+	return weight;
+}
+
+static int compareEdges(const void* a, const void* b) {
+	const Edge* x = a;
+	const Edge* y = b;
+	
+	/* Branches that would have needed the most jumps in the profile come first */
+	if(x->count != y->count) {
+		return x->count > y->count ? -1 : 1;
+	}
+	
+	/* Then the ones that are expected to be taken most often */
+	if(x->weight != y->weight) {
+		return x->weight > y->weight ? -1 : 1;
+	}
+	
+	/* Back edges come next, so that loops are rotated to put their condition at the bottom */
+	if(x->backward != y->backward) {
+		return x->backward ? -1 : 1;
+	}
+	
+	/* Otherwise, keep branches that already fall through the way they are */
+	if(x->fallthrough != y->fallthrough) {
+		return x->fallthrough ? -1 : 1;
+	}
+	
+	if(x->from != y->from) {
+		return x->from < y->from ? -1 : 1;
+	}
+	return (x->to > y->to) - (x->to < y->to);
+}
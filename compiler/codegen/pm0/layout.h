@@ -0,0 +1,25 @@
+//
+//  layout.h
+//  PL/0
+//
+
+#ifndef PL0_LAYOUT_H
+#define PL0_LAYOUT_H
+
+#include "config.h"
+#include "basicblock.h"
+#include "block.h"
+
+
+/*! Reorder the basic blocks of a procedure so that the branches taken most often fall through
+ instead of jumping. Branches that were taken more often in the profile come first, if there is
+ one. Otherwise, branches inside loops are assumed to be taken more often than the ones around
+ them. Back edges are laid out before other branches that are taken as often, which rotates each
+ loop so that its condition sits at the bottom and the loop only needs a single conditional jump
+ per iteration. The first basic block of the procedure always stays first.
+ @param scope Block whose basic blocks should be reordered, after all other optimizations
+ */
+void layout_optimize(Block* scope);
+
+
+#endif /* PL0_LAYOUT_H */
@@ -0,0 +1,385 @@
+//
+//  licm.c
+//  PL/0
+//
+
+#include "licm.h"
+#include <stdlib.h>
+#include "dynamic_array.h"
+#include "loops.h"
+
+
+/* Everything that running the body of a loop might change */
+typedef struct Clobbers {
+	dynamic_array(Symbol*) vars;
+	dynamic_array(Word) slots;
+	bool nonlocals;     /* Set when the loop calls a procedure */
+	bool everything;    /* Set when the loop calls a procedure nested in this one */
+} Clobbers;
+
+/* A computation in the loop whose value never changes, and the slot it will be loaded from */
+typedef struct Hoist {
+	BasicBlock* bb;
+	size_t start;
+	size_t end;
+	Word slot;
+} Hoist;
+typedef dynamic_array(Hoist) HoistArray;
+
+static bool isColdLoop(BasicBlock* header, BBArray* body);
+static size_t hoistLoop(Block* scope, LoopInfo* info, size_t loop, BBArray* body, Word temp_offset,
+                        size_t temp_count, size_t* code_budget);
+static void findClobbers(Block* scope, BBArray* body, Clobbers* clobbers);
+static void findInvariants(Block* scope, BasicBlock* bb, Clobbers* clobbers, HoistArray* hoists);
+static bool isInvariantLoad(Block* scope, BasicBlock* bb, size_t index, Clobbers* clobbers, size_t* weight);
+static bool isSameComputation(Hoist* a, Hoist* b);
+static BasicBlock* createPreheader(LoopInfo* info, size_t loop);
+
+/* Computations must replace at least this many instructions or static link hops to be worth it */
+#define MIN_HOIST_WEIGHT 2
+
+/* Instructions added to the program by moving a new value out of a loop */
+#define HOIST_GROWTH 2
+
+
+size_t licm_optimize(Block* scope, Word temp_offset, size_t* code_budget) {
+	LoopInfo info = {0};
+	LoopInfo_find(&info, scope->code);
+	bool* done = calloc_ff(info.loops.count, sizeof(*done));
+	BBArray body = {0};
+	size_t temp_count = 0;
+	
+	/* Inner loops are handled first, and those are the smallest ones. A preheader makes every loop
+	 around it bigger, so the smallest loop that's left is looked for again each time
+	 */
+	for(size_t round = 0; round < info.loops.count; round++) {
+		size_t next = BB_NONE;
+		enumerate(&info.loops, i, loop) {
+			if(!done[i] && (next == BB_NONE || loop->size < info.loops.elems[next].size)) {
+				next = i;
+			}
+		}
+		done[next] = true;
+		
+		LoopInfo_findBody(&info, next, &body);
+		if(!isColdLoop(info.loops.elems[next].header, &body)) {
+			temp_count = hoistLoop(scope, &info, next, &body, temp_offset, temp_count, code_budget);
+		}
+		body.count = 0;
+	}
+	
+	array_clear(&body);
+	destroy(&done);
+	LoopInfo_clear(&info);
+	return temp_count;
+}
+
+static bool isColdLoop(BasicBlock* header, BBArray* body) {
+	/* The profile may not have every basic block of the loop, but if the ones it has never ran, then
+	 the condition only ever ran once each time the loop was reached. Hoisting would only add code
+	 */
+	bool profiled = false;
+	foreach(body, pbb) {
+		if(*pbb == header || !((*pbb)->flags & BB_PROFILED)) {
+			continue;
+		}
+		if((*pbb)->exec_count != 0) {
+			return false;
+		}
+		profiled = true;
+	}
+	
+	return profiled;
+}
+
+static size_t hoistLoop(Block* scope, LoopInfo* info, size_t loop, BBArray* body, Word temp_offset,
+                        size_t temp_count, size_t* code_budget) {
+	Clobbers clobbers = {0};
+	findClobbers(scope, body, &clobbers);
+	
+	HoistArray hoists = {0};
+	foreach(body, pbb) {
+		findInvariants(scope, *pbb, &clobbers, &hoists);
+	}
+	
+	BasicBlock* preheader = NULL;
+	enumerate(&hoists, i, hoist) {
+		/* The same computation in several places of the loop only needs to happen once */
+		hoist->slot = -1;
+		for(size_t j = 0; j < i; j++) {
+			if(hoists.elems[j].slot != -1 && isSameComputation(&hoists.elems[j], hoist)) {
+				hoist->slot = hoists.elems[j].slot;
+				break;
+			}
+		}
+		if(hoist->slot != -1) {
+			continue;
+		}
+		
+		/* Each new value adds its store in the preheader and its load in the loop to the program */
+		if(*code_budget < HOIST_GROWTH) {
+			continue;
+		}
+		*code_budget -= HOIST_GROWTH;
+		
+		/* Compute the value before the loop starts and keep it in a new temporary slot */
+		if(preheader == NULL) {
+			preheader = createPreheader(info, loop);
+		}
+		hoist->slot = temp_offset + (Word)temp_count++;
+		for(size_t k = hoist->start; k < hoist->end; k++) {
+			Symbol* sym = BasicBlock_findSymbol(hoist->bb, k);
+			if(sym != NULL) {
+				BasicBlock_markSymbol(preheader, sym);
+			}
+			BasicBlock_addInsn(preheader, hoist->bb->insns.elems[k]);
+		}
+		BasicBlock_addInsn(preheader, MAKE_STO(0, hoist->slot));
+	}
+	
+	/* Each computation in the loop is replaced by a load of its value, one basic block at a time */
+	BBEditArray edits = {0};
+	foreach(body, pbb) {
+		foreach(&hoists, hoist) {
+			if(hoist->bb == *pbb && hoist->slot != -1) {
+				BBEdit edit = {hoist->start, hoist->end, 1, {MAKE_LOD(0, hoist->slot)}, NULL};
+				array_append(&edits, edit);
+			}
+		}
+		
+		BasicBlock_applyEdits(*pbb, &edits);
+		edits.count = 0;
+	}
+	array_clear(&edits);
+	
+	array_clear(&hoists);
+	array_clear(&clobbers.vars);
+	array_clear(&clobbers.slots);
+	return temp_count;
+}
+
+static void findClobbers(Block* scope, BBArray* body, Clobbers* clobbers) {
+	foreach(body, pbb) {
+		BasicBlock* bb = *pbb;
+		enumerate(&bb->insns, i, insn) {
+			Symbol* sym = BasicBlock_findSymbol(bb, i);
+			if(insn->op == OP_STO) {
+				/* Stores without a symbol go to slots of this stack frame that nothing else can see */
+				if(sym != NULL) {
+					array_append(&clobbers->vars, sym);
+				}
+				else if(insn->lvl == 0) {
+					array_append(&clobbers->slots, insn->imm);
+				}
+				else {
+					clobbers->everything = true;
+				}
+			}
+			else if(insn->op == OP_CAL) {
+				/* Only procedures nested in this one can get to its variables */
+				clobbers->nonlocals = true;
+				if(sym == NULL || sym->level >= scope->symtree->level) {
+					clobbers->everything = true;
+				}
+			}
+		}
+	}
+}
+
+static void findInvariants(Block* scope, BasicBlock* bb, Clobbers* clobbers, HoistArray* hoists) {
+	size_t count = (bb->flags & BB_HAS_TAIL) ? bb->tail_index : bb->insns.count;
+	dynamic_array(StackValue) stack = {0};
+	dynamic_array(StackValue) found = {0};
+	
+	/* Only invariant values have a run, which is the code that can be moved out of the loop */
+	for(size_t i = 0; i < count; i++) {
+		Insn insn = bb->insns.elems[i];
+		StackValue value = {BB_NONE, i, i + 1, 1};
+		bool push = true;
+		
+		switch(insn.op) {
+			case OP_LIT:
+				break;
+			
+			case OP_LOD:
+				if(!isInvariantLoad(scope, bb, i, clobbers, &value.weight)) {
+					value.start = BB_NONE;
+				}
+				break;
+			
+			case OP_OPR:
+				if(insn.imm == ALU_NEG || insn.imm == ALU_ODD) {
+					if(stack.count < 1) {
+						stack.count = 0;
+						push = false;
+						break;
+					}
+					
+					stack.count -= 1;
+					value = StackValue_combine(&stack.elems[stack.count], 1, i);
+				}
+				else if(insn.imm >= ALU_ADD && insn.imm <= ALU_GEQ) {
+					if(stack.count < 2) {
+						stack.count = 0;
+						push = false;
+						break;
+					}
+					
+					/* Division can fail, so it has to stay where the program would have done it */
+					stack.count -= 2;
+					value = StackValue_combine(&stack.elems[stack.count], 2, i);
+					if(insn.imm == ALU_DIV || insn.imm == ALU_MOD) {
+						value.start = BB_NONE;
+					}
+				}
+				else {
+					stack.count = 0;
+					push = false;
+				}
+				break;
+			
+			case OP_STO:
+				if(stack.count != 0) {
+					--stack.count;
+				}
+				push = false;
+				break;
+			
+			default:
+				/* Anything else, like calls and I/O, makes it too hard to keep track of the stack */
+				stack.count = 0;
+				push = false;
+				break;
+		}
+		
+		if(push) {
+			array_append(&stack, value);
+			if(value.start != BB_NONE && value.weight >= MIN_HOIST_WEIGHT) {
+				array_append(&found, value);
+			}
+		}
+	}
+	
+	/* Larger computations are found after the ones inside of them, so going backwards finds the
+	 outermost ones first
+	 */
+	size_t first = hoists->count;
+	for(size_t i = found.count; i-- > 0;) {
+		StackValue* value = &found.elems[i];
+		
+		/* Never mix the condition code with the code before it, and keep the comparison at the end
+		 of the condition, as the branch after it can only be inverted by changing the comparison
+		 */
+		if((bb->flags & BB_HAS_CONDITION)
+		   && ((value->start < bb->cond_index && bb->cond_index < value->end) || value->end == count)) {
+			continue;
+		}
+		
+		bool inside = false;
+		for(size_t j = first; j < hoists->count; j++) {
+			if(value->start < hoists->elems[j].end && hoists->elems[j].start < value->end) {
+				inside = true;
+				break;
+			}
+		}
+		
+		if(!inside) {
+			Hoist hoist = {.bb = bb, .start = value->start, .end = value->end};
+			array_append(hoists, hoist);
+		}
+	}
+	
+	array_clear(&stack);
+	array_clear(&found);
+}
+
+static bool isInvariantLoad(Block* scope, BasicBlock* bb, size_t index, Clobbers* clobbers, size_t* weight) {
+	Insn insn = bb->insns.elems[index];
+	Symbol* sym = BasicBlock_findSymbol(bb, index);
+	if(sym == NULL) {
+		/* A slot of this stack frame, like a temporary or a variable of an inlined procedure */
+		if(insn.lvl != 0 || clobbers->everything) {
+			return false;
+		}
+		foreach(&clobbers->slots, pslot) {
+			if(*pslot == insn.imm) {
+				return false;
+			}
+		}
+		return true;
+	}
+	
+	if(sym->type != SYM_VAR || clobbers->everything) {
+		return false;
+	}
+	
+	/* Each static link that has to be followed to get to the variable makes loading it cost more */
+	uint16_t level = scope->symtree->level;
+	if(sym->level < level && clobbers->nonlocals) {
+		return false;
+	}
+	foreach(&clobbers->vars, pvar) {
+		if(*pvar == sym) {
+			return false;
+		}
+	}
+	
+	*weight = 1 + (level - sym->level);
+	return true;
+}
+
+static bool isSameComputation(Hoist* a, Hoist* b) {
+	if(a->end - a->start != b->end - b->start) {
+		return false;
+	}
+	
+	for(size_t i = 0; i < a->end - a->start; i++) {
+		Insn x = a->bb->insns.elems[a->start + i];
+		Insn y = b->bb->insns.elems[b->start + i];
+		if(x.op != y.op || x.lvl != y.lvl || x.imm != y.imm
+		   || BasicBlock_findSymbol(a->bb, a->start + i) != BasicBlock_findSymbol(b->bb, b->start + i)) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+static BasicBlock* createPreheader(LoopInfo* info, size_t loop) {
+	BasicBlock* header = info->loops.elems[loop].header;
+	BasicBlock* preheader = BasicBlock_new();
+	
+	/* Put the preheader right before the header so it can fall through into it. The preheader takes
+	 over the reference that the previous basic block held to the header
+	 */
+	preheader->prev = header->prev;
+	preheader->next = header;
+	header->prev->next = preheader;
+	header->prev = preheader;
+	BasicBlock_setTarget(preheader, header);
+	
+	/* Every branch into the loop from outside of it now goes through the preheader. The only
+	 branches to the header from inside of the loop are its back edges
+	 */
+	BBArray preds = {0};
+	foreach(&header->coderefs, pfrom) {
+		array_append(&preds, *pfrom);
+	}
+	foreach(&preds, pfrom) {
+		BasicBlock* from = *pfrom;
+		if(from == preheader || LoopInfo_isBackEdge(info, from, header)) {
+			continue;
+		}
+		
+		if(from->target == header) {
+			BasicBlock_setTarget(from, preheader);
+		}
+		if((from->flags & BB_HAS_CONDITION) && from->ztarget == header) {
+			BasicBlock_setFalseTarget(from, preheader);
+		}
+	}
+	array_clear(&preds);
+	
+	LoopInfo_addPreheader(info, loop, preheader);
+	return preheader;
+}
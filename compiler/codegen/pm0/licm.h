@@ -0,0 +1,32 @@
+//
+//  licm.h
+//  PL/0
+//
+
+#ifndef PL0_LICM_H
+#define PL0_LICM_H
+
+#include <stddef.h>
+#include "config.h"
+#include "basicblock.h"
+#include "block.h"
+
+
+/*! Move computations that produce the same value on every iteration of a loop out of the loop.
+ Loops are found from the back edges of the procedure's control flow graph, and each loop gets a
+ preheader basic block that computes its invariant values once and stores them in temporary slots
+ of the stack frame. Variables are only changed by stores to them by name, and calls are assumed
+ to change every variable that isn't local to the procedure. Inner loops are handled first, so
+ their invariant values can be moved further out when they don't change in the outer loop either.
+ Loops whose body never ran in the profile, if there is one, are left alone.
+ @param scope Block to optimize, whose basic blocks must not have their tails yet, as a preheader
+ is put in front of its header in code order and changes which basic block falls through into which
+ @param temp_offset Frame offset of the first temporary slot that can be used
+ @param code_budget Number of instructions that may still be added to the program, which is
+ reduced by however many this adds
+ @return Number of temporary slots used, starting at temp_offset
+ */
+size_t licm_optimize(Block* scope, Word temp_offset, size_t* code_budget);
+
+
+#endif /* PL0_LICM_H */
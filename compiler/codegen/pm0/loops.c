@@ -0,0 +1,225 @@
+//
+//  loops.c
+//  PL/0
+//
+
+#include "loops.h"
+#include <stdlib.h>
+
+
+static void findPostorder(LoopInfo* self, size_t* order, size_t* rpo);
+static size_t findSuccessors(BasicBlock* bb, BasicBlock* succs[2]);
+static size_t intersect(LoopInfo* self, size_t* order, size_t a, size_t b);
+
+
+void LoopInfo_find(LoopInfo* self, BasicBlock* entry) {
+	BasicBlock_findReachable(entry, &self->blocks);
+	size_t n = self->blocks.count;
+	
+	size_t* order = malloc_ff(n * sizeof(*order));
+	size_t* rpo = malloc_ff(n * sizeof(*rpo));
+	findPostorder(self, order, rpo);
+	
+	/* A basic block is dominated by whatever dominates all of its predecessors. Visiting them in
+	 reverse postorder means most predecessors are done first, so this settles quickly
+	 */
+	for(size_t i = 0; i < n; i++) {
+		array_append(&self->idom, BB_NONE);
+	}
+	self->idom.elems[0] = 0;
+	
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		for(size_t k = 1; k < n; k++) {
+			size_t b = rpo[k];
+			size_t idom = BB_NONE;
+			foreach(&self->blocks.elems[b]->coderefs, pfrom) {
+				size_t from = (*pfrom)->index;
+				if(from == BB_NONE || self->idom.elems[from] == BB_NONE) {
+					continue;
+				}
+				idom = idom == BB_NONE ? from : intersect(self, order, from, idom);
+			}
+			
+			if(self->idom.elems[b] != idom) {
+				self->idom.elems[b] = idom;
+				changed = true;
+			}
+		}
+	}
+	destroy(&order);
+	destroy(&rpo);
+	
+	/* Any branch to a basic block that dominates it is a back edge, and its target is a loop header.
+	 The entry is never one, as there's no room for a preheader in front of it
+	 */
+	size_t* loop_of = malloc_ff(n * sizeof(*loop_of));
+	loop_of[0] = BB_NONE;
+	for(size_t h = 1; h < n; h++) {
+		BasicBlock* header = self->blocks.elems[h];
+		loop_of[h] = BB_NONE;
+		foreach(&header->coderefs, pfrom) {
+			if(LoopInfo_isBackEdge(self, *pfrom, header)) {
+				Loop loop = {.header = header};
+				loop_of[h] = self->loops.count;
+				array_append(&self->loops, loop);
+				break;
+			}
+		}
+	}
+	
+	/* A loop is inside of every loop whose body contains its header */
+	BBArray body = {0};
+	enumerate(&self->loops, i, loop) {
+		LoopInfo_findBody(self, i, &body);
+		loop->size = body.count;
+		foreach(&body, pbb) {
+			size_t inner = loop_of[(*pbb)->index];
+			if(inner != BB_NONE && inner != i) {
+				array_append(&self->loops.elems[inner].outer, i);
+			}
+		}
+		body.count = 0;
+	}
+	array_clear(&body);
+	destroy(&loop_of);
+}
+
+static void findPostorder(LoopInfo* self, size_t* order, size_t* rpo) {
+	size_t n = self->blocks.count;
+	size_t* next_succ = calloc_ff(n, sizeof(*next_succ));
+	bool* seen = calloc_ff(n, sizeof(*seen));
+	dynamic_array(size_t) stack = {0};
+	
+	/* Depth-first search from the entry, numbering each basic block once all of its successors are */
+	size_t count = 0;
+	seen[0] = true;
+	array_append(&stack, 0);
+	while(stack.count != 0) {
+		size_t b = stack.elems[stack.count - 1];
+		BasicBlock* succs[2];
+		size_t succ_count = findSuccessors(self->blocks.elems[b], succs);
+		if(next_succ[b] < succ_count) {
+			size_t s = succs[next_succ[b]++]->index;
+			if(!seen[s]) {
+				seen[s] = true;
+				array_append(&stack, s);
+			}
+			continue;
+		}
+		
+		--stack.count;
+		order[b] = count;
+		rpo[n - 1 - count] = b;
+		++count;
+	}
+	ASSERT(count == n);
+	
+	array_clear(&stack);
+	destroy(&seen);
+	destroy(&next_succ);
+}
+
+static size_t findSuccessors(BasicBlock* bb, BasicBlock* succs[2]) {
+	size_t count = 0;
+	if(bb->target != NULL) {
+		succs[count++] = bb->target;
+	}
+	if((bb->flags & BB_HAS_CONDITION) && bb->ztarget != NULL && bb->ztarget != bb->target) {
+		succs[count++] = bb->ztarget;
+	}
+	return count;
+}
+
+static size_t intersect(LoopInfo* self, size_t* order, size_t a, size_t b) {
+	/* Climb the dominator tree from whichever is numbered lower until both meet */
+	while(a != b) {
+		while(order[a] < order[b]) {
+			a = self->idom.elems[a];
+		}
+		while(order[b] < order[a]) {
+			b = self->idom.elems[b];
+		}
+	}
+	return a;
+}
+
+bool LoopInfo_dominates(LoopInfo* self, BasicBlock* dom, BasicBlock* bb) {
+	if(dom->index == BB_NONE || bb->index == BB_NONE) {
+		return false;
+	}
+	
+	/* The entry is its own immediate dominator, which is where the walk up the tree stops */
+	size_t cur = bb->index;
+	while(cur != dom->index) {
+		size_t up = self->idom.elems[cur];
+		if(up == cur) {
+			return false;
+		}
+		cur = up;
+	}
+	return true;
+}
+
+bool LoopInfo_isBackEdge(LoopInfo* self, BasicBlock* from, BasicBlock* to) {
+	return LoopInfo_dominates(self, to, from);
+}
+
+void LoopInfo_findBody(LoopInfo* self, size_t loop, BBArray* body) {
+	BasicBlock* header = self->loops.elems[loop].header;
+	bool* seen = calloc_ff(self->blocks.count, sizeof(*seen));
+	seen[header->index] = true;
+	array_append(body, header);
+	
+	/* Walk backwards from each back edge, stopping at the header */
+	BBArray worklist = {0};
+	foreach(&header->coderefs, platch) {
+		BasicBlock* latch = *platch;
+		if(!LoopInfo_isBackEdge(self, latch, header) || seen[latch->index]) {
+			continue;
+		}
+		
+		seen[latch->index] = true;
+		array_append(body, latch);
+		array_append(&worklist, latch);
+		while(worklist.count != 0) {
+			BasicBlock* cur = worklist.elems[--worklist.count];
+			foreach(&cur->coderefs, pfrom) {
+				size_t from = (*pfrom)->index;
+				if(from != BB_NONE && !seen[from]) {
+					seen[from] = true;
+					array_append(body, *pfrom);
+					array_append(&worklist, *pfrom);
+				}
+			}
+		}
+	}
+	
+	array_clear(&worklist);
+	destroy(&seen);
+}
+
+void LoopInfo_addPreheader(LoopInfo* self, size_t loop, BasicBlock* preheader) {
+	Loop* cur = &self->loops.elems[loop];
+	size_t header = cur->header->index;
+	
+	/* The preheader takes the header's place in the dominator tree, right above the header */
+	preheader->index = self->blocks.count;
+	array_append(&self->blocks, preheader);
+	array_append(&self->idom, self->idom.elems[header]);
+	self->idom.elems[header] = preheader->index;
+	
+	foreach(&cur->outer, pouter) {
+		++self->loops.elems[*pouter].size;
+	}
+}
+
+void LoopInfo_clear(LoopInfo* self) {
+	foreach(&self->loops, loop) {
+		array_clear(&loop->outer);
+	}
+	array_clear(&self->loops);
+	array_clear(&self->idom);
+	array_clear(&self->blocks);
+}
@@ -0,0 +1,74 @@
+//
+//  loops.h
+//  PL/0
+//
+
+#ifndef PL0_LOOPS_H
+#define PL0_LOOPS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+#include "basicblock.h"
+
+
+/*! A natural loop, made of its header and every basic block that can get back to it without
+ leaving the loop. All back edges to the same header belong to the same loop
+ */
+typedef struct Loop {
+	BasicBlock* header;
+	size_t size;                    /*!< Number of basic blocks in the body, including the header */
+	dynamic_array(size_t) outer;    /*!< Loops whose bodies contain this loop's header */
+} Loop;
+
+/*! Dominators and natural loops of a procedure's control flow graph */
+typedef struct LoopInfo {
+	/*! Reachable basic blocks in code order, each of which has its position here as its index */
+	BBArray blocks;
+	
+	/*! Index of the immediate dominator of each basic block, where the entry is its own */
+	dynamic_array(size_t) idom;
+	
+	/*! Natural loops in the code order of their headers */
+	dynamic_array(Loop) loops;
+} LoopInfo;
+
+
+/*! Find the dominators and natural loops of a procedure. Dominators are computed once over the
+ reverse postorder of the basic blocks, which only takes a few passes for the structured control
+ flow that the code generator produces
+ @param entry First basic block of the procedure
+ */
+void LoopInfo_find(LoopInfo* self, BasicBlock* entry);
+
+/*! Check whether every path from the entry to a basic block goes through another one
+ @param dom Basic block that might dominate the other one
+ @param bb Basic block that might be dominated, which is never dominated if it isn't reachable
+ */
+bool LoopInfo_dominates(LoopInfo* self, BasicBlock* dom, BasicBlock* bb);
+
+/*! Check whether a branch goes back to the header of a loop that contains it
+ @param from Basic block that branches
+ @param to Target of the branch
+ */
+bool LoopInfo_isBackEdge(LoopInfo* self, BasicBlock* from, BasicBlock* to);
+
+/*! Collect the body of a loop, starting with its header followed by the basic blocks that are found
+ by walking backwards from each back edge
+ @param loop Index of the loop in loops
+ @param body Empty array to append the basic blocks of the loop to
+ */
+void LoopInfo_findBody(LoopInfo* self, size_t loop, BBArray* body);
+
+/*! Record a basic block that was put on every branch into a loop from outside of it, which
+ becomes part of every loop that contains the header. Nothing else about the loops changes
+ @param loop Index of the loop in loops
+ @param preheader New basic block whose only successor is the loop's header
+ */
+void LoopInfo_addPreheader(LoopInfo* self, size_t loop, BasicBlock* preheader);
+
+/*! Free everything that LoopInfo_find allocated */
+void LoopInfo_clear(LoopInfo* self);
+
+
+#endif /* PL0_LOOPS_H */
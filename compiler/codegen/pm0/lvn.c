@@ -0,0 +1,361 @@
+//
+//  lvn.c
+//  PL/0
+//
+
+#include "lvn.h"
+#include <stdlib.h>
+#include "dynamic_array.h"
+
+
+typedef enum ValueKind {
+	VAL_FRESH,   /*!< Value that is never equal to any other, like the result of a call or read */
+	VAL_LIT,     /*!< Literal number */
+	VAL_CONST,   /*!< Constant symbol that hasn't been resolved yet */
+	VAL_LOAD,    /*!< Variable as of one of its stores */
+	VAL_UNARY,   /*!< Result of NEG or ODD */
+	VAL_BINARY   /*!< Result of an ALU operation on two values */
+} ValueKind;
+
+/* Everything that two computations need to agree on to produce the same value */
+typedef struct Value {
+	ValueKind kind;
+	Word op;
+	size_t left;
+	size_t right;
+	Symbol* sym;
+	size_t version;
+} Value;
+
+/* All occurrences of one value number, in code order */
+typedef struct Candidate {
+	size_t vn;
+	size_t weight;
+	size_t first;
+	dynamic_array(StackValue) occurs;
+} Candidate;
+
+typedef struct LVN {
+	BasicBlock* bb;
+	uint16_t level;
+	dynamic_array(Value) values;
+	size_t values_start;
+	dynamic_array(StackValue) stack;
+	dynamic_array(StackValue) occurs;
+	dynamic_array(struct {
+		Symbol* sym;
+		size_t version;
+	}) versions;
+	size_t next_version;
+} LVN;
+
+static void lvnSimulate(LVN* lvn);
+static void lvnBarrier(LVN* lvn);
+static size_t lvnNumber(LVN* lvn, Value value);
+static size_t lvnVersion(LVN* lvn, Symbol* sym);
+static void lvnBumpVersion(LVN* lvn, Symbol* sym);
+static void lvnPush(LVN* lvn, StackValue sv);
+static bool isCommutative(Word aluop);
+static int compareCandidates(const void* a, const void* b);
+
+
+size_t lvn_optimize(BasicBlock* bb, Block* scope, Word temp_offset) {
+	LVN lvn = {0};
+	lvn.bb = bb;
+	lvn.level = scope->symtree->level;
+	lvnSimulate(&lvn);
+	
+	/* Group the values that were computed more than once */
+	dynamic_array(Candidate) candidates = {0};
+	enumerate(&lvn.occurs, i, occur) {
+		Candidate* found = NULL;
+		foreach(&candidates, cand) {
+			if(cand->vn == occur->value) {
+				found = cand;
+				break;
+			}
+		}
+		
+		if(found == NULL) {
+			Candidate cand = {0};
+			cand.vn = occur->value;
+			cand.weight = occur->weight;
+			cand.first = i;
+			array_append(&candidates, cand);
+			found = &candidates.elems[candidates.count - 1];
+		}
+		array_append(&found->occurs, *occur);
+	}
+	
+	/* Reusing the most expensive values first means their subexpressions don't need to be reused */
+	if(candidates.count > 1) {
+		qsort(candidates.elems, candidates.count, sizeof(*candidates.elems), &compareCandidates);
+	}
+	
+	size_t temp_count = 0;
+	BBEditArray edits = {0};
+	foreach(&candidates, cand) {
+		/* Skip computations that are already inside of code that won't run any more */
+		dynamic_array(StackValue) live = {0};
+		foreach(&cand->occurs, occur) {
+			bool removed = false;
+			foreach(&edits, edit) {
+				if(edit->start != edit->end && edit->start <= occur->start && occur->end <= edit->end) {
+					removed = true;
+					break;
+				}
+			}
+			
+			if(!removed) {
+				array_append(&live, *occur);
+			}
+		}
+		
+		if(live.count >= 2) {
+			/* Computing the value again right after it was computed is replaced by DUP when that's cheaper */
+			size_t temp_saved = 0;
+			size_t temp_reuses = 0;
+			for(size_t i = 1; i < live.count; i++) {
+				if(live.elems[i].start == live.elems[i - 1].end) {
+					if(cand->weight > 1) {
+						BBEdit dup = {live.elems[i].start, live.elems[i].end, 1, {MAKE_DUP()}, NULL};
+						array_append(&edits, dup);
+					}
+				}
+				else {
+					temp_saved += cand->weight - 1;
+					++temp_reuses;
+				}
+			}
+			
+			/* Storing the value to a temporary costs two instructions, so the reuses have to save more */
+			if(temp_reuses != 0 && temp_saved > 2) {
+				/* Keep the value on the stack for the code that originally used it */
+				Word slot = temp_offset + (Word)temp_count++;
+				BBEdit store = {live.elems[0].end, live.elems[0].end, 2, {MAKE_STO(0, slot), MAKE_LOD(0, slot)}, NULL};
+				array_append(&edits, store);
+				
+				for(size_t i = 1; i < live.count; i++) {
+					if(live.elems[i].start != live.elems[i - 1].end) {
+						BBEdit load = {live.elems[i].start, live.elems[i].end, 1, {MAKE_LOD(0, slot)}, NULL};
+						array_append(&edits, load);
+					}
+				}
+			}
+		}
+		
+		array_clear(&live);
+	}
+	
+	BasicBlock_applyEdits(bb, &edits);
+	
+	foreach(&candidates, cand) {
+		array_clear(&cand->occurs);
+	}
+	array_clear(&candidates);
+	array_clear(&edits);
+	array_clear(&lvn.values);
+	array_clear(&lvn.stack);
+	array_clear(&lvn.occurs);
+	array_clear(&lvn.versions);
+	return temp_count;
+}
+
+static void lvnSimulate(LVN* lvn) {
+	BasicBlock* bb = lvn->bb;
+	size_t count = (bb->flags & BB_HAS_TAIL) ? bb->tail_index : bb->insns.count;
+	
+	for(size_t i = 0; i < count; i++) {
+		Insn insn = bb->insns.elems[i];
+		Symbol* sym = BasicBlock_findSymbol(bb, i);
+		Value value = {0};
+		StackValue pushed = {BB_NONE, i, i + 1, 1};
+		
+		switch(insn.op) {
+			case OP_LIT:
+				if(sym != NULL) {
+					value.kind = VAL_CONST;
+					value.sym = sym;
+				}
+				else {
+					value.kind = VAL_LIT;
+					value.op = insn.imm;
+				}
+				pushed.value = lvnNumber(lvn, value);
+				lvnPush(lvn, pushed);
+				break;
+			
+			case OP_LOD:
+				if(sym != NULL && sym->type == SYM_VAR) {
+					/* Loads through static links cost more the further out the variable is */
+					value.kind = VAL_LOAD;
+					value.sym = sym;
+					value.version = lvnVersion(lvn, sym);
+					pushed.weight += lvn->level - sym->level;
+				}
+				pushed.value = lvnNumber(lvn, value);
+				lvnPush(lvn, pushed);
+				break;
+			
+			case OP_STO:
+				if(sym == NULL || sym->type != SYM_VAR || lvn->stack.count < 1) {
+					lvnBarrier(lvn);
+					break;
+				}
+				--lvn->stack.count;
+				lvnBumpVersion(lvn, sym);
+				break;
+			
+			case OP_OPR:
+				switch(insn.imm) {
+					case ALU_NEG:
+					case ALU_ODD: {
+						if(lvn->stack.count < 1) {
+							lvnBarrier(lvn);
+							break;
+						}
+						
+						StackValue operand = lvn->stack.elems[--lvn->stack.count];
+						pushed = StackValue_combine(&operand, 1, i);
+						if(pushed.start != BB_NONE) {
+							value.kind = VAL_UNARY;
+							value.op = insn.imm;
+							value.left = operand.value;
+						}
+						pushed.value = lvnNumber(lvn, value);
+						lvnPush(lvn, pushed);
+						break;
+					}
+					
+					case ALU_ADD:
+					case ALU_SUB:
+					case ALU_MUL:
+					case ALU_DIV:
+					case ALU_MOD:
+					case ALU_EQL:
+					case ALU_NEQ:
+					case ALU_LSS:
+					case ALU_LEQ:
+					case ALU_GTR:
+					case ALU_GEQ: {
+						if(lvn->stack.count < 2) {
+							lvnBarrier(lvn);
+							break;
+						}
+						
+						lvn->stack.count -= 2;
+						StackValue* operands = &lvn->stack.elems[lvn->stack.count];
+						pushed = StackValue_combine(operands, 2, i);
+						
+						/* Only reuse values whose instructions can be replaced as a single run */
+						if(pushed.start != BB_NONE) {
+							value.kind = VAL_BINARY;
+							value.op = insn.imm;
+							value.left = operands[0].value;
+							value.right = operands[1].value;
+							if(isCommutative(insn.imm) && value.left > value.right) {
+								value.left = operands[1].value;
+								value.right = operands[0].value;
+							}
+						}
+						pushed.value = lvnNumber(lvn, value);
+						lvnPush(lvn, pushed);
+						break;
+					}
+					
+					default:
+						lvnBarrier(lvn);
+						break;
+				}
+				break;
+			
+			case OP_SIO:
+				if(insn.imm == 1 && lvn->stack.count >= 1) {
+					/* WRITE */
+					--lvn->stack.count;
+				}
+				else if(insn.imm == 2) {
+					/* READ */
+					pushed.value = lvnNumber(lvn, value);
+					lvnPush(lvn, pushed);
+				}
+				else {
+					lvnBarrier(lvn);
+				}
+				break;
+			
+			default:
+				/* Calls can change any variable, and stack adjustments hide what's on the stack */
+				lvnBarrier(lvn);
+				break;
+		}
+	}
+}
+
+static void lvnBarrier(LVN* lvn) {
+	/* Nothing computed so far can be reused */
+	array_clear(&lvn->stack);
+	lvn->values_start = lvn->values.count;
+}
+
+static size_t lvnNumber(LVN* lvn, Value value) {
+	if(value.kind != VAL_FRESH) {
+		for(size_t i = lvn->values_start; i < lvn->values.count; i++) {
+			Value* cur = &lvn->values.elems[i];
+			if(cur->kind == value.kind && cur->op == value.op && cur->left == value.left
+			   && cur->right == value.right && cur->sym == value.sym && cur->version == value.version) {
+				return i;
+			}
+		}
+	}
+	
+	array_append(&lvn->values, value);
+	return lvn->values.count - 1;
+}
+
+static size_t lvnVersion(LVN* lvn, Symbol* sym) {
+	foreach(&lvn->versions, ver) {
+		if(ver->sym == sym) {
+			return ver->version;
+		}
+	}
+	
+	return 0;
+}
+
+static void lvnBumpVersion(LVN* lvn, Symbol* sym) {
+	size_t version = ++lvn->next_version;
+	foreach(&lvn->versions, ver) {
+		if(ver->sym == sym) {
+			ver->version = version;
+			return;
+		}
+	}
+	
+	element_type(lvn->versions) ver = {sym, version};
+	array_append(&lvn->versions, ver);
+}
+
+static void lvnPush(LVN* lvn, StackValue sv) {
+	array_append(&lvn->stack, sv);
+	
+	/* Only values computed by a single run of instructions can be reused */
+	if(sv.start != BB_NONE) {
+		array_append(&lvn->occurs, sv);
+	}
+}
+
+static bool isCommutative(Word aluop) {
+	return aluop == ALU_ADD || aluop == ALU_MUL || aluop == ALU_EQL || aluop == ALU_NEQ;
+}
+
+static int compareCandidates(const void* a, const void* b) {
+	const Candidate* ca = a;
+	const Candidate* cb = b;
+	
+	/* Most expensive first, then in code order */
+	if(ca->weight != cb->weight) {
+		return ca->weight > cb->weight ? -1 : 1;
+	}
+	return ca->first < cb->first ? -1 : ca->first > cb->first;
+}
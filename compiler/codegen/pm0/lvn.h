@@ -0,0 +1,28 @@
+//
+//  lvn.h
+//  PL/0
+//
+
+#ifndef PL0_LVN_H
+#define PL0_LVN_H
+
+#include <stddef.h>
+#include "config.h"
+#include "basicblock.h"
+#include "block.h"
+
+
+/*! Find values that a basic block computes more than once using local value numbering, and
+ compute each of them only once. A value that is needed again right after it was computed is
+ copied with DUP, and any other repeat is loaded from a temporary slot in the stack frame. Only
+ arithmetic on constants and variables is reused, and nothing is reused across a call, since the
+ callee could modify any variable.
+ @param bb Basic block to optimize, of which only the code before the tail is changed
+ @param scope Block that the basic block belongs to
+ @param temp_offset Frame offset of the first temporary slot that can be used
+ @return Number of temporary slots used, starting at temp_offset
+ */
+size_t lvn_optimize(BasicBlock* bb, Block* scope, Word temp_offset);
+
+
+#endif /* PL0_LVN_H */
@@ -0,0 +1,231 @@
+//
+//  peephole.c
+//  PL/0
+//
+
+#include "peephole.h"
+#include <string.h>
+
+
+static size_t rewriteNegLit(const Insn* window, PeepholeOut* replacement);
+static size_t rewriteIncInc(const Insn* window, PeepholeOut* replacement);
+static size_t rewriteStoLod(const Insn* window, PeepholeOut* replacement);
+static bool peepholePass(BasicBlock* bb);
+static bool matchRule(BasicBlock* bb, const PeepholeRule* rule, size_t index);
+static void applyRule(BasicBlock* bb, const PeepholeRule* rule, size_t index);
+static bool isKept(const PeepholeOut* replacement, size_t count, size_t window_index);
+
+
+#define PAT(op, imm)  {(op), false, (imm)}
+#define PAT_ANY(op)   {(op), true, 0}
+
+static const PeepholeRule rules[] = {
+	{
+		/* Adding or subtracting zero does nothing */
+		.name = "LIT 0; ADD -> nothing",
+		.length = 2,
+		.pattern = {PAT(OP_LIT, 0), PAT(OP_OPR, ALU_ADD)},
+	},
+	{
+		.name = "LIT 0; SUB -> nothing",
+		.length = 2,
+		.pattern = {PAT(OP_LIT, 0), PAT(OP_OPR, ALU_SUB)},
+	},
+	{
+		/* Negating twice gives back the original value */
+		.name = "NEG; NEG -> nothing",
+		.length = 2,
+		.pattern = {PAT(OP_OPR, ALU_NEG), PAT(OP_OPR, ALU_NEG)},
+	},
+	{
+		.name = "LIT n; NEG -> LIT -n",
+		.length = 2,
+		.pattern = {PAT_ANY(OP_LIT), PAT(OP_OPR, ALU_NEG)},
+		.rewrite = &rewriteNegLit,
+	},
+	{
+		/* Storing a variable's value right back into it does nothing */
+		.name = "LOD x; STO x -> nothing",
+		.length = 2,
+		.pattern = {PAT_ANY(OP_LOD), PAT_ANY(OP_STO)},
+		.same_var = true,
+	},
+	{
+		/* Loading a variable right after storing to it can copy the value before the store instead */
+		.name = "STO x; LOD x -> DUP; STO x",
+		.length = 2,
+		.pattern = {PAT_ANY(OP_STO), PAT_ANY(OP_LOD)},
+		.same_var = true,
+		.rewrite = &rewriteStoLod,
+	},
+	{
+		.name = "INC a; INC b -> INC a+b",
+		.length = 2,
+		.pattern = {PAT_ANY(OP_INC), PAT_ANY(OP_INC)},
+		.rewrite = &rewriteIncInc,
+	},
+	{
+		.name = "INC 0 -> nothing",
+		.length = 1,
+		.pattern = {PAT(OP_INC, 0)},
+	},
+};
+
+#undef PAT
+#undef PAT_ANY
+
+
+/* Replacement instructions for the rewrite functions */
+#define OUT(new_insn) ((PeepholeOut){.insn = (new_insn)})
+#define OUT_KEEP(i)   ((PeepholeOut){.keep = true, .index = (i)})
+
+static size_t rewriteNegLit(const Insn* window, PeepholeOut* replacement) {
+	/* Negation wraps around just like it does in the VM */
+	replacement[0] = OUT(MAKE_LIT((Word)-(uint32_t)window[0].imm));
+	return 1;
+}
+
+static size_t rewriteIncInc(const Insn* window, PeepholeOut* replacement) {
+	replacement[0] = OUT(MAKE_INC(window[0].imm + window[1].imm));
+	return 1;
+}
+
+static size_t rewriteStoLod(const Insn* window, PeepholeOut* replacement) {
+	(void)window;
+	replacement[0] = OUT(MAKE_DUP());
+	replacement[1] = OUT_KEEP(0);
+	return 2;
+}
+
+#undef OUT
+#undef OUT_KEEP
+
+bool peephole_optimize(BasicBlock* bb) {
+	/* Each rewrite can create new matches for the instructions around it */
+	bool changed = false;
+	while(peepholePass(bb)) {
+		changed = true;
+	}
+	
+	return changed;
+}
+
+static bool peepholePass(BasicBlock* bb) {
+	bool changed = false;
+	for(size_t i = 0; i < bb->insns.count; i++) {
+		for(size_t r = 0; r < ARRAY_COUNT(rules); r++) {
+			if(matchRule(bb, &rules[r], i)) {
+				applyRule(bb, &rules[r], i);
+				changed = true;
+				
+				/* Whatever is at this index now hasn't been matched yet */
+				--i;
+				break;
+			}
+		}
+	}
+	
+	return changed;
+}
+
+static bool matchRule(BasicBlock* bb, const PeepholeRule* rule, size_t index) {
+	if(index + rule->length > bb->insns.count) {
+		return false;
+	}
+	
+	/* Never mix the condition code with the code before it, or the tail with the code before it */
+	size_t end = index + rule->length;
+	if((bb->flags & BB_HAS_CONDITION) && index < bb->cond_index && bb->cond_index < end) {
+		return false;
+	}
+	if((bb->flags & BB_HAS_TAIL) && index < bb->tail_index && bb->tail_index < end) {
+		return false;
+	}
+	
+	Symbol* var = NULL;
+	for(size_t i = 0; i < rule->length; i++) {
+		const PeepholeInsn* pat = &rule->pattern[i];
+		const Insn* insn = &bb->insns.elems[index + i];
+		if(insn->op != pat->op) {
+			return false;
+		}
+		
+		/* Operands of instructions that reference a symbol aren't known until it is resolved */
+		Symbol* sym = BasicBlock_findSymbol(bb, index + i);
+		if(sym != NULL && !rule->same_var) {
+			return false;
+		}
+		
+		if(!pat->any_imm && insn->imm != pat->imm) {
+			return false;
+		}
+		
+		if(rule->same_var) {
+			/* Either every instruction references the same symbol, or none do and the operands match */
+			if(i == 0) {
+				var = sym;
+			}
+			else if(sym != var) {
+				return false;
+			}
+			else if(sym == NULL
+			   && (insn->lvl != bb->insns.elems[index].lvl || insn->imm != bb->insns.elems[index].imm)) {
+				return false;
+			}
+		}
+	}
+	
+	return true;
+}
+
+static void applyRule(BasicBlock* bb, const PeepholeRule* rule, size_t index) {
+	Insn window[PEEPHOLE_MAX_WINDOW];
+	PeepholeOut replacement[PEEPHOLE_MAX_WINDOW];
+	memcpy(window, &bb->insns.elems[index], rule->length * sizeof(*window));
+	
+	size_t count = 0;
+	if(rule->rewrite != NULL) {
+		count = rule->rewrite(window, replacement);
+		ASSERT(count <= rule->length);
+	}
+	
+	/* Window instructions from next on are still in the basic block, starting at pos. New
+	 instructions overwrite window instructions that aren't kept wherever they can, so that the
+	 condition start and tail start stay where they were
+	 */
+	size_t pos = index;
+	size_t next = 0;
+	for(size_t i = 0; i < count; i++) {
+		if(replacement[i].keep) {
+			/* Drop everything before the kept instruction, which then stays where it is */
+			ASSERT(replacement[i].index >= next && replacement[i].index < rule->length);
+			for(; next < replacement[i].index; next++) {
+				BasicBlock_removeInsn(bb, pos);
+			}
+			++next;
+		}
+		else if(next < rule->length && !isKept(replacement, count, next)) {
+			BasicBlock_replaceInsn(bb, pos, replacement[i].insn);
+			++next;
+		}
+		else {
+			BasicBlock_insertInsn(bb, pos, replacement[i].insn);
+		}
+		++pos;
+	}
+	
+	/* Remove whatever is left of the window */
+	for(; next < rule->length; next++) {
+		BasicBlock_removeInsn(bb, pos);
+	}
+}
+
+static bool isKept(const PeepholeOut* replacement, size_t count, size_t window_index) {
+	for(size_t i = 0; i < count; i++) {
+		if(replacement[i].keep && replacement[i].index == window_index) {
+			return true;
+		}
+	}
+	
+	return false;
+}
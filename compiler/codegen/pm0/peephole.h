@@ -0,0 +1,69 @@
+//
+//  peephole.h
+//  PL/0
+//
+
+#ifndef PL0_PEEPHOLE_H
+#define PL0_PEEPHOLE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "instruction.h"
+#include "basicblock.h"
+
+/*! Most instructions that a peephole rule can match at once */
+#define PEEPHOLE_MAX_WINDOW 3
+
+/*! One instruction of a peephole rule's pattern */
+typedef struct PeepholeInsn {
+	Opcode op;                  /*!< Opcode the instruction must have */
+	bool any_imm;               /*!< Whether the immediate operand can be anything */
+	Word imm;                   /*!< Immediate operand the instruction must have, unless any_imm is set */
+} PeepholeInsn;
+
+/*! One instruction of a peephole rule's replacement */
+typedef struct PeepholeOut {
+	bool keep;                  /*!< Whether this is an instruction from the window, kept along with any symbol it references */
+	size_t index;               /*!< Index in the window of the instruction to keep, if keep is set */
+	Insn insn;                  /*!< New instruction, which can't reference a symbol, if keep isn't set */
+} PeepholeOut;
+
+/*! A rule that replaces a run of instructions in a basic block with a run that is no longer.
+ Instructions that reference a symbol (such as loads, stores, and constants) have no meaningful
+ operands until symbols are resolved, so they are only matched by rules with same_var set, which
+ compare the symbols instead. Those instructions can only be carried over into the replacement
+ by keeping them, and kept instructions stay in the same order.
+ */
+typedef struct PeepholeRule {
+	/*! Description of the rule, like "NEG; NEG -> nothing" */
+	const char* name;
+	
+	/*! Number of instructions in the pattern */
+	size_t length;
+	
+	/*! Instructions to match */
+	PeepholeInsn pattern[PEEPHOLE_MAX_WINDOW];
+	
+	/*! Whether every instruction in the window has to reference the same variable */
+	bool same_var;
+	
+	/*! Produce the replacement for a matched window, or NULL to remove the whole window
+	 @param window Matched instructions
+	 @param replacement Output array with room for the same number of instructions
+	 @return Number of instructions in the replacement, which must be at most length. A
+	         replacement as long as the window must not be matched by any rule again
+	 */
+	size_t (*rewrite)(const Insn* window, PeepholeOut* replacement);
+} PeepholeRule;
+
+
+/*! Apply every peephole rule to a basic block until none of them match any more. Symbol
+ references, the condition start, and the tail start stay pointed at the same instructions, and
+ no rule is applied across the start of the condition code.
+ @param bb Basic block to optimize
+ @return True if any instructions were changed
+ */
+bool peephole_optimize(BasicBlock* bb);
+
+
+#endif /* PL0_PEEPHOLE_H */
@@ -0,0 +1,190 @@
+//
+//  profile.c
+//  PL/0
+//
+
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+
+static bool Profile_read(Profile* self, FILE* counts, FILE* blockmap);
+static void addCount(ProfileCountArray* counts, const char* proc, size_t ordinal, uint64_t count, uint64_t false_count);
+static void mergeCounts(ProfileCountArray* counts);
+static ProfileCount* findCount(ProfileCountArray* counts, const char* proc, size_t ordinal);
+static int compareCounts(const void* a, const void* b);
+
+/* Longest procedure name that can be read from a block map, which is plenty for any real program */
+#define MAX_PROC_NAME 1023
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+
+Destroyer(Profile) {
+	foreach(&self->blocks, pcount) {
+		destroy(&pcount->proc);
+	}
+	array_clear(&self->blocks);
+	
+	foreach(&self->branches, pcount) {
+		destroy(&pcount->proc);
+	}
+	array_clear(&self->branches);
+}
+DEF(Profile);
+
+Profile* Profile_initWithFiles(Profile* self, FILE* counts, FILE* blockmap) {
+	if((self = Profile_init(self))) {
+		if(!Profile_read(self, counts, blockmap)) {
+			release(&self);
+			return NULL;
+		}
+	}
+	
+	return self;
+}
+
+static bool Profile_read(Profile* self, FILE* counts, FILE* blockmap) {
+	uint64_t* exec_counts = calloc_ff(MAX_CODE_LENGTH, sizeof(*exec_counts));
+	uint64_t* taken_counts = calloc_ff(MAX_CODE_LENGTH, sizeof(*taken_counts));
+	bool success = true;
+	
+	/* Each line of the VM's profile is an address, how often it ran, and how often it jumped */
+	Word addr;
+	uint64_t exec, taken;
+	int ret;
+	while((ret = fscanf(counts, "%"SCNdWORD" %"SCNu64" %"SCNu64, &addr, &exec, &taken)) == 3) {
+		if(addr < 0 || addr >= MAX_CODE_LENGTH || taken > exec) {
+			success = false;
+			break;
+		}
+		exec_counts[addr] = exec;
+		taken_counts[addr] = taken;
+	}
+	if(ret != EOF) {
+		success = false;
+	}
+	
+	/* The block map says which basic block or conditional jump is at each of those addresses */
+	char kind[8];
+	char proc[MAX_PROC_NAME + 1];
+	size_t ordinal;
+	while(success && (ret = fscanf(blockmap, "%7s %"SCNdWORD" %"XSTR(MAX_PROC_NAME)"s %zu",
+	                               kind, &addr, proc, &ordinal)) == 4) {
+		if(addr < 0 || addr >= MAX_CODE_LENGTH) {
+			success = false;
+		}
+		else if(strcmp(kind, "block") == 0) {
+			addCount(&self->blocks, proc, ordinal, exec_counts[addr], 0);
+		}
+		else if(strcmp(kind, "branch") == 0) {
+			/* Whether the JPC jumps when the condition is true or when it's false */
+			char when[6];
+			if(fscanf(blockmap, "%5s", when) != 1) {
+				success = false;
+				break;
+			}
+			
+			uint64_t jumped = taken_counts[addr];
+			uint64_t fell = exec_counts[addr] - jumped;
+			if(strcmp(when, "true") == 0) {
+				addCount(&self->branches, proc, ordinal, jumped, fell);
+			}
+			else if(strcmp(when, "false") == 0) {
+				addCount(&self->branches, proc, ordinal, fell, jumped);
+			}
+			else {
+				success = false;
+			}
+		}
+		else {
+			success = false;
+		}
+	}
+	if(success && ret != EOF) {
+		success = false;
+	}
+	
+	mergeCounts(&self->blocks);
+	mergeCounts(&self->branches);
+	
+	destroy(&exec_counts);
+	destroy(&taken_counts);
+	return success;
+}
+
+static void addCount(ProfileCountArray* counts, const char* proc, size_t ordinal, uint64_t count, uint64_t false_count) {
+	ProfileCount entry = {
+		.proc = strdup_ff(proc),
+		.ordinal = ordinal,
+		.count = count,
+		.false_count = false_count
+	};
+	array_append(counts, entry);
+}
+
+static void mergeCounts(ProfileCountArray* counts) {
+	/* Sorting the counts lets them be looked up with a binary search. Every inlined copy of a
+	 procedure has the same basic blocks, which end up next to each other and share their counts
+	 */
+	if(counts->count > 1) {
+		qsort(counts->elems, counts->count, sizeof(*counts->elems), &compareCounts);
+	}
+	
+	size_t kept = 0;
+	foreach(counts, pcount) {
+		ProfileCount* last = kept != 0 ? &counts->elems[kept - 1] : NULL;
+		if(last != NULL && compareCounts(last, pcount) == 0) {
+			last->count += pcount->count;
+			last->false_count += pcount->false_count;
+			destroy(&pcount->proc);
+		}
+		else {
+			counts->elems[kept++] = *pcount;
+		}
+	}
+	counts->count = kept;
+}
+
+static ProfileCount* findCount(ProfileCountArray* counts, const char* proc, size_t ordinal) {
+	if(counts->count == 0) {
+		return NULL;
+	}
+	
+	ProfileCount key = {.proc = (char*)proc, .ordinal = ordinal};
+	return bsearch(&key, counts->elems, counts->count, sizeof(*counts->elems), &compareCounts);
+}
+
+static int compareCounts(const void* a, const void* b) {
+	const ProfileCount* x = a;
+	const ProfileCount* y = b;
+	
+	int cmp = strcmp(x->proc, y->proc);
+	if(cmp != 0) {
+		return cmp;
+	}
+	return (x->ordinal > y->ordinal) - (x->ordinal < y->ordinal);
+}
+
+bool Profile_getBlockCount(Profile* self, const char* proc, size_t ordinal, uint64_t* count) {
+	ProfileCount* entry = findCount(&self->blocks, proc, ordinal);
+	if(entry == NULL) {
+		return false;
+	}
+	
+	*count = entry->count;
+	return true;
+}
+
+bool Profile_getBranchCounts(Profile* self, const char* proc, size_t ordinal,
+                             uint64_t* true_count, uint64_t* false_count) {
+	ProfileCount* entry = findCount(&self->branches, proc, ordinal);
+	if(entry == NULL) {
+		return false;
+	}
+	
+	*true_count = entry->count;
+	*false_count = entry->false_count;
+	return true;
+}
@@ -0,0 +1,69 @@
+//
+//  profile.h
+//  PL/0
+//
+
+#ifndef PL0_PROFILE_H
+#define PL0_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct Profile Profile;
+
+#include "object.h"
+#include "dynamic_array.h"
+#include "config.h"
+
+/*! How often a basic block or conditional branch ran, identified the same way across compilations */
+typedef struct ProfileCount {
+	char* proc;             /*!< Name of the procedure, as given by SymTree_getName */
+	size_t ordinal;         /*!< Which basic block of the procedure this is */
+	uint64_t count;         /*!< Times the basic block ran, or times the condition was true */
+	uint64_t false_count;   /*!< Times the condition was false (only used for branches) */
+} ProfileCount;
+typedef dynamic_array(ProfileCount) ProfileCountArray;
+
+struct Profile {
+	OBJECT_BASE;
+	
+	/*! Execution counts of the basic blocks that ran, sorted by procedure and ordinal */
+	ProfileCountArray blocks;
+	
+	/*! Outcomes of the conditional branches that ran, sorted by procedure and ordinal */
+	ProfileCountArray branches;
+};
+DECL(Profile);
+
+
+/*! Load a profile written by the VM along with the block map the compiler wrote for the same code
+ @param counts Profile from the VM, where each line has a code address, how many times it ran, and
+               how many times it jumped
+ @param blockmap Block map from the compiler, with a "block <addr> <proc> <ordinal>" line for each
+                 basic block and a "branch <addr> <proc> <ordinal> <true|false>" line for each JPC
+                 that ends a condition, saying whether it jumps when the condition is true
+ @return Initialized profile, or NULL if either file was malformed
+ */
+Profile* Profile_initWithFiles(Profile* self, FILE* counts, FILE* blockmap);
+
+/*! Look up how many times a basic block ran
+ @param proc Name of the procedure the basic block was generated for
+ @param ordinal Which basic block of the procedure to look up
+ @param count Set to the number of times the basic block ran
+ @return True if the basic block was part of the profiled program
+ */
+bool Profile_getBlockCount(Profile* self, const char* proc, size_t ordinal, uint64_t* count);
+
+/*! Look up how many times the condition at the end of a basic block was true and false
+ @param proc Name of the procedure the basic block was generated for
+ @param ordinal Which basic block of the procedure to look up
+ @param true_count Set to the number of times the condition was true
+ @param false_count Set to the number of times the condition was false
+ @return True if the basic block ended with a conditional jump in the profiled program
+ */
+bool Profile_getBranchCounts(Profile* self, const char* proc, size_t ordinal,
+                             uint64_t* true_count, uint64_t* false_count);
+
+
+#endif /* PL0_PROFILE_H */
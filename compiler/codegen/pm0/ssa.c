@@ -0,0 +1,387 @@
+//
+//  ssa.c
+//  PL/0
+//
+
+#include "ssa.h"
+#include <stdlib.h>
+#include <string.h>
+#include "dynamic_array.h"
+
+
+static void findPostorder(SSAProc* self, uint32_t* order);
+static uint32_t intersect(SSAProc* self, const uint32_t* order, uint32_t a, uint32_t b);
+
+
+void SSAProc_init(SSAProc* self, Block* scope) {
+	memset(self, 0, sizeof(*self));
+	self->scope = scope;
+	
+	/* Memory is always the first variable */
+	SSAVar memory = {0};
+	array_append(&self->vars, memory);
+}
+
+void SSAProc_clear(SSAProc* self) {
+	foreach(&self->blocks, blk) {
+		array_clear(&blk->phis);
+		array_clear(&blk->insns);
+		array_clear(&blk->preds);
+		array_clear(&blk->defs);
+		array_clear(&blk->incomplete);
+	}
+	array_clear(&self->blocks);
+	array_clear(&self->insns);
+	array_clear(&self->args);
+	array_clear(&self->vars);
+	array_clear(&self->rpo);
+}
+
+uint32_t SSAProc_addBlock(SSAProc* self, SymTree* origin, size_t ordinal) {
+	SSABlock blk = {0};
+	blk.succs[0] = blk.succs[1] = SSA_NONE;
+	blk.cond = SSA_NONE;
+	blk.origin = origin;
+	blk.ordinal = ordinal;
+	blk.idom = SSA_NONE;
+	array_append(&self->blocks, blk);
+	return (uint32_t)(self->blocks.count - 1);
+}
+
+SSAValue SSAProc_addInsn(SSAProc* self, uint32_t block, SSAOp op, SSAType type, const SSAValue* args, uint32_t arg_count) {
+	SSAValue value = (SSAValue)self->insns.count;
+	SSAInsn insn = {
+		.op = (uint8_t)op,
+		.type = (uint8_t)type,
+		.block = block,
+		.args = (uint32_t)self->args.count,
+		.arg_count = arg_count,
+		.var = SSA_NONE,
+		.repl = value
+	};
+	array_append(&self->insns, insn);
+	for(uint32_t i = 0; i < arg_count; i++) {
+		array_append(&self->args, args != NULL ? args[i] : SSA_NONE);
+	}
+	
+	/* Values that exist as soon as the basic block starts are kept apart from the code */
+	SSABlock* blk = &self->blocks.elems[block];
+	if(op == SSA_PHI || op == SSA_ENTRY || op == SSA_UNDEF) {
+		array_append(&blk->phis, value);
+	}
+	else {
+		array_append(&blk->insns, value);
+	}
+	return value;
+}
+
+SSAValue SSAProc_find(SSAProc* self, SSAValue value) {
+	SSAValue root = value;
+	while(self->insns.elems[root].repl != root) {
+		root = self->insns.elems[root].repl;
+	}
+	
+	/* Point everything on the way straight at the value that replaced it */
+	while(value != root) {
+		SSAValue next = self->insns.elems[value].repl;
+		self->insns.elems[value].repl = root;
+		value = next;
+	}
+	return root;
+}
+
+SSAValue SSAProc_arg(SSAProc* self, SSAValue value, uint32_t index) {
+	SSAInsn* insn = SSAProc_insn(self, value);
+	ASSERT(index < insn->arg_count);
+	SSAValue* parg = &self->args.elems[insn->args + index];
+	if(*parg != SSA_NONE) {
+		*parg = SSAProc_find(self, *parg);
+	}
+	return *parg;
+}
+
+void SSAProc_replace(SSAProc* self, SSAValue value, SSAValue repl) {
+	ASSERT(value != repl);
+	SSAInsn* insn = SSAProc_insn(self, value);
+	SSAInsn* with = SSAProc_insn(self, repl);
+	
+	/* The value that's left can still be kept in the variable that this one was assigned to */
+	if(with->var == SSA_NONE) {
+		with->var = insn->var;
+	}
+	insn->op = SSA_NOP;
+	insn->repl = repl;
+}
+
+void SSAProc_addEdge(SSAProc* self, uint32_t from, size_t k, uint32_t to) {
+	ASSERT(self->blocks.elems[from].succs[k] == SSA_NONE);
+	self->blocks.elems[from].succs[k] = to;
+	array_append(&self->blocks.elems[to].preds, from);
+}
+
+void SSAProc_removeEdge(SSAProc* self, uint32_t from, size_t k) {
+	SSABlock* blk = &self->blocks.elems[from];
+	uint32_t to = blk->succs[k];
+	ASSERT(to != SSA_NONE);
+	blk->succs[k] = SSA_NONE;
+	
+	SSABlock* target = &self->blocks.elems[to];
+	size_t index = 0;
+	while(target->preds.elems[index] != from) {
+		++index;
+	}
+	array_removeIndex(&target->preds, index);
+	
+	/* Each phi has one operand per predecessor, in the same order */
+	foreach(&target->phis, pphi) {
+		SSAInsn* phi = SSAProc_insn(self, *pphi);
+		if(phi->op != SSA_PHI) {
+			continue;
+		}
+		
+		SSAValue* args = &self->args.elems[phi->args];
+		memmove(&args[index], &args[index + 1], (phi->arg_count - index - 1) * sizeof(*args));
+		--phi->arg_count;
+	}
+}
+
+void SSAProc_removeBlock(SSAProc* self, uint32_t block) {
+	SSABlock* blk = &self->blocks.elems[block];
+	for(size_t k = 0; k < 2; k++) {
+		if(blk->succs[k] != SSA_NONE) {
+			SSAProc_removeEdge(self, block, k);
+		}
+	}
+	
+	/* Anything that still branches here is being removed too */
+	foreach(&blk->preds, pfrom) {
+		SSABlock* from = &self->blocks.elems[*pfrom];
+		for(size_t k = 0; k < 2; k++) {
+			if(from->succs[k] == block) {
+				from->succs[k] = SSA_NONE;
+			}
+		}
+	}
+	blk->preds.count = 0;
+	
+	foreach(&blk->phis, pvalue) {
+		self->insns.elems[*pvalue].op = SSA_NOP;
+	}
+	foreach(&blk->insns, pvalue) {
+		self->insns.elems[*pvalue].op = SSA_NOP;
+	}
+	blk->phis.count = 0;
+	blk->insns.count = 0;
+	blk->cond = SSA_NONE;
+	blk->removed = true;
+}
+
+void SSAProc_compact(SSAProc* self) {
+	foreach(&self->blocks, blk) {
+		size_t count = 0;
+		foreach(&blk->phis, pvalue) {
+			if(self->insns.elems[*pvalue].op != SSA_NOP) {
+				blk->phis.elems[count++] = *pvalue;
+			}
+		}
+		blk->phis.count = count;
+		
+		count = 0;
+		foreach(&blk->insns, pvalue) {
+			if(self->insns.elems[*pvalue].op != SSA_NOP) {
+				blk->insns.elems[count++] = *pvalue;
+			}
+		}
+		blk->insns.count = count;
+		
+		if(blk->cond != SSA_NONE) {
+			blk->cond = SSAProc_find(self, blk->cond);
+		}
+	}
+}
+
+void SSAProc_findDominators(SSAProc* self) {
+	size_t n = self->blocks.count;
+	uint32_t* order = malloc_ff(n * sizeof(*order));
+	findPostorder(self, order);
+	
+	foreach(&self->blocks, blk) {
+		blk->idom = SSA_NONE;
+	}
+	self->blocks.elems[0].idom = 0;
+	
+	/* A basic block is dominated by whatever dominates all of its predecessors. Visiting them in
+	 reverse postorder means most predecessors are done first, so this settles quickly
+	 */
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		for(size_t k = 1; k < self->rpo.count; k++) {
+			SSABlock* blk = &self->blocks.elems[self->rpo.elems[k]];
+			uint32_t idom = SSA_NONE;
+			foreach(&blk->preds, pfrom) {
+				if(self->blocks.elems[*pfrom].idom == SSA_NONE) {
+					continue;
+				}
+				idom = idom == SSA_NONE ? *pfrom : intersect(self, order, *pfrom, idom);
+			}
+			
+			if(blk->idom != idom) {
+				blk->idom = idom;
+				changed = true;
+			}
+		}
+	}
+	destroy(&order);
+}
+
+static void findPostorder(SSAProc* self, uint32_t* order) {
+	size_t n = self->blocks.count;
+	uint8_t* next_succ = calloc_ff(n, sizeof(*next_succ));
+	bool* seen = calloc_ff(n, sizeof(*seen));
+	dynamic_array(uint32_t) stack = {0};
+	
+	/* Depth-first search from the entry, numbering each basic block once all of its successors are */
+	uint32_t count = 0;
+	self->rpo.count = 0;
+	seen[0] = true;
+	array_append(&stack, 0);
+	while(stack.count != 0) {
+		uint32_t b = stack.elems[stack.count - 1];
+		SSABlock* blk = &self->blocks.elems[b];
+		if(next_succ[b] < 2) {
+			uint32_t s = blk->succs[next_succ[b]++];
+			if(s != SSA_NONE && !seen[s]) {
+				seen[s] = true;
+				array_append(&stack, s);
+			}
+			continue;
+		}
+		
+		--stack.count;
+		order[b] = count++;
+		array_append(&self->rpo, b);
+	}
+	
+	/* The blocks were collected in postorder */
+	for(size_t i = 0, j = self->rpo.count - 1; i < j; i++, j--) {
+		uint32_t tmp = self->rpo.elems[i];
+		self->rpo.elems[i] = self->rpo.elems[j];
+		self->rpo.elems[j] = tmp;
+	}
+	
+	array_clear(&stack);
+	destroy(&seen);
+	destroy(&next_succ);
+}
+
+static uint32_t intersect(SSAProc* self, const uint32_t* order, uint32_t a, uint32_t b) {
+	/* Climb the dominator tree from whichever is numbered lower until both meet */
+	while(a != b) {
+		while(order[a] < order[b]) {
+			a = self->blocks.elems[a].idom;
+		}
+		while(order[b] < order[a]) {
+			b = self->blocks.elems[b].idom;
+		}
+	}
+	return a;
+}
+
+bool SSAProc_dominates(SSAProc* self, uint32_t dom, uint32_t block) {
+	if(self->blocks.elems[dom].idom == SSA_NONE || self->blocks.elems[block].idom == SSA_NONE) {
+		return false;
+	}
+	
+	/* The entry is its own immediate dominator, which is where the walk up the tree stops */
+	uint32_t cur = block;
+	while(cur != dom) {
+		uint32_t up = self->blocks.elems[cur].idom;
+		if(up == cur) {
+			return false;
+		}
+		cur = up;
+	}
+	return true;
+}
+
+SSAValue SSAProc_findClobber(SSAProc* self, SSAValue mem, Symbol* sym) {
+	while(true) {
+		SSAInsn* insn = SSAProc_insn(self, mem);
+		if(insn->op == SSA_STORE && insn->sym != sym) {
+			mem = SSAProc_arg(self, mem, 0);
+		}
+		else if(insn->op == SSA_CALL && !SSAProc_canClobber(insn->sym, sym)) {
+			mem = SSAProc_arg(self, mem, 0);
+		}
+		else {
+			return mem;
+		}
+	}
+}
+
+bool SSAProc_canClobber(Symbol* proc, Symbol* var) {
+	/* A procedure's own variables are at the level just inside the block that declares it, and
+	 anything it calls is declared at that level or further out
+	 */
+	return var->level <= proc->level;
+}
+
+bool SSAProc_hasEffect(SSAProc* self, SSAValue value) {
+	SSAInsn* insn = SSAProc_insn(self, value);
+	switch(insn->op) {
+		case SSA_STORE:
+		case SSA_CALL:
+		case SSA_READ:
+		case SSA_WRITE:
+			return true;
+		
+		case SSA_BINARY: {
+			if(insn->imm != ALU_DIV && insn->imm != ALU_MOD) {
+				return false;
+			}
+			
+			/* Dividing only fails for a divisor of zero, or when the quotient doesn't fit */
+			SSAInsn* left = SSAProc_insn(self, SSAProc_arg(self, value, 0));
+			SSAInsn* right = SSAProc_insn(self, SSAProc_arg(self, value, 1));
+			if(right->op != SSA_LIT && right->op != SSA_CONST) {
+				return true;
+			}
+			if(right->imm == -1) {
+				return (left->op != SSA_LIT && left->op != SSA_CONST) || left->imm == WORD_MIN;
+			}
+			return right->imm == 0;
+		}
+		
+		default:
+			return false;
+	}
+}
+
+bool SSAProc_compute(Word op, Word left, Word right, Word* result) {
+	/* Arithmetic is done on unsigned values so that overflow wraps around like it does in the VM */
+	switch(op) {
+		case ALU_NEG: *result = (Word)(0u - (uint32_t)left); return true;
+		case ALU_ODD: *result = left & 1; return true;
+		case ALU_ADD: *result = (Word)((uint32_t)left + (uint32_t)right); return true;
+		case ALU_SUB: *result = (Word)((uint32_t)left - (uint32_t)right); return true;
+		case ALU_MUL: *result = (Word)((uint32_t)left * (uint32_t)right); return true;
+		case ALU_EQL: *result = left == right; return true;
+		case ALU_NEQ: *result = left != right; return true;
+		case ALU_LSS: *result = left < right; return true;
+		case ALU_LEQ: *result = left <= right; return true;
+		case ALU_GTR: *result = left > right; return true;
+		case ALU_GEQ: *result = left >= right; return true;
+		
+		case ALU_DIV:
+		case ALU_MOD:
+			if(right == 0 || (left == WORD_MIN && right == -1)) {
+				return false;
+			}
+			*result = op == ALU_DIV ? left / right : left % right;
+			return true;
+		
+		default:
+			return false;
+	}
+}
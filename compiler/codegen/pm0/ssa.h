@@ -0,0 +1,254 @@
+//
+//  ssa.h
+//  PL/0
+//
+
+#ifndef PL0_SSA_H
+#define PL0_SSA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "basicblock.h"
+#include "block.h"
+#include "compiler/codegen/symtree.h"
+
+
+/*! Index of an instruction in an SSAProc, which also stands for the value the instruction produces */
+typedef uint32_t SSAValue;
+
+/*! Array of values */
+typedef dynamic_array(SSAValue) SSAValueArray;
+
+/*! Marks a missing value, basic block, or variable */
+#define SSA_NONE UINT32_MAX
+
+/*! Variable that stands for memory while a procedure is built, so that the state of memory gets
+ phis at joins just like the variables that are kept as values
+ */
+#define SSA_MEMORY 0
+
+/*! Type of the value that an instruction produces */
+typedef enum SSAType {
+	SSA_VOID,           /*!< Nothing, like a write */
+	SSA_INT,            /*!< Number */
+	SSA_BOOL,           /*!< Result of a condition, which is either 0 or 1 */
+	SSA_MEM             /*!< State of every variable that is kept in memory */
+} SSAType;
+
+/*! Operation of an instruction. Operands are the values of other instructions */
+typedef enum SSAOp {
+	SSA_NOP,            /*!< Removed, or replaced by the value in repl */
+	SSA_UNDEF,          /*!< Variable read by code that can never run */
+	SSA_ENTRY,          /*!< Variable var, or memory, as it was when the procedure started */
+	SSA_PHI,            /*!< Variable var, or memory, at the start of a basic block: one operand per predecessor */
+	SSA_LIT,            /*!< Number imm */
+	SSA_CONST,          /*!< Constant sym, whose value is imm */
+	SSA_UNARY,          /*!< ALU_NEG or ALU_ODD in imm: operand */
+	SSA_BINARY,         /*!< Any other ALU operation in imm: left, right */
+	SSA_LOAD,           /*!< Variable sym in memory: memory */
+	SSA_STORE,          /*!< Store to variable sym in memory: memory, value. Produces the new memory */
+	SSA_CALL,           /*!< Call procedure sym: memory, parameters. Produces the new memory */
+	SSA_RESULT,         /*!< Return value of a call: call */
+	SSA_READ,           /*!< Number read from the input */
+	SSA_WRITE           /*!< Write a number to the output: value */
+} SSAOp;
+
+/*! Instruction in SSA form, which is never changed by anything but the value it computes */
+typedef struct SSAInsn {
+	uint8_t op;             /*!< SSAOp of the instruction */
+	uint8_t type;           /*!< SSAType of its value */
+	uint32_t block;         /*!< Basic block that the instruction is in */
+	uint32_t args;          /*!< Index in the procedure's args of the first operand */
+	uint32_t arg_count;     /*!< Number of operands */
+	Word imm;               /*!< ALU operation or number */
+	uint32_t var;           /*!< Variable of an entry value or phi, or the first variable assigned this value, or SSA_NONE */
+	Symbol* sym;            /*!< Constant, variable in memory, or procedure */
+	SSAValue repl;          /*!< Value that replaced this one, or the instruction itself */
+} SSAInsn;
+
+/*! Slot of the procedure's stack frame that is kept as values instead of memory */
+typedef struct SSAVar {
+	Word slot;              /*!< Offset of the slot in the stack frame */
+	Symbol* sym;            /*!< Symbol that the slot is loaded and stored by, or NULL for an inlined procedure's slot */
+} SSAVar;
+
+/*! Basic block of an SSAProc */
+typedef struct SSABlock {
+	/*! Values that the basic block starts with: its phis, the entry values in the first one, and undefined values */
+	SSAValueArray phis;
+	
+	/*! Instructions in the order they run */
+	SSAValueArray insns;
+	
+	/*! Predecessors in the order of the operands of each phi */
+	dynamic_array(uint32_t) preds;
+	
+	/*! Successor when the condition is true or when there isn't one, then when it's false, each of
+	 which is SSA_NONE when it's missing. A basic block without any successors returns
+	 */
+	uint32_t succs[2];
+	
+	/*! Value of the condition that the basic block branches on, or SSA_NONE */
+	SSAValue cond;
+	
+	/*! Procedure whose code created the basic block, which the basic block it's lowered into gets */
+	SymTree* origin;
+	
+	/*! Which basic block of the origin procedure this is, counting in the order they were created */
+	size_t ordinal;
+	
+	/*! Whether the basic block was removed because it can never run */
+	bool removed;
+	
+	/*! Immediate dominator, set by SSAProc_findDominators. The entry is its own */
+	uint32_t idom;
+	
+	/*! Whether every predecessor is known yet, while the procedure is built */
+	bool sealed;
+	
+	/*! Value of each variable at the end of the basic block so far, while the procedure is built */
+	SSAValueArray defs;
+	
+	/*! Phis that are waiting for the basic block to be sealed to get their operands */
+	SSAValueArray incomplete;
+} SSABlock;
+
+/*! Procedure in SSA form. Variables in the procedure's own stack frame that no nested procedure
+ can get to are values, where each assignment defines a new value and phis merge the values that
+ meet at joins. All other variables, including the procedure's return value, are memory, which is
+ itself a value that loads take and that stores and calls replace. Instructions are never
+ reordered, so a procedure lowered back into stack code does everything in the same order
+ */
+typedef struct SSAProc {
+	/*! Block that the procedure was built from */
+	Block* scope;
+	
+	/*! Every instruction, indexed by the values they produce */
+	dynamic_array(SSAInsn) insns;
+	
+	/*! Operands of the instructions */
+	SSAValueArray args;
+	
+	/*! Basic blocks in code order, starting with the entry */
+	dynamic_array(SSABlock) blocks;
+	
+	/*! Variables kept as values, of which the first is SSA_MEMORY */
+	dynamic_array(SSAVar) vars;
+	
+	/*! Basic blocks that weren't removed in reverse postorder, set by SSAProc_findDominators */
+	dynamic_array(uint32_t) rpo;
+} SSAProc;
+
+
+/*! Start a procedure without any basic blocks or instructions
+ @param scope Block that the procedure is built from
+ */
+void SSAProc_init(SSAProc* self, Block* scope);
+
+/*! Free everything that the procedure holds */
+void SSAProc_clear(SSAProc* self);
+
+/*! Add a basic block to the end of the procedure
+ @param origin Procedure whose code creates the basic block
+ @param ordinal Which basic block of the origin procedure it is
+ @return Index of the new basic block
+ */
+uint32_t SSAProc_addBlock(SSAProc* self, SymTree* origin, size_t ordinal);
+
+/*! Add an instruction to the end of a basic block, or to its phis if it's an SSA_PHI, SSA_ENTRY, or SSA_UNDEF
+ @param block Basic block that the instruction goes in
+ @param op SSAOp of the instruction
+ @param type SSAType of its value
+ @param args Operands, or NULL to leave arg_count operands to be filled in as SSA_NONE
+ @param arg_count Number of operands
+ @return Value of the new instruction
+ */
+SSAValue SSAProc_addInsn(SSAProc* self, uint32_t block, SSAOp op, SSAType type, const SSAValue* args, uint32_t arg_count);
+
+/*! Find the value that replaced a value, following replacements that were themselves replaced
+ @param value Value that may have been replaced
+ */
+SSAValue SSAProc_find(SSAProc* self, SSAValue value);
+
+/*! Get an operand of an instruction, as whatever value has replaced it
+ @param value Instruction whose operand to get
+ @param index Which operand to get
+ */
+SSAValue SSAProc_arg(SSAProc* self, SSAValue value, uint32_t index);
+
+/*! Replace every use of a value with another, and remove the instruction of the old value
+ @param value Value to replace
+ @param repl Value that replaces it
+ */
+void SSAProc_replace(SSAProc* self, SSAValue value, SSAValue repl);
+
+/*! Add a branch from one basic block to another
+ @param from Basic block that branches
+ @param k 0 for the branch that's taken when the condition is true or when there is none, 1 for the other
+ @param to Basic block that is branched to
+ */
+void SSAProc_addEdge(SSAProc* self, uint32_t from, size_t k, uint32_t to);
+
+/*! Remove a branch from one basic block, along with the operands that its target's phis had for it
+ @param from Basic block that branches
+ @param k Which of its branches to remove, which must exist
+ */
+void SSAProc_removeEdge(SSAProc* self, uint32_t from, size_t k);
+
+/*! Remove a basic block that can never run, along with its instructions and branches */
+void SSAProc_removeBlock(SSAProc* self, uint32_t block);
+
+/*! Drop instructions that were removed or replaced from the lists of every basic block */
+void SSAProc_compact(SSAProc* self);
+
+/*! Find the immediate dominator of each basic block and the reverse postorder of the basic blocks */
+void SSAProc_findDominators(SSAProc* self);
+
+/*! Check whether every path from the entry to one basic block goes through another, using the
+ dominators that SSAProc_findDominators found
+ @param dom Basic block that might dominate the other one
+ @param block Basic block that might be dominated
+ */
+bool SSAProc_dominates(SSAProc* self, uint32_t dom, uint32_t block);
+
+/*! Walk back from a state of memory past stores to other variables and calls that can't change a
+ variable, to find the last point where the variable might have changed
+ @param mem State of memory to start from
+ @param sym Variable in memory
+ @return Store to the variable, call that might change it, phi, or entry value where the walk stopped
+ */
+SSAValue SSAProc_findClobber(SSAProc* self, SSAValue mem, Symbol* sym);
+
+/*! Check whether a procedure might change a variable in memory, directly or through the
+ procedures that it calls. A procedure can only get to the variables of the blocks that contain it
+ @param proc Procedure that is called
+ @param var Variable in memory
+ */
+bool SSAProc_canClobber(Symbol* proc, Symbol* var);
+
+/*! Check whether an instruction must stay even when its value isn't used, because it has side
+ effects or might make the VM stop with an error
+ @param value Instruction to check
+ */
+bool SSAProc_hasEffect(SSAProc* self, SSAValue value);
+
+/*! Compute the result of an ALU operation on numbers the way the VM would
+ @param op ALU operation
+ @param left First operand, or the only one
+ @param right Second operand, which unary operations ignore
+ @param result Set to the result of the operation
+ @return True unless the VM would stop with an error, like when dividing by zero
+ */
+bool SSAProc_compute(Word op, Word left, Word right, Word* result);
+
+/*! Get an instruction of a procedure
+ @param value Value of the instruction
+ */
+static inline SSAInsn* SSAProc_insn(SSAProc* self, SSAValue value) {
+	return &self->insns.elems[value];
+}
+
+
+#endif /* PL0_SSA_H */
@@ -0,0 +1,1073 @@
+//
+//  ssalower.c
+//  PL/0
+//
+
+#include "ssalower.h"
+#include <stdlib.h>
+#include <string.h>
+#include "dynamic_array.h"
+
+
+/* How a value gets to the code that uses it */
+typedef enum Mode {
+	MODE_NONE,      /*!< Not a number, like memory or a write */
+	MODE_REMAT,     /*!< Pushed again wherever it's used */
+	MODE_STACK,     /*!< Left on the stack for its only use */
+	MODE_STORED,    /*!< Left on the stack for the store to a variable in memory, then loaded from there */
+	MODE_HOME,      /*!< Stored to a slot of the stack frame, and loaded from there */
+	MODE_DROP       /*!< Computed for its side effects, then popped */
+} Mode;
+
+typedef enum ItemKind {
+	ITEM_PUSH,      /*!< Push an operand of an instruction */
+	ITEM_OP,        /*!< Run an instruction */
+	ITEM_END        /*!< Branch on the condition */
+} ItemKind;
+
+/* Step of the stack code of a basic block */
+typedef struct Item {
+	uint8_t kind;
+	SSAValue user;      /* Instruction whose operand is pushed, or SSA_NONE for the condition */
+	uint32_t operand;   /* Which of its operands is pushed */
+	SSAValue value;     /* Value that is pushed or computed, or SSA_NONE for the links of a call */
+	uint32_t pos;       /* Index of the instruction that the step comes before, or the number of instructions */
+} Item;
+
+typedef dynamic_array(Item) ItemArray;
+
+/* What the simulated stack holds */
+typedef struct Token {
+	uint8_t kind;       /* ITEM_PUSH for a pushed operand or ITEM_OP for a value left on the stack */
+	SSAValue value;     /* Value left on the stack, or instruction whose operand was pushed */
+	uint32_t operand;
+} Token;
+
+typedef struct Lower {
+	SSAProc* proc;
+	uint8_t* mode;
+	uint32_t* uses;
+	bool* shared;               /* Used by a phi or by another basic block */
+	SSAValue* store;            /* Store that keeps the value in a variable in memory */
+	uint32_t* pos;
+	uint32_t* first;            /* Index of the instruction whose code pushes the first thing the value needs */
+	Word* slot;
+	ItemArray* items;
+	size_t* cond_start;         /* Index of the first step that belongs to the condition */
+	SSAValue* mem_in;
+	SSAValue* mem_out;
+	SSAValue* state_in;         /* Value that each slot holds at the start of each basic block */
+	SSAValue* state_out;
+	Word frame_size;
+	Word temp_count;
+	SSAValueArray ops;
+	SSAValueArray demote_ops;
+	dynamic_array(Token) tokens;
+} Lower;
+
+/* Memory state or slot contents that no path has reached yet */
+#define TOP (SSA_NONE - 1)
+
+/* Slot that isn't assigned yet */
+#define NO_SLOT ((Word)-1)
+
+static void findOperands(Lower* L, SSAValue user, uint32_t block, SSAValueArray* ops);
+static void chooseModes(Lower* L);
+static bool isOnStack(Lower* L, SSAValue user, SSAValue value);
+static bool demote(Lower* L, SSAValue value);
+static bool planBlock(Lower* L, uint32_t block);
+static bool isAvailable(Lower* L, uint32_t block, SSAValue value, uint32_t start);
+static bool simulate(Lower* L, uint32_t block);
+static bool demoteTokens(Lower* L, uint32_t block);
+static void findMemory(Lower* L);
+static bool checkLoads(Lower* L);
+static bool isLoadValid(Lower* L, SSAValue load, SSAValue mem);
+static void assignSlots(Lower* L);
+static bool checkSlots(Lower* L);
+static void transfer(Lower* L, uint32_t block, SSAValue* state, SSAValueArray* moved);
+static void addTemp(Lower* L, SSAValue value);
+static void emit(Lower* L);
+static void emitPush(Lower* L, BasicBlock* bb, SSAValue value);
+static void emitOp(Lower* L, BasicBlock* bb, SSAValue value);
+static void emitSlot(Lower* L, BasicBlock* bb, Word slot, Opcode op);
+static bool emitCopies(Lower* L, BasicBlock* bb, uint32_t from, uint32_t to, bool dry_run);
+
+
+void ssa_lower(SSAProc* proc) {
+	size_t value_count = proc->insns.count;
+	size_t block_count = proc->blocks.count;
+	Lower L = {
+		.proc = proc,
+		.mode = calloc_ff(value_count, sizeof(*L.mode)),
+		.uses = calloc_ff(value_count, sizeof(*L.uses)),
+		.shared = calloc_ff(value_count, sizeof(*L.shared)),
+		.store = malloc_ff(value_count * sizeof(*L.store)),
+		.pos = calloc_ff(value_count, sizeof(*L.pos)),
+		.first = calloc_ff(value_count, sizeof(*L.first)),
+		.slot = malloc_ff(value_count * sizeof(*L.slot)),
+		.items = calloc_ff(block_count, sizeof(*L.items)),
+		.cond_start = calloc_ff(block_count, sizeof(*L.cond_start)),
+		.mem_in = malloc_ff(block_count * sizeof(*L.mem_in)),
+		.mem_out = malloc_ff(block_count * sizeof(*L.mem_out)),
+		.frame_size = proc->scope->symtree->frame_size
+	};
+	
+	SSAProc_findDominators(proc);
+	chooseModes(&L);
+	findMemory(&L);
+	
+	/* Plan the stack code of each basic block until every load that's pushed again still sees the same variable */
+	do {
+		foreach(&proc->rpo, pblock) {
+			while(!planBlock(&L, *pblock)) {
+				/* Values were moved off the stack, so try again */
+			}
+		}
+	} while(checkLoads(&L));
+	
+	/* Values get the slots of their variables until one turns out to be overwritten while it's still needed */
+	assignSlots(&L);
+	while(!checkSlots(&L)) {
+		/* Values were moved to temporary slots, so check again */
+	}
+	
+	emit(&L);
+	
+	for(size_t i = 0; i < block_count; i++) {
+		array_clear(&L.items[i]);
+	}
+	array_clear(&L.ops);
+	array_clear(&L.demote_ops);
+	array_clear(&L.tokens);
+	destroy(&L.mode);
+	destroy(&L.uses);
+	destroy(&L.shared);
+	destroy(&L.store);
+	destroy(&L.pos);
+	destroy(&L.first);
+	destroy(&L.slot);
+	destroy(&L.items);
+	destroy(&L.cond_start);
+	destroy(&L.mem_in);
+	destroy(&L.mem_out);
+	destroy(&L.state_in);
+	destroy(&L.state_out);
+}
+
+static void findOperands(Lower* L, SSAValue user, uint32_t block, SSAValueArray* ops) {
+	SSAProc* proc = L->proc;
+	ops->count = 0;
+	
+	/* The condition is the only operand of the branch at the end of a basic block */
+	if(user == SSA_NONE) {
+		array_append(ops, proc->blocks.elems[block].cond);
+		return;
+	}
+	
+	SSAInsn* insn = SSAProc_insn(proc, user);
+	switch(insn->op) {
+		case SSA_UNARY:
+		case SSA_BINARY:
+		case SSA_WRITE:
+			for(uint32_t i = 0; i < insn->arg_count; i++) {
+				SSAValue arg = SSAProc_arg(proc, user, i);
+				array_append(ops, arg);
+			}
+			break;
+		
+		case SSA_STORE: {
+			SSAValue arg = SSAProc_arg(proc, user, 1);
+			array_append(ops, arg);
+			break;
+		}
+		
+		case SSA_CALL:
+			/* Parameters go past the links of the frame the call is about to set up */
+			if(insn->arg_count > 1) {
+				SSAValue links = SSA_NONE;
+				array_append(ops, links);
+			}
+			for(uint32_t i = 1; i < insn->arg_count; i++) {
+				SSAValue arg = SSAProc_arg(proc, user, i);
+				array_append(ops, arg);
+			}
+			break;
+		
+		default:
+			/* Memory isn't pushed, and a call's result is already on the stack */
+			break;
+	}
+}
+
+static void chooseModes(Lower* L) {
+	SSAProc* proc = L->proc;
+	
+	/* Count the uses of every value, noting which ones are used anywhere but later in their own basic block */
+	foreach(&proc->rpo, pblock) {
+		SSABlock* blk = &proc->blocks.elems[*pblock];
+		foreach(&blk->phis, pphi) {
+			SSAInsn* phi = SSAProc_insn(proc, *pphi);
+			if(phi->op != SSA_PHI || phi->type == SSA_MEM) {
+				continue;
+			}
+			
+			for(uint32_t i = 0; i < phi->arg_count; i++) {
+				SSAValue arg = SSAProc_arg(proc, *pphi, i);
+				L->uses[arg]++;
+				L->shared[arg] = true;
+			}
+		}
+		
+		enumerate(&blk->insns, i, pvalue) {
+			L->pos[*pvalue] = (uint32_t)i;
+			findOperands(L, *pvalue, *pblock, &L->ops);
+			foreach(&L->ops, pop) {
+				if(*pop == SSA_NONE) {
+					continue;
+				}
+				
+				L->uses[*pop]++;
+				if(SSAProc_insn(proc, *pop)->block != *pblock) {
+					L->shared[*pop] = true;
+				}
+			}
+		}
+		
+		if(blk->cond != SSA_NONE) {
+			L->uses[blk->cond]++;
+			if(SSAProc_insn(proc, blk->cond)->block != *pblock) {
+				L->shared[blk->cond] = true;
+			}
+		}
+	}
+	
+	/* A value that's stored to a variable in memory right where it's computed can be loaded from
+	 there by its other uses, for as long as nothing changes the variable
+	 */
+	for(SSAValue value = 0; value < proc->insns.count; value++) {
+		L->store[value] = SSA_NONE;
+	}
+	foreach(&proc->rpo, pblock) {
+		foreach(&proc->blocks.elems[*pblock].insns, pvalue) {
+			SSAInsn* insn = SSAProc_insn(proc, *pvalue);
+			if(insn->op != SSA_STORE) {
+				continue;
+			}
+			
+			SSAValue value = SSAProc_arg(proc, *pvalue, 1);
+			SSAInsn* def = SSAProc_insn(proc, value);
+			if(def->block == *pblock && def->op != SSA_LOAD && L->store[value] == SSA_NONE) {
+				L->store[value] = *pvalue;
+			}
+		}
+	}
+	
+	for(SSAValue value = 0; value < proc->insns.count; value++) {
+		SSAInsn* insn = SSAProc_insn(proc, value);
+		L->slot[value] = NO_SLOT;
+		if(insn->op == SSA_NOP || insn->type == SSA_VOID || insn->type == SSA_MEM) {
+			L->mode[value] = MODE_NONE;
+		}
+		else if(insn->op == SSA_LIT || insn->op == SSA_CONST || insn->op == SSA_UNDEF) {
+			L->mode[value] = MODE_REMAT;
+		}
+		else if(insn->op == SSA_PHI || insn->op == SSA_ENTRY) {
+			L->mode[value] = MODE_HOME;
+		}
+		else if(L->uses[value] == 0) {
+			L->mode[value] = MODE_DROP;
+		}
+		else if(L->uses[value] == 1 && !L->shared[value]) {
+			L->mode[value] = MODE_STACK;
+		}
+		else if(L->store[value] != SSA_NONE) {
+			L->mode[value] = MODE_STORED;
+		}
+		else if(insn->op == SSA_LOAD) {
+			L->mode[value] = MODE_REMAT;
+		}
+		else {
+			L->mode[value] = MODE_HOME;
+		}
+	}
+}
+
+static bool isOnStack(Lower* L, SSAValue user, SSAValue value) {
+	if(value == SSA_NONE) {
+		return false;
+	}
+	
+	return L->mode[value] == MODE_STACK || (L->mode[value] == MODE_STORED && L->store[value] == user);
+}
+
+static bool demote(Lower* L, SSAValue value) {
+	if(value == SSA_NONE || (L->mode[value] != MODE_STACK && L->mode[value] != MODE_STORED)) {
+		return false;
+	}
+	
+	bool load = L->mode[value] == MODE_STACK && SSAProc_insn(L->proc, value)->op == SSA_LOAD;
+	L->mode[value] = load ? MODE_REMAT : MODE_HOME;
+	return true;
+}
+
+static bool planBlock(Lower* L, uint32_t block) {
+	SSAProc* proc = L->proc;
+	SSABlock* blk = &proc->blocks.elems[block];
+	size_t count = blk->insns.count;
+	
+	/* Find where the code of each value starts, which is where its first operand left on the stack starts */
+	enumerate(&blk->insns, i, pvalue) {
+		SSAInsn* insn = SSAProc_insn(proc, *pvalue);
+		if(insn->op == SSA_RESULT) {
+			/* A call leaves its result right where its code started */
+			L->first[*pvalue] = L->first[SSAProc_arg(proc, *pvalue, 0)];
+			continue;
+		}
+		
+		L->first[*pvalue] = (uint32_t)i;
+		findOperands(L, *pvalue, block, &L->ops);
+		for(size_t p = 0; p < L->ops.count; p++) {
+			SSAValue op = L->ops.elems[p];
+			if(isOnStack(L, *pvalue, op)) {
+				L->first[*pvalue] = L->first[op];
+				break;
+			}
+		}
+	}
+	
+	/* Pushes that come before each instruction, then before the branch */
+	ItemArray* preludes = calloc_ff(count + 1, sizeof(*preludes));
+	bool success = true;
+	for(uint32_t i = 0; i <= count && success; i++) {
+		SSAValue user = i < count ? blk->insns.elems[i] : SSA_NONE;
+		if(user == SSA_NONE && blk->cond == SSA_NONE) {
+			break;
+		}
+		
+		findOperands(L, user, block, &L->ops);
+		size_t pending = 0;
+		for(size_t p = 0; p < L->ops.count; p++) {
+			SSAValue op = L->ops.elems[p];
+			if(!isOnStack(L, user, op)) {
+				continue;
+			}
+			
+			/* Operands before one that's left on the stack are pushed before its code starts */
+			uint32_t start = L->first[op];
+			for(size_t q = pending; q < p; q++) {
+				if(!isAvailable(L, block, L->ops.elems[q], start)) {
+					demote(L, op);
+					success = false;
+					break;
+				}
+			}
+			if(!success) {
+				break;
+			}
+			
+			for(size_t q = pending; q < p; q++) {
+				Item item = {ITEM_PUSH, user, (uint32_t)q, L->ops.elems[q], start};
+				array_insert(&preludes[start], q - pending, &item);
+			}
+			pending = p + 1;
+		}
+		
+		for(size_t q = pending; q < L->ops.count && success; q++) {
+			Item item = {ITEM_PUSH, user, (uint32_t)q, L->ops.elems[q], i};
+			array_append(&preludes[i], item);
+		}
+	}
+	
+	/* Lay out the steps, noting where the code of the condition starts */
+	ItemArray* items = &L->items[block];
+	items->count = 0;
+	L->cond_start[block] = SIZE_MAX;
+	size_t cond_first = count;
+	if(isOnStack(L, SSA_NONE, blk->cond)) {
+		cond_first = L->first[blk->cond];
+	}
+	
+	for(uint32_t i = 0; i <= count; i++) {
+		if(blk->cond != SSA_NONE && i == cond_first) {
+			L->cond_start[block] = items->count;
+		}
+		
+		array_extend(items, preludes[i].elems, preludes[i].count);
+		array_clear(&preludes[i]);
+		
+		Item item = {i < count ? ITEM_OP : ITEM_END, SSA_NONE, 0, i < count ? blk->insns.elems[i] : SSA_NONE, i};
+		array_append(items, item);
+	}
+	destroy(&preludes);
+	
+	return success && simulate(L, block);
+}
+
+static bool isAvailable(Lower* L, uint32_t block, SSAValue value, uint32_t start) {
+	/* The links of a call and values that are pushed again can go anywhere */
+	if(value == SSA_NONE || L->mode[value] == MODE_REMAT || L->mode[value] == MODE_STORED) {
+		return true;
+	}
+	
+	/* Values from earlier basic blocks and from the start of this one are already in their slots */
+	SSAInsn* insn = SSAProc_insn(L->proc, value);
+	if(insn->block != block || insn->op == SSA_PHI || insn->op == SSA_ENTRY) {
+		return true;
+	}
+	
+	return L->pos[value] < start;
+}
+
+static bool simulate(Lower* L, uint32_t block) {
+	L->tokens.count = 0;
+	foreach(&L->items[block], pitem) {
+		if(pitem->kind == ITEM_PUSH) {
+			Token token = {ITEM_PUSH, pitem->user, pitem->operand};
+			array_append(&L->tokens, token);
+			continue;
+		}
+		
+		SSAValue user = pitem->kind == ITEM_OP ? pitem->value : SSA_NONE;
+		if(user == SSA_NONE && L->proc->blocks.elems[block].cond == SSA_NONE) {
+			continue;
+		}
+		
+		/* The operands must be on top of the stack in order, either pushed for it or left there */
+		findOperands(L, user, block, &L->ops);
+		bool match = L->tokens.count >= L->ops.count;
+		for(size_t q = 0; q < L->ops.count && match; q++) {
+			SSAValue op = L->ops.elems[q];
+			Token* token = &L->tokens.elems[L->tokens.count - L->ops.count + q];
+			if(isOnStack(L, user, op)) {
+				match = token->kind == ITEM_OP && token->value == op;
+			}
+			else {
+				match = token->kind == ITEM_PUSH && token->value == user && token->operand == q;
+			}
+		}
+		
+		if(!match) {
+			bool demoted = demoteTokens(L, block);
+			foreach(&L->ops, pop) {
+				demoted = demote(L, *pop) || demoted;
+			}
+			
+			/* Planning again only helps when something moved off the stack */
+			ASSERT(demoted);
+			return false;
+		}
+		
+		L->tokens.count -= L->ops.count;
+		if(user != SSA_NONE && (L->mode[user] == MODE_STACK || L->mode[user] == MODE_STORED)) {
+			Token token = {ITEM_OP, user, 0};
+			array_append(&L->tokens, token);
+		}
+	}
+	
+	/* Nothing may be left on the stack at the end of the basic block */
+	if(L->tokens.count != 0) {
+		bool demoted = demoteTokens(L, block);
+		ASSERT(demoted);
+		return false;
+	}
+	
+	return true;
+}
+
+static bool demoteTokens(Lower* L, uint32_t block) {
+	/* Whatever is in the way gets stored to a slot instead of being left on the stack */
+	bool demoted = false;
+	foreach(&L->tokens, ptoken) {
+		if(ptoken->kind == ITEM_OP) {
+			demoted = demote(L, ptoken->value) || demoted;
+			continue;
+		}
+		
+		findOperands(L, ptoken->value, block, &L->demote_ops);
+		foreach(&L->demote_ops, pop) {
+			demoted = demote(L, *pop) || demoted;
+		}
+	}
+	
+	return demoted;
+}
+
+static void findMemory(Lower* L) {
+	SSAProc* proc = L->proc;
+	for(size_t i = 0; i < proc->blocks.count; i++) {
+		L->mem_in[i] = TOP;
+		L->mem_out[i] = TOP;
+	}
+	
+	/* Find the state of memory at the start and end of each basic block, which is unknown at a
+	 join whose memory phi was removed because nothing used it
+	 */
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		foreach(&proc->rpo, pblock) {
+			SSABlock* blk = &proc->blocks.elems[*pblock];
+			SSAValue mem = *pblock == 0 ? SSA_NONE : TOP;
+			bool found = false;
+			foreach(&blk->phis, pphi) {
+				SSAInsn* phi = SSAProc_insn(proc, *pphi);
+				if(phi->type == SSA_MEM) {
+					mem = *pphi;
+					found = true;
+				}
+			}
+			
+			if(!found && *pblock != 0) {
+				foreach(&blk->preds, ppred) {
+					SSAValue out = L->mem_out[*ppred];
+					if(out == TOP) {
+						continue;
+					}
+					
+					mem = mem == TOP || mem == out ? out : SSA_NONE;
+				}
+			}
+			
+			L->mem_in[*pblock] = mem;
+			foreach(&blk->insns, pvalue) {
+				if(SSAProc_insn(proc, *pvalue)->type == SSA_MEM) {
+					mem = *pvalue;
+				}
+			}
+			
+			if(L->mem_out[*pblock] != mem) {
+				L->mem_out[*pblock] = mem;
+				changed = true;
+			}
+		}
+	}
+}
+
+static bool checkLoads(Lower* L) {
+	SSAProc* proc = L->proc;
+	bool changed = false;
+	
+	/* A load that's pushed again must still see the same store or call wherever it's pushed, and a
+	 value loaded from the variable it was stored to must still be there
+	 */
+	foreach(&proc->rpo, pblock) {
+		SSABlock* blk = &proc->blocks.elems[*pblock];
+		SSAValue mem = L->mem_in[*pblock];
+		uint32_t pos = 0;
+		foreach(&L->items[*pblock], pitem) {
+			for(; pos < pitem->pos; pos++) {
+				SSAValue value = blk->insns.elems[pos];
+				if(SSAProc_insn(proc, value)->type == SSA_MEM) {
+					mem = value;
+				}
+			}
+			
+			if(pitem->kind == ITEM_PUSH && !isLoadValid(L, pitem->value, mem)) {
+				L->mode[pitem->value] = MODE_HOME;
+				changed = true;
+			}
+		}
+		
+		/* The same goes for the copies to the phis of its successors */
+		for(size_t k = 0; k < 2; k++) {
+			uint32_t succ = blk->succs[k];
+			if(succ == SSA_NONE) {
+				continue;
+			}
+			
+			SSABlock* target = &proc->blocks.elems[succ];
+			uint32_t index = 0;
+			while(target->preds.elems[index] != *pblock) {
+				index++;
+			}
+			
+			foreach(&target->phis, pphi) {
+				SSAInsn* phi = SSAProc_insn(proc, *pphi);
+				if(phi->op != SSA_PHI || phi->type == SSA_MEM) {
+					continue;
+				}
+				
+				SSAValue arg = SSAProc_arg(proc, *pphi, index);
+				if(!isLoadValid(L, arg, L->mem_out[*pblock])) {
+					L->mode[arg] = MODE_HOME;
+					changed = true;
+				}
+			}
+		}
+	}
+	
+	return changed;
+}
+
+static bool isLoadValid(Lower* L, SSAValue load, SSAValue mem) {
+	if(load == SSA_NONE) {
+		return true;
+	}
+	
+	/* Find the store or call that the value has to be loaded after */
+	SSAProc* proc = L->proc;
+	SSAInsn* insn = SSAProc_insn(proc, load);
+	SSAValue clobber;
+	Symbol* sym;
+	if(L->mode[load] == MODE_STORED) {
+		clobber = L->store[load];
+		sym = SSAProc_insn(proc, clobber)->sym;
+	}
+	else if(L->mode[load] == MODE_REMAT && insn->op == SSA_LOAD) {
+		clobber = SSAProc_findClobber(proc, SSAProc_arg(proc, load, 0), insn->sym);
+		sym = insn->sym;
+	}
+	else {
+		return true;
+	}
+	
+	if(mem == SSA_NONE || mem == TOP) {
+		return false;
+	}
+	
+	return SSAProc_findClobber(proc, mem, sym) == clobber;
+}
+
+static void assignSlots(Lower* L) {
+	SSAProc* proc = L->proc;
+	
+	/* Values go to the slot of their variable when they have one */
+	for(SSAValue value = 0; value < proc->insns.count; value++) {
+		SSAInsn* insn = SSAProc_insn(proc, value);
+		if(L->mode[value] == MODE_HOME && insn->var != SSA_NONE && insn->var != SSA_MEMORY) {
+			L->slot[value] = proc->vars.elems[insn->var].slot;
+		}
+	}
+	
+	/* Values only used later in their own basic block share temporary slots once they're done with */
+	dynamic_array(size_t) busy_until = {0};
+	foreach(&proc->rpo, pblock) {
+		ItemArray* items = &L->items[*pblock];
+		enumerate(items, i, pitem) {
+			SSAValue value = pitem->value;
+			if(pitem->kind != ITEM_OP || L->mode[value] != MODE_HOME || L->slot[value] != NO_SLOT || L->shared[value]) {
+				continue;
+			}
+			
+			size_t last = i;
+			for(size_t j = i + 1; j < items->count; j++) {
+				if(items->elems[j].kind == ITEM_PUSH && items->elems[j].value == value) {
+					last = j;
+				}
+			}
+			
+			size_t temp = 0;
+			while(temp < busy_until.count && busy_until.elems[temp] != SIZE_MAX && busy_until.elems[temp] >= i) {
+				temp++;
+			}
+			
+			if(temp == busy_until.count) {
+				array_append(&busy_until, last);
+			}
+			else {
+				busy_until.elems[temp] = last;
+			}
+			L->slot[value] = L->frame_size + (Word)temp;
+		}
+		
+		/* None of them are needed past the end of the basic block */
+		foreach(&busy_until, pbusy) {
+			*pbusy = SIZE_MAX;
+		}
+	}
+	L->temp_count = (Word)busy_until.count;
+	array_clear(&busy_until);
+	
+	/* Every other value gets a temporary slot of its own */
+	for(SSAValue value = 0; value < proc->insns.count; value++) {
+		if(L->mode[value] == MODE_HOME && L->slot[value] == NO_SLOT) {
+			addTemp(L, value);
+		}
+	}
+}
+
+static void addTemp(Lower* L, SSAValue value) {
+	L->slot[value] = L->frame_size + L->temp_count++;
+}
+
+static bool checkSlots(Lower* L) {
+	SSAProc* proc = L->proc;
+	size_t slot_count = (size_t)(L->frame_size + L->temp_count);
+	size_t block_count = proc->blocks.count;
+	destroy(&L->state_in);
+	destroy(&L->state_out);
+	L->state_in = malloc_ff(block_count * slot_count * sizeof(*L->state_in));
+	L->state_out = malloc_ff(block_count * slot_count * sizeof(*L->state_out));
+	for(size_t i = 0; i < block_count * slot_count; i++) {
+		L->state_in[i] = TOP;
+		L->state_out[i] = TOP;
+	}
+	
+	/* Slots hold nothing that's known when the procedure starts, except for its variables' entry values */
+	SSAValue* entry = L->state_in;
+	for(size_t i = 0; i < slot_count; i++) {
+		entry[i] = SSA_NONE;
+	}
+	foreach(&proc->blocks.elems[0].phis, pvalue) {
+		SSAInsn* insn = SSAProc_insn(proc, *pvalue);
+		if(insn->op == SSA_ENTRY && L->mode[*pvalue] == MODE_HOME) {
+			entry[proc->vars.elems[insn->var].slot] = *pvalue;
+			entry[L->slot[*pvalue]] = *pvalue;
+		}
+	}
+	
+	/* Find what each slot holds at the start and end of each basic block */
+	SSAValue* state = malloc_ff(slot_count * sizeof(*state));
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		foreach(&proc->rpo, pblock) {
+			SSABlock* blk = &proc->blocks.elems[*pblock];
+			SSAValue* in = &L->state_in[*pblock * slot_count];
+			if(*pblock != 0) {
+				for(size_t i = 0; i < slot_count; i++) {
+					SSAValue value = TOP;
+					foreach(&blk->preds, ppred) {
+						SSAValue out = L->state_out[*ppred * slot_count + i];
+						if(out != TOP) {
+							value = value == TOP || value == out ? out : SSA_NONE;
+						}
+					}
+					in[i] = value;
+				}
+				
+				foreach(&blk->phis, pphi) {
+					if(SSAProc_insn(proc, *pphi)->op == SSA_PHI && L->mode[*pphi] == MODE_HOME) {
+						in[L->slot[*pphi]] = *pphi;
+					}
+				}
+			}
+			
+			memcpy(state, in, slot_count * sizeof(*state));
+			transfer(L, *pblock, state, NULL);
+			
+			SSAValue* out = &L->state_out[*pblock * slot_count];
+			if(memcmp(out, state, slot_count * sizeof(*state)) != 0) {
+				memcpy(out, state, slot_count * sizeof(*state));
+				changed = true;
+			}
+		}
+	}
+	
+	/* Every value that's loaded must still be in its slot there */
+	SSAValueArray moved = {0};
+	foreach(&proc->rpo, pblock) {
+		SSABlock* blk = &proc->blocks.elems[*pblock];
+		memcpy(state, &L->state_in[*pblock * slot_count], slot_count * sizeof(*state));
+		transfer(L, *pblock, state, &moved);
+		
+		for(size_t k = 0; k < 2; k++) {
+			uint32_t succ = blk->succs[k];
+			if(succ == SSA_NONE) {
+				continue;
+			}
+			
+			SSABlock* target = &proc->blocks.elems[succ];
+			uint32_t index = 0;
+			while(target->preds.elems[index] != *pblock) {
+				index++;
+			}
+			
+			foreach(&target->phis, pphi) {
+				if(SSAProc_insn(proc, *pphi)->op != SSA_PHI || L->mode[*pphi] != MODE_HOME) {
+					continue;
+				}
+				
+				SSAValue arg = SSAProc_arg(proc, *pphi, index);
+				if(state[L->slot[*pphi]] != arg && L->mode[arg] == MODE_HOME && state[L->slot[arg]] != arg) {
+					array_append(&moved, arg);
+				}
+			}
+		}
+	}
+	destroy(&state);
+	
+	/* Those that weren't get a temporary slot of their own, and the check starts over */
+	Word limit = L->frame_size + L->temp_count;
+	foreach(&moved, pvalue) {
+		if(L->slot[*pvalue] < limit) {
+			addTemp(L, *pvalue);
+		}
+	}
+	
+	bool valid = moved.count == 0;
+	array_clear(&moved);
+	return valid;
+}
+
+static void transfer(Lower* L, uint32_t block, SSAValue* state, SSAValueArray* moved) {
+	foreach(&L->items[block], pitem) {
+		SSAValue value = pitem->value;
+		if(value == SSA_NONE || L->mode[value] != MODE_HOME) {
+			continue;
+		}
+		
+		if(pitem->kind == ITEM_OP) {
+			state[L->slot[value]] = value;
+		}
+		else if(moved != NULL && state[L->slot[value]] != value) {
+			array_append(moved, value);
+		}
+	}
+}
+
+static void emit(Lower* L) {
+	SSAProc* proc = L->proc;
+	SymTree* scope = proc->scope->symtree;
+	size_t block_count = proc->blocks.count;
+	
+	/* Create a basic block for each one that can run, in the same order */
+	BasicBlock** bbs = calloc_ff(block_count, sizeof(*bbs));
+	BasicBlock* last = NULL;
+	for(uint32_t i = 0; i < block_count; i++) {
+		SSABlock* blk = &proc->blocks.elems[i];
+		if(blk->removed || blk->idom == SSA_NONE) {
+			continue;
+		}
+		
+		bbs[i] = last == NULL ? BasicBlock_new() : BasicBlock_createNext(&last);
+		bbs[i]->origin = blk->origin;
+		bbs[i]->ordinal = blk->ordinal;
+		last = bbs[i];
+	}
+	
+	/* Temporary slots grow the stack frame */
+	scope->frame_size = L->frame_size + L->temp_count;
+	if(scope->frame_size != 0) {
+		BasicBlock_addInsn(bbs[0], MAKE_INC(scope->frame_size));
+	}
+	
+	/* Entry values that moved to a temporary slot are copied there first */
+	foreach(&proc->blocks.elems[0].phis, pvalue) {
+		SSAInsn* insn = SSAProc_insn(proc, *pvalue);
+		if(insn->op != SSA_ENTRY || L->mode[*pvalue] != MODE_HOME) {
+			continue;
+		}
+		
+		Word slot = proc->vars.elems[insn->var].slot;
+		if(slot != L->slot[*pvalue]) {
+			emitSlot(L, bbs[0], slot, OP_LOD);
+			emitSlot(L, bbs[0], L->slot[*pvalue], OP_STO);
+		}
+	}
+	
+	for(uint32_t i = 0; i < block_count; i++) {
+		BasicBlock* bb = bbs[i];
+		if(bb == NULL) {
+			continue;
+		}
+		
+		enumerate(&L->items[i], j, pitem) {
+			if(j == L->cond_start[i]) {
+				BasicBlock_markCondition(bb);
+			}
+			
+			if(pitem->kind == ITEM_PUSH) {
+				if(pitem->value == SSA_NONE) {
+					BasicBlock_addInsn(bb, MAKE_INC(4));
+				}
+				else {
+					emitPush(L, bb, pitem->value);
+				}
+			}
+			else if(pitem->kind == ITEM_OP) {
+				emitOp(L, bb, pitem->value);
+			}
+		}
+		
+		/* A basic block that doesn't branch sets the phis of its successor itself */
+		SSABlock* blk = &proc->blocks.elems[i];
+		if(blk->cond == SSA_NONE) {
+			if(blk->succs[0] != SSA_NONE) {
+				emitCopies(L, bb, i, blk->succs[0], false);
+				BasicBlock_setTarget(bb, bbs[blk->succs[0]]);
+			}
+			continue;
+		}
+		
+		/* Each branch that needs copies for the phis of its target gets a basic block for them */
+		for(size_t k = 0; k < 2; k++) {
+			uint32_t succ = blk->succs[k];
+			BasicBlock* target = bbs[succ];
+			if(emitCopies(L, NULL, i, succ, true)) {
+				target = BasicBlock_createNext(&last);
+				emitCopies(L, target, i, succ, false);
+				BasicBlock_setTarget(target, bbs[succ]);
+			}
+			
+			if(k == 0) {
+				BasicBlock_setTarget(bb, target);
+			}
+			else {
+				BasicBlock_setFalseTarget(bb, target);
+			}
+		}
+	}
+	
+	proc->scope->code = bbs[0];
+	destroy(&bbs);
+}
+
+static void emitPush(Lower* L, BasicBlock* bb, SSAValue value) {
+	SSAInsn* insn = SSAProc_insn(L->proc, value);
+	if(L->mode[value] == MODE_HOME) {
+		emitSlot(L, bb, L->slot[value], OP_LOD);
+		return;
+	}
+	
+	if(L->mode[value] == MODE_STORED) {
+		BasicBlock_markSymbol(bb, SSAProc_insn(L->proc, L->store[value])->sym);
+		BasicBlock_addInsn(bb, MAKE_LOD(0, 0));
+		return;
+	}
+	
+	switch(insn->op) {
+		case SSA_LIT:
+			BasicBlock_addInsn(bb, MAKE_LIT(insn->imm));
+			break;
+		
+		case SSA_CONST:
+			/* The constant's value is set during symbol resolution */
+			BasicBlock_markSymbol(bb, insn->sym);
+			BasicBlock_addInsn(bb, MAKE_LIT(0));
+			break;
+		
+		case SSA_UNDEF:
+			/* Code that can never run reads it, so any number will do */
+			BasicBlock_addInsn(bb, MAKE_LIT(0));
+			break;
+		
+		case SSA_LOAD:
+			BasicBlock_markSymbol(bb, insn->sym);
+			BasicBlock_addInsn(bb, MAKE_LOD(0, 0));
+			break;
+		
+		default:
+			ASSERT(!"Value can't be pushed again");
+	}
+}
+
+static void emitOp(Lower* L, BasicBlock* bb, SSAValue value) {
+	SSAInsn* insn = SSAProc_insn(L->proc, value);
+	if(L->mode[value] == MODE_REMAT) {
+		return;
+	}
+	
+	switch(insn->op) {
+		case SSA_UNARY:
+		case SSA_BINARY:
+			BasicBlock_addInsn(bb, MAKE_OPR(insn->imm));
+			break;
+		
+		case SSA_LOAD:
+			BasicBlock_markSymbol(bb, insn->sym);
+			BasicBlock_addInsn(bb, MAKE_LOD(0, 0));
+			break;
+		
+		case SSA_STORE:
+			BasicBlock_markSymbol(bb, insn->sym);
+			BasicBlock_addInsn(bb, MAKE_STO(0, 0));
+			break;
+		
+		case SSA_CALL:
+			/* Move the stack pointer back below the parameters, which the callee finds past its links */
+			if(insn->arg_count > 1) {
+				BasicBlock_addInsn(bb, MAKE_INC(-(4 + (Word)insn->arg_count - 1)));
+			}
+			
+			/* The target is set during symbol resolution */
+			BasicBlock_markSymbol(bb, insn->sym);
+			BasicBlock_addInsn(bb, MAKE_CAL(0, ADDR_UND));
+			break;
+		
+		case SSA_RESULT:
+			/* The return value is left in the first slot of the callee's frame, right at the top of the stack */
+			BasicBlock_addInsn(bb, MAKE_INC(1));
+			break;
+		
+		case SSA_READ:
+			BasicBlock_addInsn(bb, MAKE_READ());
+			break;
+		
+		case SSA_WRITE:
+			BasicBlock_addInsn(bb, MAKE_WRITE());
+			break;
+		
+		default:
+			ASSERT(!"Unexpected instruction");
+	}
+	
+	if(L->mode[value] == MODE_HOME) {
+		emitSlot(L, bb, L->slot[value], OP_STO);
+	}
+	else if(L->mode[value] == MODE_DROP) {
+		BasicBlock_addInsn(bb, MAKE_INC(-1));
+	}
+}
+
+static void emitSlot(Lower* L, BasicBlock* bb, Word slot, Opcode op) {
+	/* Slots of the procedure's own variables are loaded through their symbols, like any other code does */
+	SSAProc* proc = L->proc;
+	for(size_t i = 0; i < proc->vars.count; i++) {
+		SSAVar* var = &proc->vars.elems[i];
+		if(var->sym != NULL && var->slot == slot) {
+			BasicBlock_markSymbol(bb, var->sym);
+			slot = 0;
+			break;
+		}
+	}
+	
+	BasicBlock_addInsn(bb, op == OP_LOD ? MAKE_LOD(0, slot) : MAKE_STO(0, slot));
+}
+
+static bool emitCopies(Lower* L, BasicBlock* bb, uint32_t from, uint32_t to, bool dry_run) {
+	SSAProc* proc = L->proc;
+	SSABlock* target = &proc->blocks.elems[to];
+	size_t slot_count = (size_t)(L->frame_size + L->temp_count);
+	SSAValue* state = &L->state_out[from * slot_count];
+	uint32_t index = 0;
+	while(target->preds.elems[index] != from) {
+		index++;
+	}
+	
+	/* Push every value first, so that phis can take each other's values */
+	size_t count = 0;
+	foreach(&target->phis, pphi) {
+		if(SSAProc_insn(proc, *pphi)->op != SSA_PHI || L->mode[*pphi] != MODE_HOME) {
+			continue;
+		}
+		
+		SSAValue arg = SSAProc_arg(proc, *pphi, index);
+		if(state[L->slot[*pphi]] == arg) {
+			continue;
+		}
+		
+		if(dry_run) {
+			return true;
+		}
+		emitPush(L, bb, arg);
+		count++;
+	}
+	
+	/* Then store them in reverse, as the last one pushed is on top */
+	for(size_t i = target->phis.count; i-- > 0 && count > 0;) {
+		SSAValue phi = target->phis.elems[i];
+		if(SSAProc_insn(proc, phi)->op != SSA_PHI || L->mode[phi] != MODE_HOME) {
+			continue;
+		}
+		
+		if(state[L->slot[phi]] == SSAProc_arg(proc, phi, index)) {
+			continue;
+		}
+		
+		emitSlot(L, bb, L->slot[phi], OP_STO);
+		count--;
+	}
+	
+	return false;
+}
@@ -0,0 +1,27 @@
+//
+//  ssalower.h
+//  PL/0
+//
+
+#ifndef PL0_SSALOWER_H
+#define PL0_SSALOWER_H
+
+#include "config.h"
+#include "ssa.h"
+
+
+/*! Lower a procedure in SSA form into the basic blocks of its scope's code graph. Instructions
+ stay in the same order. A value that's only used once, by code in the same basic block that
+ can take it straight off the stack, is left there. Numbers, constants, and loads that nothing
+ could have changed in between are pushed again wherever they're used. Every other value is
+ stored to a slot of the stack frame, which is the slot of the variable it was first assigned to
+ as long as that still holds the value wherever it's used, or a temporary slot past the
+ procedure's variables otherwise. The phis of a basic block become stores to their slots at the
+ end of each predecessor, in a new basic block on a branch that needs one. The stack frame grows
+ to make room for the temporary slots
+ @param proc Procedure to lower, which has been optimized
+ */
+void ssa_lower(SSAProc* proc);
+
+
+#endif /* PL0_SSALOWER_H */
@@ -0,0 +1,510 @@
+//
+//  ssaopt.c
+//  PL/0
+//
+
+#include "ssaopt.h"
+#include <stdlib.h>
+#include <string.h>
+#include "dynamic_array.h"
+
+
+/* What constant propagation knows about a value. Each value only ever moves down this list */
+typedef enum Lattice {
+	LAT_UNKNOWN,   /*!< Not computed by any code that can run yet */
+	LAT_CONST,     /*!< Always the same number */
+	LAT_VARYING    /*!< Might be different each time */
+} Lattice;
+
+typedef struct SCCP {
+	SSAProc* proc;
+	uint8_t* lattice;
+	Word* number;
+	bool* executable;
+} SCCP;
+
+/* Everything that two computations need to agree on to produce the same value */
+typedef struct ValueKey {
+	uint8_t op;
+	Word imm;
+	Symbol* sym;
+	SSAValue left;      /* First operand, or the last store or call that a load depends on */
+	SSAValue right;
+} ValueKey;
+
+static bool propagateCopies(SSAProc* proc);
+static bool propagateConstants(SSAProc* proc);
+static bool evaluate(SCCP* sccp, uint32_t block, SSAValue value);
+static bool isTaken(SCCP* sccp, uint32_t from, uint32_t to);
+static bool lowerLattice(SCCP* sccp, SSAValue value, Lattice lattice, Word number);
+static bool foldConstants(SCCP* sccp);
+static bool numberValues(SSAProc* proc);
+static bool findKey(SSAProc* proc, SSAValue value, ValueKey* key);
+static bool isSameValue(SSAProc* proc, SSAValue a, const ValueKey* akey, SSAValue b, const ValueKey* bkey);
+static size_t hashKey(const ValueKey* key);
+static bool removeDeadCode(SSAProc* proc);
+
+
+void ssa_optimize(SSAProc* proc) {
+	for(size_t round = 0; round < SSA_MAX_ROUNDS; round++) {
+		bool changed = propagateCopies(proc);
+		changed = propagateConstants(proc) || changed;
+		changed = numberValues(proc) || changed;
+		changed = removeDeadCode(proc) || changed;
+		if(!changed) {
+			break;
+		}
+	}
+}
+
+static bool propagateCopies(SSAProc* proc) {
+	bool changed = false;
+	bool again = true;
+	while(again) {
+		again = false;
+		foreach(&proc->blocks, blk) {
+			/* A phi whose operands are all the same value, apart from the phi itself, is that value */
+			foreach(&blk->phis, pphi) {
+				SSAInsn* phi = SSAProc_insn(proc, *pphi);
+				if(phi->op != SSA_PHI) {
+					continue;
+				}
+				
+				SSAValue same = SSA_NONE;
+				bool trivial = true;
+				for(uint32_t i = 0; i < phi->arg_count; i++) {
+					SSAValue operand = SSAProc_arg(proc, *pphi, i);
+					if(operand == same || operand == *pphi) {
+						continue;
+					}
+					if(same != SSA_NONE) {
+						trivial = false;
+						break;
+					}
+					same = operand;
+				}
+				
+				if(trivial && same != SSA_NONE) {
+					SSAProc_replace(proc, *pphi, same);
+					again = true;
+				}
+			}
+			
+			/* A load that can only see one store gets the value that was stored */
+			foreach(&blk->insns, pvalue) {
+				SSAInsn* insn = SSAProc_insn(proc, *pvalue);
+				if(insn->op != SSA_LOAD) {
+					continue;
+				}
+				
+				SSAValue clobber = SSAProc_findClobber(proc, SSAProc_arg(proc, *pvalue, 0), insn->sym);
+				SSAInsn* store = SSAProc_insn(proc, clobber);
+				if(store->op == SSA_STORE && store->sym == insn->sym) {
+					SSAProc_replace(proc, *pvalue, SSAProc_arg(proc, clobber, 1));
+					again = true;
+				}
+			}
+		}
+		changed = changed || again;
+	}
+	
+	SSAProc_compact(proc);
+	return changed;
+}
+
+static bool propagateConstants(SSAProc* proc) {
+	SCCP sccp = {.proc = proc};
+	sccp.lattice = calloc_ff(proc->insns.count, sizeof(*sccp.lattice));
+	sccp.number = calloc_ff(proc->insns.count, sizeof(*sccp.number));
+	sccp.executable = calloc_ff(proc->blocks.count, sizeof(*sccp.executable));
+	sccp.executable[0] = true;
+	
+	/* Sweep over the basic blocks that can run until nothing more is learned about any value */
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		enumerate(&proc->blocks, b, blk) {
+			if(blk->removed || !sccp.executable[b]) {
+				continue;
+			}
+			
+			foreach(&blk->phis, pvalue) {
+				changed = evaluate(&sccp, (uint32_t)b, *pvalue) || changed;
+			}
+			foreach(&blk->insns, pvalue) {
+				changed = evaluate(&sccp, (uint32_t)b, *pvalue) || changed;
+			}
+			
+			for(size_t k = 0; k < 2; k++) {
+				uint32_t to = blk->succs[k];
+				if(to != SSA_NONE && !sccp.executable[to] && isTaken(&sccp, (uint32_t)b, to)) {
+					sccp.executable[to] = true;
+					changed = true;
+				}
+			}
+		}
+	}
+	
+	changed = foldConstants(&sccp);
+	destroy(&sccp.lattice);
+	destroy(&sccp.number);
+	destroy(&sccp.executable);
+	return changed;
+}
+
+static bool evaluate(SCCP* sccp, uint32_t block, SSAValue value) {
+	SSAProc* proc = sccp->proc;
+	SSAInsn* insn = SSAProc_insn(proc, value);
+	switch(insn->op) {
+		case SSA_NOP:
+			return false;
+		
+		case SSA_LIT:
+		case SSA_CONST:
+			return lowerLattice(sccp, value, LAT_CONST, insn->imm);
+		
+		case SSA_PHI: {
+			/* Only the branches that can be taken matter */
+			SSABlock* blk = &proc->blocks.elems[block];
+			Lattice lattice = LAT_UNKNOWN;
+			Word number = 0;
+			enumerate(&blk->preds, i, pfrom) {
+				if(!isTaken(sccp, *pfrom, block)) {
+					continue;
+				}
+				
+				SSAValue operand = SSAProc_arg(proc, value, (uint32_t)i);
+				Lattice operand_lattice = sccp->lattice[operand];
+				if(operand_lattice == LAT_UNKNOWN) {
+					continue;
+				}
+				if(lattice == LAT_UNKNOWN) {
+					lattice = operand_lattice;
+					number = sccp->number[operand];
+				}
+				else if(operand_lattice == LAT_VARYING || sccp->number[operand] != number) {
+					lattice = LAT_VARYING;
+				}
+			}
+			return lowerLattice(sccp, value, lattice, number);
+		}
+		
+		case SSA_UNARY:
+		case SSA_BINARY: {
+			SSAValue left = SSAProc_arg(proc, value, 0);
+			SSAValue right = insn->op == SSA_BINARY ? SSAProc_arg(proc, value, 1) : left;
+			if(sccp->lattice[left] == LAT_VARYING || sccp->lattice[right] == LAT_VARYING) {
+				return lowerLattice(sccp, value, LAT_VARYING, 0);
+			}
+			if(sccp->lattice[left] == LAT_UNKNOWN || sccp->lattice[right] == LAT_UNKNOWN) {
+				return false;
+			}
+			
+			/* Operations that the VM would reject stay where they are, so it still does */
+			Word result;
+			if(!SSAProc_compute(insn->imm, sccp->number[left], sccp->number[right], &result)) {
+				return lowerLattice(sccp, value, LAT_VARYING, 0);
+			}
+			return lowerLattice(sccp, value, LAT_CONST, result);
+		}
+		
+		default:
+			/* Nothing is known about entry values, loads, results, or numbers read from the input */
+			return lowerLattice(sccp, value, LAT_VARYING, 0);
+	}
+}
+
+static bool isTaken(SCCP* sccp, uint32_t from, uint32_t to) {
+	if(!sccp->executable[from]) {
+		return false;
+	}
+	
+	SSABlock* blk = &sccp->proc->blocks.elems[from];
+	if(blk->cond == SSA_NONE) {
+		return blk->succs[0] == to;
+	}
+	
+	SSAValue cond = SSAProc_find(sccp->proc, blk->cond);
+	switch(sccp->lattice[cond]) {
+		case LAT_UNKNOWN:
+			return false;
+		
+		case LAT_CONST:
+			return blk->succs[sccp->number[cond] != 0 ? 0 : 1] == to;
+		
+		default:
+			return blk->succs[0] == to || blk->succs[1] == to;
+	}
+}
+
+static bool lowerLattice(SCCP* sccp, SSAValue value, Lattice lattice, Word number) {
+	if(lattice == LAT_UNKNOWN || sccp->lattice[value] == LAT_VARYING) {
+		return false;
+	}
+	
+	if(sccp->lattice[value] == LAT_CONST) {
+		if(lattice == LAT_CONST && number == sccp->number[value]) {
+			return false;
+		}
+		sccp->lattice[value] = LAT_VARYING;
+		return true;
+	}
+	
+	sccp->lattice[value] = (uint8_t)lattice;
+	sccp->number[value] = number;
+	return true;
+}
+
+static bool foldConstants(SCCP* sccp) {
+	SSAProc* proc = sccp->proc;
+	bool changed = false;
+	
+	/* A condition that's always the same only ever takes one branch */
+	enumerate(&proc->blocks, b, blk) {
+		if(blk->removed || !sccp->executable[b] || blk->cond == SSA_NONE) {
+			continue;
+		}
+		
+		SSAValue cond = SSAProc_find(proc, blk->cond);
+		if(sccp->lattice[cond] != LAT_CONST) {
+			continue;
+		}
+		
+		size_t taken = sccp->number[cond] != 0 ? 0 : 1;
+		SSAProc_removeEdge(proc, (uint32_t)b, 1 - taken);
+		blk->succs[0] = blk->succs[taken];
+		blk->succs[1] = SSA_NONE;
+		blk->cond = SSA_NONE;
+		changed = true;
+	}
+	
+	/* Code that can never run is removed, along with its branches into code that can */
+	enumerate(&proc->blocks, b, blk) {
+		if(!blk->removed && !sccp->executable[b]) {
+			SSAProc_removeBlock(proc, (uint32_t)b);
+			changed = true;
+		}
+	}
+	
+	/* Computations whose result is always the same become that number. A phi is replaced by a new
+	 number, while anything else is turned into one where it is
+	 */
+	foreach(&proc->blocks, blk) {
+		foreach(&blk->phis, pvalue) {
+			SSAInsn* insn = SSAProc_insn(proc, *pvalue);
+			if(insn->op != SSA_PHI || sccp->lattice[*pvalue] != LAT_CONST) {
+				continue;
+			}
+			
+			SSAValue lit = (SSAValue)proc->insns.count;
+			SSAInsn number = {
+				.op = SSA_LIT,
+				.type = insn->type,
+				.block = insn->block,
+				.args = (uint32_t)proc->args.count,
+				.imm = sccp->number[*pvalue],
+				.var = SSA_NONE,
+				.repl = lit
+			};
+			array_append(&proc->insns, number);
+			array_insert(&blk->insns, 0, &lit);
+			SSAProc_replace(proc, *pvalue, lit);
+			changed = true;
+		}
+		
+		foreach(&blk->insns, pvalue) {
+			SSAInsn* insn = SSAProc_insn(proc, *pvalue);
+			if((insn->op != SSA_UNARY && insn->op != SSA_BINARY) || sccp->lattice[*pvalue] != LAT_CONST) {
+				continue;
+			}
+			
+			insn->op = SSA_LIT;
+			insn->arg_count = 0;
+			insn->imm = sccp->number[*pvalue];
+			changed = true;
+		}
+	}
+	
+	SSAProc_compact(proc);
+	return changed;
+}
+
+static bool numberValues(SSAProc* proc) {
+	SSAProc_findDominators(proc);
+	
+	/* Open-addressed hash table of the values seen so far, with room for all of them */
+	size_t capacity = 16;
+	while(capacity < 2 * proc->insns.count) {
+		capacity *= 2;
+	}
+	SSAValue* table = malloc_ff(capacity * sizeof(*table));
+	for(size_t i = 0; i < capacity; i++) {
+		table[i] = SSA_NONE;
+	}
+	ValueKey* keys = malloc_ff(proc->insns.count * sizeof(*keys));
+	
+	/* Visiting the basic blocks in reverse postorder sees every dominator before what it dominates.
+	 A value can only stand in for an equal one when its basic block dominates the other's. Repeats
+	 within a basic block are left to local value numbering, which keeps the value on the stack
+	 instead of storing it to a slot
+	 */
+	bool changed = false;
+	foreach(&proc->rpo, pb) {
+		SSABlock* blk = &proc->blocks.elems[*pb];
+		for(size_t list = 0; list < 2; list++) {
+			foreach(list == 0 ? &blk->phis : &blk->insns, pvalue) {
+				SSAValue value = *pvalue;
+				if(!findKey(proc, value, &keys[value])) {
+					continue;
+				}
+				
+				size_t mask = capacity - 1;
+				size_t slot = hashKey(&keys[value]) & mask;
+				bool found = false;
+				while(table[slot] != SSA_NONE) {
+					SSAValue other = table[slot];
+					uint32_t other_block = SSAProc_insn(proc, other)->block;
+					if(isSameValue(proc, value, &keys[value], other, &keys[other])
+					   && (list == 0 || other_block != *pb)
+					   && SSAProc_dominates(proc, other_block, *pb)) {
+						SSAProc_replace(proc, value, other);
+						found = changed = true;
+						break;
+					}
+					slot = (slot + 1) & mask;
+				}
+				if(!found) {
+					table[slot] = value;
+				}
+			}
+		}
+	}
+	
+	destroy(&keys);
+	destroy(&table);
+	SSAProc_compact(proc);
+	return changed;
+}
+
+static bool findKey(SSAProc* proc, SSAValue value, ValueKey* key) {
+	SSAInsn* insn = SSAProc_insn(proc, value);
+	memset(key, 0, sizeof(*key));
+	key->op = insn->op;
+	key->imm = insn->imm;
+	key->left = key->right = SSA_NONE;
+	switch(insn->op) {
+		case SSA_PHI:
+			/* Phis are only equal in the same basic block, where they're compared operand by operand */
+			key->left = insn->block;
+			return true;
+		
+		case SSA_UNARY:
+			key->left = SSAProc_arg(proc, value, 0);
+			return true;
+		
+		case SSA_BINARY:
+			key->left = SSAProc_arg(proc, value, 0);
+			key->right = SSAProc_arg(proc, value, 1);
+			
+			/* The order of the operands doesn't matter for these */
+			if((insn->imm == ALU_ADD || insn->imm == ALU_MUL || insn->imm == ALU_EQL || insn->imm == ALU_NEQ)
+			   && key->right < key->left) {
+				key->left = key->right;
+				key->right = SSAProc_arg(proc, value, 0);
+			}
+			return true;
+		
+		case SSA_LOAD:
+			/* Loads see the same value as long as nothing that might have changed it came in between */
+			key->sym = insn->sym;
+			key->left = SSAProc_findClobber(proc, SSAProc_arg(proc, value, 0), insn->sym);
+			return true;
+		
+		default:
+			return false;
+	}
+}
+
+static bool isSameValue(SSAProc* proc, SSAValue a, const ValueKey* akey, SSAValue b, const ValueKey* bkey) {
+	if(memcmp(akey, bkey, sizeof(*akey)) != 0) {
+		return false;
+	}
+	if(akey->op != SSA_PHI) {
+		return true;
+	}
+	
+	SSAInsn* aphi = SSAProc_insn(proc, a);
+	SSAInsn* bphi = SSAProc_insn(proc, b);
+	if(aphi->arg_count != bphi->arg_count) {
+		return false;
+	}
+	for(uint32_t i = 0; i < aphi->arg_count; i++) {
+		if(SSAProc_arg(proc, a, i) != SSAProc_arg(proc, b, i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static size_t hashKey(const ValueKey* key) {
+	size_t hash = key->op;
+	hash = hash * 31 + (uint32_t)key->imm;
+	hash = hash * 31 + (size_t)key->sym;
+	hash = hash * 31 + key->left;
+	hash = hash * 31 + key->right;
+	return hash ^ (hash >> 16);
+}
+
+static bool removeDeadCode(SSAProc* proc) {
+	bool* live = calloc_ff(proc->insns.count, sizeof(*live));
+	dynamic_array(SSAValue) worklist = {0};
+	
+	/* Start from everything with side effects and every condition that's branched on */
+	foreach(&proc->blocks, blk) {
+		for(size_t list = 0; list < 2; list++) {
+			foreach(list == 0 ? &blk->phis : &blk->insns, pvalue) {
+				if(SSAProc_hasEffect(proc, *pvalue)) {
+					live[*pvalue] = true;
+					array_append(&worklist, *pvalue);
+				}
+			}
+		}
+		
+		if(blk->cond != SSA_NONE) {
+			blk->cond = SSAProc_find(proc, blk->cond);
+			if(!live[blk->cond]) {
+				live[blk->cond] = true;
+				array_append(&worklist, blk->cond);
+			}
+		}
+	}
+	
+	/* Anything that a live value uses is live too */
+	while(worklist.count != 0) {
+		SSAValue value = worklist.elems[--worklist.count];
+		for(uint32_t i = 0; i < proc->insns.elems[value].arg_count; i++) {
+			SSAValue operand = SSAProc_arg(proc, value, i);
+			if(operand != SSA_NONE && !live[operand]) {
+				live[operand] = true;
+				array_append(&worklist, operand);
+			}
+		}
+	}
+	array_clear(&worklist);
+	
+	bool changed = false;
+	foreach(&proc->blocks, blk) {
+		for(size_t list = 0; list < 2; list++) {
+			foreach(list == 0 ? &blk->phis : &blk->insns, pvalue) {
+				if(!live[*pvalue]) {
+					proc->insns.elems[*pvalue].op = SSA_NOP;
+					changed = true;
+				}
+			}
+		}
+	}
+	
+	destroy(&live);
+	SSAProc_compact(proc);
+	return changed;
+}
@@ -0,0 +1,29 @@
+//
+//  ssaopt.h
+//  PL/0
+//
+
+#ifndef PL0_SSAOPT_H
+#define PL0_SSAOPT_H
+
+#include "config.h"
+#include "ssa.h"
+
+
+/*! Most times ssa_optimize runs its passes over a procedure. Each round only runs again when the
+ one before it changed something, so this is only reached if something has gone wrong
+ */
+#define SSA_MAX_ROUNDS 8
+
+/*! Optimize a procedure in SSA form. Copy propagation removes phis that only ever see one value
+ and forwards stores to the loads that can only see them. Sparse conditional constant propagation
+ finds the values that are always the same number and the branches that are never taken, and
+ removes the code that can never run. Global value numbering makes every computation that an
+ earlier one dominates reuse its value, and dead code elimination removes whatever is left that
+ nothing uses and that has no side effects. The passes run again as long as one of them changes
+ something, up to SSA_MAX_ROUNDS times
+ */
+void ssa_optimize(SSAProc* proc);
+
+
+#endif /* PL0_SSAOPT_H */
@@ -14,7 +14,8 @@ static Word Symbol_getValue(Symbol* self);
 
 
 Destroyer(Symbol) {
-	destroy(&self->name);
+	/* Nothing to do, as the name is interned */
+	(void)self;
 }
 DEF(Symbol);
 
@@ -35,8 +35,8 @@ struct Symbol {
 	/*! The type of variable this symbol represents */
 	SYM_TYPE type;
 	
-	/*! Name of the symbol */
-	char* name;
+	/*! Interned name of the symbol */
+	const char* name;
 	
 	/*! Lexical level of the symbol, with 0 being the top level */
 	uint16_t level;
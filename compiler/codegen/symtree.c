@@ -8,39 +8,110 @@
 
 #include "symtree.h"
 #include <inttypes.h>
+#include "intern.h"
+#include "dynamic_string.h"
 
 
+/* Initial number of slots in each node's hash table, must be a power of 2 */
+#define SYMTREE_INITIAL_CAPACITY 16
+
+/*! Initialize a node of the symbol tree without any symbols except for "return" in a procedure
+ @param parent Parent node in the symbol tree to this one
+ @param level Current lexicographic level of the SymTree
+ */
+static SymTree* SymTree_initScope(SymTree* self, SymTree* parent, uint16_t level);
+
+/*! Add a variable or parameter, giving it the next slot in the stack frame
+ @param name Interned name of the variable
+ */
+static bool SymTree_addVar(SymTree* self, const char* name);
+
+/*! Add a constant
+ @param name Interned name of the constant
+ @param value Value of the constant
+ */
+static bool SymTree_addConst(SymTree* self, const char* name, Word value);
+
+/*! Add a procedure
+ @param name Interned name of the procedure
+ @param child Node of the symbol tree for the procedure's block
+ @param param_count Number of parameters the procedure takes
+ */
+static bool SymTree_addProc(SymTree* self, const char* name, SymTree* child, size_t param_count);
+
 /*! Add all parameters from a block's containing procedure
- @param params Node that holds all of the parameter declarations for a block
+ @param params Names of all of the parameters of a block
  */
-static bool SymTree_addParams(SymTree* self, AST_ParamDecls* params);
+static bool SymTree_addParams(SymTree* self, AST* ast, AST_Range params);
 
 /*! Add all const names from a given block's declarations
- @param decls Node that holds all of the constant declarations in a block
+ @param decls Constant declarations of a block, as pairs of a name and a value in extra
  */
-static bool SymTree_addConsts(SymTree* self, AST_ConstDecls* decls);
+static bool SymTree_addConsts(SymTree* self, AST* ast, AST_Range decls);
 
 /*! Add all var names from a given block's declarations
- @param decls Node that holds all of the variable declarations in a block
+ @param decls Names of all of the variables declared in a block
  */
-static bool SymTree_addVars(SymTree* self, AST_VarDecls* decls);
+static bool SymTree_addVars(SymTree* self, AST* ast, AST_Range decls);
 
 /*! Add all proc names from a given block's declarations
- @param decls Node that holds all of the procedure declarations in a block
+ @param block Index of the block whose procedure declarations should be added
+ */
+static bool SymTree_addProcs(SymTree* self, AST* ast, uint32_t block);
+
+/*! Hash an interned name by its address */
+static size_t hash_name(const char* name);
+
+/*! Double the size of the hash table and rehash all of its symbols */
+static void SymTree_grow(SymTree* self);
+
+/*! Find the hash table slot holding the symbol with the given name, or the empty slot where it would go
+ @param name Interned name of the symbol
+ */
+static Symbol** SymTree_findSlot(SymTree* self, const char* name);
+
+/*! Orders two `const Symbol** psym` alphabetically by name */
+static int compare_sym_names(const void* a, const void* b);
+
+/*! Make a copy of the symbols in this level of the tree sorted alphabetically by name
+ @return Array of symbols which must be freed by the caller, or NULL if there are no symbols
  */
-static bool SymTree_addProcs(SymTree* self, AST_ProcDecls* decls);
+static Symbol** SymTree_sortedSymbols(SymTree* self);
 
-/*! Compares a `const char* name` with the name of a `const Symbol** psym` */
-static int compare_sym(const void* a, const void* b);
+/* Find the procedure symbol in the parent node whose body is this node */
+static Symbol* SymTree_getProc(SymTree* self);
+
+/* Whether every call to a procedure was replaced by a copy of its body, leaving it without any
+ code or stack frame of its own
+ */
+static bool isInlinedAway(Symbol* sym);
 
 
 Destroyer(SymTree) {
 	array_release(&self->children);
 	array_release(&self->syms);
+	destroy(&self->slots);
+	destroy(&self->name);
 }
 DEF(SymTree);
 
-SymTree* SymTree_initWithAST(SymTree* self, SymTree* parent, AST_ParamDecls* params, AST_Block* block, uint16_t level) {
+SymTree* SymTree_initWithAST(SymTree* self, SymTree* parent, AST* ast, AST_Range params, uint32_t block, uint16_t level) {
+	if((self = SymTree_initScope(self, parent, level))) {
+		/* Add consts, vars, and procs into the symbol tree and sort them */
+		AST_Block* blk = &ast->blocks.elems[block];
+		if(!SymTree_addParams(self, ast, params)       ||
+		   !SymTree_addConsts(self, ast, blk->consts) ||
+		   !SymTree_addVars(self, ast, blk->vars)     ||
+		   !SymTree_addProcs(self, ast, block)) {
+			release(&self);
+			return NULL;
+		}
+	}
+	
+	return self;
+}
+
+static SymTree* SymTree_initScope(SymTree* self, SymTree* parent, uint16_t level) {
 	if((self = SymTree_init(self))) {
 		/* Set the hierarchy first */
 		SymTree_addChild(parent, self);
@@ -56,7 +127,7 @@ SymTree* SymTree_initWithAST(SymTree* self, SymTree* parent, AST_ParamDecls* par
 			/* Create a new symbol for the procedure's return value */
 			Symbol* ret = Symbol_new();
 			ret->type = SYM_VAR;
-			ret->name = strdup_ff("return");
+			ret->name = intern_cstr("return");
 			ret->level = level;
 			ret->value.frame_offset = 0;
 			
@@ -68,164 +139,176 @@ SymTree* SymTree_initWithAST(SymTree* self, SymTree* parent, AST_ParamDecls* par
 				return NULL;
 			}
 		}
-		
-		/* Add consts, vars, and procs into the symbol tree and sort them */
-		if(!SymTree_addParams(self, params)        ||
-		   !SymTree_addConsts(self, block->consts) ||
-		   !SymTree_addVars(self, block->vars)     ||
-		   !SymTree_addProcs(self, block->procs)) {
-			release(&self);
-			return NULL;
-		}
 	}
 	
 	return self;
 }
 
-static bool SymTree_addParams(SymTree* self, AST_ParamDecls* params) {
-	bool success = true;
+static bool SymTree_addVar(SymTree* self, const char* name) {
+	/* Create a new symbol for the variable */
+	Symbol* sym = Symbol_new();
+	sym->type = SYM_VAR;
+	sym->name = name;
+	sym->level = self->level;
 	
-	/* Check if we were given parameters */
-	if(params != NULL && params->params.count > 0) {
-		/* Add variables for all the parameters */
-		foreach(&params->params, pparam) {
-			/* Create new parameter symbol for each param */
-			Symbol* symParam = Symbol_new();
-			symParam->type = SYM_VAR;
-			symParam->name = strdup_ff(*pparam);
-			symParam->level = self->level;
-			symParam->value.frame_offset = self->frame_size++;
-			
-			/* Try to add the parameter into the Tree node */
-			success = SymTree_addSymbol(self, symParam);
-			
-			/* The SymTree now holds a reference to symParam, so release our local reference */
-			release(&symParam);
-		}
-	}
+	/* Set the variable's local stack offset and increment the offset */
+	sym->value.frame_offset = self->frame_size++;
 	
+	/* Add the variable symbol to the current level of the tree */
+	bool success = SymTree_addSymbol(self, sym);
+	
+	/* The SymTree now holds a reference to sym, so release our local reference */
+	release(&sym);
 	return success;
 }
 
-static bool SymTree_addConsts(SymTree* self, AST_ConstDecls* decls) {
-	/* Make sure the declarations exist */
-	if(decls == NULL) {
-		return true;
-	}
+static bool SymTree_addConst(SymTree* self, const char* name, Word value) {
+	/* Create a new symbol for the constant */
+	Symbol* sym = Symbol_new();
+	sym->type = SYM_CONST;
+	sym->name = name;
+	sym->level = self->level;
 	
-	/* Iterate through each declaration and add a new symbol into the table */
-	bool success = true;
-	foreach(&decls->consts, pconst) {
-		/* Create a new symbol for the constant */
-		Symbol* sym = Symbol_new();
-		sym->type = SYM_CONST;
-		sym->name = strdup_ff(pconst->ident);
-		sym->level = self->level;
-		
-		/* Set the constant's numeric value */
-		sym->value.number = pconst->value;
-		
-		/* Add the constant symbol to the current level of the tree */
-		success = SymTree_addSymbol(self, sym);
-		release(&sym);
-	}
+	/* Set the constant's numeric value */
+	sym->value.number = value;
+	
+	/* Add the constant symbol to the current level of the tree */
+	bool success = SymTree_addSymbol(self, sym);
+	release(&sym);
+	return success;
+}
+
+static bool SymTree_addProc(SymTree* self, const char* name, SymTree* child, size_t param_count) {
+	/* Create a new symbol for the procedure */
+	Symbol* symProc = Symbol_new();
+	symProc->type = SYM_PROC;
+	symProc->name = name;
+	symProc->level = self->level;
+	
+	/* Set the parameter count */
+	symProc->value.procedure.param_count = param_count;
 	
+	/* Create the block */
+	symProc->value.procedure.body = Block_initWithScope(Block_alloc(), child);
+	
+	/* Need to add the symbol before codegen-ing its block to handle recursion */
+	bool success = SymTree_addSymbol(self, symProc);
+	release(&symProc);
 	return success;
 }
 
-static bool SymTree_addVars(SymTree* self, AST_VarDecls* decls) {
-	/* Make sure the declarations exist */
-	if(decls == NULL) {
-		return true;
+static bool SymTree_addParams(SymTree* self, AST* ast, AST_Range params) {
+	bool success = true;
+	
+	/* Add variables for all the parameters */
+	for(uint32_t i = 0; i < params.count; i++) {
+		success = SymTree_addVar(self, AST_ident(ast, params.start + i));
 	}
 	
+	return success;
+}
+
+static bool SymTree_addConsts(SymTree* self, AST* ast, AST_Range decls) {
 	/* Iterate through each declaration and add a new symbol into the table */
 	bool success = true;
-	foreach(&decls->vars, pvar) {
-		/* Create a new symbol for the variable */
-		Symbol* sym = Symbol_new();
-		sym->type = SYM_VAR;
-		sym->name = strdup_ff(*pvar);
-		sym->level = self->level;
-		
-		/* Set the variable's local stack offset and increment the offset */
-		sym->value.frame_offset = self->frame_size++;
-		
-		/* Add the variable symbol to the current level of the tree */
-		success = SymTree_addSymbol(self, sym);
-		release(&sym);
+	for(uint32_t i = 0; i < decls.count; i++) {
+		const uint32_t* pconst = &ast->extra.elems[decls.start + 2 * i];
+		success = SymTree_addConst(self, AST_ident(ast, pconst[0]), (Word)pconst[1]);
 	}
 	
 	return success;
 }
 
-static bool SymTree_addProcs(SymTree* self, AST_ProcDecls* decls) {
-	/* Make sure the declarations exist */
-	if(decls == NULL) {
-		return true;
+static bool SymTree_addVars(SymTree* self, AST* ast, AST_Range decls) {
+	/* Iterate through each declaration and add a new symbol into the table */
+	bool success = true;
+	for(uint32_t i = 0; i < decls.count; i++) {
+		success = SymTree_addVar(self, AST_ident(ast, decls.start + i));
 	}
 	
+	return success;
+}
+
+static bool SymTree_addProcs(SymTree* self, AST* ast, uint32_t block) {
 	/* Iterate through each declaration and add a new symbol into the table */
 	bool success = true;
-	foreach(&decls->procs, pproc) {
-		/* Create a new symbol for the procedure */
-		Symbol* symProc = Symbol_new();
-		symProc->type = SYM_PROC;
-		symProc->name = strdup_ff((*pproc)->ident);
-		symProc->level = self->level;
+	uint32_t count = AST_procCount(ast, block);
+	for(uint32_t i = 0; i < count; i++) {
+		AST_Proc* proc = &ast->procs.elems[AST_procAt(ast, block, i)];
 		
 		/* Create the child symtrees */
-		SymTree* child = SymTree_initWithAST(SymTree_alloc(), self, (*pproc)->param_decls, (*pproc)->body, self->level + 1);
+		SymTree* child = SymTree_initWithAST(SymTree_alloc(), self, ast, proc->params, proc->body, self->level + 1);
 		if(!child) {
-			release(&symProc);
 			return false;
 		}
 		
-		/* Set the parameter count */
-		size_t param_count = (*pproc)->param_decls ? (*pproc)->param_decls->params.count : 0;
-		symProc->value.procedure.param_count = param_count;
-		
-		/* Create the block */
-		symProc->value.procedure.body = Block_initWithScope(Block_alloc(), child);
-		
-		/* Need to add the symbol before codegen-ing its block to handle recursion */
-		success = SymTree_addSymbol(self, symProc);
-		release(&symProc);
+		success = SymTree_addProc(self, AST_ident(ast, proc->ident), child, proc->params.count);
 	}
 	
 	return success;
 }
 
-static int compare_sym(const void* key, const void* elem) {
-	const char* name = key;
-	const Symbol* sym = *(const Symbol**)elem;
-	return strcmp(name, sym->name);
+static size_t hash_name(const char* name) {
+	/* Names are interned, so they can be hashed by their addresses rather than their contents.
+	 Fibonacci hashing mixes the address bits so that the low bits used as the index vary.
+	 */
+	uint64_t hash = (uint64_t)(uintptr_t)name * UINT64_C(11400714819323198485);
+	return (size_t)(hash >> 32);
+}
+
+static void SymTree_grow(SymTree* self) {
+	size_t new_capacity = self->capacity ? self->capacity * 2 : SYMTREE_INITIAL_CAPACITY;
+	destroy(&self->slots);
+	self->slots = calloc_ff(new_capacity, sizeof(*self->slots));
+	self->capacity = new_capacity;
+	
+	/* Every symbol is also in the syms array, so the table can just be filled in again */
+	foreach(&self->syms, psym) {
+		*SymTree_findSlot(self, (*psym)->name) = *psym;
+	}
+}
+
+static Symbol** SymTree_findSlot(SymTree* self, const char* name) {
+	/* Linear probe until either the symbol or an empty slot is found */
+	size_t idx = hash_name(name) & (self->capacity - 1);
+	while(self->slots[idx] != NULL && self->slots[idx]->name != name) {
+		idx = (idx + 1) & (self->capacity - 1);
+	}
+	return &self->slots[idx];
+}
+
+static int compare_sym_names(const void* a, const void* b) {
+	const Symbol* sym_a = *(const Symbol**)a;
+	const Symbol* sym_b = *(const Symbol**)b;
+	return strcmp(sym_a->name, sym_b->name);
+}
+
+static Symbol** SymTree_sortedSymbols(SymTree* self) {
+	if(self->syms.count == 0) {
+		return NULL;
+	}
+	
+	Symbol** sorted = malloc_ff(self->syms.count * sizeof(*sorted));
+	memcpy(sorted, self->syms.elems, self->syms.count * sizeof(*sorted));
+	qsort(sorted, self->syms.count, sizeof(*sorted), &compare_sym_names);
+	return sorted;
 }
 
 bool SymTree_addSymbol(SymTree* self, Symbol* sym) {
-	/* Have to manually bsearch to find the place to insert the symbol */
-	size_t lo = 0, hi = self->syms.count;
-	while(lo < hi) {
-		size_t mid = lo + (hi - lo) / 2;
-		
-		/* Determine where the symbol should go in relation to the middle element */
-		int diff = compare_sym(sym->name, &self->syms.elems[mid]);
-		if(diff < 0) {
-			/* Not mid - 1 because we want to insert before hi */
-			hi = mid;
-		}
-		else if(diff > 0) {
-			lo = mid + 1;
-		}
-		else {
-			/* Symbol already exists in this level, so this is a redefinition (illegal) */
-			return false;
-		}
+	/* Keep the load factor at or below one half */
+	if((self->syms.count + 1) * 2 > self->capacity) {
+		SymTree_grow(self);
 	}
 	
-	/* Insert the symbol into its position */
-	retain(sym);
-	array_insert(&self->syms, lo, &sym);
+	Symbol** slot = SymTree_findSlot(self, sym->name);
+	if(*slot != NULL) {
+		/* Symbol already exists in this level, so this is a redefinition (illegal) */
+		return false;
+	}
+	
+	/* Add the symbol to both the table and the array */
+	*slot = retain(sym);
+	array_append(&self->syms, sym);
 	return true;
 }
 
@@ -242,20 +325,64 @@ void SymTree_addChild(SymTree* self, SymTree* child) {
 }
 
 Symbol* SymTree_findSymbol(SymTree* self, const char* name) {
-	/* Base case, this means that we never found a symbol when recursing up through the tree */
-	if(self == NULL) {
+	/* Check each node from this one up to the root */
+	for(SymTree* cur = self; cur != NULL; cur = cur->parent) {
+		if(cur->capacity == 0) {
+			continue;
+		}
+		
+		Symbol* sym = *SymTree_findSlot(cur, name);
+		if(sym != NULL) {
+			return sym;
+		}
+	}
+	
+	/* Never found the symbol in any of the nodes */
+	return NULL;
+}
+
+const char* SymTree_getName(SymTree* self) {
+	if(self->name != NULL) {
+		return self->name;
+	}
+	
+	dynamic_string name = {0};
+	if(self->parent == NULL) {
+		string_append(&name, "main");
+	}
+	else {
+		string_append(&name, SymTree_getName(self->parent));
+		Symbol* proc = SymTree_getProc(self);
+		if(proc != NULL) {
+			string_appendChar(&name, '/');
+			string_append(&name, proc->name);
+		}
+	}
+	
+	return self->name = string_cstr(&name);
+}
+
+static Symbol* SymTree_getProc(SymTree* self) {
+	if(self->parent == NULL) {
 		return NULL;
 	}
 	
-	/* Binary search through the symbol array and see if it contains our symbol */
-	Symbol** psym = bsearch(name,
-		self->syms.elems, self->syms.count, element_size(self->syms), &compare_sym);
-	if(psym != NULL) {
-		return *psym;
+	foreach(&self->parent->syms, psym) {
+		if((*psym)->type == SYM_PROC && (*psym)->value.procedure.body->symtree == self) {
+			return *psym;
+		}
+	}
+	
+	return NULL;
+}
+
+static bool isInlinedAway(Symbol* sym) {
+	if(sym == NULL || sym->type != SYM_PROC) {
+		return false;
 	}
 	
-	/* If we never found a symbol, then check this node's parent */
-	return SymTree_findSymbol(self->parent, name);
+	Block* body = sym->value.procedure.body;
+	return body->inlined && Block_getAddress(body) < 0;
 }
 
 void SymTree_write(SymTree* self, FILE* fp) {
@@ -263,19 +390,32 @@ void SymTree_write(SymTree* self, FILE* fp) {
 		return;
 	}
 	
-	/* Write all the symbols in the current level of the symbol tree */
-	foreach(&self->syms, psym) {
-		Symbol_write(*psym, fp);
+	/* Write all the symbols in the current level of the symbol tree in alphabetical order. Procedures
+	 that were inlined everywhere are left out along with their scopes, since they have no address
+	 and their variables live in the stack frames of their callers
+	 */
+	Symbol** sorted = SymTree_sortedSymbols(self);
+	for(size_t i = 0; i < self->syms.count; i++) {
+		if(!isInlinedAway(sorted[i])) {
+			Symbol_write(sorted[i], fp);
+		}
 	}
+	free(sorted);
 	
 	/* Write all the symbols in each of the child nodes */
 	foreach(&self->children, pchild) {
-		SymTree_write(*pchild, fp);
+		if(!isInlinedAway(SymTree_getProc(*pchild))) {
+			SymTree_write(*pchild, fp);
+		}
 	}
 }
 
 void SymTree_drawProcs(SymTree* self, Graphviz* gv) {
-	foreach(&self->syms, psym) {
+	/* Draw procedures in alphabetical order so the output doesn't depend on memory layout */
+	Symbol** sorted = SymTree_sortedSymbols(self);
+	for(size_t i = 0; i < self->syms.count; i++) {
+		Symbol** psym = &sorted[i];
+		
 		/* Only draw procedures */
 		if((*psym)->type == SYM_PROC) {
 			/* Create subgraph for this procedure */
@@ -296,4 +436,5 @@ void SymTree_drawProcs(SymTree* self, Graphviz* gv) {
 			release(&proc);
 		}
 	}
+	free(sorted);
 }
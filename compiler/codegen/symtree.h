@@ -33,22 +33,50 @@ struct SymTree {
 	/*! Array of children to this node */
 	dynamic_array(SymTree*) children;
 	
-	/*! Sorted array of symbols */
+	/*! Array of symbols in the order they were declared */
 	dynamic_array(Symbol*) syms;
 	
+	/*! Open-addressed hash table of the symbols, keyed by the address of their interned names */
+	Symbol** slots;
+	
+	/*! Number of slots in the hash table, which is zero or a power of 2 */
+	size_t capacity;
+	
 	/*! Current size of the stack frame */
 	Word frame_size;
+	
+	/*! While generating code, the offset just past the slots of the stack frame that are in use.
+	 Procedures that are inlined into this one keep their variables after it
+	 */
+	Word inline_top;
+	
+	/*! While this procedure's body is being inlined, the scope whose stack frame holds its variables */
+	SymTree* inline_frame;
+	
+	/*! While this procedure's body is being inlined, the offset in inline_frame of its return value,
+	 which is followed by its parameters and then its variables
+	 */
+	Word inline_base;
+	
+	/*! Path of procedure names from the main block down to this one, built by SymTree_getName */
+	char* name;
+	
+	/*! Number of basic blocks generated for this procedure's body so far, which gives each one an
+	 ordinal that stays the same from one compilation to the next
+	 */
+	size_t block_count;
 };
 DECL(SymTree);
 
 
 /*! Initialize the symbol tree given an AST of the block
  @param parent Parent node in the symbol tree to this one
- @param params AST node for the parameters to this block's containing procedure
- @param block AST node for the block used to recursively create the symbol tree
+ @param ast AST of the whole program
+ @param params Names of the parameters to this block's containing procedure
+ @param block Index of the block used to recursively create the symbol tree
  @param level Current lexicographic level of the SymTree
  */
-SymTree* SymTree_initWithAST(SymTree* self, SymTree* parent, AST_ParamDecls* params, AST_Block* block, uint16_t level);
+SymTree* SymTree_initWithAST(SymTree* self, SymTree* parent, AST* ast, AST_Range params, uint32_t block, uint16_t level);
 
 /*! Add a new symbol into the current SymTree node. Holds a strong reference
  @param sym The Symbol that is being added into the tree
@@ -62,11 +90,18 @@ bool SymTree_addSymbol(SymTree* self, Symbol* sym);
 void SymTree_addChild(SymTree* self, SymTree* child);
 
 /*! Lookup the symbol with the given name in this node or any parents
- @param name Name of symbol to lookup
+ @param name Interned name of symbol to lookup
  @return The symbol that was found, or NULL if it wasn't found
  */
 Symbol* SymTree_findSymbol(SymTree* self, const char* name);
 
+/*! Get a name for this node that stays the same from one compilation to the next, which is "main"
+ for the main block and the names of the enclosing procedures joined with slashes for the others,
+ such as "main/outer/inner"
+ @return Name of the node, owned by the SymTree
+ */
+const char* SymTree_getName(SymTree* self);
+
 /*! Writes the symbol table output as specified in the assignment description
  @param fp File stream to write the table output to
  */
@@ -0,0 +1,427 @@
+//
+//  edit_session.c
+//  PL/0
+//
+
+#include "edit_session.h"
+#include <stdint.h>
+#include <string.h>
+#include "intern.h"
+#include "lexer/lexer.h"
+#include "lexer/pl0spec.h"
+#include "compiler/parser/parser.h"
+
+
+/* Scan the whole text and parse the whole program from scratch */
+static bool EditSession_rebuild(EditSession* self);
+
+/* Scan tokens again starting from the token at index first, until the scan lines up with an old
+ token at or after resync_start (in new text offsets). Outputs the end of the replaced range of old
+ tokens, the end of the new tokens that took their place, and how many lines the tokens after them moved.
+ */
+static bool EditSession_scan(EditSession* self, size_t first, size_t resync_start, ptrdiff_t delta,
+                             size_t* old_end, size_t* new_end, ptrdiff_t* line_delta);
+
+/* Parse the whole program again */
+static bool EditSession_parseAll(EditSession* self);
+
+/* Parse only the smallest statement or procedure declaration holding every changed token */
+static bool EditSession_reparse(EditSession* self, size_t first, size_t old_end, size_t new_end, ptrdiff_t line_delta);
+
+/* Copy a token so that its lexeme doesn't point into the text, which is about to change */
+static Token keepToken(Token tok);
+
+/* Find the smallest part of the tree holding the tokens from first up to old_end, which is either
+ the statement of a block or a procedure declaration. The procedure is output as the index in extra
+ of its place in its block's list. Both are left AST_NONE if neither holds them.
+ */
+static void findEnclosing(AST* ast, uint32_t block, size_t first, size_t old_end, uint32_t* proc_slot, uint32_t* stmt_block);
+
+/* Move the token ranges of statements and procedures after old_end by delta tokens */
+static void shiftSpans(AST* ast, uint32_t block, size_t old_end, ptrdiff_t delta);
+
+/* Move the lines of the statements after the part that is parsed again, which is either a procedure
+ (by its index in extra) or the statement of a block. Set after once that part has been passed.
+ */
+static void shiftLines(AST* ast, uint32_t block, uint32_t proc_slot, uint32_t stmt_block, ptrdiff_t line_delta, bool* after);
+
+/* Move the lines of a statement and every statement inside of it */
+static void shiftStmtLines(AST* ast, AST_Node statement, ptrdiff_t line_delta);
+
+
+Destroyer(EditSession) {
+	array_clear(&self->text);
+	array_clear(&self->tokens);
+	array_clear(&self->offsets);
+	release(&self->program);
+}
+DEF(EditSession);
+
+EditSession* EditSession_initWithText(EditSession* self, const char* text, size_t length) {
+	if((self = EditSession_init(self))) {
+		array_extend(&self->text, text, length);
+		EditSession_rebuild(self);
+	}
+	
+	return self;
+}
+
+bool EditSession_setText(EditSession* self, const char* text, size_t length) {
+	/* Everything between the common prefix and suffix of the old and new text is one edit */
+	size_t old_length = self->text.count;
+	size_t limit = MIN(old_length, length);
+	size_t prefix = 0;
+	while(prefix < limit && text[prefix] == self->text.elems[prefix]) {
+		++prefix;
+	}
+	
+	size_t suffix = 0;
+	while(suffix < limit - prefix && text[length - 1 - suffix] == self->text.elems[old_length - 1 - suffix]) {
+		++suffix;
+	}
+	
+	return EditSession_edit(self, prefix, old_length - prefix - suffix, &text[prefix], length - prefix - suffix);
+}
+
+bool EditSession_edit(EditSession* self, size_t start, size_t old_length, const char* text, size_t length) {
+	ASSERT(start + old_length <= self->text.count);
+	
+	self->scanned_count = 0;
+	self->parsed_count = 0;
+	self->reparsed_proc = AST_NONE;
+	self->reparsed_stmt = false;
+	
+	if(!self->tokens_valid) {
+		/* The old tokens stopped at a lexer error, so there's nothing to reuse */
+		array_splice(&self->text, start, start + old_length, text, length);
+		return EditSession_rebuild(self);
+	}
+	
+	/* Find the first token that starts at or after the edit */
+	size_t lo = 0;
+	size_t hi = self->offsets.count;
+	while(lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if(self->offsets.elems[mid] < start) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	
+	/* The token before that one may run into the edit, and the edit may join onto the one before it */
+	size_t first = lo >= 2 ? lo - 2 : 0;
+	
+	array_splice(&self->text, start, start + old_length, text, length);
+	
+	size_t old_end, new_end;
+	ptrdiff_t line_delta;
+	if(!EditSession_scan(self, first, start + length, (ptrdiff_t)length - (ptrdiff_t)old_length, &old_end, &new_end, &line_delta)) {
+		return false;
+	}
+	
+	if(self->program == NULL) {
+		/* The old tokens didn't parse, so there is no tree to patch */
+		return EditSession_parseAll(self);
+	}
+	
+	return EditSession_reparse(self, first, old_end, new_end, line_delta);
+}
+
+static bool EditSession_rebuild(EditSession* self) {
+	array_clear(&self->tokens);
+	array_clear(&self->offsets);
+	
+	size_t old_end, new_end;
+	ptrdiff_t line_delta;
+	if(!EditSession_scan(self, 0, SIZE_MAX, 0, &old_end, &new_end, &line_delta)) {
+		return false;
+	}
+	
+	return EditSession_parseAll(self);
+}
+
+static bool EditSession_scan(EditSession* self, size_t first, size_t resync_start, ptrdiff_t delta,
+                             size_t* old_end, size_t* new_end, ptrdiff_t* line_delta) {
+	/* Tokens never start inside a comment, so scanning can pick up at the start of any old token.
+	 The first token might not be at the very start of the text though.
+	 */
+	size_t start = 0;
+	size_t line_number = 1;
+	if(first != 0) {
+		start = self->offsets.elems[first];
+		line_number = self->tokens.elems[first].line_number;
+	}
+	
+	const char* data = self->text.count != 0 ? &self->text.elems[start] : "";
+	Lexer* lexer = Lexer_initWithBuffer(Lexer_alloc(), data, self->text.count - start, &PL0_lexTable);
+	lexer->line_number = (int)line_number;
+	
+	TokenArray scanned = {0};
+	dynamic_array(size_t) offsets = {0};
+	size_t old_index = first;
+	ptrdiff_t lines_moved = 0;
+	bool success = true;
+	
+	Token tok;
+	while(true) {
+		if(!Lexer_nextToken(lexer, &tok)) {
+			/* The lexer already printed the error */
+			success = false;
+			break;
+		}
+		
+		size_t offset = tok.type == nulsym ? self->text.count : start + lexer->lexeme_start;
+		if(offset >= resync_start) {
+			/* Past the edit, a token starting where an old token started sees the same text after
+			 it, so every token from there on would be the same as before
+			 */
+			size_t old_offset = (size_t)((ptrdiff_t)offset - delta);
+			while(old_index < self->offsets.count && self->offsets.elems[old_index] < old_offset) {
+				++old_index;
+			}
+			
+			if(old_index < self->offsets.count && self->offsets.elems[old_index] == old_offset) {
+				lines_moved = (ptrdiff_t)tok.line_number - (ptrdiff_t)self->tokens.elems[old_index].line_number;
+				break;
+			}
+		}
+		
+		array_append(&scanned, keepToken(tok));
+		array_append(&offsets, offset);
+		if(tok.type == nulsym) {
+			/* Never lined up with the old tokens, so they are all replaced */
+			old_index = self->tokens.count;
+			break;
+		}
+	}
+	
+	self->scanned_count += scanned.count;
+	release(&lexer);
+	
+	if(!success) {
+		/* Nothing after the error was scanned, so start over once the error is fixed */
+		self->tokens_valid = false;
+		array_clear(&self->tokens);
+		array_clear(&self->offsets);
+		release(&self->program);
+	}
+	else {
+		/* Tokens after the edit only moved */
+		for(size_t i = old_index; i < self->tokens.count; i++) {
+			self->tokens.elems[i].line_number += lines_moved;
+			self->offsets.elems[i] += delta;
+		}
+		
+		array_splice(&self->tokens, first, old_index, scanned.elems, scanned.count);
+		array_splice(&self->offsets, first, old_index, offsets.elems, offsets.count);
+		self->tokens_valid = true;
+		*old_end = old_index;
+		*new_end = first + scanned.count;
+		*line_delta = lines_moved;
+	}
+	
+	array_clear(&scanned);
+	array_clear(&offsets);
+	return success;
+}
+
+static bool EditSession_parseAll(EditSession* self) {
+	release(&self->program);
+	self->reparsed_proc = AST_NONE;
+	self->reparsed_stmt = false;
+	self->parsed_count = self->tokens.count;
+	
+	Parser* parser = Parser_initWithTokens(Parser_alloc(), self->tokens.elems, self->tokens.count, PARSER_RDP);
+	bool success = Parser_parseProgram(parser, &self->program);
+	release(&parser);
+	return success;
+}
+
+static bool EditSession_reparse(EditSession* self, size_t first, size_t old_end, size_t new_end, ptrdiff_t line_delta) {
+	AST* ast = self->program;
+	uint32_t proc_slot = AST_NONE;
+	uint32_t stmt_block = AST_NONE;
+	findEnclosing(ast, ast->program, first, old_end, &proc_slot, &stmt_block);
+	if(proc_slot == AST_NONE && stmt_block == AST_NONE) {
+		/* The edit touched the declarations of the main block */
+		return EditSession_parseAll(self);
+	}
+	
+	/* Everything before the changed part is the same, so the parser would be in the same state there */
+	ptrdiff_t delta = (ptrdiff_t)new_end - (ptrdiff_t)old_end;
+	size_t start, end;
+	if(stmt_block != AST_NONE) {
+		start = ast->blocks.elems[stmt_block].stmt_first_token;
+		end = ast->blocks.elems[stmt_block].stmt_end_token + delta;
+	}
+	else {
+		AST_Proc* old_proc = &ast->procs.elems[ast->extra.elems[proc_slot]];
+		start = old_proc->first_token;
+		end = old_proc->end_token + delta;
+	}
+	Parser* parser = Parser_initWithTokens(Parser_alloc(), self->tokens.elems, self->tokens.count, PARSER_RDP);
+	TokenStream_seek(parser->token_stream, start);
+	
+	/* The new part is added to the end of the AST. The old part is left behind unused */
+	AST_Node stmt = AST_NONE;
+	uint32_t proc = AST_NONE;
+	bool success = stmt_block != AST_NONE
+		? Parser_parseStatement(parser, ast, &stmt)
+		: Parser_parseProcDecl(parser, ast, &proc);
+	size_t parsed_end = parser->token_stream->position;
+	release(&parser);
+	
+	if(!success) {
+		/* The same error would stop a parse of the whole program */
+		release(&self->program);
+		return false;
+	}
+	
+	if(parsed_end != end) {
+		/* The edit moved where this part ends, so the code around it parses differently too */
+		return EditSession_parseAll(self);
+	}
+	
+	/* Swap in the new part, keeping the rest of the tree */
+	shiftSpans(ast, ast->program, old_end, delta);
+	if(line_delta != 0) {
+		bool after = false;
+		shiftLines(ast, ast->program, proc_slot, stmt_block, line_delta, &after);
+	}
+	if(stmt_block != AST_NONE) {
+		ast->blocks.elems[stmt_block].stmt = stmt;
+		self->reparsed_stmt = true;
+	}
+	else {
+		ast->extra.elems[proc_slot] = proc;
+	}
+	
+	self->parsed_count = end - start;
+	self->reparsed_proc = proc_slot != AST_NONE ? ast->extra.elems[proc_slot] : AST_NONE;
+	return true;
+}
+
+static Token keepToken(Token tok) {
+	switch(tok.type) {
+		case identsym:
+			/* Already interned by the lexer */
+			break;
+		
+		case numbersym:
+			tok.lexeme = SLICE(intern_slice(tok.lexeme), tok.lexeme.length);
+			break;
+		
+		case nulsym:
+			break;
+		
+		default:
+			tok.lexeme = SLICE(token_spelling(tok.type), tok.lexeme.length);
+			break;
+	}
+	
+	return tok;
+}
+
+static void findEnclosing(AST* ast, uint32_t block, size_t first, size_t old_end, uint32_t* proc_slot, uint32_t* stmt_block) {
+	uint32_t list = ast->blocks.elems[block].procs;
+	uint32_t count = AST_listCount(ast, list);
+	for(uint32_t i = 0; i < count; i++) {
+		/* The "procedure" token and the final ";" both have to be untouched */
+		AST_Proc* cur = &ast->procs.elems[AST_listItem(ast, list, i)];
+		if(cur->first_token < first && old_end < cur->end_token) {
+			*proc_slot = list + 1 + i;
+			findEnclosing(ast, cur->body, first, old_end, proc_slot, stmt_block);
+			return;
+		}
+	}
+	
+	/* Same for the first and last tokens of the block's statement */
+	AST_Block* blk = &ast->blocks.elems[block];
+	if(blk->stmt != AST_NONE && blk->stmt_first_token < first && old_end < blk->stmt_end_token) {
+		*stmt_block = block;
+	}
+}
+
+static void shiftSpans(AST* ast, uint32_t block, size_t old_end, ptrdiff_t delta) {
+	AST_Block* blk = &ast->blocks.elems[block];
+	if(blk->stmt_first_token >= old_end) {
+		blk->stmt_first_token += delta;
+	}
+	if(blk->stmt_end_token >= old_end) {
+		blk->stmt_end_token += delta;
+	}
+	
+	uint32_t count = AST_procCount(ast, block);
+	for(uint32_t i = 0; i < count; i++) {
+		AST_Proc* proc = &ast->procs.elems[AST_procAt(ast, block, i)];
+		if(proc->end_token < old_end) {
+			/* Entirely before the edit */
+			continue;
+		}
+		
+		if(proc->first_token >= old_end) {
+			proc->first_token += delta;
+		}
+		proc->end_token += delta;
+		shiftSpans(ast, proc->body, old_end, delta);
+	}
+}
+
+static void shiftLines(AST* ast, uint32_t block, uint32_t proc_slot, uint32_t stmt_block, ptrdiff_t line_delta, bool* after) {
+	/* Procedures come before the block's statement in the source */
+	uint32_t list = ast->blocks.elems[block].procs;
+	uint32_t count = AST_listCount(ast, list);
+	for(uint32_t i = 0; i < count; i++) {
+		if(list + 1 + i == proc_slot) {
+			*after = true;
+			continue;
+		}
+		
+		AST_Proc* proc = &ast->procs.elems[AST_listItem(ast, list, i)];
+		shiftLines(ast, proc->body, proc_slot, stmt_block, line_delta, after);
+	}
+	
+	if(block == stmt_block) {
+		*after = true;
+	}
+	else if(*after) {
+		shiftStmtLines(ast, ast->blocks.elems[block].stmt, line_delta);
+	}
+}
+
+static void shiftStmtLines(AST* ast, AST_Node statement, ptrdiff_t line_delta) {
+	if(statement == AST_NONE) {
+		return;
+	}
+	
+	uint32_t* pline = &ast->lines.elems[statement];
+	if(*pline != 0) {
+		*pline = (uint32_t)(*pline + line_delta);
+	}
+	
+	uint32_t lhs = ast->lhs.elems[statement];
+	uint32_t rhs = ast->rhs.elems[statement];
+	switch(ast->types.elems[statement]) {
+		case STMT_BEGIN: {
+			uint32_t count = AST_listCount(ast, lhs);
+			for(uint32_t i = 0; i < count; i++) {
+				shiftStmtLines(ast, AST_listItem(ast, lhs, i), line_delta);
+			}
+			break;
+		}
+		
+		case STMT_IF:
+			shiftStmtLines(ast, ast->extra.elems[rhs], line_delta);
+			shiftStmtLines(ast, ast->extra.elems[rhs + 1], line_delta);
+			break;
+		
+		case STMT_WHILE:
+			shiftStmtLines(ast, rhs, line_delta);
+			break;
+		
+		default:
+			break;
+	}
+}
@@ -0,0 +1,84 @@
+//
+//  edit_session.h
+//  PL/0
+//
+
+#ifndef PL0_EDIT_SESSION_H
+#define PL0_EDIT_SESSION_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct EditSession EditSession;
+
+#include "object.h"
+#include "token.h"
+#include "compiler/ast_nodes.h"
+
+/*! Source text being edited along with its tokens and AST, which are kept up to date
+ incrementally. After an edit, only the tokens around the changed text are scanned again,
+ and only the smallest block statement or procedure declaration holding all of the changed
+ tokens is parsed again. The rest of the AST is reused as-is, and the new part is added to the
+ end of it.
+ */
+struct EditSession {
+	OBJECT_BASE;
+	
+	/*! Current source text */
+	dynamic_array(char) text;
+	
+	/*! Tokens scanned from the text, ending with nulsym. Their lexemes don't point into the text */
+	TokenArray tokens;
+	
+	/*! Offset in the text where each token starts */
+	dynamic_array(size_t) offsets;
+	
+	/*! Whether the tokens match the text, which is false after a lexer error */
+	bool tokens_valid;
+	
+	/*! AST of the whole program, or NULL if the tokens couldn't be parsed */
+	AST* program;
+	
+	/*! Number of tokens that were scanned during the most recent update */
+	size_t scanned_count;
+	
+	/*! Number of tokens that were parsed during the most recent update */
+	size_t parsed_count;
+	
+	/*! Index in the program's procs of the procedure holding what was parsed again during the
+	 most recent update, or AST_NONE if it was in the main block
+	 */
+	uint32_t reparsed_proc;
+	
+	/*! Whether only the statement of a block was parsed again during the most recent update,
+	 rather than a whole procedure declaration
+	 */
+	bool reparsed_stmt;
+};
+DECL(EditSession);
+
+
+/*! Create an edit session by scanning and parsing the full source text. Any errors are printed
+ @param text Source text, which is copied
+ @param length Number of characters in text
+ */
+EditSession* EditSession_initWithText(EditSession* self, const char* text, size_t length);
+
+/*! Replace a range of the source text, then bring the tokens and AST up to date
+ @param start Offset of the first character that changed
+ @param old_length Number of characters that were replaced
+ @param text New characters to put in their place
+ @param length Number of new characters
+ @return True if the updated program parsed successfully, or false if errors were printed
+ */
+bool EditSession_edit(EditSession* self, size_t start, size_t old_length, const char* text, size_t length);
+
+/*! Replace the whole source text, updating only what changed between the old and new text
+ @param text New source text, which is copied
+ @param length Number of characters in text
+ @return True if the updated program parsed successfully, or false if errors were printed
+ */
+bool EditSession_setText(EditSession* self, const char* text, size_t length);
+
+
+#endif /* PL0_EDIT_SESSION_H */
@@ -0,0 +1,332 @@
+//
+//  parallel_parser.c
+//  PL/0
+//
+
+#include "parser.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+
+/*! Procedure declarations spanning fewer tokens than this per thread aren't worth splitting up */
+#ifndef PARPARSE_MIN_TOKENS
+#define PARPARSE_MIN_TOKENS 4096
+#endif
+
+/*! Most threads to parse with, or 0 to use one per online CPU */
+#ifndef PARPARSE_THREADS
+#define PARPARSE_THREADS 0
+#endif
+
+/* One procedure declaration found by the prescan, along with the result of parsing it */
+typedef struct ParsedProc {
+	/* Index of the "procedure" token */
+	size_t start;
+	
+	/* Whether a worker got to this declaration, which it doesn't after an earlier error */
+	bool parsed;
+	
+	/* Index of the parsed declaration in its job's AST (or the caller's once adopted), or AST_NONE on error */
+	uint32_t proc;
+	
+	/* Syntax errors that stopped the parse, formatted just as they would have been printed */
+	dynamic_string errors;
+} ParsedProc;
+
+/* Run of consecutive procedure declarations parsed by one thread */
+typedef struct ParseJob {
+	/* Tokens of the whole program */
+	const Token* tokens;
+	size_t token_count;
+	
+	/* Declarations for this job to parse */
+	ParsedProc* procs;
+	size_t count;
+	
+	/* AST that the job's declarations are added to */
+	AST* ast;
+	
+	/* Thread that parses the declarations */
+	pthread_t thread;
+	
+	/* Whether the declarations are being parsed on their own thread */
+	bool threaded;
+} ParseJob;
+
+
+/* Type of the token at an index, treating everything past the end as nulsym */
+static token_type tokenAt(const Token* tokens, size_t count, size_t index);
+
+/* Skip over a whole procedure declaration without building anything. Fails if the tokens don't
+ look like one, which only means that the caller should parse it sequentially instead.
+ */
+static bool skipProc(const Token* tokens, size_t count, size_t* pos);
+
+/* Skip over a block, including its nested procedure declarations */
+static bool skipBlock(const Token* tokens, size_t count, size_t* pos);
+
+/* Skip over a statement by matching up "begin" and "end" */
+static void skipStmt(const Token* tokens, size_t count, size_t* pos);
+
+/* Parse a job's declarations with a speculative parser, stopping at the first error */
+static void ParseJob_parse(ParseJob* job);
+
+/* Thread entry point that parses a job */
+static void* ParseJob_run(void* arg);
+
+
+bool Parser_parseProcsParallel(Parser* self) {
+	TokenStream* stream = self->token_stream;
+	ASSERT(stream->tokens != NULL);
+	
+	/* Find where each declaration of this block starts by skipping over it */
+	dynamic_array(ParsedProc) found = {0};
+	size_t first = stream->position;
+	size_t pos = first;
+	while(tokenAt(stream->tokens, stream->token_count, pos) == procsym) {
+		size_t start = pos;
+		if(!skipProc(stream->tokens, stream->token_count, &pos)) {
+			break;
+		}
+		
+		ParsedProc item = {0};
+		item.start = start;
+		item.proc = AST_NONE;
+		array_append(&found, item);
+	}
+	
+	/* Give each thread enough tokens to be worth starting it */
+	long threads = PARPARSE_THREADS;
+	if(threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	size_t total = pos - first;
+	size_t job_count = MIN(found.count, total / PARPARSE_MIN_TOKENS);
+	if(threads > 0) {
+		job_count = MIN(job_count, (size_t)threads);
+	}
+	
+	if(job_count < 2) {
+		/* Not worth it, so leave all of the declarations to the caller */
+		array_clear(&found);
+		return true;
+	}
+	
+	/* Split the declarations into runs with about the same number of tokens each */
+	ParseJob* jobs = calloc_ff(job_count, sizeof(*jobs));
+	size_t next = 0;
+	for(size_t i = 0; i < job_count; i++) {
+		ParseJob* job = &jobs[i];
+		job->tokens = stream->tokens;
+		job->token_count = stream->token_count;
+		job->ast = AST_new();
+		job->procs = &found.elems[next];
+		
+		size_t goal = first + total * (i + 1) / job_count;
+		size_t end = next;
+		while(end < found.count && (end == next || found.elems[end].start < goal)) {
+			++end;
+		}
+		if(i == job_count - 1) {
+			end = found.count;
+		}
+		
+		job->count = end - next;
+		next = end;
+	}
+	
+	/* The found array won't be resized from here on, so the threads can hold pointers into it */
+	for(size_t i = 1; i < job_count; i++) {
+		ParseJob* job = &jobs[i];
+		job->threaded = job->count != 0 && pthread_create(&job->thread, NULL, &ParseJob_run, job) == 0;
+		if(!job->threaded) {
+			/* Couldn't start a thread, so just parse the job here instead */
+			ParseJob_parse(job);
+		}
+	}
+	
+	/* Parse the first job on this thread while waiting for the others. Each job built an AST of
+	 its own, which is appended to the caller's, so the indices of its declarations shift.
+	 */
+	ParseJob_parse(&jobs[0]);
+	for(size_t i = 0; i < job_count; i++) {
+		ParseJob* job = &jobs[i];
+		if(job->threaded) {
+			pthread_join(job->thread, NULL);
+		}
+		
+		uint32_t offset = AST_adopt(self->ast, job->ast);
+		for(size_t j = 0; j < job->count; j++) {
+			if(job->procs[j].proc != AST_NONE) {
+				job->procs[j].proc += offset;
+			}
+		}
+		release(&job->ast);
+	}
+	
+	/* Use the results in source order, for as long as each declaration starts where the one
+	 before it actually ended. A parse from the same token gives the same result on any thread,
+	 so past that point this is just what a sequential parse would have done.
+	 */
+	bool success = true;
+	pos = first;
+	foreach(&found, pitem) {
+		if(!pitem->parsed || pitem->start != pos) {
+			/* The prescan guessed wrong, so the caller parses the rest sequentially */
+			break;
+		}
+		
+		if(pitem->proc == AST_NONE) {
+			/* A sequential parse would have stopped with these same errors */
+			if(!string_empty(&pitem->errors)) {
+				fputs(string_cstr(&pitem->errors), stdout);
+			}
+			success = false;
+			break;
+		}
+		
+		pos = self->ast->procs.elems[pitem->proc].end_token;
+		AST_listAppend(self->ast, pitem->proc);
+	}
+	
+	if(success) {
+		TokenStream_seek(stream, pos);
+	}
+	
+	/* Clean up the errors of any results that weren't used */
+	foreach(&found, pitem) {
+		string_clear(&pitem->errors);
+	}
+	array_clear(&found);
+	destroy(&jobs);
+	return success;
+}
+
+static token_type tokenAt(const Token* tokens, size_t count, size_t index) {
+	return index < count ? tokens[index].type : nulsym;
+}
+
+static bool skipProc(const Token* tokens, size_t count, size_t* pos) {
+	/* "procedure" ident "(" */
+	size_t i = *pos + 1;
+	if(tokenAt(tokens, count, i++) != identsym || tokenAt(tokens, count, i++) != lparentsym) {
+		return false;
+	}
+	
+	/* Parameter names up to ")" */
+	token_type type;
+	while((type = tokenAt(tokens, count, i)) == identsym || type == commasym) {
+		++i;
+	}
+	if(type != rparentsym || tokenAt(tokens, count, i + 1) != semicolonsym) {
+		return false;
+	}
+	i += 2;
+	
+	/* Block followed by ";" */
+	if(!skipBlock(tokens, count, &i) || tokenAt(tokens, count, i) != semicolonsym) {
+		return false;
+	}
+	
+	*pos = i + 1;
+	return true;
+}
+
+static bool skipBlock(const Token* tokens, size_t count, size_t* pos) {
+	size_t i = *pos;
+	
+	/* Constant and variable declarations both end at the first ";" */
+	if(tokenAt(tokens, count, i) == constsym) {
+		token_type type;
+		while((type = tokenAt(tokens, count, i)) != semicolonsym && type != nulsym) {
+			++i;
+		}
+		++i;
+	}
+	if(tokenAt(tokens, count, i) == varsym) {
+		token_type type;
+		while((type = tokenAt(tokens, count, i)) != semicolonsym && type != nulsym) {
+			++i;
+		}
+		++i;
+	}
+	
+	while(tokenAt(tokens, count, i) == procsym) {
+		if(!skipProc(tokens, count, &i)) {
+			return false;
+		}
+	}
+	
+	skipStmt(tokens, count, &i);
+	*pos = i;
+	return true;
+}
+
+static void skipStmt(const Token* tokens, size_t count, size_t* pos) {
+	size_t i = *pos;
+	size_t depth = 0;
+	
+	while(true) {
+		switch(tokenAt(tokens, count, i)) {
+			case beginsym:
+				++depth;
+				break;
+			
+			case endsym:
+				if(depth == 0) {
+					/* Ends an enclosing begin statement */
+					*pos = i;
+					return;
+				}
+				--depth;
+				break;
+			
+			case semicolonsym:
+				if(depth == 0) {
+					*pos = i;
+					return;
+				}
+				break;
+			
+			case periodsym:
+			case nulsym:
+			case constsym:
+			case varsym:
+			case procsym:
+				/* Can't be part of a statement */
+				*pos = i;
+				return;
+			
+			default:
+				break;
+		}
+		
+		++i;
+	}
+}
+
+static void ParseJob_parse(ParseJob* job) {
+	Parser* parser = Parser_initWithTokens(Parser_alloc(), job->tokens, job->token_count, PARSER_RDP);
+	parser->speculative = true;
+	
+	for(size_t i = 0; i < job->count; i++) {
+		ParsedProc* item = &job->procs[i];
+		TokenStream_seek(parser->token_stream, item->start);
+		item->parsed = true;
+		if(!Parser_parseProcDecl(parser, job->ast, &item->proc)) {
+			/* Nothing after an error is used, so the errors can just be handed over */
+			item->errors = parser->errors;
+			memset(&parser->errors, 0, sizeof(parser->errors));
+			break;
+		}
+	}
+	
+	release(&parser);
+}
+
+static void* ParseJob_run(void* arg) {
+	ParseJob_parse(arg);
+	return NULL;
+}
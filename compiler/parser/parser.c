@@ -12,6 +12,9 @@
 
 Destroyer(Parser) {
 	release(&self->token_stream);
+	array_clear(&self->expr_stack);
+	array_clear(&self->op_stack);
+	string_clear(&self->errors);
 }
 DEF(Parser);
 
@@ -23,6 +26,10 @@ Parser* Parser_initWithLexer(Parser* self, Lexer* lexer, PARSER_TYPE type) {
 	return Parser_initWithStream(self, TokenStream_initWithLexer(TokenStream_alloc(), lexer), type);
 }
 
+Parser* Parser_initWithTokens(Parser* self, const Token* tokens, size_t count, PARSER_TYPE type) {
+	return Parser_initWithStream(self, TokenStream_initWithTokens(TokenStream_alloc(), tokens, count), type);
+}
+
 Parser* Parser_initWithStream(Parser* self, TokenStream* stream, PARSER_TYPE type) {
 	if((self = Parser_init(self))) {
 		self->token_stream = stream;
@@ -33,41 +40,59 @@ Parser* Parser_initWithStream(Parser* self, TokenStream* stream, PARSER_TYPE typ
 }
 
 
+
+
 /* Private parser function declarations */
-static bool Parser_parseTopBlock(Parser* self, AST_Block** program);
-static bool Parser_parseBlock(Parser* self, AST_Block** block);
-static bool Parser_parseConstDecls(Parser* self, AST_ConstDecls** const_decls);
-static bool Parser_parseVarDecls(Parser* self, AST_VarDecls** var_decls);
-static bool Parser_parseProcDecls(Parser* self, AST_ProcDecls** proc_decls);
-static bool Parser_parseProc(Parser* self, AST_Proc** procedure);
-static bool Parser_parseParamDecls(Parser* self, AST_ParamDecls** param_decls);
-static bool Parser_parseStmt(Parser* self, AST_Stmt** statement);
-static bool Parser_parseStmtAssign(Parser* self, AST_Stmt** statement);
-static bool Parser_parseStmtCall(Parser* self, AST_Stmt** statement);
-static bool Parser_parseStmtBegin(Parser* self, AST_Stmt** statement);
-static bool Parser_parseStmtIf(Parser* self, AST_Stmt** statement);
-static bool Parser_parseStmtWhile(Parser* self, AST_Stmt** statement);
-static bool Parser_parseStmtRead(Parser* self, AST_Stmt** statement);
-static bool Parser_parseStmtWrite(Parser* self, AST_Stmt** statement);
-static bool Parser_parseCond(Parser* self, AST_Cond** condition);
-static bool Parser_parseExpr(Parser* self, AST_Expr** expression);
-static bool Parser_parseRawExpr(Parser* self, AST_Expr** expression, bool negate);
-static bool Parser_parseTerm(Parser* self, AST_Expr** term, bool negate);
-static bool Parser_parseFactor(Parser* self, AST_Expr** factor);
-static bool Parser_parseParamList(Parser* self, AST_ParamList** param_list);
-static bool Parser_parseIdent(Parser* self, char** identifier);
+static bool Parser_parseTopBlock(Parser* self, AST** program);
+static bool Parser_parseBlock(Parser* self, uint32_t* block);
+static bool Parser_parseConstDecls(Parser* self, AST_Range* const_decls);
+static bool Parser_parseVarDecls(Parser* self, AST_Range* var_decls);
+static bool Parser_parseProcDecls(Parser* self, uint32_t* proc_decls);
+static bool Parser_parseProc(Parser* self, uint32_t* procedure);
+static bool Parser_parseParamDecls(Parser* self, AST_Range* param_decls);
+static bool Parser_parseStmt(Parser* self, AST_Node* statement);
+static bool Parser_parseStmtAssign(Parser* self, AST_Node* statement);
+static bool Parser_parseStmtCall(Parser* self, AST_Node* statement);
+static bool Parser_parseStmtBegin(Parser* self, AST_Node* statement);
+static bool Parser_parseStmtIf(Parser* self, AST_Node* statement);
+static bool Parser_parseStmtWhile(Parser* self, AST_Node* statement);
+static bool Parser_parseStmtRead(Parser* self, AST_Node* statement);
+static bool Parser_parseStmtWrite(Parser* self, AST_Node* statement);
+static bool Parser_parseCond(Parser* self, AST_Node* condition);
+static bool Parser_parseExpr(Parser* self, AST_Node* expression);
+static bool Parser_parseSign(Parser* self);
+static void Parser_reduceExpr(Parser* self, size_t op_base, bool terms_only);
+static bool Parser_parseFactor(Parser* self, AST_Node* factor);
+static bool Parser_parseParamList(Parser* self, uint32_t* param_list);
+static bool Parser_parseIdent(Parser* self, uint32_t* identifier);
 static bool Parser_parseNumber(Parser* self, Word* number);
-static bool Parser_parseCall(Parser* self, char** identifier, AST_ParamList** param_list);
+static bool Parser_parseCall(Parser* self, uint32_t* identifier, uint32_t* param_list);
+
+/* Format a syntax error message the way it is printed */
+static char* formatSyntaxError(size_t line_number, const char* fmt, va_list ap);
+
+/* Print a syntax error message, or one without a line number if line_number is 0 */
+static void vSyntaxError(size_t line_number, const char* fmt, va_list ap);
 
 
-bool Parser_parseProgram(Parser* self, AST_Block** program) {
+bool Parser_parseProgram(Parser* self, AST** program) {
 	switch(self->type) {
 		case PARSER_RDP:
+		case PARSER_PARALLEL:
 			return Parser_parseTopBlock(self, program);
 			
 #if WITH_BISON
-		case PARSER_BISON:
-			return yyparse(self->token_stream, program) == 0;
+		case PARSER_BISON: {
+			*program = NULL;
+			AST* ast = AST_new();
+			if(yyparse(self->token_stream, ast) != 0) {
+				release(&ast);
+				return false;
+			}
+			
+			*program = ast;
+			return true;
+		}
 #endif /* WITH_BISON */
 			
 		default:
@@ -77,43 +102,89 @@ bool Parser_parseProgram(Parser* self, AST_Block** program) {
 
 
 static void vSyntaxError(size_t line_number, const char* fmt, va_list ap) {
-	if(line_number > 0) {
-		printf("Syntax Error on line %zu: ", line_number);
-	}
-	else {
-		printf("Syntax Error: ");
-	}
-	vprintf(fmt, ap);
-	printf("\n");
+	char* message = formatSyntaxError(line_number, fmt, ap);
+	fputs(message, stdout);
+	destroy(&message);
+}
+
+static char* formatSyntaxError(size_t line_number, const char* fmt, va_list ap) {
+	char* text = vrsprintf_ff(fmt, ap);
+	char* message = line_number > 0
+		? rsprintf_ff("Syntax Error on line %zu: %s\n", line_number, text)
+		: rsprintf_ff("Syntax Error: %s\n", text);
+	destroy(&text);
+	return message;
 }
 
-static void syntaxError(size_t line_number, const char* fmt, ...) {
+static void syntaxError(Parser* self, const char* fmt, ...) {
 	VARIADIC(fmt, ap, {
-		vSyntaxError(line_number, fmt, ap);
+		if(!self->speculative) {
+			vSyntaxError(self->token_stream->line_number, fmt, ap);
+		}
+		else {
+			/* Keep the errors until it's known whether a sequential parse would have seen them */
+			char* message = formatSyntaxError(self->token_stream->line_number, fmt, ap);
+			string_append(&self->errors, message);
+			destroy(&message);
+		}
 	});
 }
 
 
+bool Parser_parseProcDecl(Parser* self, AST* ast, uint32_t* procedure) {
+	ASSERT(self->type == PARSER_RDP || self->type == PARSER_PARALLEL);
+	*procedure = AST_NONE;
+	
+	/* Make sure the declaration starts where it's supposed to */
+	Token* tok;
+	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != procsym) {
+		syntaxError(self, "Expected \"procedure\", not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
+		return false;
+	}
+	
+	/* Nodes from a failed parse are left behind, but lists that were still being built are dropped */
+	size_t mark = ast->pending.count;
+	self->ast = ast;
+	bool success = Parser_parseProc(self, procedure);
+	self->ast = NULL;
+	ast->pending.count = mark;
+	return success;
+}
+
+bool Parser_parseStatement(Parser* self, AST* ast, AST_Node* statement) {
+	ASSERT(self->type == PARSER_RDP);
+	
+	size_t mark = ast->pending.count;
+	self->ast = ast;
+	bool success = Parser_parseStmt(self, statement);
+	self->ast = NULL;
+	ast->pending.count = mark;
+	return success;
+}
+
+
 /*! Grammar:
  @code
  program ::= block "."
  @endcode
  */
-static bool Parser_parseTopBlock(Parser* self, AST_Block** program) {
+static bool Parser_parseTopBlock(Parser* self, AST** program) {
 	*program = NULL;
-	AST_Block* prog = AST_Block_new();
+	AST* prog = AST_new();
 	Token* tok;
 	
 	/* Parse the program block */
-	if(!Parser_parseBlock(self, &prog)) {
+	self->ast = prog;
+	bool success = Parser_parseBlock(self, &prog->program);
+	self->ast = NULL;
+	if(!success) {
 		release(&prog);
 		return false;
 	}
 	
 	/* Consume "." token */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != periodsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \".\" at end of program block, not \"%s\"", tok->lexeme);
+		syntaxError(self, "Expected \".\" at end of program block, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		release(&prog);
 		return false;
 	}
@@ -131,20 +202,25 @@ static bool Parser_parseTopBlock(Parser* self, AST_Block** program) {
  block ::= const-declaration var-declaration proc-declaration statement
  @endcode
  */
-static bool Parser_parseBlock(Parser* self, AST_Block** block) {
-	*block = NULL;
-	AST_Block* blk = AST_Block_new();
+static bool Parser_parseBlock(Parser* self, uint32_t* block) {
+	*block = AST_NONE;
+	AST_Block blk = {0};
 	
 	/* Parse all parts of the block. Any errors will already have been printed */
-	if(!Parser_parseConstDecls(self, &blk->consts) ||
-	   !Parser_parseVarDecls(self, &blk->vars) ||
-	   !Parser_parseProcDecls(self, &blk->procs) ||
-	   !Parser_parseStmt(self, &blk->stmt)) {
-		release(&blk);
+	if(!Parser_parseConstDecls(self, &blk.consts) ||
+	   !Parser_parseVarDecls(self, &blk.vars) ||
+	   !Parser_parseProcDecls(self, &blk.procs)) {
+		return false;
+	}
+	
+	/* Remember which tokens the statement came from so it can be parsed again on its own */
+	blk.stmt_first_token = self->token_stream->position;
+	if(!Parser_parseStmt(self, &blk.stmt)) {
 		return false;
 	}
+	blk.stmt_end_token = self->token_stream->position;
 	
-	*block = blk;
+	*block = AST_addBlock(self->ast, &blk);
 	return true;
 }
 
@@ -153,15 +229,14 @@ static bool Parser_parseBlock(Parser* self, AST_Block** block) {
  const-declaration ::= [ "const" ident "=" number {"," ident "=" number} ";" ]
  @endcode
  */
-static bool Parser_parseConstDecls(Parser* self, AST_ConstDecls** const_decls) {
-	*const_decls = NULL;
-	AST_ConstDecls* consts = AST_ConstDecls_new();
+static bool Parser_parseConstDecls(Parser* self, AST_Range* const_decls) {
+	AST_Range consts = {(uint32_t)self->ast->extra.count, 0};
+	*const_decls = consts;
 	Token* tok;
 	
 	/* Read "const" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != constsym) {
-		/* This is optional, so return success but leave the output parameter NULL */
-		release(&consts);
+		/* This is optional, so return success but leave the output range empty */
 		return true;
 	}
 	
@@ -170,51 +245,42 @@ static bool Parser_parseConstDecls(Parser* self, AST_ConstDecls** const_decls) {
 		/* This will consume "const" on first loop and separating commas after that */
 		TokenStream_consumeToken(self->token_stream);
 		
-		/* Build the new constant that will be appended to the array */
-		element_type(consts->consts) newConst;
-		
 		/* Parse name of constant being defined */
-		if(!Parser_parseIdent(self, &newConst.ident)) {
-			TokenStream_peekToken(self->token_stream, &tok);
-			syntaxError(self->token_stream->line_number,
-						"Expected identifier in constant declaration, not \"%s\"", tok->lexeme);
-			release(&consts);
+		if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != identsym) {
+			syntaxError(self, "Expected identifier in constant declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 			return false;
 		}
+		const char* ident = tok->lexeme.text;
+		TokenStream_consumeToken(self->token_stream);
 		
 		/* Consume "=" */
 		if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != eqsym) {
-			syntaxError(self->token_stream->line_number,
-						"Expected \"=\" after name in constant declaration, not \"%s\"", tok->lexeme);
-			release(&consts);
+			syntaxError(self, "Expected \"=\" after name in constant declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 			return false;
 		}
 		TokenStream_consumeToken(self->token_stream);
 		
-		/* Parse value of constant being defined and append it to the array */
-		if(!Parser_parseNumber(self, &newConst.value)) {
+		/* Parse value of constant being defined and append it to the block's constants */
+		Word value;
+		if(!Parser_parseNumber(self, &value)) {
 			TokenStream_peekToken(self->token_stream, &tok);
-			syntaxError(self->token_stream->line_number,
-						"Expected number after \"=\" in constant declaration, not \"%s\"", tok->lexeme);
-			release(&consts);
+			syntaxError(self, "Expected number after \"=\" in constant declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 			return false;
 		}
-		array_append(&consts->consts, newConst);
+		AST_addConst(self->ast, ident, value);
+		++consts.count;
 	} while(TokenStream_peekToken(self->token_stream, &tok) && tok->type == commasym);
 	
 	/* Consume ";" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != semicolonsym) {
 		if(tok != NULL && tok->type == identsym) {
-			syntaxError(self->token_stream->line_number,
-						"Expected \",\" between constant declarations");
+			syntaxError(self, "Expected \",\" between constant declarations");
 		}
 		else {
-			syntaxError(self->token_stream->line_number,
-						"Expected \";\" at end of constant declaration, not \"%s\"", tok->lexeme);
+			syntaxError(self, "Expected \";\" at end of constant declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		}
 		
-		release(&consts);
-		return NULL;
+		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
@@ -227,14 +293,13 @@ static bool Parser_parseConstDecls(Parser* self, AST_ConstDecls** const_decls) {
  var-declaration ::= [ "var" ident {"," ident} ";" ]
  @endcode
  */
-static bool Parser_parseVarDecls(Parser* self, AST_VarDecls** var_decls) {
-	*var_decls = NULL;
-	AST_VarDecls* vars = AST_VarDecls_new();
+static bool Parser_parseVarDecls(Parser* self, AST_Range* var_decls) {
+	AST_Range vars = {(uint32_t)self->ast->idents.count, 0};
+	*var_decls = vars;
 	Token* tok;
 	
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != varsym) {
-		/* This is optional, so return success but leave the output parameter NULL */
-		release(&vars);
+		/* This is optional, so return success but leave the output range empty */
 		return true;
 	}
 	
@@ -243,30 +308,25 @@ static bool Parser_parseVarDecls(Parser* self, AST_VarDecls** var_decls) {
 		/* This will consume "var" on first loop and separating commas after that */
 		TokenStream_consumeToken(self->token_stream);
 		
-		/* Parse name of variable being declared and append it to the array */
-		char* var;
+		/* Parse name of variable being declared, which adds it to the block's variables */
+		uint32_t var;
 		if(!Parser_parseIdent(self, &var)) {
 			TokenStream_peekToken(self->token_stream, &tok);
-			syntaxError(self->token_stream->line_number,
-						"Expected identifier in variable declaration, not \"%s\"", tok->lexeme);
-			release(&vars);
+			syntaxError(self, "Expected identifier in variable declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 			return false;
 		}
-		array_append(&vars->vars, var);
+		++vars.count;
 	} while(TokenStream_peekToken(self->token_stream, &tok) && tok->type == commasym);
 	
 	/* Consume ";" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != semicolonsym) {
 		if(tok != NULL && tok->type == identsym) {
-			syntaxError(self->token_stream->line_number,
-						"Expected \",\" between variable declarations");
+			syntaxError(self, "Expected \",\" between variable declarations");
 		}
 		else {
-			syntaxError(self->token_stream->line_number,
-						"Expected \";\" at end of variable declarations, not \"%s\"", tok->lexeme);
+			syntaxError(self, "Expected \";\" at end of variable declarations, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		}
 		
-		release(&vars);
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
@@ -280,23 +340,28 @@ static bool Parser_parseVarDecls(Parser* self, AST_VarDecls** var_decls) {
  proc-decls ::= { proc-decl }
  @endcode
  */
-static bool Parser_parseProcDecls(Parser* self, AST_ProcDecls** proc_decls) {
-	*proc_decls = NULL;
-	AST_ProcDecls* procs = AST_ProcDecls_new();
+static bool Parser_parseProcDecls(Parser* self, uint32_t* proc_decls) {
+	*proc_decls = AST_NONE;
+	uint32_t mark = AST_beginList(self->ast);
 	Token* tok;
 	
+	/* Parse as many of the procedures as possible on other threads first */
+	if(self->type == PARSER_PARALLEL && self->token_stream->tokens != NULL &&
+	   !Parser_parseProcsParallel(self)) {
+		return false;
+	}
+	
 	/* Parse procedures as long as we see "procedure" */
 	while(TokenStream_peekToken(self->token_stream, &tok) && tok->type == procsym) {
-		/* Parse a procedure and append it to the array */
-		AST_Proc* proc;
+		/* Parse a procedure and append it to the list */
+		uint32_t proc;
 		if(!Parser_parseProc(self, &proc)) {
-			release(&procs);
 			return false;
 		}
-		array_append(&procs->procs, proc);
+		AST_listAppend(self->ast, proc);
 	}
-
-	*proc_decls = procs;
+	
+	*proc_decls = AST_endList(self->ast, mark);
 	return true;
 }
 
@@ -305,11 +370,14 @@ static bool Parser_parseProcDecls(Parser* self, AST_ProcDecls** proc_decls) {
  proc-decl ::= "procedure" ident parameter-block ";" block ";"
  @endcode
  */
-static bool Parser_parseProc(Parser* self, AST_Proc** procedure) {
-	*procedure = NULL;
-	AST_Proc* proc = AST_Proc_new();
+static bool Parser_parseProc(Parser* self, uint32_t* procedure) {
+	*procedure = AST_NONE;
+	AST_Proc proc = {0};
 	Token* tok;
 	
+	/* Remember which tokens the declaration came from so it can be parsed again on its own */
+	proc.first_token = self->token_stream->position;
+	
 	/* Consume "procedure" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != procsym) {
 		/* Shouldn't be possible */
@@ -318,45 +386,38 @@ static bool Parser_parseProc(Parser* self, AST_Proc** procedure) {
 	TokenStream_consumeToken(self->token_stream);
 	
 	/* Parse the procedure's name */
-	if(!Parser_parseIdent(self, &proc->ident)) {
+	if(!Parser_parseIdent(self, &proc.ident)) {
 		TokenStream_peekToken(self->token_stream, &tok);
-		syntaxError(self->token_stream->line_number,
-					"Expected identifier after \"procedure\", not \"%s\"", tok->lexeme);
-		release(&proc);
+		syntaxError(self, "Expected identifier after \"procedure\", not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	
 	/* Parse parameter declarations */
-	if(!Parser_parseParamDecls(self, &proc->param_decls)) {
-		release(&proc);
+	if(!Parser_parseParamDecls(self, &proc.params)) {
 		return false;
 	}
 	
 	/* Consume ";" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != semicolonsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \";\" after name of procedure in procedure declaration, not \"%s\"", tok->lexeme);
-		release(&proc);
+		syntaxError(self, "Expected \";\" after name of procedure in procedure declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
 	/* Parse the procedure's block */
-	if(!Parser_parseBlock(self, &proc->body)) {
-		release(&proc);
+	if(!Parser_parseBlock(self, &proc.body)) {
 		return false;
 	}
 	
 	/* Consume ";" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != semicolonsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \";\" at end of procedure declaration, not \"%s\"", tok->lexeme);
-		release(&proc);
+		syntaxError(self, "Expected \";\" at end of procedure declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
-	*procedure = proc;
+	proc.end_token = self->token_stream->position;
+	*procedure = AST_addProc(self->ast, &proc);
 	return true;
 }
 
@@ -365,56 +426,48 @@ static bool Parser_parseProc(Parser* self, AST_Proc** procedure) {
  param-decls ::= "(" [ ident { "," ident } ] ")"
  @endcode
  */
-static bool Parser_parseParamDecls(Parser* self, AST_ParamDecls** param_decls) {
-	*param_decls = NULL;
-	AST_ParamDecls* params = AST_ParamDecls_new();
+static bool Parser_parseParamDecls(Parser* self, AST_Range* param_decls) {
+	AST_Range params = {(uint32_t)self->ast->idents.count, 0};
+	*param_decls = params;
 	Token* tok;
 	
 	/* Consume "(" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != lparentsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected parameter declaration list after procedure declaration, not \"%s\"", tok->lexeme);
-		release(&params);
+		syntaxError(self, "Expected parameter declaration list after procedure declaration, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
 	/* Check if there are any parameters to parse */
 	if(TokenStream_peekToken(self->token_stream, &tok) && tok->type != rparentsym) {
-		/* Parse name of first parameter and append it to the array */
-		char* param;
+		/* Parse name of first parameter, which adds it to the procedure's parameters */
+		uint32_t param;
 		if(!Parser_parseIdent(self, &param)) {
 			TokenStream_peekToken(self->token_stream, &tok);
-			syntaxError(self->token_stream->line_number,
-						"Expected identifier for first parameter in parameter declarations list, not \"%s\"", tok->lexeme);
-			release(&params);
+			syntaxError(self, "Expected identifier for first parameter in parameter declarations list, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 			return false;
 		}
-		array_append(&params->params, param);
+		++params.count;
 		
 		/* Keep going as long as we have another parameter to parse */
 		while(TokenStream_peekToken(self->token_stream, &tok) && tok->type == commasym) {
 			/* Consume "," */
 			TokenStream_consumeToken(self->token_stream);
 			
-			/* Parse name of next parameter and append it to the array */
+			/* Parse name of next parameter */
 			if(!Parser_parseIdent(self, &param)) {
 				TokenStream_peekToken(self->token_stream, &tok);
-				syntaxError(self->token_stream->line_number,
-					"Expected identifier for parameter %zu in parameter declarations list, not \"%s\"",
-					params->params.count, tok->lexeme);
-				release(&params);
+				syntaxError(self, "Expected identifier for parameter %zu in parameter declarations list, not \"%"PRIslice"\"",
+					(size_t)params.count, SLICE_ARG(tok->lexeme));
 				return false;
 			}
-			array_append(&params->params, param);
+			++params.count;
 		}
 	}
 	
 	/* Consume ")" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != rparentsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \")\" at end of parameter declarations, not \"%s\"", tok->lexeme);
-		release(&params);
+		syntaxError(self, "Expected \")\" at end of parameter declarations, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
@@ -434,8 +487,8 @@ static bool Parser_parseParamDecls(Parser* self, AST_ParamDecls** param_decls) {
                  stmt-write ]
  @endcode
  */
-static bool Parser_parseStmt(Parser* self, AST_Stmt** statement) {
-	*statement = NULL;
+static bool Parser_parseStmt(Parser* self, AST_Node* statement) {
+	*statement = AST_NONE;
 	Token* tok;
 	
 	/* Make sure to handle EOF */
@@ -444,16 +497,24 @@ static bool Parser_parseStmt(Parser* self, AST_Stmt** statement) {
 	}
 	
 	/* Invoke the parser function that corresponds to each branch of the alternation */
+	size_t line_number = tok->line_number;
+	bool success;
 	switch(tok->type) {
-		case identsym: return Parser_parseStmtAssign(self, statement);
-		case callsym:  return Parser_parseStmtCall(self, statement);
-		case beginsym: return Parser_parseStmtBegin(self, statement);
-		case ifsym:    return Parser_parseStmtIf(self, statement);
-		case whilesym: return Parser_parseStmtWhile(self, statement);
-		case readsym:  return Parser_parseStmtRead(self, statement);
-		case writesym: return Parser_parseStmtWrite(self, statement);
+		case identsym: success = Parser_parseStmtAssign(self, statement); break;
+		case callsym:  success = Parser_parseStmtCall(self, statement); break;
+		case beginsym: success = Parser_parseStmtBegin(self, statement); break;
+		case ifsym:    success = Parser_parseStmtIf(self, statement); break;
+		case whilesym: success = Parser_parseStmtWhile(self, statement); break;
+		case readsym:  success = Parser_parseStmtRead(self, statement); break;
+		case writesym: success = Parser_parseStmtWrite(self, statement); break;
 		default:       return true;
 	}
+	
+	/* Remember where the statement starts for diagnostics */
+	if(success && *statement != AST_NONE) {
+		self->ast->lines.elems[*statement] = (uint32_t)line_number;
+	}
+	return success;
 }
 
 /*! Grammar:
@@ -462,205 +523,239 @@ static bool Parser_parseStmt(Parser* self, AST_Stmt** statement) {
  rel-op    ::= "=" | "<>" | "<" | "<=" | ">" | ">="
  @endcode
  */
-static bool Parser_parseCond(Parser* self, AST_Cond** condition) {
-	*condition = NULL;
-	AST_Cond* cond = AST_Cond_new();
+static bool Parser_parseCond(Parser* self, AST_Node* condition) {
+	*condition = AST_NONE;
 	Token* tok;
 	
 	/* Peek the next token */
 	if(!TokenStream_peekToken(self->token_stream, &tok)) {
-		syntaxError(self->token_stream->line_number,
-					"Expected a condition, not \"%s\"", tok->lexeme);
-		release(&cond);
+		syntaxError(self, "Expected a condition, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	
 	if(tok->type == oddsym) {
 		/* Consume "odd" */
 		TokenStream_consumeToken(self->token_stream);
-		cond->type = COND_ODD;
 		
 		/* Parse the single operand to the "odd" keyword */
-		if(!Parser_parseExpr(self, &cond->values.operand)) {
-			release(&cond);
-			return false;
-		}
-	}
-	else {
-		/* Parse the left operand to the condition */
-		if(!Parser_parseExpr(self, &cond->values.binop.left)) {
-			release(&cond);
+		AST_Node operand;
+		if(!Parser_parseExpr(self, &operand)) {
 			return false;
 		}
 		
-		/* Peek next token */
-		if(!TokenStream_peekToken(self->token_stream, &tok)) {
-			syntaxError(self->token_stream->line_number,
-						"Expected a relational operator, not \"%s\"", tok->lexeme);
-			release(&cond);
-			return false;
-		}
-		
-		/* Determine the type of the conditional operator and consume it */
-		switch(tok->type) {
-			case eqsym:  cond->type = COND_EQ; break;
-			case neqsym: cond->type = COND_NE; break;
-			case lessym: cond->type = COND_LT; break;
-			case leqsym: cond->type = COND_LE; break;
-			case gtrsym: cond->type = COND_GT; break;
-			case geqsym: cond->type = COND_GE; break;
-				
-			default:
-				syntaxError(self->token_stream->line_number,
-							"Expected a relational operator, not \"%s\"", tok->lexeme);
-				release(&cond);
-				return false;
-		}
-		TokenStream_consumeToken(self->token_stream);
-		
-		/* Parse the right operand to the condition */
-		if(!Parser_parseExpr(self, &cond->values.binop.right)) {
-			release(&cond);
-			return false;
-		}
+		*condition = AST_addNode(self->ast, COND_ODD, operand, AST_NONE);
+		return true;
 	}
 	
-	*condition = cond;
-	return true;
-}
-
-/*! Grammar:
- @code
- expression ::= [ "+"|"-" ] raw-expression
- @endcode
- */
-static bool Parser_parseExpr(Parser* self, AST_Expr** expression) {
-	*expression = NULL;
-	Token* tok;
-	bool negate = false;
+	/* Parse the left operand to the condition */
+	AST_Node left;
+	if(!Parser_parseExpr(self, &left)) {
+		return false;
+	}
 	
-	/* Try to consume a unary plus or minus operator token */
-	if(TokenStream_peekToken(self->token_stream, &tok)
-	   && (tok->type == plussym || tok->type == minussym)) {
-		negate = tok->type == minussym;
-		TokenStream_consumeToken(self->token_stream);
+	/* Peek next token */
+	if(!TokenStream_peekToken(self->token_stream, &tok)) {
+		syntaxError(self, "Expected a relational operator, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
+		return false;
+	}
+	
+	/* Determine the type of the conditional operator and consume it */
+	COND_TYPE type;
+	switch(tok->type) {
+		case eqsym:  type = COND_EQ; break;
+		case neqsym: type = COND_NE; break;
+		case lessym: type = COND_LT; break;
+		case leqsym: type = COND_LE; break;
+		case gtrsym: type = COND_GT; break;
+		case geqsym: type = COND_GE; break;
+			
+		default:
+			syntaxError(self, "Expected a relational operator, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
+			return false;
+	}
+	TokenStream_consumeToken(self->token_stream);
+	
+	/* Parse the right operand to the condition */
+	AST_Node right;
+	if(!Parser_parseExpr(self, &right)) {
+		return false;
 	}
 	
-	/* Parse the raw expression */
-	return Parser_parseRawExpr(self, expression, negate);
+	*condition = AST_addNode(self->ast, type, left, right);
+	return true;
 }
 
 /*! Grammar:
  @code
+ expression ::= [ "+"|"-" ] raw-expression
  raw-expression ::= term [ ("+"|"-") raw-expression ]
+ term ::= factor [ ("*"|"/"|"%") term ]
+ factor ::= ident | number | "(" expression ")" | call-expr
  @endcode
+ 
+ Both binary operator levels are right associative, and a leading "-" negates only the first factor.
+ Rather than recursing once per level and once per operator, this uses an operand stack and an
+ operator stack, so parentheses can nest as deeply as memory allows. Only the parameter lists of
+ call expressions recurse back into this function.
  */
-static bool Parser_parseRawExpr(Parser* self, AST_Expr** expression, bool negate) {
-	*expression = NULL;
+static bool Parser_parseExpr(Parser* self, AST_Node* expression) {
+	*expression = AST_NONE;
 	Token* tok;
-	AST_Expr* expr;
 	
-	/* Parse left term of the expression */
-	if(!Parser_parseTerm(self, &expr, negate)) {
-		return false;
-	}
+	/* Another expression may already be using the stacks if this is a call parameter */
+	size_t expr_base = self->expr_stack.count;
+	size_t op_base = self->op_stack.count;
+	bool success = true;
+	bool done = false;
+	bool negate = Parser_parseSign(self);
 	
-	/* Try to consume a plus or minus */
-	if(TokenStream_peekToken(self->token_stream, &tok)
-	   && (tok->type == plussym || tok->type == minussym)) {
-		/* Determine expression type */
-		EXPR_TYPE type = tok->type == plussym ? EXPR_ADD : EXPR_SUB;
-		TokenStream_consumeToken(self->token_stream);
+	while(success && !done) {
+		/* Expecting a factor here */
+		if(!TokenStream_peekToken(self->token_stream, &tok)) {
+			syntaxError(self, "Expected identifier, number, or parenthesized subexpression, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
+			success = false;
+			break;
+		}
 		
-		/* Parse right expression of the expression */
-		AST_Expr* right;
-		if(!Parser_parseRawExpr(self, &right, false)) {
-			release(&expr);
-			return false;
+		if(tok->type == lparentsym) {
+			/* Consume "(" and remember whether the subexpression should be negated once it's parsed */
+			TokenStream_consumeToken(self->token_stream);
+			array_append(&self->op_stack, (uint8_t)(negate ? EXPR_NEG : EXPR_UNINITIALIZED));
+			negate = Parser_parseSign(self);
+			continue;
 		}
 		
-		/* Build binary expression */
-		expr = AST_Expr_create(type, expr, right);
+		AST_Node fact;
+		if(!Parser_parseFactor(self, &fact)) {
+			success = false;
+			break;
+		}
+		
+		/* Negate the first factor if told */
+		if(negate) {
+			fact = AST_addNode(self->ast, EXPR_NEG, fact, AST_NONE);
+			negate = false;
+		}
+		array_append(&self->expr_stack, fact);
+		
+		/* Close parenthesized subexpressions until there's another binary operator */
+		while(true) {
+			/* Try to consume a binary operator token */
+			EXPR_TYPE type = EXPR_UNINITIALIZED;
+			if(TokenStream_peekToken(self->token_stream, &tok)) {
+				switch(tok->type) {
+					case plussym:    type = EXPR_ADD; break;
+					case minussym:   type = EXPR_SUB; break;
+					case multsym:    type = EXPR_MUL; break;
+					case slashsym:   type = EXPR_DIV; break;
+					case percentsym: type = EXPR_MOD; break;
+					default:         break;
+				}
+			}
+			
+			if(type != EXPR_UNINITIALIZED) {
+				/* Operators are right associative, so a "+" or "-" only finishes the terms before it */
+				if(type == EXPR_ADD || type == EXPR_SUB) {
+					Parser_reduceExpr(self, op_base, true);
+				}
+				TokenStream_consumeToken(self->token_stream);
+				array_append(&self->op_stack, (uint8_t)type);
+				break;
+			}
+			
+			/* No more operators, so this is the end of the innermost subexpression */
+			Parser_reduceExpr(self, op_base, false);
+			if(self->op_stack.count == op_base) {
+				done = true;
+				break;
+			}
+			
+			/* Consume ")" */
+			if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != rparentsym) {
+				syntaxError(self, "Expected \")\" after subexpression, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
+				success = false;
+				break;
+			}
+			TokenStream_consumeToken(self->token_stream);
+			
+			/* The parenthesized subexpression is now a factor of the expression around it */
+			if(self->op_stack.elems[--self->op_stack.count] == EXPR_NEG) {
+				AST_Node* psub = &self->expr_stack.elems[self->expr_stack.count - 1];
+				*psub = AST_addNode(self->ast, EXPR_NEG, *psub, AST_NONE);
+			}
+		}
 	}
 	
-	*expression = expr;
+	if(!success) {
+		/* Throw away the partial expression */
+		self->expr_stack.count = expr_base;
+		self->op_stack.count = op_base;
+		return false;
+	}
+	
+	ASSERT(self->expr_stack.count == expr_base + 1);
+	*expression = self->expr_stack.elems[--self->expr_stack.count];
 	return true;
 }
 
-/*! Grammar:
- @code
- term ::= factor [ ("*"|"/"|"%") term ]
- @endcode
- */
-static bool Parser_parseTerm(Parser* self, AST_Expr** term, bool negate) {
-	*term = NULL;
+/* Consume an optional unary "+" or "-", returning true if it was "-" */
+static bool Parser_parseSign(Parser* self) {
 	Token* tok;
-	AST_Expr* trm;
 	
-	/* Parse the left factor */
-	if(!Parser_parseFactor(self, &trm)) {
-		return false;
-	}
-	
-	/* Negate left factor if told */
-	if(negate) {
-		trm = AST_Expr_create(EXPR_NEG, trm);
+	/* Try to consume a unary plus or minus operator token */
+	if(TokenStream_peekToken(self->token_stream, &tok)
+	   && (tok->type == plussym || tok->type == minussym)) {
+		bool negate = tok->type == minussym;
+		TokenStream_consumeToken(self->token_stream);
+		return negate;
 	}
 	
-	/* Try to consume a multiplication, division, or modulus operator token */
-	if(TokenStream_peekToken(self->token_stream, &tok)) {
-		/* Determine expression type */
-		EXPR_TYPE type;
-		switch(tok->type) {
-			case multsym:    type = EXPR_MUL; break;
-			case slashsym:   type = EXPR_DIV; break;
-			case percentsym: type = EXPR_MOD; break;
-			
-			default: goto done;
+	return false;
+}
+
+/* Pop binary operators back to the innermost "(" (or op_base), building an expression from the two
+ operands on top of the operand stack for each one. With terms_only, stop at a "+" or "-" instead.
+ */
+static void Parser_reduceExpr(Parser* self, size_t op_base, bool terms_only) {
+	while(self->op_stack.count > op_base) {
+		EXPR_TYPE type = self->op_stack.elems[self->op_stack.count - 1];
+		if(type == EXPR_UNINITIALIZED || type == EXPR_NEG) {
+			/* Stop at the "(" of the current subexpression */
+			break;
 		}
-		
-		TokenStream_consumeToken(self->token_stream);
-		
-		/* Parse right side */
-		AST_Expr* right;
-		if(!Parser_parseTerm(self, &right, false)) {
-			release(&trm);
-			return false;
+		if(terms_only && (type == EXPR_ADD || type == EXPR_SUB)) {
+			break;
 		}
 		
-		/* Create binary operator expression */
-		trm = AST_Expr_create(type, trm, right);
+		/* Build binary expression from the top two operands */
+		--self->op_stack.count;
+		AST_Node right = self->expr_stack.elems[--self->expr_stack.count];
+		AST_Node* pleft = &self->expr_stack.elems[self->expr_stack.count - 1];
+		*pleft = AST_addNode(self->ast, type, *pleft, right);
 	}
-	
-done:
-	*term = trm;
-	return true;
 }
 
 /*! Grammar:
  @code
- factor ::= ident | number | "(" expression ")" | call-expr
+ factor ::= ident | number | call-expr
  @endcode
+ 
+ Parenthesized subexpressions are handled by Parser_parseExpr.
  */
-static bool Parser_parseFactor(Parser* self, AST_Expr** factor) {
-	*factor = NULL;
+static bool Parser_parseFactor(Parser* self, AST_Node* factor) {
+	*factor = AST_NONE;
 	Token* tok;
-	AST_Expr* fact;
-	
-	if(!TokenStream_peekToken(self->token_stream, &tok)) {
-		syntaxError(self->token_stream->line_number,
-					"Expected identifier, number, or parenthesized subexpression, not \"%s\"", tok->lexeme);
-		return false;
-	}
+	AST_Node fact;
 	
+	TokenStream_peekToken(self->token_stream, &tok);
 	switch(tok->type) {
 		case identsym: {
-			char* ident;
+			uint32_t ident;
 			if(!Parser_parseIdent(self, &ident)) {
 				/* Shouldn't be possible */
 				ASSERT(!"Failed to parse identifier");
 			}
-			fact = AST_Expr_create(EXPR_VAR, ident);
+			fact = AST_addNode(self->ast, EXPR_VAR, ident, AST_NONE);
 			break;
 		}
 		
@@ -670,44 +765,23 @@ static bool Parser_parseFactor(Parser* self, AST_Expr** factor) {
 				/* Shouldn't be possible */
 				ASSERT(!"Failed to parse number");
 			}
-			fact = AST_Expr_create(EXPR_NUM, number);
+			fact = AST_addNode(self->ast, EXPR_NUM, (uint32_t)number, AST_NONE);
 			break;
 		}
 		
-		case lparentsym:
-			/* Consume "(" */
-			TokenStream_consumeToken(self->token_stream);
-			
-			/* Parse subexpression within parentheses */
-			if(!Parser_parseExpr(self, &fact)) {
-				return false;
-			}
-			
-			/* Consume ")" */
-			if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != rparentsym) {
-				syntaxError(self->token_stream->line_number,
-							"Expected \")\" after subexpression, not \"%s\"", tok->lexeme);
-				release(&fact);
-				return false;
-			}
-			TokenStream_consumeToken(self->token_stream);
-			break;
-		
 		case callsym: {
-			char* ident;
-			AST_ParamList* param_list;
+			uint32_t ident;
+			uint32_t param_list;
 			if(!Parser_parseCall(self, &ident, &param_list)) {
 				/* Don't print an error now as one should already have been printed */
-				release(&fact);
 				return false;
 			}
-			fact = AST_Expr_create(EXPR_CALL, ident, param_list);
+			fact = AST_addNode(self->ast, EXPR_CALL, ident, param_list);
 			break;
 		}
 		
 		default:
-			syntaxError(self->token_stream->line_number,
-						"Unexpected token \"%s\" while parsing factor", tok->lexeme);
+			syntaxError(self, "Unexpected token \"%"PRIslice"\" while parsing factor", SLICE_ARG(tok->lexeme));
 			return false;
 	}
 	
@@ -727,12 +801,10 @@ static bool Parser_parseNumber(Parser* self, Word* number) {
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != numbersym) {
 		return false;
 	}
-	ASSERT(strlen(tok->lexeme) <= 5);
+	ASSERT(tok->lexeme.length <= 5);
 	
 	/* Convert the lexeme into an unsigned integer and store it in the number node */
-	char* end;
-	*number = (Word)strtoul(tok->lexeme, &end, 10);
-	ASSERT(end == tok->lexeme + strlen(tok->lexeme));
+	*number = (Word)slice_toULong(tok->lexeme);
 	
 	/* Consume the number token */
 	TokenStream_consumeToken(self->token_stream);
@@ -744,18 +816,18 @@ static bool Parser_parseNumber(Parser* self, Word* number) {
  ident := [a-zA-Z]{1,11}
  @endcode
  */
-static bool Parser_parseIdent(Parser* self, char** identifier) {
-	*identifier = NULL;
+static bool Parser_parseIdent(Parser* self, uint32_t* identifier) {
+	*identifier = AST_NONE;
 	Token* tok;
 	
 	/* Peek the identifier token */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != identsym) {
 		return false;
 	}
-	ASSERT(strlen(tok->lexeme) <= 11);
+	ASSERT(tok->lexeme.length <= 11);
 	
-	/* Copy the identifier's name into the identifier and consume the token */
-	*identifier = strdup_ff(tok->lexeme);
+	/* Identifier lexemes are already interned, so the AST can share them */
+	*identifier = AST_addIdent(self->ast, tok->lexeme.text);
 	TokenStream_consumeToken(self->token_stream);
 	return true;
 }
@@ -765,15 +837,14 @@ static bool Parser_parseIdent(Parser* self, char** identifier) {
  call-expr ::= "call" ident parameter-list
  @endcode
  */
-static bool Parser_parseCall(Parser* self, char** identifier, AST_ParamList** param_list) {
-	*identifier = NULL;
-	*param_list = NULL;
+static bool Parser_parseCall(Parser* self, uint32_t* identifier, uint32_t* param_list) {
+	*identifier = AST_NONE;
+	*param_list = AST_NONE;
 	Token* tok;
 	
 	/* Consume "call" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != callsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \"call\", not \"%s\"", tok->lexeme);
+		syntaxError(self, "Expected \"call\", not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
@@ -781,14 +852,12 @@ static bool Parser_parseCall(Parser* self, char** identifier, AST_ParamList** pa
 	/* Parse the identifier */
 	if(!Parser_parseIdent(self, identifier)) {
 		TokenStream_peekToken(self->token_stream, &tok);
-		syntaxError(self->token_stream->line_number,
-					"Expected identifier after \"call\", not \"%s\"", tok->lexeme);
+		syntaxError(self, "Expected identifier after \"call\", not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	
 	/* Parse the procedure call's parameter list */
 	if(!Parser_parseParamList(self, param_list)) {
-		destroy(identifier);
 		return false;
 	}
 	return true;
@@ -799,16 +868,14 @@ static bool Parser_parseCall(Parser* self, char** identifier, AST_ParamList** pa
  parameter-list ::= "(" [ expression { "," expression } ] ")"
  @endcode
  */
-static bool Parser_parseParamList(Parser* self, AST_ParamList** param_list) {
-	*param_list = NULL;
-	AST_ParamList* paramList = AST_ParamList_new();
+static bool Parser_parseParamList(Parser* self, uint32_t* param_list) {
+	*param_list = AST_NONE;
+	uint32_t mark = AST_beginList(self->ast);
 	Token* tok;
 	
 	/* Consume "(" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != lparentsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected parameter list after procedure call, not \"%s\"", tok->lexeme);
-		release(&paramList);
+		syntaxError(self, "Expected parameter list after procedure call, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
@@ -816,14 +883,12 @@ static bool Parser_parseParamList(Parser* self, AST_ParamList** param_list) {
 	/* Check if there are any parameters to parse */
 	if(TokenStream_peekToken(self->token_stream, &tok) && tok->type != rparentsym) {
 		/* Parse expression for first parameter */
-		AST_Expr* param;
+		AST_Node param;
 		if(!Parser_parseExpr(self, &param)) {
-			syntaxError(self->token_stream->line_number,
-						"Expected expression for first parameter in parameter list");
-			release(&paramList);
+			syntaxError(self, "Expected expression for first parameter in parameter list");
 			return false;
 		}
-		array_append(&paramList->params, param);
+		AST_listAppend(self->ast, param);
 		
 		/* Keep going as long as we have another parameter to parse */
 		while(TokenStream_peekToken(self->token_stream, &tok) && tok->type == commasym) {
@@ -832,26 +897,22 @@ static bool Parser_parseParamList(Parser* self, AST_ParamList** param_list) {
 			
 			/* Parse expression for next parameter */
 			if(!Parser_parseExpr(self, &param)) {
-				syntaxError(self->token_stream->line_number,
-					"Expected expression for parameter %zu in parameter list",
-					paramList->params.count);
-				release(&paramList);
+				syntaxError(self, "Expected expression for parameter %zu in parameter list",
+					self->ast->pending.count - mark);
 				return false;
 			}
-			array_append(&paramList->params, param);
+			AST_listAppend(self->ast, param);
 		}
 	}
 	
 	/* Consume ")" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != rparentsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \")\" at end of parameter list, not \"%s\"", tok->lexeme);
-		release(&paramList);
+		syntaxError(self, "Expected \")\" at end of parameter list, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
-	*param_list = paramList;
+	*param_list = AST_endList(self->ast, mark);
 	return true;
 }
 
@@ -860,11 +921,11 @@ static bool Parser_parseParamList(Parser* self, AST_ParamList** param_list) {
  stmt-assign ::= ident ":=" expression
  @endcode
  */
-static bool Parser_parseStmtAssign(Parser* self, AST_Stmt** assign_statement) {
-	*assign_statement = NULL;
+static bool Parser_parseStmtAssign(Parser* self, AST_Node* assign_statement) {
+	*assign_statement = AST_NONE;
 	Token* tok;
-	char* ident;
-	AST_Expr* value;
+	uint32_t ident;
+	AST_Node value;
 	
 	/* Parse the name of the variable */
 	if(!Parser_parseIdent(self, &ident)) {
@@ -874,21 +935,18 @@ static bool Parser_parseStmtAssign(Parser* self, AST_Stmt** assign_statement) {
 	
 	/* Read and consume the := token */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != becomessym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \":=\" after identifier in assignment statement, not \"%s\"", tok->lexeme);
-		destroy(&ident);
+		syntaxError(self, "Expected \":=\" after identifier in assignment statement, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
 	/* Parse the expression */
 	if(!Parser_parseExpr(self, &value)) {
-		destroy(&ident);
 		return false;
 	}
 	
 	/* Create assign statement */
-	*assign_statement = AST_Stmt_create(STMT_ASSIGN, ident, value);
+	*assign_statement = AST_addNode(self->ast, STMT_ASSIGN, ident, value);
 	return true;
 }
 
@@ -897,11 +955,11 @@ static bool Parser_parseStmtAssign(Parser* self, AST_Stmt** assign_statement) {
  stmt-call ::= "call" ident [ parameter-list ]
  @endcode
  */
-static bool Parser_parseStmtCall(Parser* self, AST_Stmt** call_statement) {
-	*call_statement = NULL;
+static bool Parser_parseStmtCall(Parser* self, AST_Node* call_statement) {
+	*call_statement = AST_NONE;
 	Token* tok;
-	char* ident;
-	AST_ParamList* param_list = NULL;
+	uint32_t ident;
+	uint32_t param_list = AST_NONE;
 	
 	/* Consume "call" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != callsym) {
@@ -913,8 +971,7 @@ static bool Parser_parseStmtCall(Parser* self, AST_Stmt** call_statement) {
 	/* Read the identifier, which should be the name of the subprocedure */
 	if(!Parser_parseIdent(self, &ident)) {
 		TokenStream_peekToken(self->token_stream, &tok);
-		syntaxError(self->token_stream->line_number,
-					"Expected identifier after \"call\", not \"%s\"", tok->lexeme);
+		syntaxError(self, "Expected identifier after \"call\", not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	
@@ -922,13 +979,12 @@ static bool Parser_parseStmtCall(Parser* self, AST_Stmt** call_statement) {
 	if(TokenStream_peekToken(self->token_stream, &tok) && tok->type == lparentsym) {
 		/* Parse the parameter list following the procedure call statement */
 		if(!Parser_parseParamList(self, &param_list)) {
-			destroy(&ident);
 			return false;
 		}
 	}
 	
 	/* Create call statement */
-	*call_statement = AST_Stmt_create(STMT_CALL, ident, param_list);
+	*call_statement = AST_addNode(self->ast, STMT_CALL, ident, param_list);
 	return true;
 }
 
@@ -937,11 +993,11 @@ static bool Parser_parseStmtCall(Parser* self, AST_Stmt** call_statement) {
  stmt-begin ::= "begin" statement { ";" statement } "end"
  @endcode
  */
-static bool Parser_parseStmtBegin(Parser* self, AST_Stmt** begin_statement) {
-	*begin_statement = NULL;
+static bool Parser_parseStmtBegin(Parser* self, AST_Node* begin_statement) {
+	*begin_statement = AST_NONE;
+	uint32_t mark = AST_beginList(self->ast);
 	Token* tok;
-	AST_Stmt* begin = NULL;
-	AST_Stmt* stmt;
+	AST_Node stmt;
 	
 	/* Peek for "begin" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != beginsym) {
@@ -956,24 +1012,23 @@ static bool Parser_parseStmtBegin(Parser* self, AST_Stmt** begin_statement) {
 		
 		/* Parse next statement */
 		if(!Parser_parseStmt(self, &stmt)) {
-			release(&begin);
 			return false;
 		}
 		
-		/* Append statement to begin statement */
-		begin = AST_Stmt_append(begin, stmt);
+		/* Don't bother appending empty statements */
+		if(stmt != AST_NONE) {
+			AST_listAppend(self->ast, stmt);
+		}
 	} while(TokenStream_peekToken(self->token_stream, &tok) && tok->type == semicolonsym);
 	
 	/* Consume "end" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != endsym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \"end\" at end of block, not \"%s\"", tok->lexeme);
-		release(&begin);
+		syntaxError(self, "Expected \"end\" at end of block, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
-	*begin_statement = begin;
+	*begin_statement = AST_addBegin(self->ast, mark);
 	return true;
 }
 
@@ -982,12 +1037,12 @@ static bool Parser_parseStmtBegin(Parser* self, AST_Stmt** begin_statement) {
  stmt-if ::= "if" condition "then" statement [ "else" statement ]
  @endcode
  */
-static bool Parser_parseStmtIf(Parser* self, AST_Stmt** if_statement) {
-	*if_statement = NULL;
+static bool Parser_parseStmtIf(Parser* self, AST_Node* if_statement) {
+	*if_statement = AST_NONE;
 	Token* tok;
-	AST_Cond* cond;
-	AST_Stmt* then_stmt;
-	AST_Stmt* else_stmt = NULL;
+	AST_Node cond;
+	AST_Node then_stmt;
+	AST_Node else_stmt = AST_NONE;
 	
 	/* Consume "if" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != ifsym) {
@@ -998,25 +1053,20 @@ static bool Parser_parseStmtIf(Parser* self, AST_Stmt** if_statement) {
 	
 	/* Parse condition */
 	if(!Parser_parseCond(self, &cond)) {
-		syntaxError(self->token_stream->line_number,
-					"Expected condition after \"if\"");
+		syntaxError(self, "Expected condition after \"if\"");
 		return false;
 	}
 	
 	/* Consume "then" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != thensym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \"then\" after condition of \"if\" statement, not \"%s\"", tok->lexeme);
-		release(&cond);
+		syntaxError(self, "Expected \"then\" after condition of \"if\" statement, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
 	/* Parse body of the "then" branch of the if statement */
 	if(!Parser_parseStmt(self, &then_stmt)) {
-		syntaxError(self->token_stream->line_number,
-					"Expected statement after \"then\" in \"if\" statement");
-		release(&cond);
+		syntaxError(self, "Expected statement after \"then\" in \"if\" statement");
 		return false;
 	}
 	
@@ -1027,16 +1077,13 @@ static bool Parser_parseStmtIf(Parser* self, AST_Stmt** if_statement) {
 		
 		/* Parse body of the "else" branch of the if statement */
 		if(!Parser_parseStmt(self, &else_stmt)) {
-			syntaxError(self->token_stream->line_number,
-						"Expected statement after \"else\" in \"if\" statement");
-			release(&then_stmt);
-			release(&cond);
+			syntaxError(self, "Expected statement after \"else\" in \"if\" statement");
 			return false;
 		}
 	}
 	
 	/* Create if statement */
-	*if_statement = AST_Stmt_create(STMT_IF, cond, then_stmt, else_stmt);
+	*if_statement = AST_addNode(self->ast, STMT_IF, cond, AST_addPair(self->ast, then_stmt, else_stmt));
 	return true;
 }
 
@@ -1045,11 +1092,11 @@ static bool Parser_parseStmtIf(Parser* self, AST_Stmt** if_statement) {
  stmt-while ::= "while" condition "do" statement
  @endcode
  */
-static bool Parser_parseStmtWhile(Parser* self, AST_Stmt** while_statement) {
-	*while_statement = NULL;
+static bool Parser_parseStmtWhile(Parser* self, AST_Node* while_statement) {
+	*while_statement = AST_NONE;
 	Token* tok;
-	AST_Cond* cond;
-	AST_Stmt* body;
+	AST_Node cond;
+	AST_Node body;
 	
 	/* Consume "while" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != whilesym) {
@@ -1060,30 +1107,25 @@ static bool Parser_parseStmtWhile(Parser* self, AST_Stmt** while_statement) {
 	
 	/* Parse condition */
 	if(!Parser_parseCond(self, &cond)) {
-		syntaxError(self->token_stream->line_number,
-					"Expected condition after \"while\"");
+		syntaxError(self, "Expected condition after \"while\"");
 		return false;
 	}
 	
 	/* Consume "do" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != dosym) {
-		syntaxError(self->token_stream->line_number,
-					"Expected \"do\" after condition of \"while\" statement, not \"%s\"", tok->lexeme);
-		release(&cond);
+		syntaxError(self, "Expected \"do\" after condition of \"while\" statement, not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	TokenStream_consumeToken(self->token_stream);
 	
 	/* Parse body of while statement */
 	if(!Parser_parseStmt(self, &body)) {
-		syntaxError(self->token_stream->line_number,
-					"Expected statement after \"do\" in \"while\" statement");
-		release(&cond);
+		syntaxError(self, "Expected statement after \"do\" in \"while\" statement");
 		return false;
 	}
 	
 	/* Create while statement */
-	*while_statement = AST_Stmt_create(STMT_WHILE, cond, body);
+	*while_statement = AST_addNode(self->ast, STMT_WHILE, cond, body);
 	return true;
 }
 
@@ -1092,10 +1134,10 @@ static bool Parser_parseStmtWhile(Parser* self, AST_Stmt** while_statement) {
  stmt-read ::= "read" ident
  @endcode
  */
-static bool Parser_parseStmtRead(Parser* self, AST_Stmt** read_statement) {
-	*read_statement = NULL;
+static bool Parser_parseStmtRead(Parser* self, AST_Node* read_statement) {
+	*read_statement = AST_NONE;
 	Token* tok;
-	char* ident;
+	uint32_t ident;
 	
 	/* Consume "read" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != readsym) {
@@ -1107,13 +1149,12 @@ static bool Parser_parseStmtRead(Parser* self, AST_Stmt** read_statement) {
 	/* Parse name of variable to read into */
 	if(!Parser_parseIdent(self, &ident)) {
 		TokenStream_peekToken(self->token_stream, &tok);
-		syntaxError(self->token_stream->line_number,
-					"Expected identifier after \"read\", not \"%s\"", tok->lexeme);
+		syntaxError(self, "Expected identifier after \"read\", not \"%"PRIslice"\"", SLICE_ARG(tok->lexeme));
 		return false;
 	}
 	
 	/* Create read statement */
-	*read_statement = AST_Stmt_create(STMT_READ, ident);
+	*read_statement = AST_addNode(self->ast, STMT_READ, ident, AST_NONE);
 	return true;
 }
 
@@ -1122,10 +1163,10 @@ static bool Parser_parseStmtRead(Parser* self, AST_Stmt** read_statement) {
  stmt-write ::= "write" expr
  @endcode
  */
-static bool Parser_parseStmtWrite(Parser* self, AST_Stmt** write_statement) {
-	*write_statement = NULL;
+static bool Parser_parseStmtWrite(Parser* self, AST_Node* write_statement) {
+	*write_statement = AST_NONE;
 	Token* tok;
-	AST_Expr* value;
+	AST_Node value;
 	
 	/* Consume "write" */
 	if(!TokenStream_peekToken(self->token_stream, &tok) || tok->type != writesym) {
@@ -1136,12 +1177,11 @@ static bool Parser_parseStmtWrite(Parser* self, AST_Stmt** write_statement) {
 	
 	/* Parse expression to write */
 	if(!Parser_parseExpr(self, &value)) {
-		syntaxError(self->token_stream->line_number,
-					"Expected expression after \"write\"");
+		syntaxError(self, "Expected expression after \"write\"");
 		return false;
 	}
 	
 	/* Create write statement */
-	*write_statement = AST_Stmt_create(STMT_WRITE, value);
+	*write_statement = AST_addNode(self->ast, STMT_WRITE, value, AST_NONE);
 	return true;
 }
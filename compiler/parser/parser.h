@@ -9,12 +9,14 @@
 #ifndef PL0_PARSER_H
 #define PL0_PARSER_H
 
+#include <stddef.h>
 #include <stdbool.h>
 
 typedef struct Parser Parser;
 
 typedef enum PARSER_TYPE {
 	PARSER_RDP = 1,
+	PARSER_PARALLEL,
 	
 #if WITH_BISON
 	PARSER_BISON,
@@ -22,6 +24,7 @@ typedef enum PARSER_TYPE {
 } PARSER_TYPE;
 
 #include "object.h"
+#include "dynamic_string.h"
 #include "token.h"
 #include "compiler/ast_nodes.h"
 #include "token_stream.h"
@@ -35,6 +38,23 @@ struct Parser {
 	
 	/*! Parser type */
 	PARSER_TYPE type;
+	
+	/*! AST that the nodes being parsed are added to, only set while parsing */
+	AST* ast;
+	
+	/*! Operands of the expressions being parsed, kept between expressions to reuse the memory */
+	dynamic_array(AST_Node) expr_stack;
+	
+	/*! Binary operators and open parentheses of the expressions being parsed */
+	dynamic_array(uint8_t) op_stack;
+	
+	/*! Whether this parser parses procedures on a worker thread, which keeps its syntax
+	 errors rather than printing them so that errors are still reported in source order
+	 */
+	bool speculative;
+	
+	/*! Syntax errors seen by a speculative parser, formatted just as they would have been printed */
+	dynamic_string errors;
 };
 DECL(Parser);
 
@@ -49,6 +69,12 @@ Parser* Parser_initWithFile(Parser* self, FILE* fin, PARSER_TYPE type);
  */
 Parser* Parser_initWithLexer(Parser* self, Lexer* lexer, PARSER_TYPE type);
 
+/*! Initializes a parser with tokens that were already scanned
+ @param tokens Array of tokens ending with nulsym, which must outlive the parser
+ @param count Number of tokens in the array
+ */
+Parser* Parser_initWithTokens(Parser* self, const Token* tokens, size_t count, PARSER_TYPE type);
+
 /*! Initializes a parser with a token stream
  @param stream Token stream to read from
  */
@@ -59,7 +85,30 @@ Parser* Parser_initWithStream(Parser* self, TokenStream* stream, PARSER_TYPE typ
                 the entire program, or NULL on error
  @return True on success or false on error
  */
-bool Parser_parseProgram(Parser* self, AST_Block** program);
+bool Parser_parseProgram(Parser* self, AST** program);
+
+/*! Parses a single procedure declaration starting at the current token. Only for the
+ recursive descent parser
+ @param ast AST to add the procedure declaration to
+ @param procedure Out pointer to the index of the parsed procedure declaration in the AST's procs
+ @return True on success or false on error
+ */
+bool Parser_parseProcDecl(Parser* self, AST* ast, uint32_t* procedure);
+
+/*! Parses a single statement starting at the current token. Only for the recursive descent parser
+ @param ast AST to add the statement to
+ @param statement Out pointer to the parsed statement, which is AST_NONE for an empty statement or on error
+ @return True on success or false on error
+ */
+bool Parser_parseStatement(Parser* self, AST* ast, AST_Node* statement);
+
+/*! Parses the procedure declarations at the current token on several threads, appending their
+ indices to the list of procedure declarations that is being built in the parser's AST. Any
+ declarations after the ones that could be split up are left for the caller to parse. Only for
+ the parallel parser, and only when reading from a tokens array
+ @return True on success or false on error
+ */
+bool Parser_parseProcsParallel(Parser* self);
 
 
 #endif /* PL0_PARSER_H */
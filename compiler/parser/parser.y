@@ -3,7 +3,7 @@
 
 /* Declares yylex as `int yylex(YYSTYPE* lvalp, yyscan_t scanner)` */
 %lex-param {yyscan_t scanner}
-%parse-param {yyscan_t scanner}{AST_Block** program}
+%parse-param {yyscan_t scanner}{AST* ast}
 
 %define parse.trace
 %define parse.error verbose
@@ -15,7 +15,7 @@
 	
 	/* Forward declaration */
 	typedef struct TokenStream* yyscan_t;
-	void yyerror(yyscan_t scanner, AST_Block** program, char const* msg);
+	void yyerror(yyscan_t scanner, AST* ast, char const* msg);
 }
 
 /* token_stream.h includes the generated header, so it must go last */
@@ -25,19 +25,13 @@
 
 /* All types used by tokens or non-terminals */
 %union {
-	char* ident;
+	const char* ident;
 	Word num;
-	AST_Block* block;
-	AST_ConstDecls* const_decls;
-	AST_VarDecls* var_decls;
-	AST_ProcDecls* proc_decls;
-	AST_ParamDecls* param_decls;
-	AST_Stmt* stmt;
+	uint32_t index;
+	AST_Range range;
+	AST_Node node;
 	COND_TYPE cond_op;
-	AST_Cond* cond;
 	EXPR_TYPE expr_op;
-	AST_Expr* expr;
-	AST_ParamList* param_list;
 }
 
 /* All tokens are prefixed with "TOK_" for external usage */
@@ -83,81 +77,94 @@
 %precedence    THEN
 %precedence    ELSE
 
-%type <block> block
-%type <const_decls> const_decls const_decls_list
-%type <var_decls> var_decls var_decls_list
-%type <proc_decls> proc_decls
-%type <param_decls> param_decls param_decls_list
-%type <stmt> stmt stmt_assign stmt_call stmt_begin stmts stmt_if stmt_while stmt_read stmt_write
+%type <index> block
+%type <range> const_decls const_decls_list var_decls var_decls_list param_decls param_decls_list
+%type <index> proc_decls stmts params params_list
+%type <node> stmt stmt_assign stmt_call stmt_begin stmt_if stmt_while stmt_read stmt_write
 %type <cond_op> cond_op
-%type <cond> cond
+%type <node> cond
 %type <expr_op> expr_op term_op
-%type <expr> expr raw_expr negated_expr term negated_term factor negated_factor
-%type <param_list> params params_list
+%type <node> expr raw_expr negated_expr term negated_term factor negated_factor
 
 %%
 
 program
 	: block "."
-		{ *program = $1; }
+		{ ast->program = $1; }
 	;
 
 block
 	: const_decls var_decls proc_decls stmt
-		{ $$ = AST_Block_create($1, $2, $3, $4); }
+		{
+			AST_Block block = {
+				.consts = $1,
+				.vars = $2,
+				.procs = AST_endList(ast, $3),
+				.stmt = $4
+			};
+			$$ = AST_addBlock(ast, &block);
+		}
 	;
 
 const_decls
 	: %empty
-		{ $$ = NULL; }
+		{ $$ = (AST_Range){0}; }
 	| "const" const_decls_list IDENT "=" NUMBER ";"
-		{ $$ = AST_ConstDecls_append($2, $3, $5); }
+		{ AST_addConst(ast, $3, $5); $$ = $2; ++$$.count; }
 	;
 
 const_decls_list
 	: %empty
-		{ $$ = NULL; }
+		{ $$ = (AST_Range){(uint32_t)ast->extra.count, 0}; }
 	| const_decls_list IDENT "=" NUMBER ","
-		{ $$ = AST_ConstDecls_append($1, $2, $4); }
+		{ AST_addConst(ast, $2, $4); $$ = $1; ++$$.count; }
 	;
 
 var_decls
 	: %empty
-		{ $$ = NULL; }
+		{ $$ = (AST_Range){0}; }
 	| VAR var_decls_list IDENT ";"
-		{ $$ = AST_VarDecls_append($2, $3); }
+		{ AST_addIdent(ast, $3); $$ = $2; ++$$.count; }
 	;
 
 var_decls_list
 	: %empty
-		{ $$ = NULL; }
+		{ $$ = (AST_Range){(uint32_t)ast->idents.count, 0}; }
 	| var_decls_list IDENT ","
-		{ $$ = AST_VarDecls_append($1, $2); }
+		{ AST_addIdent(ast, $2); $$ = $1; ++$$.count; }
 	;
 
 proc_decls
 	: %empty
-		{ $$ = NULL; }
+		{ $$ = AST_beginList(ast); }
 	| proc_decls "procedure" IDENT "(" param_decls ")" ";" block ";"
-		{ $$ = AST_ProcDecls_append($1, $3, $5, $8); }
+		{
+			AST_Proc proc = {
+				.ident = AST_addIdent(ast, $3),
+				.params = $5,
+				.body = $8
+			};
+			AST_listAppend(ast, AST_addProc(ast, &proc));
+			$$ = $1;
+		}
 	;
 
 param_decls
 	: %empty
-		{ $$ = NULL; }
+		{ $$ = (AST_Range){0}; }
 	| param_decls_list
 		{ $$ = $1; }
 	;
 
 param_decls_list
 	: IDENT
-		{ $$ = AST_ParamDecls_append(NULL, $1); }
+		{ $$ = (AST_Range){AST_addIdent(ast, $1), 1}; }
 	| param_decls_list "," IDENT
-		{ $$ = AST_ParamDecls_append($1, $3); }
+		{ AST_addIdent(ast, $3); $$ = $1; ++$$.count; }
 	;
 
 stmt
-	: %empty      { $$ = NULL; }
+	: %empty      { $$ = AST_NONE; }
 	| stmt_assign { $$ = $1; }
 	| stmt_call   { $$ = $1; }
 	| stmt_begin  { $$ = $1; }
@@ -169,48 +176,48 @@ stmt
 
 stmt_assign
 	: IDENT ":=" expr
-		{ $$ = AST_Stmt_create(STMT_ASSIGN, $1, $3); }
+		{ $$ = AST_addNode(ast, STMT_ASSIGN, AST_addIdent(ast, $1), $3); }
 	;
 
 stmt_call
 	: "call" IDENT
-		{ $$ = AST_Stmt_create(STMT_CALL, $2, NULL); }
+		{ $$ = AST_addNode(ast, STMT_CALL, AST_addIdent(ast, $2), AST_NONE); }
 	| "call" IDENT "(" params ")"
-		{ $$ = AST_Stmt_create(STMT_CALL, $2, $4); }
+		{ $$ = AST_addNode(ast, STMT_CALL, AST_addIdent(ast, $2), $4); }
 	;
 
 stmt_begin
 	: "begin" stmts "end"
-		{ $$ = $2; }
+		{ $$ = AST_addBegin(ast, $2); }
 	;
 
 stmts
 	: stmt
-		{ $$ = AST_Stmt_append(NULL, $1); }
+		{ $$ = AST_beginList(ast); if($1 != AST_NONE) AST_listAppend(ast, $1); }
 	| stmts ";" stmt
-		{ $$ = AST_Stmt_append($1, $3); }
+		{ if($3 != AST_NONE) AST_listAppend(ast, $3); $$ = $1; }
 	;
 
 stmt_if
 	: "if" cond "then" stmt
-		{ $$ = AST_Stmt_create(STMT_IF, $2, $4, NULL); }
+		{ $$ = AST_addNode(ast, STMT_IF, $2, AST_addPair(ast, $4, AST_NONE)); }
 	| "if" cond "then" stmt "else" stmt
-		{ $$ = AST_Stmt_create(STMT_IF, $2, $4, $6); }
+		{ $$ = AST_addNode(ast, STMT_IF, $2, AST_addPair(ast, $4, $6)); }
 	;
 
 stmt_while
 	: "while" cond "do" stmt
-		{ $$ = AST_Stmt_create(STMT_WHILE, $2, $4); }
+		{ $$ = AST_addNode(ast, STMT_WHILE, $2, $4); }
 	;
 
 stmt_read
 	: "read" IDENT
-		{ $$ = AST_Stmt_create(STMT_READ, $2); }
+		{ $$ = AST_addNode(ast, STMT_READ, AST_addIdent(ast, $2), AST_NONE); }
 	;
 
 stmt_write
 	: "write" expr
-		{ $$ = AST_Stmt_create(STMT_WRITE, $2); }
+		{ $$ = AST_addNode(ast, STMT_WRITE, $2, AST_NONE); }
 	;
 
 cond_op
@@ -224,9 +231,9 @@ cond_op
 
 cond
 	: "odd" expr
-		{ $$ = AST_Cond_create(COND_ODD, $2); }
+		{ $$ = AST_addNode(ast, COND_ODD, $2, AST_NONE); }
 	| expr cond_op expr
-		{ $$ = AST_Cond_create($2, $1, $3); }
+		{ $$ = AST_addNode(ast, $2, $1, $3); }
 	;
 
 expr
@@ -247,14 +254,14 @@ raw_expr
 	: term
 		{ $$ = $1; }
 	| term expr_op raw_expr
-		{ $$ = AST_Expr_create($2, $1, $3); }
+		{ $$ = AST_addNode(ast, $2, $1, $3); }
 	;
 
 negated_expr
 	: negated_term
 		{ $$ = $1; }
 	| negated_term expr_op raw_expr
-		{ $$ = AST_Expr_create($2, $1, $3); }
+		{ $$ = AST_addNode(ast, $2, $1, $3); }
 	;
 
 term_op
@@ -267,54 +274,54 @@ term
 	: factor
 		{ $$ = $1; }
 	| factor term_op term
-		{ $$ = AST_Expr_create($2, $1, $3); }
+		{ $$ = AST_addNode(ast, $2, $1, $3); }
 	;
 
 negated_term
 	: negated_factor
 		{ $$ = $1; }
 	| negated_factor term_op term
-		{ $$ = AST_Expr_create($2, $1, $3); }
+		{ $$ = AST_addNode(ast, $2, $1, $3); }
 	;
 
 factor
 	: IDENT
-		{ $$ = AST_Expr_create(EXPR_VAR, $1); }
+		{ $$ = AST_addNode(ast, EXPR_VAR, AST_addIdent(ast, $1), AST_NONE); }
 	| NUMBER
-		{ $$ = AST_Expr_create(EXPR_NUM, $1); }
+		{ $$ = AST_addNode(ast, EXPR_NUM, (uint32_t)$1, AST_NONE); }
 	| "(" expr ")"
 		{ $$ = $2; }
 	| "call" IDENT
-		{ $$ = AST_Expr_create(EXPR_CALL, $2, NULL); }
+		{ $$ = AST_addNode(ast, EXPR_CALL, AST_addIdent(ast, $2), AST_NONE); }
 	| "call" IDENT "(" params ")"
-		{ $$ = AST_Expr_create(EXPR_CALL, $2, $4); }
+		{ $$ = AST_addNode(ast, EXPR_CALL, AST_addIdent(ast, $2), $4); }
 	;
 
 negated_factor
 	: factor
-		{ $$ = AST_Expr_create(EXPR_NEG, $1); }
+		{ $$ = AST_addNode(ast, EXPR_NEG, $1, AST_NONE); }
 	;
 
 params
 	: %empty
-		{ $$ = NULL; }
+		{ $$ = AST_NONE; }
 	| params_list
-		{ $$ = $1; }
+		{ $$ = AST_endList(ast, $1); }
 	;
 
 params_list
 	: expr
-		{ $$ = AST_ParamList_append(AST_ParamList_new(), $1); }
+		{ $$ = AST_beginList(ast); AST_listAppend(ast, $1); }
 	| params_list "," expr
-		{ $$ = AST_ParamList_append($1, $3); }
+		{ AST_listAppend(ast, $3); $$ = $1; }
 	;
 
 %%
 
 #include <stdio.h>
 
-void yyerror(yyscan_t scanner, AST_Block** program, char const* msg) {
+void yyerror(yyscan_t scanner, AST* ast, char const* msg) {
 	(void)scanner;
-	(void)program;
+	(void)ast;
 	fprintf(stderr, "%s\n", msg);
 }
@@ -10,11 +10,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include "config.h"
+#include "intern.h"
+
+
+static bool TokenStream_readToken(TokenStream* self, Token* tok);
+static void TokenStream_refill(TokenStream* self);
 
 
 Destroyer(TokenStream) {
-	release(&self->token);
 	release(&self->lexer);
+	arena_destroy(&self->lexemes);
+	destroy(&self->error);
 }
 DEF(TokenStream);
 
@@ -30,24 +36,119 @@ TokenStream* TokenStream_initWithLexer(TokenStream* self, Lexer* lexer) {
 	if((self = TokenStream_init(self))) {
 		/* Hold a strong reference to the lexer */
 		self->lexer = retain(lexer);
+		
+		/* Tokens are scanned ahead of the parser, so don't print an error until the parser gets to it */
+		self->lexer->defer_errors = true;
 	}
 	
 	return self;
 }
 
+TokenStream* TokenStream_initWithTokens(TokenStream* self, const Token* tokens, size_t count) {
+	if((self = TokenStream_init(self))) {
+		self->tokens = tokens;
+		self->token_count = count;
+	}
+	
+	return self;
+}
+
+void TokenStream_seek(TokenStream* self, size_t index) {
+	ASSERT(self->tokens != NULL && index <= self->token_count);
+	
+	/* Drop any tokens that were already peeked */
+	self->count = 0;
+	self->failed = false;
+	self->token_index = index;
+	self->position = index;
+}
+
 bool TokenStream_peekToken(TokenStream* self, Token** tok) {
-	if(self->token != NULL) {
-		*tok = self->token;
-		return true;
+	if(!TokenStream_peekAhead(self, 0, tok)) {
+		return false;
+	}
+	
+	self->line_number = (*tok)->line_number;
+	return true;
+}
+
+bool TokenStream_peekAhead(TokenStream* self, size_t k, Token** tok) {
+	ASSERT(k < TOKEN_RING_SIZE);
+	
+	if(k >= self->count && !self->failed) {
+		TokenStream_refill(self);
+	}
+	
+	if(k >= self->count) {
+		/* Point at the error token, or at the last token read if nothing is left after it */
+		size_t last = self->count != 0 ? self->count - 1 : 0;
+		*tok = &self->ring[(self->head + last) & (TOKEN_RING_SIZE - 1)];
+		return false;
+	}
+	
+	*tok = &self->ring[(self->head + k) & (TOKEN_RING_SIZE - 1)];
+	if(self->failed && k == self->count - 1) {
+		/* The error wasn't printed when the token was read, since the parser hadn't gotten to it yet */
+		if(self->lexer != NULL) {
+			Lexer_reportError(self->lexer);
+		}
+		else if(self->error != NULL) {
+			printf("%s\n", self->error);
+			destroy(&self->error);
+		}
+		return false;
+	}
+	return true;
+}
+
+void TokenStream_consumeToken(TokenStream* self) {
+	if(self->count == 0) {
+		return;
 	}
 	
-	bool success = true;
+	self->head = (self->head + 1) & (TOKEN_RING_SIZE - 1);
+	--self->count;
+	++self->position;
+	
+	if(self->count == 0) {
+		/* Consumed the error token, so the next peek tries reading again */
+		self->failed = false;
+	}
+}
+
+static void TokenStream_refill(TokenStream* self) {
+	/* Read tokens into every free slot, stopping early at the end of the program */
+	while(self->count < TOKEN_RING_SIZE) {
+		Token* tok = &self->ring[(self->head + self->count) & (TOKEN_RING_SIZE - 1)];
+		++self->count;
+		if(!TokenStream_readToken(self, tok)) {
+			/* Leave an error token in place of the token that couldn't be read */
+			self->failed = true;
+			return;
+		}
+		
+		/* Reading past the end would fail, but that error shouldn't happen unless the parser asks for it */
+		if(tok->type == nulsym) {
+			return;
+		}
+	}
+}
+
+static bool TokenStream_readToken(TokenStream* self, Token* tok) {
 	const char* errorLexeme = "ERROR";
-	*tok = NULL;
 	
 	if(self->lexer != NULL) {
 		/* Need to get the next token from the lexer */
-		self->token = Lexer_nextToken(self->lexer);
+		if(Lexer_nextToken(self->lexer, tok)) {
+			return true;
+		}
+	}
+	else if(self->tokens != NULL) {
+		/* Take the next token that was already scanned */
+		if(self->token_index < self->token_count) {
+			*tok = self->tokens[self->token_index++];
+			return true;
+		}
 	}
 	else {
 		/* Need to read a token from the tokenlist file */
@@ -57,7 +158,6 @@ bool TokenStream_peekToken(TokenStream* self, Token** tok) {
 		/* Read in the token type and its lexeme */
 		int val;
 		if(fscanf(self->fin, "%d", &val) != 1) {
-			success = false;
 			errorLexeme = "BAD_INPUT";
 			goto out;
 		}
@@ -69,70 +169,34 @@ bool TokenStream_peekToken(TokenStream* self, Token** tok) {
 			case numbersym:
 				/* Read the lexeme (max 11 chars) */
 				if(fscanf(self->fin, "%11s", lexeme) != 1) {
-					success = false;
 					errorLexeme = "BAD_LITERAL";
 					goto out;
 				}
-				break;
 				
-			case plussym:      strcpy(lexeme, "+");     break;
-			case minussym:     strcpy(lexeme, "-");     break;
-			case multsym:      strcpy(lexeme, "*");     break;
-			case slashsym:     strcpy(lexeme, "/");     break;
-			case oddsym:       strcpy(lexeme, "odd");   break;
-			case eqsym:        strcpy(lexeme, "=");     break;
-			case neqsym:       strcpy(lexeme, "<>");    break;
-			case lessym:       strcpy(lexeme, "<");     break;
-			case leqsym:       strcpy(lexeme, "<=");    break;
-			case gtrsym:       strcpy(lexeme, ">");     break;
-			case geqsym:       strcpy(lexeme, ">=");    break;
-			case lparentsym:   strcpy(lexeme, "(");     break;
-			case rparentsym:   strcpy(lexeme, ")");     break;
-			case commasym:     strcpy(lexeme, ",");     break;
-			case semicolonsym: strcpy(lexeme, ";");     break;
-			case periodsym:    strcpy(lexeme, ".");     break;
-			case becomessym:   strcpy(lexeme, ":=");    break;
-			case beginsym:     strcpy(lexeme, "begin"); break;
-			case endsym:       strcpy(lexeme, "end");   break;
-			case ifsym:        strcpy(lexeme, "if");    break;
-			case thensym:      strcpy(lexeme, "then");  break;
-			case whilesym:     strcpy(lexeme, "while"); break;
-			case dosym:        strcpy(lexeme, "do");    break;
-			case callsym:      strcpy(lexeme, "call");  break;
-			case constsym:     strcpy(lexeme, "const"); break;
-			case varsym:       strcpy(lexeme, "var");   break;
-			case procsym:      strcpy(lexeme, "proc");  break;
-			case writesym:     strcpy(lexeme, "write"); break;
-			case readsym:      strcpy(lexeme, "read");  break;
-			case elsesym:      strcpy(lexeme, "else");  break;
+				/* Line number set to zero since it's not known */
+				if(type == identsym) {
+					*tok = Token_make(type, slice_fromCString(intern_cstr(lexeme)), 0);
+				}
+				else {
+					*tok = Token_make(type, arena_copySlice(&self->lexemes, slice_fromCString(lexeme)), 0);
+				}
+				return true;
 			
 			default:
-				printf("Invalid token type: %d\n", type);
-				success = false;
-				errorLexeme = "BAD_TYPE";
-				goto out;
+				if(type == nulsym || token_spelling(type) == NULL) {
+					self->error = rsprintf_ff("Invalid token type: %d", type);
+					errorLexeme = "BAD_TYPE";
+					goto out;
+				}
+				
+				*tok = Token_make(type, slice_fromCString(token_spelling(type)), 0);
+				return true;
 		}
-		
-		/* Make sure the lexeme is NULL-terminated */
-		lexeme[sizeof(lexeme) - 1] = '\0';
-		
-		/* Create and return token (line number set to zero since it's not known) */
-		self->token = Token_initWithType(Token_alloc(), type, lexeme, 0);
 	}
 	
 out:
-	self->line_number = self->token->line_number;
-	if(!self->token) {
-		success = false;
-		self->token = Token_initWithType(Token_alloc(), nulsym, errorLexeme, self->line_number);
-	}
-	
-	*tok = self->token;
-	return success;
-}
-
-void TokenStream_consumeToken(TokenStream* self) {
-	release(&self->token);
+	*tok = Token_make(nulsym, slice_fromCString(errorLexeme), self->line_number);
+	return false;
 }
 
 #if WITH_BISON
@@ -147,11 +211,11 @@ int yylex(YYSTYPE* lvalp, yyscan_t scanner) {
 	int ret = tok->type;
 	switch(tok->type) {
 		case identsym:
-			lvalp->ident = strdup_ff(tok->lexeme);
+			lvalp->ident = tok->lexeme.text;
 			break;
 		
 		case numbersym:
-			lvalp->num = (Word)strtoul(tok->lexeme, NULL, 10);
+			lvalp->num = (Word)slice_toULong(tok->lexeme);
 			break;
 		
 		case nulsym:
@@ -163,7 +227,7 @@ int yylex(YYSTYPE* lvalp, yyscan_t scanner) {
 			break;
 	}
 	
-	/* Release tok */
+	/* Done with tok */
 	TokenStream_consumeToken(scanner);
 	return ret;
 }
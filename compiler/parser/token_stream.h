@@ -16,23 +16,58 @@ typedef struct TokenStream TokenStream;
 
 #include "object.h"
 #include "token.h"
+#include "arena.h"
 #include "lexer/lexer.h"
 
+/*! Number of tokens that the ring buffer can hold (must be a power of 2). This is also the
+ most tokens that can be peeked ahead at once
+ */
+#define TOKEN_RING_SIZE 128
+
 
 struct TokenStream {
 	OBJECT_BASE;
 	
-	/*! The stream's current token */
-	Token* token;
+	/*! Ring buffer of tokens that have been read but not yet consumed */
+	Token ring[TOKEN_RING_SIZE];
+	
+	/*! Index in the ring of the current token */
+	size_t head;
+	
+	/*! Number of tokens in the ring, which is refilled all at once when the parser peeks past them */
+	size_t count;
+	
+	/*! Whether the last token in the ring is an error token left in place of a token that couldn't be read */
+	bool failed;
 	
 	/*! File stream to read tokens from */
 	FILE* fin;
 	
+	/*! Storage for the lexemes of tokens read from fin */
+	Arena lexemes;
+	
+	/*! Error from reading fin to print once the parser gets to the error token, or NULL */
+	char* error;
+	
 	/*! Lexer to read tokens from */
 	Lexer* lexer;
 	
+	/*! Tokens that were already scanned, or NULL */
+	const Token* tokens;
+	
+	/*! Number of tokens in the tokens array */
+	size_t token_count;
+	
+	/*! Index of the next token to read from the tokens array */
+	size_t token_index;
+	
 	/*! Current line number */
 	size_t line_number;
+	
+	/*! Number of tokens consumed so far, which is also the index of the current token when
+	 reading from a tokens array
+	 */
+	size_t position;
 };
 DECL(TokenStream);
 
@@ -47,13 +82,31 @@ TokenStream* TokenStream_initWithFile(TokenStream* self, FILE* fin);
  */
 TokenStream* TokenStream_initWithLexer(TokenStream* self, Lexer* lexer);
 
+/*! Initializes a TokenStream object to read tokens that were already scanned
+ @param tokens Array of tokens ending with nulsym, which must outlive the stream
+ @param count Number of tokens in the array
+ */
+TokenStream* TokenStream_initWithTokens(TokenStream* self, const Token* tokens, size_t count);
+
+/*! Move to a different token of a stream that reads tokens that were already scanned
+ @param index Index in the tokens array of the token that should be read next
+ */
+void TokenStream_seek(TokenStream* self, size_t index);
+
 /*! Get a pointer to the current token being read from the stream
- @param tok Out pointer to the token to read
+ @param tok Out pointer to the token to read, which stays valid until the token is consumed
  @return True on success, or false on error
  */
 bool TokenStream_peekToken(TokenStream* self, Token** tok);
 
-/*! Consumes the current token and releases the stream's reference to it */
+/*! Get a pointer to a token after the current one without consuming anything
+ @param k How many tokens past the current token to look, which must be less than TOKEN_RING_SIZE
+ @param tok Out pointer to the token, which stays valid until it is consumed
+ @return True on success, or false if that token or one before it couldn't be read
+ */
+bool TokenStream_peekAhead(TokenStream* self, size_t k, Token** tok);
+
+/*! Consumes the current token so that the next one can be peeked */
 void TokenStream_consumeToken(TokenStream* self);
 
 #if WITH_BISON
@@ -13,67 +13,183 @@
 #include "ast_nodes.h"
 #include "ast_graph.h"
 #include "lexer/pl0lex.h"
+#include "lexer/tokenlist.h"
 
 
 Destroyer(CompilerFiles) {
-	fclose(self->tokenlist);
-	fclose(self->symtab);
-	fclose(self->mcode);
-	fclose(self->ast);
+	fclose_opt(self->tokenlist);
+	fclose_opt(self->tokenbin);
+	fclose_opt(self->symtab);
+	fclose_opt(self->mcode);
+	fclose_opt(self->ast);
 #if DEBUG
-	fclose(self->unoptimized_cfg);
+	fclose_opt(self->unoptimized_cfg);
 #endif
-	fclose(self->cfg);
+	fclose_opt(self->cfg);
+	fclose_opt(self->blockmap);
+	release(&self->profile);
 }
 DEF(CompilerFiles);
 
 
-int run_compiler(CompilerFiles* files, PARSER_TYPE parserType, CODEGEN_TYPE codegenType) {
-	int err = EXIT_SUCCESS;
+/* Parse the program from the parser's tokens, then generate its code */
+static int compileProgram(CompilerFiles* files, Parser* parser, CODEGEN_TYPE codegenType, InsnArray* code);
+
+/* Write out everything that was asked for from a code generator that succeeded */
+static int writeOutputs(CompilerFiles* files, Codegen* codegen, InsnArray* code);
+
+/* Scan every token of the source up front, returning false if the lexer hit an error */
+static bool scanAllTokens(Lexer* lexer, TokenArray* tokens);
+
+
+int run_compiler(CompilerFiles* files, LEXER_TYPE lexerType, PARSER_TYPE parserType, CODEGEN_TYPE codegenType) {
+	if(files->tokenbin != NULL) {
+		/* Load the tokens that the lexer already scanned rather than scanning the source again */
+		TokenArray tokens = {0};
+		int err = EXIT_FAILURE;
+		if(tokenlist_read(files->tokenbin, &tokens)) {
+			err = run_compiler_withTokens(files, tokens.elems, tokens.count, parserType, codegenType, NULL);
+		}
+		
+		array_clear(&tokens);
+		return err;
+	}
 	
 	/* Allocate and initialize PL/0 parser object */
 	FILE* input_fp = fopen_ff("input.txt", "r");
-	Lexer* lexer = PL0Lexer_initWithFile(Lexer_alloc(), input_fp);
+	Lexer* lexer = PL0Lexer_initWithFile(Lexer_alloc(), input_fp, lexerType);
+	if(parserType == PARSER_PARALLEL) {
+		/* Procedures can only be split up between threads once all of their tokens are known */
+		TokenArray tokens = {0};
+		int err = EXIT_FAILURE;
+		bool scanned = scanAllTokens(lexer, &tokens);
+		if(scanned) {
+			err = run_compiler_withTokens(files, tokens.elems, tokens.count, parserType, codegenType, NULL);
+		}
+		
+		array_clear(&tokens);
+		release(&lexer);
+		if(scanned) {
+			fclose(input_fp);
+			return err;
+		}
+		
+		/* Scan again while parsing so that the lexer error shows up after any syntax errors before it */
+		rewind(input_fp);
+		lexer = PL0Lexer_initWithFile(Lexer_alloc(), input_fp, lexerType);
+		parserType = PARSER_RDP;
+	}
+	
 	Parser* parser = Parser_initWithLexer(Parser_alloc(), lexer, parserType);
 	
+	int err = compileProgram(files, parser, codegenType, NULL);
+	
+	/* Clean up resources */
+	release(&parser);
+	fclose(input_fp);
+	return err;
+}
+
+int run_compiler_withTokens(CompilerFiles* files, const Token* tokens, size_t count,
+                            PARSER_TYPE parserType, CODEGEN_TYPE codegenType, InsnArray* code) {
+	Parser* parser = Parser_initWithTokens(Parser_alloc(), tokens, count, parserType);
+	int err = compileProgram(files, parser, codegenType, code);
+	release(&parser);
+	return err;
+}
+
+static int compileProgram(CompilerFiles* files, Parser* parser, CODEGEN_TYPE codegenType, InsnArray* code) {
 	/* Parse program */
-	AST_Block* prog = NULL;
+	AST* prog = NULL;
 	bool noSyntaxErrors = Parser_parseProgram(parser, &prog);
+	
+	int err = EXIT_FAILURE;
 	if(!noSyntaxErrors) {
 		printf("Stopping due to an earlier parsing error\n");
-		err = EXIT_FAILURE;
 	}
 	else {
-		/* Parser completed without syntax errors, now output AST graph */
+		/* Parser completed without syntax errors, so generate code from the AST */
+		err = run_compiler_withAST(files, prog, codegenType, code);
+	}
+	
+	release(&prog);
+	return err;
+}
+
+int run_compiler_withAST(CompilerFiles* files, AST* prog, CODEGEN_TYPE codegenType, InsnArray* code) {
+	/* Output AST graph */
+	if(files->ast != NULL) {
 		Graphviz* gv = Graphviz_initWithFile(Graphviz_alloc(), files->ast, "AST");
-		AST_Block_drawGraph(prog, gv);
+		AST_drawGraph(prog, gv);
 		release(&gv);
-		
-		/* Generate code using the parsed AST of the program */
-		Codegen* codegen = Codegen_initWithAST(Codegen_alloc(), prog, codegenType);
-		if(codegen == NULL) {
-			printf("Stopping due to an earlier codegen error\n");
+	}
+	
+	/* Generate code using the parsed AST of the program */
+	Codegen* codegen = Codegen_initWithAST(Codegen_alloc(), prog, codegenType, files->profile);
+	if(codegen == NULL) {
+		printf("Stopping due to an earlier codegen error\n");
+		return EXIT_FAILURE;
+	}
+	
+	int err = writeOutputs(files, codegen, code);
+	release(&codegen);
+	return err;
+}
+
+static bool scanAllTokens(Lexer* lexer, TokenArray* tokens) {
+	/* Hold on to the error for now, since a sequential parse might stop at a syntax error first */
+	lexer->defer_errors = true;
+	
+	Token tok;
+	do {
+		if(!Lexer_nextToken(lexer, &tok)) {
+			return false;
+		}
+		array_append(tokens, tok);
+	} while(tok.type != nulsym);
+	
+	return true;
+}
+
+static int writeOutputs(CompilerFiles* files, Codegen* codegen, InsnArray* code) {
+	int err = EXIT_SUCCESS;
+	
+	/* Perform optimizations and layout code again, then draw optimized code flow graph */
+	if(files->cfg != NULL) {
+		Codegen_drawGraph(codegen, files->cfg);
+	}
+	
+	/* Produce the machine code to be executed by the vm and finish the symbol table */
+	if(code != NULL) {
+		/* Hand the code to the caller, writing the same instructions to the file if wanted */
+		if(!Codegen_emitInsns(codegen, code)) {
+			printf("This code generator can't pass its code directly to the VM\n");
 			err = EXIT_FAILURE;
 		}
-		else {
-			/* Perform optimizations and layout code again, then draw optimized code flow graph */
-			Codegen_drawGraph(codegen, files->cfg);
-			
-			/* Produce the machine code to be executed by the vm and finish the symbol table */
-			Codegen_emit(codegen, files->mcode);
+		else if(files->mcode != NULL) {
+			write_program(code->elems, code->count, files->mcode);
 			fflush(files->mcode);
-			
-			/* Produce the symbol "table" output */
-			Codegen_writeSymbolTable(codegen, files->symtab);
-			fflush(files->symtab);
 		}
-		
-		release(&codegen);
+	}
+	else if(files->mcode != NULL) {
+		Codegen_emit(codegen, files->mcode);
+		fflush(files->mcode);
+	}
+	
+	/* Identify the basic blocks at each address of the code for a profile of the program */
+	if(err == EXIT_SUCCESS && files->blockmap != NULL) {
+		if(!Codegen_writeBlockMap(codegen, files->blockmap)) {
+			printf("This code generator can't write a block map for profiling\n");
+			err = EXIT_FAILURE;
+		}
+		fflush(files->blockmap);
+	}
+	
+	/* Produce the symbol "table" output */
+	if(files->symtab != NULL) {
+		Codegen_writeSymbolTable(codegen, files->symtab);
+		fflush(files->symtab);
 	}
 	
-	/* Clean up resources */
-	release(&prog);
-	release(&parser);
-	fclose(input_fp);
 	return err;
 }
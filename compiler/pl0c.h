@@ -14,11 +14,13 @@ typedef struct CompilerFiles CompilerFiles;
 #include "object.h"
 #include "compiler/parser/parser.h"
 #include "compiler/codegen/codegen.h"
+#include "lexer/pl0lex.h"
 
 struct CompilerFiles {
 	OBJECT_BASE;
 	
 	FILE* tokenlist;
+	FILE* tokenbin;
 	FILE* symtab;
 	FILE* mcode;
 	FILE* ast;
@@ -26,17 +28,46 @@ struct CompilerFiles {
 	FILE* unoptimized_cfg;
 #endif
 	FILE* cfg;
+	FILE* blockmap;
+	
+	/*! Profile of an earlier compilation of the program used to guide optimizations, or NULL */
+	Profile* profile;
 };
 DECL(CompilerFiles);
 
 
 /*! Run the lexer and compiler together to produce the PM/0 machine code
- @param files Open file streams used by the compiler
+ @param files Open file streams used by the compiler. Output streams may be NULL to skip writing them.
+              If tokenbin is set, tokens are loaded from that binary token list instead of being scanned
+ @param lexerType Which lexer engine to use
+ @param parserType Which parser to use
+ @param codegenType Which code generation engine to use
+ @return Zero on success, nonzero on error
+ */
+int run_compiler(CompilerFiles* files, LEXER_TYPE lexerType, PARSER_TYPE parserType, CODEGEN_TYPE codegenType);
+
+/*! Compile tokens that were already scanned into PM/0 machine code in memory
+ @param files Open file streams used by the compiler. Output streams may be NULL to skip writing them
+ @param tokens Array of tokens ending with nulsym
+ @param count Number of tokens in the array
  @param parserType Which parser to use
  @param codegenType Which code generation engine to use
+ @param code Array where the PM/0 machine code is appended so it can be run without
+             reading it back from a file, or NULL to only write it to files->mcode
+ @return Zero on success, nonzero on error
+ */
+int run_compiler_withTokens(CompilerFiles* files, const Token* tokens, size_t count,
+                            PARSER_TYPE parserType, CODEGEN_TYPE codegenType, InsnArray* code);
+
+/*! Generate PM/0 machine code for a program that was already parsed
+ @param files Open file streams used by the compiler. Output streams may be NULL to skip writing them,
+              and tokenlist/tokenbin aren't used
+ @param prog AST of the whole program
+ @param codegenType Which code generation engine to use
+ @param code Array where the PM/0 machine code is appended, or NULL to only write it to files->mcode
  @return Zero on success, nonzero on error
  */
-int run_compiler(CompilerFiles* files, PARSER_TYPE parserType, CODEGEN_TYPE codegenType);
+int run_compiler_withAST(CompilerFiles* files, AST* prog, CODEGEN_TYPE codegenType, InsnArray* code);
 
 
 #endif /* PL0_PL0C_H */
@@ -103,10 +103,9 @@ static inline void _expand_size_array(void** parr, size_t elem_size, void* pcap,
 	if(!_array_extend_src || _array_extend_srccount == 0) { \
 		break; \
 	} \
-	size_t _array_extend_dstsize = _array_extend_parr->count * sizeof(*_array_extend_parr->elems); \
 	size_t _array_extend_srcsize = _array_extend_srccount * sizeof(*_array_extend_src); \
-	size_t _array_extend_newsize = _array_extend_dstsize + _array_extend_srcsize; \
-	while(_array_extend_parr->cap < _array_extend_newsize) { \
+	size_t _array_extend_newcount = _array_extend_parr->count + _array_extend_srccount; \
+	while(_array_extend_parr->cap < _array_extend_newcount) { \
 		array_expand(_array_extend_parr); \
 	} \
 	memcpy(_array_extend_parr->elems + _array_extend_parr->count, src, _array_extend_srcsize); \
@@ -156,6 +155,31 @@ static inline void _insert_index_array(
 	_array_removeRange_parr->count -= _array_removeRange_end - _array_removeRange_start; \
 } while(0)
 
+/*! Helper macro to replace an indexed range of a dynamic array with the elements of another array */
+#define array_splice(parr, start, end, src, srccount) do { \
+	__typeof__(parr) _array_splice_parr = (parr); \
+	size_t _array_splice_start = (start); \
+	size_t _array_splice_end = (end); \
+	size_t _array_splice_srccount = (srccount); \
+	ASSERT(_array_splice_start <= _array_splice_end && _array_splice_end <= _array_splice_parr->count); \
+	size_t _array_splice_newcount = ( \
+		_array_splice_parr->count - (_array_splice_end - _array_splice_start) + _array_splice_srccount \
+	); \
+	while(_array_splice_parr->cap < _array_splice_newcount) { \
+		array_expand(_array_splice_parr); \
+	} \
+	memmove( \
+		&_array_splice_parr->elems[_array_splice_start + _array_splice_srccount], \
+		&_array_splice_parr->elems[_array_splice_end], \
+		(_array_splice_parr->count - _array_splice_end) * sizeof(*_array_splice_parr->elems) \
+	); \
+	if(_array_splice_srccount != 0) { \
+		memcpy(&_array_splice_parr->elems[_array_splice_start], (src), \
+			_array_splice_srccount * sizeof(*_array_splice_parr->elems)); \
+	} \
+	_array_splice_parr->count = _array_splice_newcount; \
+} while(0)
+
 /*! Helper macro for removing an element from a dynamic array by its pointer */
 #define array_removeElement(parr, pelem) do { \
 	__typeof__(parr) _array_removeElement_parr = (parr); \
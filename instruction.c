@@ -35,6 +35,13 @@ void Insn_emit(Insn insn, FILE* fp) {
 	fprintf(fp, "%hu %hu %"PRIdWORD"\n", insn.op, insn.lvl, insn.imm);
 }
 
+/* Write an entire PM/0 program to a text file */
+void write_program(const Insn* code, size_t count, FILE* fp) {
+	for(size_t i = 0; i < count; i++) {
+		Insn_emit(code[i], fp);
+	}
+}
+
 /* Read an entire PM/0 program from the text file into the code array given */
 int read_program(Insn* code, Word maxcount, FILE* fp) {
 	Insn* cur = code;
@@ -114,6 +121,7 @@ const char* Insn_getMnemonic(Insn insn) {
 				case ALU_LEQ: return "LEQ";
 				case ALU_GTR: return "GTR";
 				case ALU_GEQ: return "GEQ";
+				case ALU_DUP: return "DUP";
 				default: return "OPR ?";
 			}
 			
@@ -156,6 +164,7 @@ static const char* Insn_getPrettyMnemonic(Insn insn) {
 				case ALU_LEQ: return "<font color=\"" COND_COLOR "\">LEQ</font>  ";
 				case ALU_GTR: return "<font color=\"" COND_COLOR "\">GTR</font>  ";
 				case ALU_GEQ: return "<font color=\"" COND_COLOR "\">GEQ</font>  ";
+				case ALU_DUP: return "<font color=\"" ARITH_COLOR "\">DUP</font>  ";
 				default: return "<font color=\"" ERR_COLOR "\">OPR ?</font>";
 			}
 			
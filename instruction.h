@@ -17,6 +17,7 @@
 typedef struct Insn Insn;
 
 #include "config.h"
+#include "object.h"
 
 /* Not using an enum so I can specify the underlying type */
 typedef uint16_t Opcode;
@@ -47,7 +48,8 @@ typedef uint16_t Opcode;
 #define ALU_LEQ    11
 #define ALU_GTR    12
 #define ALU_GEQ    13
-#define ALU_COUNT  (ALU_GEQ + 1)
+#define ALU_DUP    14   /* Pushes another copy of the value on top of the stack */
+#define ALU_COUNT  (ALU_DUP + 1)
 
 
 /*! Defines the format of a PM/0 instruction (64-bits) */
@@ -57,6 +59,9 @@ struct Insn {
 	Word imm;          /*!< Immediate operand (M) */
 };
 
+/*! Growable array of instructions, used to hand a program from the compiler to the VM */
+typedef dynamic_array(Insn) InsnArray;
+
 /* Pseudoinstruction used as a breakpoint */
 #define IS_BREAK(insn)  ((insn).op == OP_BREAK && (insn).lvl != 0)
 #define MAKE_BREAK(id)  ((Insn){OP_BREAK, 1, (id)})
@@ -88,6 +93,7 @@ struct Insn {
 #define MAKE_LEQ()      MAKE_OPR(ALU_LEQ)
 #define MAKE_GTR()      MAKE_OPR(ALU_GTR)
 #define MAKE_GEQ()      MAKE_OPR(ALU_GEQ)
+#define MAKE_DUP()      MAKE_OPR(ALU_DUP)
 
 /* Inverts a conditional instruction (excluding ODD) */
 #define MAKE_INV(cond) \
@@ -137,6 +143,13 @@ void Insn_emit(Insn insn, FILE* fp);
 #define EMIT_INV(cond, fp)  EMIT(MAKE_INV(cond), fp)
 
 
+/*! Write an entire PM/0 program to a text file, one instruction per line
+ @param code Array of instructions
+ @param count Number of instructions in @p code
+ @param fp Output file to write instructions to
+ */
+void write_program(const Insn* code, size_t count, FILE* fp);
+
 /*! Read an entire PM/0 program from the text file into the code array given
  @param code Output array of instructions
  @param maxcount Number of instructions allowed to write into @p code
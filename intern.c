@@ -0,0 +1,100 @@
+//
+//  intern.c
+//  PL/0
+//
+
+#include "intern.h"
+#include <stdint.h>
+#include "arena.h"
+#include "macros.h"
+
+
+/* Initial number of slots in the hash table, must be a power of 2 */
+#define INTERN_INITIAL_CAPACITY 256
+
+typedef struct InternSlot {
+	/*! Interned string, or NULL if the slot is empty */
+	const char* str;
+	
+	/*! Length of the interned string */
+	size_t length;
+	
+	/*! Cached hash of the interned string */
+	uint32_t hash;
+} InternSlot;
+
+/*! Open-addressed hash table of every interned string. The strings themselves are
+ stored in an arena that is never freed, as interned strings live for the whole process.
+ */
+static struct {
+	InternSlot* slots;
+	size_t capacity;
+	size_t count;
+	Arena strings;
+} g_table;
+
+
+/*! Hash a string using 32-bit FNV-1a */
+static uint32_t intern_hash(Slice str);
+
+/*! Double the size of the hash table and rehash all of its entries */
+static void intern_grow(void);
+
+
+static uint32_t intern_hash(Slice str) {
+	uint32_t hash = 2166136261u;
+	for(size_t i = 0; i < str.length; i++) {
+		hash ^= (unsigned char)str.text[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void intern_grow(void) {
+	size_t new_capacity = g_table.capacity ? g_table.capacity * 2 : INTERN_INITIAL_CAPACITY;
+	InternSlot* new_slots = calloc_ff(new_capacity, sizeof(*new_slots));
+	
+	/* Move every entry into its position in the new table */
+	for(size_t i = 0; i < g_table.capacity; i++) {
+		InternSlot* slot = &g_table.slots[i];
+		if(slot->str == NULL) {
+			continue;
+		}
+		
+		size_t idx = slot->hash & (new_capacity - 1);
+		while(new_slots[idx].str != NULL) {
+			idx = (idx + 1) & (new_capacity - 1);
+		}
+		new_slots[idx] = *slot;
+	}
+	
+	free(g_table.slots);
+	g_table.slots = new_slots;
+	g_table.capacity = new_capacity;
+}
+
+const char* intern_slice(Slice str) {
+	/* Keep the load factor at or below one half */
+	if((g_table.count + 1) * 2 > g_table.capacity) {
+		intern_grow();
+	}
+	
+	/* Linear probe until either the string or an empty slot is found */
+	uint32_t hash = intern_hash(str);
+	size_t idx = hash & (g_table.capacity - 1);
+	while(g_table.slots[idx].str != NULL) {
+		InternSlot* slot = &g_table.slots[idx];
+		if(slot->hash == hash && slot->length == str.length && memcmp(slot->str, str.text, str.length) == 0) {
+			return slot->str;
+		}
+		idx = (idx + 1) & (g_table.capacity - 1);
+	}
+	
+	/* Not interned yet, so store a copy of it in the empty slot */
+	InternSlot* slot = &g_table.slots[idx];
+	slot->str = arena_copySlice(&g_table.strings, str).text;
+	slot->length = str.length;
+	slot->hash = hash;
+	g_table.count++;
+	return slot->str;
+}
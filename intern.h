@@ -0,0 +1,27 @@
+//
+//  intern.h
+//  PL/0
+//
+
+#ifndef PL0_INTERN_H
+#define PL0_INTERN_H
+
+#include "slice.h"
+
+/*! Look up the unique copy of a string in the process-wide string table, adding it if it's new.
+ Two interned strings hold the same characters exactly when they are the same pointer, so they
+ may be compared with == instead of strcmp.
+ @param str Characters of the string to intern
+ @return Null-terminated interned copy of the string, which lives until the process exits
+ */
+const char* intern_slice(Slice str);
+
+/*! Intern a null-terminated string
+ @param cstr String to intern
+ @return Null-terminated interned copy of the string, which lives until the process exits
+ */
+static inline const char* intern_cstr(const char* cstr) {
+	return intern_slice(slice_fromCString(cstr));
+}
+
+#endif /* PL0_INTERN_H */
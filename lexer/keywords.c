@@ -0,0 +1,48 @@
+//
+//  keywords.c
+//  PL/0
+//
+
+#include "keywords.h"
+#include <string.h>
+
+
+#define KEYWORD(word, type) {word, sizeof(word) - 1, type}
+
+const Keyword PL0_keywords[PL0_KEYWORD_COUNT] = {
+	KEYWORD("begin",     beginsym),
+	KEYWORD("call",      callsym),
+	KEYWORD("const",     constsym),
+	KEYWORD("do",        dosym),
+	KEYWORD("else",      elsesym),
+	KEYWORD("end",       endsym),
+	KEYWORD("if",        ifsym),
+	KEYWORD("odd",       oddsym),
+	KEYWORD("procedure", procsym),
+	KEYWORD("read",      readsym),
+	KEYWORD("then",      thensym),
+	KEYWORD("var",       varsym),
+	KEYWORD("while",     whilesym),
+	KEYWORD("write",     writesym),
+};
+
+
+token_type keyword_lookup(Slice lexeme) {
+	if(lexeme.length < KEYWORD_MIN_LENGTH || lexeme.length > KEYWORD_MAX_LENGTH) {
+		return identsym;
+	}
+	
+	const unsigned char* text = (const unsigned char*)lexeme.text;
+	uint8_t entry = PL0_keywordTable[KEYWORD_HASH(text, lexeme.length)];
+	if(entry == 0) {
+		return identsym;
+	}
+	
+	/* Exactly one reserved word could live in this slot, so one comparison decides it */
+	const Keyword* keyword = &PL0_keywords[entry - 1];
+	if(keyword->length == lexeme.length && memcmp(keyword->text, text, lexeme.length) == 0) {
+		return keyword->type;
+	}
+	
+	return identsym;
+}
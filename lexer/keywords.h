@@ -0,0 +1,55 @@
+//
+//  keywords.h
+//  PL/0
+//
+
+#ifndef PL0_KEYWORDS_H
+#define PL0_KEYWORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "token.h"
+#include "slice.h"
+
+/* Every reserved word is between 2 and 9 characters long */
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 9
+
+/* Number of slots in the hash table (must be a power of 2) */
+#define KEYWORD_TABLE_SIZE 32
+
+/* Perfect hash over the reserved words, computed from the length and three of the characters */
+#define KEYWORD_HASH(text, length) \
+	(((length) + (text)[0] + 2 * (text)[1] + (text)[(length) - 1]) & (KEYWORD_TABLE_SIZE - 1))
+
+/*! One of PL/0's reserved words */
+typedef struct Keyword {
+	/*! Text of the reserved word */
+	const char* text;
+	
+	/*! Number of characters in text */
+	size_t length;
+	
+	/*! Token type of the reserved word */
+	token_type type;
+} Keyword;
+
+/*! Number of entries in PL0_keywords */
+#define PL0_KEYWORD_COUNT 14
+
+/*! All of PL/0's reserved words */
+extern const Keyword PL0_keywords[PL0_KEYWORD_COUNT];
+
+/*! One plus the index in PL0_keywords of the reserved word that hashes to each slot, or zero if none
+ does. Generated by tools/lexgen, which fails the build if two reserved words share a slot.
+ */
+extern const uint8_t PL0_keywordTable[KEYWORD_TABLE_SIZE];
+
+/*! Classify a scanned identifier as either one of PL/0's reserved words or a plain identifier
+ @param lexeme Text of the identifier
+ @return Token type of the reserved word, or identsym if it isn't one
+ */
+token_type keyword_lookup(Slice lexeme);
+
+
+#endif /* PL0_KEYWORDS_H */
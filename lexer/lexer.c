@@ -12,17 +12,31 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include "intern.h"
+
+
+/* Shared setup for every kind of lexer */
+static Lexer* Lexer_initWithSource(Lexer* self, Source* source);
+
+/* Scan the next token by walking the lexer's FSM */
+static bool Lexer_nextTokenFSM(Lexer* self, Token* tok);
+
+/* Scan the next token by looking up transitions in the lexer's pregenerated tables */
+static bool Lexer_nextTokenTable(Lexer* self, Token* tok);
 
 
 Destroyer(Lexer) {
+	release(&self->source);
 	release(&self->fsm);
+	release(&self->parallel);
+	destroy(&self->error);
+	array_clear(&self->lexeme);
+	arena_destroy(&self->lexemes);
 }
 DEF(Lexer);
 
 Lexer* Lexer_initWithFile(Lexer* self, FILE* fin) {
-	if((self = Lexer_init(self))) {
-		self->line_number = 1;
-		self->stream = fin;
+	if((self = Lexer_initWithSource(self, Source_initWithFile(Source_alloc(), fin)))) {
 		self->fsm = State_new();
 		ASSERT(self->fsm != NULL);
 	}
@@ -30,6 +44,39 @@ Lexer* Lexer_initWithFile(Lexer* self, FILE* fin) {
 	return self;
 }
 
+Lexer* Lexer_initWithTable(Lexer* self, FILE* fin, const LexTable* table) {
+	if((self = Lexer_initWithSource(self, Source_initWithFile(Source_alloc(), fin)))) {
+		self->table = table;
+	}
+	
+	return self;
+}
+
+Lexer* Lexer_initWithBuffer(Lexer* self, const char* data, size_t length, const LexTable* table) {
+	if((self = Lexer_initWithSource(self, Source_initWithBuffer(Source_alloc(), data, length)))) {
+		self->table = table;
+	}
+	
+	return self;
+}
+
+static Lexer* Lexer_initWithSource(Lexer* self, Source* source) {
+	ASSERT(source != NULL);
+	if((self = Lexer_init(self))) {
+		self->line_number = 1;
+		self->thread_count = 1;
+		self->source = source;
+	}
+	
+	return self;
+}
+
+void Lexer_setParallel(Lexer* self, unsigned thread_count, Acceptor* comment_fn) {
+	ASSERT(self->table != NULL);
+	self->thread_count = thread_count > 0 ? thread_count : 1;
+	self->comment_fn = comment_fn;
+}
+
 static State* getState(State* cur, const char* prefix) {
 	/* Base case, token fully matched */
 	if(*prefix == '\0') {
@@ -67,6 +114,7 @@ static State* getState(State* cur, const char* prefix) {
 }
 
 State* Lexer_getState(Lexer* self, const char* prefix) {
+	ASSERT(self->fsm != NULL);
 	return getState(self->fsm, prefix);
 }
 
@@ -79,68 +127,247 @@ void Lexer_addToken(Lexer* self, const char* text, token_type type) {
 	weak_state->simple_type = type;
 }
 
+/* Start a new lexeme at the source's current position */
+static inline void Lexer_beginLexeme(Lexer* self) {
+	if(Source_isBuffered(self->source)) {
+		self->lexeme_start = self->source->pos;
+	}
+	else {
+		string_clear(&self->lexeme);
+	}
+}
+
+/* Record a character read from the source as part of the current lexeme */
+static inline void Lexer_extendLexeme(Lexer* self, int c) {
+	/* Buffered lexemes are slices of the source, so they grow along with the cursor */
+	if(!Source_isBuffered(self->source) && c != EOF) {
+		string_appendChar(&self->lexeme, c);
+	}
+}
+
+/* Give the most recently read character back to the source and drop it from the lexeme */
+static inline void Lexer_unreadChar(Lexer* self, int c) {
+	Source_ungetc(self->source, c);
+	if(!Source_isBuffered(self->source) && c != EOF) {
+		string_removeIndex(&self->lexeme, string_length(&self->lexeme) - 1);
+	}
+}
+
+/* Skip a run of whitespace in a buffered source before starting a token */
+static void Lexer_skipWhitespace(Lexer* self) {
+	Source* src = self->source;
+	const char* start = &src->data[src->pos];
+	size_t newlines = 0;
+	const char* p = scan_whitespace(start, &src->data[src->length], &newlines);
+	
+	/* The whitespace callback still gets to see every character that was skipped */
+	if(self->ws_cb != NULL) {
+		for(const char* ws = start; ws != p; ws++) {
+			self->ws_cb(self->cb_cookie, *ws);
+		}
+	}
+	
+	self->line_number += newlines;
+	src->pos += p - start;
+	Lexer_beginLexeme(self);
+}
+
+/* Skip a run of characters that all keep the lexer on a state with the given scan kind */
+static void Lexer_skipRun(Lexer* self, ScanKind scan) {
+	Source* src = self->source;
+	const char* p = &src->data[src->pos];
+	src->pos += scan_run(scan, p, &src->data[src->length]) - p;
+}
+
+/* Handle a character read at the initial state that has no transition from it
+ @return True if the character was whitespace, so the lexer should stay on the initial state
+ */
+static bool Lexer_skipSpace(Lexer* self, int c) {
+	if(!isspace(c)) {
+		return false;
+	}
+	
+	/* Discard lexeme */
+	Lexer_beginLexeme(self);
+	
+	/* Keep track of line numbers */
+	if(c == '\n') {
+		++self->line_number;
+	}
+	
+	/* Invoke whitespace callback when we encounter whitespace */
+	if(self->ws_cb != NULL) {
+		self->ws_cb(self->cb_cookie, c);
+	}
+	
+	return true;
+}
+
+/* Finish scanning a lexeme that ended on a state, producing a token if it was an acceptor state
+ @param c Lookahead character that had no transition from the final state
+ */
+static bool Lexer_finishToken(Lexer* self, Token* tok, int c, bool acceptor, Acceptor* acceptfn, token_type simple_type) {
+	/* Scanning of the current lexeme finished, so the current state should be an acceptor */
+	if(!acceptor) {
+		Slice lexeme = Lexer_getLexeme(self);
+		if(isspace(c)) {
+			/* Remove final space */
+			--lexeme.length;
+		}
+		
+		/* The current state isn't an acceptor state, so this is an error */
+		Lexer_syntaxError(self, "Unknown sequence: \"%"PRIslice"\"", SLICE_ARG(lexeme));
+		return false;
+	}
+	
+	/* Ended lexeme on an acceptor state, so a token was matched. Put back the lookahead */
+	Lexer_unreadChar(self, c);
+	
+	/* If the state has an acceptor function, call it */
+	if(acceptfn != NULL) {
+		return acceptfn(self, tok);
+	}
+	
+	/* State doesn't have an acceptor function, so it must be a simple acceptor */
+	return Lexer_makeToken(self, tok, simple_type);
+}
+
+/* Produce the nulsym token that marks the end of the file */
+static bool Lexer_finishEOF(Lexer* self, Token* tok) {
+	/* Return nulsym as an indicator of EOF, and only return false afterwards */
+	self->at_eof = true;
+	*tok = Token_make(nulsym, slice_fromCString(token_spelling(nulsym)), self->line_number);
+	return true;
+}
+
+Slice Lexer_getLexeme(Lexer* self) {
+	if(Source_isBuffered(self->source)) {
+		return Source_sliceFrom(self->source, self->lexeme_start);
+	}
+	
+	return SLICE(string_cstr(&self->lexeme), string_length(&self->lexeme));
+}
+
+bool Lexer_makeToken(Lexer* self, Token* tok, token_type type) {
+	Slice lexeme = Lexer_getLexeme(self);
+	
+	if(type == identsym && !self->speculative) {
+		/* Identifiers are interned so later stages can compare names by pointer. Speculative
+		 lexers leave that to the lexer replaying their tokens so the interner needs no locking.
+		 */
+		lexeme = SLICE(intern_slice(lexeme), lexeme.length);
+	}
+	else if(!Source_isBuffered(self->source)) {
+		/* The lexeme buffer is about to be reused, so the token needs its own copy */
+		const char* spelling = token_spelling(type);
+		if(spelling != NULL) {
+			lexeme = SLICE(spelling, lexeme.length);
+		}
+		else {
+			lexeme = arena_copySlice(&self->lexemes, lexeme);
+		}
+	}
+	
+	*tok = Token_make(type, lexeme, self->line_number);
+	return true;
+}
+
+void Lexer_syntaxError(Lexer* self, const char* fmt, ...) {
+	VARIADIC(fmt, ap, {
+		if(!self->speculative && !self->defer_errors) {
+			printf("Syntax Error on line %d: ", self->line_number);
+			vprintf(fmt, ap);
+			printf("\n");
+		}
+		else if(self->error == NULL) {
+			/* Keep the first error until the line numbers of this chunk are known, or until the reader gets to it */
+			self->error = vrsprintf_ff(fmt, ap);
+			self->error_line = self->line_number;
+		}
+	});
+}
+
+void Lexer_reportError(Lexer* self) {
+	if(self->error != NULL) {
+		printf("Syntax Error on line %d: %s\n", self->error_line, self->error);
+		destroy(&self->error);
+	}
+}
+
 void Lexer_setWhitespaceCallback(Lexer* self, WhitespaceCB* ws_cb, void* cookie) {
 	self->ws_cb = ws_cb;
 	self->cb_cookie = cookie;
 }
 
-Token* Lexer_nextToken(Lexer* self) {
-	/* After the lexer has returned a nulsym token, only return NULL afterwards */
+bool Lexer_nextToken(Lexer* self, Token* tok) {
+	/* After the lexer has returned a nulsym token, only return false afterwards */
 	if(self->at_eof) {
-		return NULL;
+		return false;
+	}
+	
+	if(self->thread_count > 1) {
+		/* Scan the whole source up front, now that the whitespace callback has been set */
+		if(Source_isBuffered(self->source)) {
+			self->parallel = ParLex_initWithLexer(ParLex_alloc(), self);
+		}
+		self->thread_count = 1;
 	}
 	
+	/* Replay tokens that were already scanned on several threads */
+	if(self->parallel != NULL) {
+		return ParLex_nextToken(self->parallel, self, tok);
+	}
+	
+	/* Reset the lexeme buffer */
+	Lexer_beginLexeme(self);
+	
+	if(self->table != NULL) {
+		return Lexer_nextTokenTable(self, tok);
+	}
+	return Lexer_nextTokenFSM(self, tok);
+}
+
+static bool Lexer_nextTokenFSM(Lexer* self, Token* tok) {
 	/* Start the machine at the initial state */
 	State* cur = NULL;
 	State* next = self->fsm;
 	
-	/* Reset the lexeme buffer */
-	string_clear(&self->lexeme);
-	
 	/* Keep reading characters until a complete token is scanned */
 	int c = ' ';
+	bool buffered = Source_isBuffered(self->source);
 	while(next != NULL) {
 		/* Advance current state */
 		cur = next;
 		
-		/* Read a character from the input stream */
-		c = getc(self->stream);
+		if(buffered) {
+			if(cur == self->fsm) {
+				/* Skip whitespace in bulk before a token starts */
+				Lexer_skipWhitespace(self);
+			}
+			else if(cur->scan != SCAN_NONE) {
+				/* This state loops on a whole class of characters, so skip that run in bulk */
+				Lexer_skipRun(self, cur->scan);
+			}
+		}
+		
+		/* Read a character from the input source */
+		c = Source_getc(self->source);
 		
 		/* Store the current character in the next position in the lexeme buffer */
-		string_appendChar(&self->lexeme, c);
+		Lexer_extendLexeme(self, c);
 		
 		/* Try to transition to the next state */
 		next = State_transition(cur, c);
 		
 		/* At initial state and read a character without a matching transition? */
 		if(next == NULL && cur == self->fsm) {
-			if(isspace(c)) {
-				/* Discard lexeme */
-				string_clear(&self->lexeme);
-				
-				/* Keep track of line numbers */
-				if(c == '\n') {
-					++self->line_number;
-				}
-				
-				/* Invoke whitespace callback when we encounter whitespace */
-				if(self->ws_cb != NULL) {
-					self->ws_cb(self->cb_cookie, c);
-				}
-				
+			if(Lexer_skipSpace(self, c)) {
 				/* Stay on the initial state */
 				next = cur;
 				continue;
 			}
 			else if(c == EOF) {
-				/* Discard lexeme */
-				string_clear(&self->lexeme);
-				
-				/* End of file */
-				self->at_eof = true;
-				
-				/* Return nulsym as an indicator of EOF */
-				return Token_initWithType(Token_alloc(), nulsym, "EOF", self->line_number);
+				return Lexer_finishEOF(self, tok);
 			}
 			else {
 				/* Need to handle error below */
@@ -149,33 +376,71 @@ Token* Lexer_nextToken(Lexer* self) {
 		}
 	}
 	
-	/* Scanning of the current lexeme finished, so the current state should be an acceptor */
-	if(!cur->acceptor) {
-		if(isspace(c)) {
-			/* Remove final space */
-			string_removeIndex(&self->lexeme, string_length(&self->lexeme) - 1);
-		}
-		
-		/* The current state isn't an acceptor state, so this is an error */
-		fprintf(stdout, "Syntax Error on line %d: Unknown sequence: \"%s\"\n", self->line_number, string_cstr(&self->lexeme));
-		return NULL;
-	}
-	
-	/* Ended lexeme on an acceptor state, so a token was matched */
-	ungetc(c, self->stream);
+	return Lexer_finishToken(self, tok, c, cur->acceptor, cur->acceptfn, cur->simple_type);
+}
+
+static bool Lexer_nextTokenTable(Lexer* self, Token* tok) {
+	const LexTable* table = self->table;
 	
-	/* Remove final space */
-	string_removeIndex(&self->lexeme, string_length(&self->lexeme) - 1);
+	/* Start the machine at the initial state */
+	uint8_t cur = LEXTABLE_START;
+	uint8_t next = LEXTABLE_START;
 	
-	/* If the state has an acceptor function, call it */
-	if(cur->acceptfn != NULL) {
-		return cur->acceptfn(self);
+	/* Keep reading characters until a complete token is scanned */
+	int c = ' ';
+	bool buffered = Source_isBuffered(self->source);
+	while(next != LEXTABLE_NO_STATE) {
+		/* Advance current state */
+		cur = next;
+		
+		if(buffered) {
+			if(cur == LEXTABLE_START) {
+				/* Skip whitespace in bulk before a token starts */
+				Lexer_skipWhitespace(self);
+			}
+			else if(table->states[cur].scan != SCAN_NONE) {
+				/* This state loops on a whole class of characters, so skip that run in bulk */
+				Lexer_skipRun(self, table->states[cur].scan);
+			}
+		}
+		
+		/* Read a character from the input source */
+		c = Source_getc(self->source);
+		
+		/* Store the current character in the next position in the lexeme buffer */
+		Lexer_extendLexeme(self, c);
+		
+		/* Look up the next state. EOF truncates to 0xFF just like it does when the FSM sees it as a char */
+		next = table->next[cur * table->class_count + table->char_class[(unsigned char)c]];
+		
+		/* At initial state and read a character without a matching transition? */
+		if(next == LEXTABLE_NO_STATE && cur == LEXTABLE_START) {
+			if(Lexer_skipSpace(self, c)) {
+				/* Stay on the initial state */
+				next = cur;
+				continue;
+			}
+			else if(c == EOF) {
+				return Lexer_finishEOF(self, tok);
+			}
+			else {
+				/* Need to handle error below */
+				break;
+			}
+		}
 	}
 	
-	/* State doesn't have an acceptor function, so it must be a simple acceptor */
-	return Token_initWithType(Token_alloc(), cur->simple_type, string_cstr(&self->lexeme), self->line_number);
+	const LexTableState* state = &table->states[cur];
+	Acceptor* acceptfn = state->acceptfn >= 0 ? table->acceptors[state->acceptfn] : NULL;
+	return Lexer_finishToken(self, tok, c, state->acceptor, acceptfn, state->simple_type);
 }
 
 void Lexer_drawGraph(Lexer* self, Graphviz* gv) {
-	State_drawGraph(self->fsm, gv);
+	if(self->table != NULL) {
+		/* The FSM was drawn when the tables were generated */
+		Graphviz_printf(gv, "%s", self->table->graph);
+	}
+	else {
+		State_drawGraph(self->fsm, gv, NULL, NULL);
+	}
 }
@@ -15,27 +15,43 @@
 typedef struct Lexer Lexer;
 
 #include "object.h"
+#include "slice.h"
+#include "arena.h"
 #include "token.h"
-#include "state.h"
-#include "transition.h"
-#include "graphviz.h"
 
 /* Callback types */
 typedef void WhitespaceCB(void* cookie, char ws);
+typedef bool Acceptor(Lexer* lexer, Token* tok);
+
+#include "source.h"
+#include "state.h"
+#include "transition.h"
+#include "lextable.h"
+#include "parlex.h"
+#include "graphviz.h"
 
 /*! Lexer object */
 struct Lexer {
 	OBJECT_BASE;
 	
-	/*! File stream that the lexer scans from */
-	FILE* stream;
+	/*! Character source that the lexer scans from */
+	Source* source;
 	
-	/*! Finite state machine that makes up the functionality of the lexer */
+	/*! Finite state machine that makes up the functionality of the lexer, or NULL if it uses a table */
 	State* fsm;
 	
-	/*! Character buffer for the lexeme of the current token */
+	/*! Pregenerated tables that make up the functionality of the lexer, or NULL if it uses an FSM */
+	const LexTable* table;
+	
+	/*! Offset of the current token's first character when the source is buffered */
+	size_t lexeme_start;
+	
+	/*! Character buffer for the lexeme of the current token when the source is streamed */
 	dynamic_string lexeme;
 	
+	/*! Storage for the lexemes of tokens scanned from a streamed source */
+	Arena lexemes;
+	
 	/*! Current line number (aids in debugging) */
 	int line_number;
 	
@@ -47,6 +63,34 @@ struct Lexer {
 	
 	/*! Pointer passed to both callback functions when they are invoked */
 	void* cb_cookie;
+	
+	/*! Number of threads to scan a buffered source with, or 1 to scan it sequentially */
+	unsigned thread_count;
+	
+	/*! Acceptor that skips the rest of a comment, used to scan chunks that start inside one */
+	Acceptor* comment_fn;
+	
+	/*! Tokens that were scanned ahead of time on several threads, or NULL when scanning sequentially */
+	ParLex* parallel;
+	
+	/*! Whether this lexer scans one chunk of a parallel scan. Speculative lexers don't intern
+	 identifiers or print errors, as they may run on a worker thread and not know their line numbers.
+	 */
+	bool speculative;
+	
+	/*! Whether syntax errors are kept in error rather than printed, for a reader that scans tokens
+	 before they are used and reports the error with Lexer_reportError once it gets to it
+	 */
+	bool defer_errors;
+	
+	/*! First syntax error seen by a speculative lexer or one that defers errors, or NULL */
+	char* error;
+	
+	/*! Line number of the first syntax error seen by a speculative lexer or one that defers errors */
+	int error_line;
+	
+	/*! Whether the source ended inside a comment */
+	bool eof_in_comment;
 };
 DECL(Lexer);
 
@@ -56,7 +100,26 @@ DECL(Lexer);
  */
 Lexer* Lexer_initWithFile(Lexer* self, FILE* fin);
 
-/*! Get the state with the exact text as a prefix, creating it if necessary
+/*! Creates a lexer that scans tokens from the provided file stream using pregenerated tables
+ @param fin Input file object that the lexer reads characters from
+ @param table Tables of the state machine to scan with, which must outlive the lexer
+ */
+Lexer* Lexer_initWithTable(Lexer* self, FILE* fin, const LexTable* table);
+
+/*! Creates a lexer that scans tokens from a buffer in memory using pregenerated tables
+ @param data Characters to scan, which must outlive the lexer
+ @param length Number of characters in data
+ @param table Tables of the state machine to scan with, which must outlive the lexer
+ */
+Lexer* Lexer_initWithBuffer(Lexer* self, const char* data, size_t length, const LexTable* table);
+
+/*! Scan buffered sources on several threads. Only for table lexers
+ @param thread_count Maximum number of threads to scan with
+ @param comment_fn Acceptor that skips the rest of a comment when called just after its opening
+ */
+void Lexer_setParallel(Lexer* self, unsigned thread_count, Acceptor* comment_fn);
+
+/*! Get the state with the exact text as a prefix, creating it if necessary. Only for FSM lexers
  @param prefix Exact prefix that leads to the created state
  @return Created state object. Not retained
  */
@@ -74,10 +137,32 @@ void Lexer_addToken(Lexer* self, const char* text, token_type type);
  */
 void Lexer_setWhitespaceCallback(Lexer* self, WhitespaceCB* ws_cb, void* cookie);
 
-/*! Scan the next token from the lexer's file stream
- @return Token read in from the input stream, or NULL on error (or after EOF)
+/*! Get the text of the token currently being scanned, for use by acceptor functions
+ @return Slice holding the lexeme. It is only valid until the lexer scans another character
+ */
+Slice Lexer_getLexeme(Lexer* self);
+
+/*! Fill in a token using the current lexeme, for use by acceptor functions
+ @param tok Out pointer to the token to fill in. Its lexeme stays valid for the life of the lexer
+ @param type Type of the token
+ @return True, so that acceptors can return this directly
+ */
+bool Lexer_makeToken(Lexer* self, Token* tok, token_type type);
+
+/*! Report a syntax error on the current line, for use by acceptor functions
+ @param fmt Format string of the message, without a trailing newline
+ */
+void Lexer_syntaxError(Lexer* self, const char* fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/*! Print the syntax error that was kept back because defer_errors is set, if there was one */
+void Lexer_reportError(Lexer* self);
+
+/*! Scan the next token from the lexer's source
+ @param tok Out pointer to the token that was read. Its lexeme stays valid for the life of the lexer
+ @return True if a token was read, or false on error (or after EOF)
  */
-Token* Lexer_nextToken(Lexer* self);
+bool Lexer_nextToken(Lexer* self, Token* tok);
 
 /*! Draws the lexer's FSM as a graph
  @param gv Graphviz drawing object
@@ -0,0 +1,68 @@
+//
+//  lextable.h
+//  PL/0
+//
+
+#ifndef PL0_LEXTABLE_H
+#define PL0_LEXTABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct LexTableState LexTableState;
+typedef struct LexTable LexTable;
+
+#include "token.h"
+#include "lexer.h"
+#include "scan.h"
+
+/*! Entry in a LexTable's transition table when a state has no transition for a character class */
+#define LEXTABLE_NO_STATE UINT8_MAX
+
+/*! Index of the initial state in a LexTable */
+#define LEXTABLE_START 0
+
+/*! Everything about a lexer state other than its transitions */
+struct LexTableState {
+	/*! Whether the state is an acceptor state */
+	bool acceptor;
+	
+	/*! Index of the state's acceptor function in the table's acceptors, or -1 if it has none */
+	int8_t acceptfn;
+	
+	/*! In place of an acceptor function, simple states can specify a token type */
+	token_type simple_type;
+	
+	/*! Set when every character in this run stays on this state, so it can be skipped in bulk */
+	ScanKind scan;
+};
+
+/*! A lexer's state machine flattened into static tables, as generated by tools/lexgen.
+ Characters that every state treats the same way share a character class, so the
+ transition table only needs one column per class.
+ */
+struct LexTable {
+	/*! Number of states in the machine */
+	uint8_t state_count;
+	
+	/*! Number of distinct character classes */
+	uint8_t class_count;
+	
+	/*! Character class of each possible character, indexed by its value as an unsigned char */
+	const uint8_t* char_class;
+	
+	/*! Transition table, indexed by [state * class_count + class] */
+	const uint8_t* next;
+	
+	/*! Information about each state */
+	const LexTableState* states;
+	
+	/*! Acceptor functions referred to by the states */
+	Acceptor* const* acceptors;
+	
+	/*! Graphviz DOT statements that draw the state machine the tables were generated from */
+	const char* graph;
+};
+
+
+#endif /* PL0_LEXTABLE_H */
@@ -0,0 +1,249 @@
+//
+//  parlex.c
+//  PL/0
+//
+
+#include "parlex.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "intern.h"
+
+
+/* Split the lexer's source into chunks that each end just after a newline */
+static void ParLex_splitSource(ParLex* self, Lexer* lexer, size_t chunk_count);
+
+/* Decide which chunks hold valid tokens, scanning again any that started inside a comment */
+static void ParLex_stitchChunks(ParLex* self);
+
+/* Pass whitespace characters of the current chunk to the lexer's whitespace callback */
+static void ParLex_replayWhitespace(ParLex* self, Lexer* lexer, const ParLexChunk* chunk, size_t ws_end);
+
+/* Scan all tokens in a chunk with a speculative lexer */
+static void ParLexChunk_scan(ParLexChunk* chunk);
+
+/* Forget everything that was scanned from a chunk */
+static void ParLexChunk_reset(ParLexChunk* chunk);
+
+/* Thread entry point that scans a chunk */
+static void* ParLexChunk_run(void* arg);
+
+/* Whitespace callback of a speculative lexer, which records the character in its chunk */
+static void ParLexChunk_recordWhitespace(void* cookie, char c);
+
+
+Destroyer(ParLex) {
+	foreach(&self->chunks, pchunk) {
+		ParLexChunk_reset(pchunk);
+	}
+	array_clear(&self->chunks);
+}
+DEF(ParLex);
+
+ParLex* ParLex_initWithLexer(ParLex* self, Lexer* lexer) {
+	ASSERT(lexer->table != NULL && lexer->comment_fn != NULL);
+	
+	if((self = ParLex_init(self))) {
+		/* Give each thread enough of the source to be worth starting it */
+		size_t chunk_count = MIN(lexer->thread_count, lexer->source->length / PARLEX_MIN_CHUNK_SIZE);
+		if(chunk_count >= 2) {
+			ParLex_splitSource(self, lexer, chunk_count);
+		}
+		
+		if(self->chunks.count < 2) {
+			/* Either the source is small or it has too few newlines to split it on */
+			release(&self);
+			return NULL;
+		}
+		
+		/* The array won't be resized from here on, so the threads can hold pointers into it */
+		for(size_t i = 1; i < self->chunks.count; i++) {
+			ParLexChunk* chunk = &self->chunks.elems[i];
+			chunk->threaded = pthread_create(&chunk->thread, NULL, &ParLexChunk_run, chunk) == 0;
+			if(!chunk->threaded) {
+				/* Couldn't start a thread, so just scan the chunk here instead */
+				ParLexChunk_scan(chunk);
+			}
+		}
+		
+		/* Scan the first chunk on this thread while waiting for the others */
+		ParLexChunk_scan(&self->chunks.elems[0]);
+		foreach(&self->chunks, pchunk) {
+			if(pchunk->threaded) {
+				pthread_join(pchunk->thread, NULL);
+			}
+		}
+		
+		ParLex_stitchChunks(self);
+	}
+	
+	return self;
+}
+
+static void ParLex_splitSource(ParLex* self, Lexer* lexer, size_t chunk_count) {
+	const char* data = lexer->source->data;
+	size_t length = lexer->source->length;
+	
+	size_t start = 0;
+	for(size_t i = 1; i <= chunk_count && start < length; i++) {
+		size_t end = length;
+		if(i < chunk_count) {
+			/* Tokens only cross a line break inside of a comment, so end the chunk after one */
+			end = MAX(length / chunk_count * i, start);
+			const char* newline = memchr(&data[end], '\n', length - end);
+			end = newline != NULL ? (size_t)(newline - data) + 1 : length;
+		}
+		
+		ParLexChunk chunk = {
+			.parent = lexer,
+			.data = &data[start],
+			.length = end - start
+		};
+		array_append(&self->chunks, chunk);
+		start = end;
+	}
+	
+	self->chunks.elems[self->chunks.count - 1].is_last = true;
+}
+
+static void ParLex_stitchChunks(ParLex* self) {
+	bool in_comment = false;
+	int line_number = 1;
+	
+	for(size_t i = 0; i < self->chunks.count; i++) {
+		ParLexChunk* chunk = &self->chunks.elems[i];
+		
+		/* Every chunk was scanned as if it doesn't start inside a comment */
+		if(chunk->starts_in_comment != in_comment) {
+			ParLexChunk_reset(chunk);
+			chunk->starts_in_comment = in_comment;
+			ParLexChunk_scan(chunk);
+		}
+		
+		chunk->first_line = line_number;
+		self->valid_count = i + 1;
+		
+		if(chunk->ends_in_comment && !chunk->is_last) {
+			/* Not actually an error, since the comment continues into the next chunk */
+			destroy(&chunk->error);
+			in_comment = true;
+		}
+		else if(chunk->error != NULL) {
+			/* Tokens after a syntax error are never seen */
+			break;
+		}
+		else {
+			in_comment = false;
+		}
+		
+		line_number += chunk->newlines;
+	}
+}
+
+bool ParLex_nextToken(ParLex* self, Lexer* lexer, Token* tok) {
+	while(self->chunk_index < self->valid_count) {
+		ParLexChunk* chunk = &self->chunks.elems[self->chunk_index];
+		
+		if(self->token_index < chunk->tokens.count) {
+			/* Report the whitespace before this token just like the sequential lexer would */
+			ParLex_replayWhitespace(self, lexer, chunk, chunk->ws_ends.elems[self->token_index]);
+			
+			*tok = chunk->tokens.elems[self->token_index++];
+			tok->line_number += chunk->first_line - 1;
+			if(tok->type == identsym) {
+				/* Speculative lexers leave identifiers uninterned */
+				tok->lexeme = SLICE(intern_slice(tok->lexeme), tok->lexeme.length);
+			}
+			
+			lexer->line_number = (int)tok->line_number;
+			if(tok->type == nulsym) {
+				lexer->at_eof = true;
+			}
+			return true;
+		}
+		
+		/* Whitespace after the chunk's last token comes before anything in the next chunk */
+		ParLex_replayWhitespace(self, lexer, chunk, chunk->whitespace.count);
+		
+		if(chunk->error != NULL) {
+			/* Now that the chunk's line numbers are known, the error can be reported */
+			lexer->line_number = chunk->first_line - 1 + chunk->error_line;
+			Lexer_syntaxError(lexer, "%s", chunk->error);
+			self->chunk_index = self->valid_count;
+			return false;
+		}
+		
+		++self->chunk_index;
+		self->token_index = 0;
+		self->ws_index = 0;
+	}
+	
+	return false;
+}
+
+static void ParLex_replayWhitespace(ParLex* self, Lexer* lexer, const ParLexChunk* chunk, size_t ws_end) {
+	if(lexer->ws_cb == NULL) {
+		return;
+	}
+	
+	while(self->ws_index < ws_end) {
+		lexer->ws_cb(lexer->cb_cookie, chunk->whitespace.elems[self->ws_index++]);
+	}
+}
+
+static void ParLexChunk_scan(ParLexChunk* chunk) {
+	Lexer* parent = chunk->parent;
+	Lexer* lexer = Lexer_initWithBuffer(Lexer_alloc(), chunk->data, chunk->length, parent->table);
+	ASSERT(lexer != NULL);
+	lexer->speculative = true;
+	
+	/* Only keep the whitespace if somebody will look at it */
+	if(parent->ws_cb != NULL) {
+		Lexer_setWhitespaceCallback(lexer, &ParLexChunk_recordWhitespace, chunk);
+	}
+	
+	/* Chunks that start inside a comment pick up right after where the comment opened */
+	Token tok;
+	bool ok = chunk->starts_in_comment ? parent->comment_fn(lexer, &tok) : Lexer_nextToken(lexer, &tok);
+	while(ok) {
+		/* Reaching the end of a chunk is only the end of the file for the last one */
+		if(tok.type == nulsym && !chunk->is_last) {
+			break;
+		}
+		
+		array_append(&chunk->ws_ends, chunk->whitespace.count);
+		array_append(&chunk->tokens, tok);
+		if(tok.type == nulsym) {
+			break;
+		}
+		
+		ok = Lexer_nextToken(lexer, &tok);
+	}
+	
+	chunk->ends_in_comment = lexer->eof_in_comment;
+	chunk->newlines = lexer->line_number - 1;
+	chunk->error = lexer->error;
+	chunk->error_line = lexer->error_line;
+	lexer->error = NULL;
+	release(&lexer);
+}
+
+static void ParLexChunk_reset(ParLexChunk* chunk) {
+	array_clear(&chunk->tokens);
+	array_clear(&chunk->ws_ends);
+	array_clear(&chunk->whitespace);
+	destroy(&chunk->error);
+	chunk->ends_in_comment = false;
+	chunk->newlines = 0;
+	chunk->error_line = 0;
+}
+
+static void* ParLexChunk_run(void* arg) {
+	ParLexChunk_scan(arg);
+	return NULL;
+}
+
+static void ParLexChunk_recordWhitespace(void* cookie, char c) {
+	ParLexChunk* chunk = cookie;
+	array_append(&chunk->whitespace, c);
+}
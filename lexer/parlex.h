@@ -0,0 +1,110 @@
+//
+//  parlex.h
+//  PL/0
+//
+
+#ifndef PL0_PARLEX_H
+#define PL0_PARLEX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef struct ParLex ParLex;
+typedef struct ParLexChunk ParLexChunk;
+
+#include "object.h"
+#include "dynamic_array.h"
+#include "token.h"
+#include "lexer.h"
+
+/*! Sources smaller than this many bytes per thread aren't worth splitting up */
+#ifndef PARLEX_MIN_CHUNK_SIZE
+#define PARLEX_MIN_CHUNK_SIZE (64 * 1024)
+#endif
+
+/*! Tokens scanned from one chunk of the source by a speculative lexer */
+struct ParLexChunk {
+	/*! Lexer that scans the whole source, used for its tables and settings */
+	Lexer* parent;
+	
+	/*! Thread that scans this chunk */
+	pthread_t thread;
+	
+	/*! Whether the chunk is being scanned on its own thread */
+	bool threaded;
+	
+	/*! Characters of the chunk, which always ends just after a newline or at the end of the source */
+	const char* data;
+	size_t length;
+	
+	/*! Whether this is the final chunk of the source */
+	bool is_last;
+	
+	/*! Whether the chunk was scanned as if it starts inside a comment */
+	bool starts_in_comment;
+	
+	/*! Whether the chunk ended inside a comment */
+	bool ends_in_comment;
+	
+	/*! Line number of the chunk's first character, filled in when the chunks are stitched together */
+	int first_line;
+	
+	/*! Number of newlines in the chunk */
+	int newlines;
+	
+	/*! Tokens in the chunk with line numbers relative to the start of the chunk */
+	dynamic_array(Token) tokens;
+	
+	/*! Number of whitespace characters seen before each token */
+	dynamic_array(size_t) ws_ends;
+	
+	/*! Every whitespace character seen in the chunk, only recorded if the parent has a whitespace callback */
+	dynamic_array(char) whitespace;
+	
+	/*! Message of the syntax error that stopped scanning the chunk, or NULL */
+	char* error;
+	
+	/*! Relative line number of the syntax error */
+	int error_line;
+};
+
+/*! Tokens of a whole buffered source that were scanned ahead of time on several threads,
+ which are replayed in order so that they match what a sequential scan would produce.
+ */
+struct ParLex {
+	OBJECT_BASE;
+	
+	/*! Chunks that the source was split into */
+	dynamic_array(ParLexChunk) chunks;
+	
+	/*! Number of chunks holding valid tokens, where the last one may end with an error */
+	size_t valid_count;
+	
+	/*! Index of the chunk currently being replayed */
+	size_t chunk_index;
+	
+	/*! Index of the next token to replay from the current chunk */
+	size_t token_index;
+	
+	/*! Number of whitespace characters already replayed from the current chunk */
+	size_t ws_index;
+};
+DECL(ParLex);
+
+
+/*! Scan a lexer's whole buffered source on several threads
+ @param lexer Lexer whose source should be scanned, which must use tables and have a thread count above 1
+ @return Scanned tokens ready to be replayed, or NULL if the source is too small to be worth splitting up
+ */
+ParLex* ParLex_initWithLexer(ParLex* self, Lexer* lexer);
+
+/*! Replay the next token that was scanned ahead of time, just as Lexer_nextToken would produce it
+ @param lexer Lexer that the tokens were scanned for
+ @param tok Out pointer to the token that was read
+ @return True if a token was read, or false on error (or after EOF)
+ */
+bool ParLex_nextToken(ParLex* self, Lexer* lexer, Token* tok);
+
+
+#endif /* PL0_PARLEX_H */
@@ -13,6 +13,12 @@
 
 typedef struct LexerFiles LexerFiles;
 
+typedef enum LEXER_TYPE {
+	LEXER_TABLE = 1, /*!< Scan using the tables generated from PL/0's tokens at build time */
+	LEXER_FSM,       /*!< Scan by walking a state machine built from PL/0's tokens at startup */
+	LEXER_PARALLEL   /*!< Scan large files in chunks on several threads using the generated tables */
+} LEXER_TYPE;
+
 #include "object.h"
 #include "lexer.h"
 
@@ -23,19 +29,31 @@ struct LexerFiles {
 	FILE* table;
 	FILE* clean;
 	FILE* tokenlist;
+	FILE* tokenbin;
 	FILE* graph;
 };
 DECL(LexerFiles);
 
 
 /*! Runs the lexer on the PL/0 input file
- @param files Open file streams used by the lexer
+ @param files Open file streams used by the lexer. Output streams may be NULL to skip writing them
+ @param lexerType Which lexer engine to scan with
+ */
+int run_lexer(LexerFiles* files, LEXER_TYPE lexerType);
+
+/*! Runs the lexer on the PL/0 input file, keeping the scanned tokens in memory
+ @param files Open file streams used by the lexer. Output streams may be NULL to skip writing them
+ @param lexerType Which lexer engine to scan with
+ @param tokens Array where every token is appended, ending with nulsym, or NULL
+ @return The lexer that scanned the tokens, which must stay alive while their lexemes are in use,
+         or NULL on error
  */
-int run_lexer(LexerFiles* files);
+Lexer* run_lexer_withTokens(LexerFiles* files, LEXER_TYPE lexerType, TokenArray* tokens);
 
 /*! Create a lexer object intended for scanning PL/0 source
  @param fin Input file
+ @param type Which lexer engine to scan with
  */
-Lexer* PL0Lexer_initWithFile(Lexer* self, FILE* fin);
+Lexer* PL0Lexer_initWithFile(Lexer* self, FILE* fin, LEXER_TYPE type);
 
 #endif /* PL0_PL0LEX_H */
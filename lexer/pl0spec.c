@@ -0,0 +1,197 @@
+//
+//  pl0spec.c
+//  PL/0
+//
+
+#include "pl0spec.h"
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "keywords.h"
+
+
+static bool accept_comment(Lexer* lexer, Token* tok);
+static bool accept_identifier(Lexer* lexer, Token* tok);
+static bool accept_number(Lexer* lexer, Token* tok);
+static bool accept_invalid_varname(Lexer* lexer, Token* tok);
+static bool match_ident_begin(char c);
+static bool match_ident_middle(char c);
+static bool match_number(char c);
+
+
+Acceptor* const PL0_acceptors[PL0_ACCEPTOR_COUNT] = {
+	&accept_comment,
+	&accept_identifier,
+	&accept_number,
+	&accept_invalid_varname
+};
+
+static bool accept_comment(Lexer* lexer, Token* tok) {
+	/* Ignore all characters until the following two characters are found: */
+	Source* src = lexer->source;
+	bool closed = false;
+	if(Source_isBuffered(src)) {
+		size_t newlines = 0;
+		const char* end = scan_commentEnd(&src->data[src->pos], &src->data[src->length], &newlines);
+		lexer->line_number += newlines;
+		if(end != NULL) {
+			src->pos = end - src->data;
+			closed = true;
+		}
+	}
+	else {
+		int c, prev = EOF;
+		while(!closed && (c = Source_getc(src)) != EOF) {
+			if(c == '\n') {
+				++lexer->line_number;
+			}
+			closed = prev == '*' && c == '/';
+			prev = c;
+		}
+	}
+	
+	if(!closed) {
+		lexer->eof_in_comment = true;
+		Lexer_syntaxError(lexer, "End of file occurred within a comment.");
+		return false;
+	}
+	
+	/* Need to return a token, so invoke the lexer again */
+	return Lexer_nextToken(lexer, tok);
+}
+
+static bool accept_identifier(Lexer* lexer, Token* tok) {
+	/* Make sure the identifier doesn't have more than 11 characters */
+	Slice lexeme = Lexer_getLexeme(lexer);
+	if(lexeme.length > 11) {
+		Lexer_syntaxError(lexer, "Identifier cannot be longer than 11 characters: \"%"PRIslice"\"", SLICE_ARG(lexeme));
+		return false;
+	}
+	
+	/* Reserved words are scanned just like identifiers, so tell them apart here */
+	return Lexer_makeToken(lexer, tok, keyword_lookup(lexeme));
+}
+
+static bool accept_number(Lexer* lexer, Token* tok) {
+	/* Make sure the number doesn't have more than 5 digits */
+	Slice lexeme = Lexer_getLexeme(lexer);
+	if(lexeme.length > 5) {
+		Lexer_syntaxError(lexer, "Number literal cannot be longer than 5 digits: \"%"PRIslice"\"", SLICE_ARG(lexeme));
+		return false;
+	}
+	
+	/* Return a number token normally */
+	return Lexer_makeToken(lexer, tok, numbersym);
+}
+
+static bool accept_invalid_varname(Lexer* lexer, Token* tok) {
+	(void)tok;
+	Slice lexeme = Lexer_getLexeme(lexer);
+	Lexer_syntaxError(lexer, "Invalid identifier: \"%"PRIslice"\"", SLICE_ARG(lexeme));
+	return false;
+}
+
+static bool match_ident_begin(char c) {
+	return isalpha(c);
+}
+
+static bool match_ident_middle(char c) {
+	return isalnum(c);
+}
+
+static bool match_number(char c) {
+	return isdigit(c);
+}
+
+void PL0_addTokens(Lexer* lexer) {
+	/* Label the initial state */
+	State* first_state = Lexer_getState(lexer, "");
+	State_setLabel(first_state, "START");
+	
+	/* Recognize the tail of an identifier, [a-zA-Z0-9]* (weakly referenced). Reserved words are
+	 * scanned as identifiers too, and accept_identifier tells them apart */
+	State* state_ident_middle = State_initWithAcceptor(State_alloc(), "ID", &accept_identifier);
+	Transition* trans_ident_middle = Transition_initWithMatcher(
+		Transition_alloc(),
+		"[a-zA-Z0-9]",
+		state_ident_middle,
+		false,
+		&match_ident_middle);
+	State_addTransition(state_ident_middle, trans_ident_middle);
+	state_ident_middle->scan = SCAN_ALNUM;
+	
+	/* Punctuation, matching exactly */
+	Lexer_addToken(lexer, "+", plussym);
+	Lexer_addToken(lexer, "-", minussym);
+	Lexer_addToken(lexer, "*", multsym);
+	Lexer_addToken(lexer, "/", slashsym);
+	Lexer_addToken(lexer, "%", percentsym);
+	Lexer_addToken(lexer, "=", eqsym);
+	Lexer_addToken(lexer, "<", lessym);
+	Lexer_addToken(lexer, "<>", neqsym);
+	Lexer_addToken(lexer, "<=", leqsym);
+	Lexer_addToken(lexer, ">", gtrsym);
+	Lexer_addToken(lexer, ">=", geqsym);
+	Lexer_addToken(lexer, "(", lparentsym);
+	Lexer_addToken(lexer, ")", rparentsym);
+	Lexer_addToken(lexer, ",", commasym);
+	Lexer_addToken(lexer, ";", semicolonsym);
+	Lexer_addToken(lexer, ".", periodsym);
+	Lexer_addToken(lexer, ":=", becomessym);
+	
+	/* First character of identifiers, matching [a-zA-Z] (strongly referenced) */
+	Transition* trans_ident_begin = Transition_initWithMatcher(
+		Transition_alloc(),
+		"[a-zA-Z]",
+		state_ident_middle,
+		true,
+		&match_ident_begin);
+	State_addTransition(first_state, trans_ident_begin);
+	
+	/* Numbers, matching [0-9]+ (weakly referenced) */
+	State* state_number = State_initWithAcceptor(State_alloc(), "NUMBER", &accept_number);
+	Transition* weak_trans_number = Transition_initWithMatcher(
+		Transition_alloc(),
+		"[0-9]",
+		state_number,
+		false,
+		&match_number);
+	State_addTransition(state_number, weak_trans_number);
+	state_number->scan = SCAN_DIGITS;
+	
+	/* So that first_state indirectly holds a strong reference to state_number */
+	Transition* trans_number = Transition_initWithMatcher(
+		Transition_alloc(),
+		"[0-9]",
+		state_number,
+		true,
+		&match_number);
+	State_addTransition(first_state, trans_number);
+	
+	/* Invalid variable names, matching [0-9]+[a-zA-Z] (strongly referenced) */
+	State* state_invalid_varname = State_initWithAcceptor(State_alloc(), "INVALID", &accept_invalid_varname);
+	Transition* trans_invalid_varname = Transition_initWithMatcher(
+		Transition_alloc(),
+		"[a-zA-Z]",
+		state_invalid_varname,
+		true,
+		&match_ident_begin);
+	State_addTransition(state_number, trans_invalid_varname);
+	
+	/* Comments, like this one */
+	State* state_comment = Lexer_getState(lexer, "/*");
+	State_setLabel(state_comment, "COMMENT");
+	state_comment->acceptor = true;
+	state_comment->acceptfn = &accept_comment;
+	
+	/* Cleanup, since the lexer now holds references to all of these */
+	release(&trans_invalid_varname);
+	release(&state_invalid_varname);
+	release(&trans_number);
+	release(&weak_trans_number);
+	release(&state_number);
+	release(&trans_ident_begin);
+	release(&trans_ident_middle);
+	release(&state_ident_middle);
+}
@@ -0,0 +1,32 @@
+//
+//  pl0spec.h
+//  PL/0
+//
+
+#ifndef PL0_PL0SPEC_H
+#define PL0_PL0SPEC_H
+
+#include "lexer.h"
+#include "lextable.h"
+
+/*! Number of acceptor functions used by PL/0's tokens */
+#define PL0_ACCEPTOR_COUNT 4
+
+/*! Index of the acceptor that skips the rest of a comment */
+#define PL0_ACCEPTOR_COMMENT 0
+
+/*! Every acceptor function used by PL/0's tokens. Generated lexer tables refer to
+ acceptors by their index in this array.
+ */
+extern Acceptor* const PL0_acceptors[PL0_ACCEPTOR_COUNT];
+
+/*! Tables generated at build time by tools/lexgen from the state machine built by PL0_addTokens */
+extern const LexTable PL0_lexTable;
+
+/*! Add all of PL/0's tokens to a lexer's state machine. This is the specification of PL/0's
+ tokens, used both at build time to generate PL0_lexTable and at runtime by the FSM lexer.
+ */
+void PL0_addTokens(Lexer* lexer);
+
+
+#endif /* PL0_PL0SPEC_H */
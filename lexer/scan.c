@@ -0,0 +1,168 @@
+//
+//  scan.c
+//  PL/0
+//
+
+#include "scan.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "macros.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+#define VEC_WIDTH 32
+#define VEC_FULL 0xffffffffU
+typedef __m256i vec;
+#define vec_load(p)      _mm256_loadu_si256((const __m256i*)(p))
+#define vec_splat(c)     _mm256_set1_epi8((char)(c))
+#define vec_eq(a, b)     _mm256_cmpeq_epi8((a), (b))
+#define vec_or(a, b)     _mm256_or_si256((a), (b))
+#define vec_sub(a, b)    _mm256_sub_epi8((a), (b))
+#define vec_min(a, b)    _mm256_min_epu8((a), (b))
+#define vec_mask(v)      ((uint32_t)_mm256_movemask_epi8(v))
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+#define VEC_WIDTH 16
+#define VEC_FULL 0xffffU
+typedef __m128i vec;
+#define vec_load(p)      _mm_loadu_si128((const __m128i*)(p))
+#define vec_splat(c)     _mm_set1_epi8((char)(c))
+#define vec_eq(a, b)     _mm_cmpeq_epi8((a), (b))
+#define vec_or(a, b)     _mm_or_si128((a), (b))
+#define vec_sub(a, b)    _mm_sub_epi8((a), (b))
+#define vec_min(a, b)    _mm_min_epu8((a), (b))
+#define vec_mask(v)      ((uint32_t)_mm_movemask_epi8(v))
+
+#endif /* __AVX2__ */
+
+
+static inline bool is_space(char c) {
+	return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static inline bool is_digit(char c) {
+	return (unsigned char)(c - '0') <= 9;
+}
+
+static inline bool is_alnum(char c) {
+	/* Setting bit 5 maps 'A'-'Z' onto 'a'-'z' without moving anything else into that range */
+	return is_digit(c) || (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a';
+}
+
+#ifdef VEC_WIDTH
+
+/* Each lane is all ones when lo <= lane <= lo + span (unsigned), zero otherwise */
+static inline vec vec_inRange(vec v, char lo, char span) {
+	vec off = vec_sub(v, vec_splat(lo));
+	return vec_eq(vec_min(off, vec_splat(span)), off);
+}
+
+static inline uint32_t vec_spaceMask(vec v) {
+	return vec_mask(vec_or(vec_eq(v, vec_splat(' ')), vec_inRange(v, '\t', '\r' - '\t')));
+}
+
+static inline uint32_t vec_digitMask(vec v) {
+	return vec_mask(vec_inRange(v, '0', 9));
+}
+
+static inline uint32_t vec_alnumMask(vec v) {
+	vec lower = vec_or(v, vec_splat(0x20));
+	return vec_mask(vec_or(vec_inRange(v, '0', 9), vec_inRange(lower, 'a', 'z' - 'a')));
+}
+
+/* Mask with the low n bits set, for n < 32 */
+static inline uint32_t low_bits(unsigned n) {
+	return (1U << n) - 1;
+}
+
+#endif /* VEC_WIDTH */
+
+
+const char* scan_whitespace(const char* p, const char* end, size_t* newlines) {
+#ifdef VEC_WIDTH
+	while(end - p >= VEC_WIDTH) {
+		vec v = vec_load(p);
+		uint32_t space = vec_spaceMask(v);
+		uint32_t nl = vec_mask(vec_eq(v, vec_splat('\n')));
+		
+		if(space != VEC_FULL) {
+			/* Only count the newlines that come before the first non-whitespace character */
+			unsigned n = __builtin_ctz(~space);
+			*newlines += __builtin_popcount(nl & low_bits(n));
+			return p + n;
+		}
+		
+		*newlines += __builtin_popcount(nl);
+		p += VEC_WIDTH;
+	}
+#endif /* VEC_WIDTH */
+	
+	for(; p != end && is_space(*p); ++p) {
+		if(*p == '\n') {
+			++*newlines;
+		}
+	}
+	return p;
+}
+
+const char* scan_run(ScanKind kind, const char* p, const char* end) {
+	ASSERT(kind != SCAN_NONE);
+	
+#ifdef VEC_WIDTH
+	while(end - p >= VEC_WIDTH) {
+		vec v = vec_load(p);
+		uint32_t match = kind == SCAN_DIGITS ? vec_digitMask(v) : vec_alnumMask(v);
+		if(match != VEC_FULL) {
+			return p + __builtin_ctz(~match);
+		}
+		p += VEC_WIDTH;
+	}
+#endif /* VEC_WIDTH */
+	
+	if(kind == SCAN_DIGITS) {
+		while(p != end && is_digit(*p)) {
+			++p;
+		}
+	}
+	else {
+		while(p != end && is_alnum(*p)) {
+			++p;
+		}
+	}
+	return p;
+}
+
+const char* scan_commentEnd(const char* p, const char* end, size_t* newlines) {
+#ifdef VEC_WIDTH
+	/* Compare each position against '*' and the position after it against '/' */
+	while(end - p > VEC_WIDTH) {
+		vec v = vec_load(p);
+		uint32_t star = vec_mask(vec_eq(v, vec_splat('*')));
+		uint32_t slash = vec_mask(vec_eq(vec_load(p + 1), vec_splat('/')));
+		uint32_t nl = vec_mask(vec_eq(v, vec_splat('\n')));
+		uint32_t close = star & slash;
+		
+		if(close != 0) {
+			unsigned n = __builtin_ctz(close);
+			*newlines += __builtin_popcount(nl & low_bits(n));
+			return p + n + 2;
+		}
+		
+		*newlines += __builtin_popcount(nl);
+		p += VEC_WIDTH;
+	}
+#endif /* VEC_WIDTH */
+	
+	for(; p != end; ++p) {
+		if(*p == '\n') {
+			++*newlines;
+		}
+		else if(*p == '*' && p + 1 != end && p[1] == '/') {
+			return p + 2;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,48 @@
+//
+//  scan.h
+//  PL/0
+//
+
+#ifndef PL0_SCAN_H
+#define PL0_SCAN_H
+
+#include <stddef.h>
+
+/*! Bulk scanning kernels that let the lexer skip over runs of characters in a buffered
+ source without stepping through the FSM one character at a time. They use SSE2 or AVX2
+ when the compiler targets them, and plain C otherwise.
+ */
+
+/*! Kinds of character runs that a state can skip over in bulk */
+typedef enum ScanKind {
+	SCAN_NONE = 0,  /*!< Characters must go through the state's transitions one by one */
+	SCAN_ALNUM,     /*!< Run of [a-zA-Z0-9] characters */
+	SCAN_DIGITS     /*!< Run of [0-9] characters */
+} ScanKind;
+
+/*! Skip over a run of whitespace characters
+ @param p Pointer to the first character to examine
+ @param end Pointer just past the last character of the buffer
+ @param newlines Incremented by the number of newline characters that were skipped
+ @return Pointer to the first non-whitespace character, or end
+ */
+const char* scan_whitespace(const char* p, const char* end, size_t* newlines);
+
+/*! Skip over a run of characters of the given kind
+ @param kind Kind of characters to skip, not SCAN_NONE
+ @param p Pointer to the first character to examine
+ @param end Pointer just past the last character of the buffer
+ @return Pointer to the first character not in the run, or end
+ */
+const char* scan_run(ScanKind kind, const char* p, const char* end);
+
+/*! Find the end of a comment's body
+ @param p Pointer to the first character after the opening "/" "*"
+ @param end Pointer just past the last character of the buffer
+ @param newlines Incremented by the number of newline characters in the comment's body
+ @return Pointer just past the closing "*" "/", or NULL if the comment is never closed
+ */
+const char* scan_commentEnd(const char* p, const char* end, size_t* newlines);
+
+
+#endif /* PL0_SCAN_H */
@@ -0,0 +1,68 @@
+//
+//  source.c
+//  PL/0
+//
+
+#include "source.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+
+Destroyer(Source) {
+	if(self->map_size != 0) {
+		munmap((void*)self->data, self->map_size);
+	}
+}
+DEF(Source);
+
+Source* Source_initWithFile(Source* self, FILE* fin) {
+	if((self = Source_init(self))) {
+		self->stream = fin;
+		
+		/* Only regular files can be mapped, everything else is read through the stream */
+		struct stat st;
+		int fd = fileno(fin);
+		if(fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			return self;
+		}
+		
+		/* Scanning should begin wherever the stream is currently positioned */
+		off_t start = ftello(fin);
+		if(start < 0 || start > st.st_size) {
+			return self;
+		}
+		
+		/* Zero-length mappings aren't allowed, but there's nothing to map anyway */
+		if(st.st_size == 0) {
+			self->data = "";
+			self->stream = NULL;
+			return self;
+		}
+		
+		void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(map == MAP_FAILED) {
+			return self;
+		}
+		
+		/* The whole file is scanned front to back exactly once */
+		madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+		
+		self->data = map;
+		self->length = (size_t)st.st_size;
+		self->map_size = (size_t)st.st_size;
+		self->pos = (size_t)start;
+		self->stream = NULL;
+	}
+	
+	return self;
+}
+
+Source* Source_initWithBuffer(Source* self, const char* data, size_t length) {
+	if((self = Source_init(self))) {
+		self->data = data;
+		self->length = length;
+	}
+	
+	return self;
+}
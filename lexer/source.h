@@ -0,0 +1,100 @@
+//
+//  source.h
+//  PL/0
+//
+
+#ifndef PL0_SOURCE_H
+#define PL0_SOURCE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct Source Source;
+
+#include "object.h"
+#include "slice.h"
+
+/*! Character source that the lexer scans from. Regular files are memory-mapped so that
+ the lexer can walk a cursor over the whole file and refer to lexemes in place, while
+ anything that can't be mapped (like a pipe) is read one character at a time.
+ */
+struct Source {
+	OBJECT_BASE;
+	
+	/*! File stream used when the input couldn't be mapped, otherwise NULL */
+	FILE* stream;
+	
+	/*! Contents of the input when it is held in memory, otherwise NULL */
+	const char* data;
+	
+	/*! Number of bytes in data */
+	size_t length;
+	
+	/*! Offset into data of the next character to be read */
+	size_t pos;
+	
+	/*! Size of the memory mapping backing data, or 0 when data isn't mapped */
+	size_t map_size;
+};
+DECL(Source);
+
+
+/*! Create a source that reads from the provided file, mapping it into memory if possible
+ @param fin Input file object. Not closed by the source
+ */
+Source* Source_initWithFile(Source* self, FILE* fin);
+
+/*! Create a source that reads from a buffer that is already in memory
+ @param data Characters to read, which must outlive the source
+ @param length Number of characters in data
+ */
+Source* Source_initWithBuffer(Source* self, const char* data, size_t length);
+
+/*! Determine whether the entire input is held in memory
+ @return True if data/length hold the input and slices into it are valid
+ */
+static inline bool Source_isBuffered(const Source* self) {
+	return self->data != NULL;
+}
+
+/*! Read the next character from the source
+ @return Next character, or EOF at the end of the input
+ */
+static inline int Source_getc(Source* self) {
+	if(Source_isBuffered(self)) {
+		if(self->pos == self->length) {
+			return EOF;
+		}
+		return (unsigned char)self->data[self->pos++];
+	}
+	
+	return getc(self->stream);
+}
+
+/*! Push back the character most recently returned by Source_getc
+ @param c Character that was read, which may be EOF
+ */
+static inline void Source_ungetc(Source* self, int c) {
+	if(c == EOF) {
+		return;
+	}
+	
+	if(Source_isBuffered(self)) {
+		--self->pos;
+	}
+	else {
+		ungetc(c, self->stream);
+	}
+}
+
+/*! Build a slice over the buffered input between an offset and the cursor
+ @param start Offset of the first character in the slice
+ @return Slice that stays valid for the lifetime of the source
+ */
+static inline Slice Source_sliceFrom(const Source* self, size_t start) {
+	return SLICE(&self->data[start], self->pos - start);
+}
+
+
+#endif /* PL0_SOURCE_H */
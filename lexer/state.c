@@ -7,6 +7,7 @@
 //
 
 #include "state.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -67,13 +68,24 @@ State* State_transition(State* self, char c) {
 	return NULL;
 }
 
-void State_drawGraph(State* self, Graphviz* gv) {
+void State_getNodeName(State* self, StateNamer* namer, void* cookie, char* name, size_t size) {
+	if(namer != NULL) {
+		namer(cookie, self, name, size);
+	}
+	else {
+		snprintf(name, size, "<%p>", (void*)self);
+	}
+}
+
+void State_drawGraph(State* self, Graphviz* gv, StateNamer* namer, void* cookie) {
 	/* Draw state node */
+	char name[STATE_NAME_SIZE];
+	State_getNodeName(self, namer, cookie, name, sizeof(name));
 	const char* shape = self->acceptor ? "doublecircle" : "circle";
-	Graphviz_draw(gv, "<%p> [label = <%s>, shape = %s];", self, self->label ?: " ", shape);
+	Graphviz_draw(gv, "%s [label = <%s>, shape = %s];", name, self->label ?: " ", shape);
 	
 	/* Draw all transitions */
 	foreach(&self->transitions, ptrans) {
-		Transition_drawGraph(*ptrans, gv, self);
+		Transition_drawGraph(*ptrans, gv, self, namer, cookie);
 	}
 }
@@ -14,13 +14,23 @@
 
 typedef struct State State;
 
+/*! Size of a buffer that can hold any state's Graphviz node ID */
+#define STATE_NAME_SIZE 32
+
+/*! Callback that chooses the Graphviz node ID of a state when drawing the lexer's FSM
+ @param cookie Pointer that was passed to State_drawGraph
+ @param state State that is being drawn
+ @param name Buffer to write the node ID into, including any quotes or angle brackets it needs
+ @param size Size of the name buffer in bytes
+ */
+typedef void StateNamer(void* cookie, State* state, char* name, size_t size);
+
 #include "object.h"
 #include "token.h"
 #include "lexer.h"
 #include "transition.h"
 #include "graphviz.h"
-
-typedef Token* Acceptor(Lexer*);
+#include "scan.h"
 
 struct State {
 	OBJECT_BASE;
@@ -39,6 +49,9 @@ struct State {
 	
 	/*! In place of an acceptor function, simple states can specify a token type */
 	token_type simple_type;
+	
+	/*! Set when every character in this run stays on this state, so it can be skipped in bulk */
+	ScanKind scan;
 };
 DECL(State);
 
@@ -76,10 +89,20 @@ void State_addTransition(State* self, Transition* trans);
  */
 State* State_transition(State* self, char c);
 
+/*! Writes the Graphviz node ID of the state
+ @param namer Callback that chooses the node ID, or NULL to name the state after its address
+ @param cookie Pointer passed to namer
+ @param name Buffer to write the node ID into
+ @param size Size of the name buffer in bytes
+ */
+void State_getNodeName(State* self, StateNamer* namer, void* cookie, char* name, size_t size);
+
 /*! Draws the state and any transitions it holds
  @param gv Graphviz drawing object
+ @param namer Callback that chooses each state's node ID, or NULL to name states after their addresses
+ @param cookie Pointer passed to namer
  */
-void State_drawGraph(State* self, Graphviz* gv);
+void State_drawGraph(State* self, Graphviz* gv, StateNamer* namer, void* cookie);
 
 
 #endif /* PL0_STATE_H */
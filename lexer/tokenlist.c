@@ -0,0 +1,249 @@
+//
+//  tokenlist.c
+//  PL/0
+//
+
+#include "tokenlist.h"
+#include <stdint.h>
+#include <string.h>
+#include "intern.h"
+#include "source.h"
+
+
+/* Input being decoded from a binary token list */
+typedef struct TokenReader {
+	const unsigned char* cur;
+	const unsigned char* end;
+} TokenReader;
+
+/* Distinct lexemes in a binary token list, in the order they're stored */
+typedef dynamic_array(const char*) StringTable;
+
+/* String table being built for a binary token list, with a hash table to find each string's index */
+typedef struct StringIndex {
+	StringTable strings;
+	
+	/* Open addressing table holding string indices plus one, where zero marks an empty slot */
+	size_t* slots;
+	size_t capacity;
+} StringIndex;
+
+/* Whether a token type has a lexeme of its own rather than a fixed spelling */
+static inline bool hasLexeme(token_type type);
+
+/* Find the index of an interned string in the string table, adding it if it's new */
+static size_t StringIndex_add(StringIndex* index, const char* str);
+
+static void writeVarint(uint64_t value, FILE* fp);
+static bool readVarint(TokenReader* reader, uint64_t* value);
+static bool readHeader(TokenReader* reader);
+static bool readStrings(TokenReader* reader, StringTable* strings);
+static bool readTokens(TokenReader* reader, const StringTable* strings, TokenArray* tokens);
+
+
+static inline bool hasLexeme(token_type type) {
+	return type == identsym || type == numbersym;
+}
+
+void tokenlist_write(const Token* tokens, size_t count, FILE* fp) {
+	/* Build the string table first, since it comes before the tokens */
+	StringIndex index = {0};
+	size_t* indices = malloc_ff(count * sizeof(*indices) + 1);
+	for(size_t i = 0; i < count; i++) {
+		if(hasLexeme(tokens[i].type)) {
+			/* Identifiers are already interned, and interning numbers lets them be compared by pointer too */
+			indices[i] = StringIndex_add(&index, intern_slice(tokens[i].lexeme));
+		}
+	}
+	
+	fwrite(TOKENLIST_MAGIC, 1, strlen(TOKENLIST_MAGIC), fp);
+	fputc(TOKENLIST_VERSION, fp);
+	
+	writeVarint(index.strings.count, fp);
+	foreach(&index.strings, pstr) {
+		size_t length = strlen(*pstr);
+		writeVarint(length, fp);
+		fwrite(*pstr, 1, length, fp);
+	}
+	
+	writeVarint(count, fp);
+	size_t line_number = 0;
+	for(size_t i = 0; i < count; i++) {
+		fputc(tokens[i].type, fp);
+		if(hasLexeme(tokens[i].type)) {
+			writeVarint(indices[i], fp);
+		}
+		
+		/* Zigzag encoding keeps small deltas small even if they're negative */
+		int64_t delta = (int64_t)tokens[i].line_number - (int64_t)line_number;
+		writeVarint(((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63), fp);
+		line_number = tokens[i].line_number;
+	}
+	
+	destroy(&indices);
+	destroy(&index.slots);
+	array_clear(&index.strings);
+}
+
+static size_t StringIndex_add(StringIndex* index, const char* str) {
+	/* Keep the hash table at most half full */
+	if(index->capacity < index->strings.count * 2 + 2) {
+		destroy(&index->slots);
+		index->capacity = index->capacity != 0 ? index->capacity * 2 : 64;
+		index->slots = calloc_ff(index->capacity, sizeof(*index->slots));
+		
+		enumerate(&index->strings, i, pstr) {
+			size_t slot = ((uintptr_t)*pstr >> 3) & (index->capacity - 1);
+			while(index->slots[slot] != 0) {
+				slot = (slot + 1) & (index->capacity - 1);
+			}
+			index->slots[slot] = i + 1;
+		}
+	}
+	
+	/* Interned strings are unique, so they are hashed and compared by address */
+	size_t slot = ((uintptr_t)str >> 3) & (index->capacity - 1);
+	while(index->slots[slot] != 0) {
+		size_t i = index->slots[slot] - 1;
+		if(index->strings.elems[i] == str) {
+			return i;
+		}
+		slot = (slot + 1) & (index->capacity - 1);
+	}
+	
+	index->slots[slot] = index->strings.count + 1;
+	array_append(&index->strings, str);
+	return index->strings.count - 1;
+}
+
+bool tokenlist_read(FILE* fp, TokenArray* tokens) {
+	/* Regular files are mapped, and anything else is read into memory first */
+	Source* src = Source_initWithFile(Source_alloc(), fp);
+	dynamic_array(unsigned char) buffer = {0};
+	TokenReader reader;
+	if(Source_isBuffered(src)) {
+		reader.cur = (const unsigned char*)&src->data[src->pos];
+		reader.end = (const unsigned char*)&src->data[src->length];
+	}
+	else {
+		int c;
+		while((c = Source_getc(src)) != EOF) {
+			array_append(&buffer, (unsigned char)c);
+		}
+		reader.cur = buffer.elems;
+		reader.end = buffer.elems + buffer.count;
+	}
+	
+	StringTable strings = {0};
+	bool success = readHeader(&reader) && readStrings(&reader, &strings) && readTokens(&reader, &strings, tokens);
+	if(!success) {
+		printf("Invalid binary token list\n");
+	}
+	
+	array_clear(&strings);
+	array_clear(&buffer);
+	release(&src);
+	return success;
+}
+
+static bool readHeader(TokenReader* reader) {
+	size_t magic_length = strlen(TOKENLIST_MAGIC);
+	if((size_t)(reader->end - reader->cur) < magic_length + 1
+	   || memcmp(reader->cur, TOKENLIST_MAGIC, magic_length) != 0
+	   || reader->cur[magic_length] != TOKENLIST_VERSION) {
+		return false;
+	}
+	
+	reader->cur += magic_length + 1;
+	return true;
+}
+
+static bool readStrings(TokenReader* reader, StringTable* strings) {
+	/* Each string takes at least one byte for its length */
+	uint64_t string_count;
+	if(!readVarint(reader, &string_count) || string_count > (uint64_t)(reader->end - reader->cur)) {
+		return false;
+	}
+	
+	for(uint64_t i = 0; i < string_count; i++) {
+		uint64_t length;
+		if(!readVarint(reader, &length) || length > (uint64_t)(reader->end - reader->cur)) {
+			return false;
+		}
+		
+		/* Interning the strings means the tokens don't depend on the file staying open */
+		array_append(strings, intern_slice(SLICE((const char*)reader->cur, (size_t)length)));
+		reader->cur += length;
+	}
+	
+	return true;
+}
+
+static bool readTokens(TokenReader* reader, const StringTable* strings, TokenArray* tokens) {
+	/* Each token takes at least two bytes */
+	uint64_t token_count;
+	if(!readVarint(reader, &token_count) || token_count > (uint64_t)(reader->end - reader->cur) / 2) {
+		return false;
+	}
+	
+	size_t line_number = 0;
+	for(uint64_t i = 0; i < token_count; i++) {
+		if(reader->cur == reader->end) {
+			return false;
+		}
+		
+		token_type type = *reader->cur++;
+		Slice lexeme;
+		if(hasLexeme(type)) {
+			uint64_t index;
+			if(!readVarint(reader, &index) || index >= strings->count) {
+				return false;
+			}
+			lexeme = slice_fromCString(strings->elems[index]);
+		}
+		else if(token_spelling(type) != NULL) {
+			/* Every other token is always spelled the same way */
+			lexeme = slice_fromCString(token_spelling(type));
+		}
+		else {
+			return false;
+		}
+		
+		uint64_t zigzag;
+		if(!readVarint(reader, &zigzag)) {
+			return false;
+		}
+		line_number += (size_t)((zigzag >> 1) ^ -(zigzag & 1));
+		
+		array_append(tokens, Token_make(type, lexeme, line_number));
+	}
+	
+	return true;
+}
+
+static void writeVarint(uint64_t value, FILE* fp) {
+	while(value >= 0x80) {
+		fputc((int)(value & 0x7f) | 0x80, fp);
+		value >>= 7;
+	}
+	fputc((int)value, fp);
+}
+
+static bool readVarint(TokenReader* reader, uint64_t* value) {
+	uint64_t result = 0;
+	for(unsigned shift = 0; shift < 64; shift += 7) {
+		if(reader->cur == reader->end) {
+			return false;
+		}
+		
+		unsigned char byte = *reader->cur++;
+		result |= (uint64_t)(byte & 0x7f) << shift;
+		if(!(byte & 0x80)) {
+			*value = result;
+			return true;
+		}
+	}
+	
+	/* Too many bytes to fit in 64 bits */
+	return false;
+}
@@ -0,0 +1,45 @@
+//
+//  tokenlist.h
+//  PL/0
+//
+
+#ifndef PL0_TOKENLIST_H
+#define PL0_TOKENLIST_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "token.h"
+
+/*! Binary token list format. All integers are unsigned LEB128 varints.
+ @code
+ magic        "PL0T" followed by TOKENLIST_VERSION as a single byte
+ string count
+ strings      length, then that many bytes, for each distinct identifier or number lexeme
+ token count
+ tokens       type byte, then for identsym and numbersym the index of its lexeme in the
+              string table, then the zigzag-encoded difference from the previous token's
+              line number (starting from 0)
+ @endcode
+ */
+#define TOKENLIST_MAGIC "PL0T"
+#define TOKENLIST_VERSION 1
+
+
+/*! Write tokens to a file in the binary token list format
+ @param tokens Array of tokens to write
+ @param count Number of tokens in the array
+ @param fp Output file stream
+ */
+void tokenlist_write(const Token* tokens, size_t count, FILE* fp);
+
+/*! Load every token from a file in the binary token list format, mapping it into memory if possible
+ @param fp Input file stream
+ @param tokens Array where the loaded tokens are appended. Identifier and number lexemes are
+               interned, so they stay valid after the file is closed
+ @return True on success, or false if the file isn't a valid binary token list
+ */
+bool tokenlist_read(FILE* fp, TokenArray* tokens);
+
+
+#endif /* PL0_TOKENLIST_H */
@@ -48,13 +48,17 @@ void Transition_setLabel(Transition* self, const char* label) {
 	self->label = html_str(label);
 }
 
-void Transition_drawGraph(Transition* self, Graphviz* gv, State* src) {
+void Transition_drawGraph(Transition* self, Graphviz* gv, State* src, StateNamer* namer, void* cookie) {
 	/* Draw the target state only if this is a strong reference */
 	if(self->strong) {
-		State_drawGraph(self->state, gv);
+		State_drawGraph(self->state, gv, namer, cookie);
 	}
 	
 	/* Draw the transition edge */
+	char src_name[STATE_NAME_SIZE];
+	char dst_name[STATE_NAME_SIZE];
+	State_getNodeName(src, namer, cookie, src_name, sizeof(src_name));
+	State_getNodeName(self->state, namer, cookie, dst_name, sizeof(dst_name));
 	const char* style = self->strong ? "" : " style = dashed";
-	Graphviz_draw(gv, "<%p> -> <%p> [label = < %s>%s];", src, self->state, self->label, style);
+	Graphviz_draw(gv, "%s -> %s [label = < %s>%s];", src_name, dst_name, self->label, style);
 }
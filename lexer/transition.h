@@ -70,8 +70,10 @@ void Transition_setLabel(Transition* self, const char* label);
 /*! Draws the transition edge and any states strongly referenced
  @param gv Graphviz drawing object
  @param src State the transition originates from
+ @param namer Callback that chooses each state's node ID, or NULL to name states after their addresses
+ @param cookie Pointer passed to namer
  */
-void Transition_drawGraph(Transition* self, Graphviz* gv, State* src);
+void Transition_drawGraph(Transition* self, Graphviz* gv, State* src, StateNamer* namer, void* cookie);
 
 
 #endif /* PL0_TRANSITION_H */
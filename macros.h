@@ -120,10 +120,21 @@ static inline char* strdup_ff(const char* str) {
 	return REQUIRE_PERROR(strdup(str), "strdup_ff");
 }
 
+static inline char* strndup_ff(const char* str, size_t length) {
+	return REQUIRE_PERROR(strndup(str, length), "strndup_ff");
+}
+
 static inline FILE* fopen_ff(const char* fname, const char* mode) {
 	return REQUIRE_PERROR(fopen(fname, mode), fname);
 }
 
+/*! Close a file stream that is optional or may be one of the standard streams, which are left open */
+static inline void fclose_opt(FILE* fp) {
+	if(fp != NULL && fp != stdin && fp != stdout && fp != stderr) {
+		fclose(fp);
+	}
+}
+
 /* Fail-fast allocating format string printing functions that will abort on failures */
 static inline int asprintf_ff(char** pstr, const char* format, ...)
 	__attribute__((format(printf, 2, 3)));
@@ -8,9 +8,12 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
 #include "argparse.h"
 #include "tee.h"
 #include "compiler/pl0c.h"
+#include "compiler/edit_session.h"
 #include "lexer/pl0lex.h"
 #include "vm/pm0.h"
 
@@ -20,10 +23,11 @@ static const char* const input_txt = "input.txt";
 static const char* const lexemetable_txt = "lexemetable.txt";
 static const char* const cleaninput_txt = "cleaninput.txt";
 static const char* const tokenlist_txt = "tokenlist.txt";
+static const char* const tokenlist_bin = "tokenlist.bin";
 static const char* const lexer_dot = "lexer.dot";
 
 /* Compiler files */
-/* tokenlist.txt already included */
+/* tokenlist.txt and tokenlist.bin already included */
 static const char* const symboltable_txt = "symboltable.txt";
 static const char* const mcode_txt = "mcode.txt";
 static const char* const ast_dot = "ast.dot";
@@ -37,6 +41,10 @@ static const char* const cfg_dot = "cfg.dot";
 static const char* const acode_txt = "acode.txt";
 static const char* const stacktrace_txt = "stacktrace.txt";
 
+/* Profiling files */
+static const char* const profile_txt = "profile.txt";
+static const char* const blockmap_txt = "blockmap.txt";
+
 
 /* Command line argument option flags */
 #define OPT_TEE_TOKLIST   (1<<0)
@@ -49,12 +57,34 @@ static const char* const stacktrace_txt = "stacktrace.txt";
 #define OPT_SKIP_COMPILE  (1<<7)
 #define OPT_DEBUGGER      (1<<8)
 #define OPT_NO_STACKTRACE (1<<9)
+#define OPT_PIPELINE      (1<<10)
+#define OPT_BINARY_TOKENS (1<<11)
+#define OPT_WATCH         (1<<12)
+#define OPT_PROFILE_GEN   (1<<13)
+#define OPT_PROFILE_USE   (1<<14)
+
+/* How often to check whether the source file changed in watch mode, in milliseconds */
+#define WATCH_INTERVAL_MS 100
+
+
+/* Compile and run the program in memory, only writing what the tee options ask for to stdout */
+static int run_pipeline(unsigned opts, LEXER_TYPE lexerType, PARSER_TYPE parserType, CODEGEN_TYPE codegenType);
+
+/* Recompile the program whenever the source file changes, only scanning and parsing what the change touched */
+static int run_watch(unsigned opts, CODEGEN_TYPE codegenType);
+
+/* Read the profile and block map written by an earlier run with --profile-generate */
+static Profile* loadProfile(void);
+
+/* Write the compiler's output files for a program that was already parsed */
+static int compileAST(unsigned opts, AST* prog, CODEGEN_TYPE codegenType);
 
 
 int main(int argc, char* argv[]) {
 	/* Flags used to track command line arguments */
 	unsigned opts = 0;
 	int err = EXIT_SUCCESS;
+	LEXER_TYPE lexerType = LEXER_TABLE;
 	PARSER_TYPE parserType = PARSER_RDP;
 	CODEGEN_TYPE codegenType = CODEGEN_PM0;
 	
@@ -93,9 +123,36 @@ int main(int argc, char* argv[]) {
 		ARG('n', "no-stacktrace", "Don't write stacktrace while running (MUCH FASTER!)") {
 			opts |= OPT_NO_STACKTRACE;
 		}
+		ARG(0, "pipeline", "Compile and run in memory without writing any files") {
+			opts |= OPT_PIPELINE;
+		}
+		ARG(0, "binary-tokens", "Pass tokens from the lexer to the compiler in tokenlist.bin") {
+			opts |= OPT_BINARY_TOKENS;
+		}
+		ARG(0, "watch", "Compile again whenever input.txt changes, reusing what didn't change") {
+			opts |= OPT_WATCH;
+		}
+		ARG(0, "profile-generate", "Write how often each part of the program ran to profile.txt") {
+			opts |= OPT_PROFILE_GEN;
+		}
+		ARG(0, "profile-use", "Optimize the program using profile.txt from an earlier --profile-generate") {
+			opts |= OPT_PROFILE_USE;
+		}
+		ARG(0, "lexer=table", "Use the lexer tables generated at build time (default)") {
+			lexerType = LEXER_TABLE;
+		}
+		ARG(0, "lexer=fsm", "Use the lexer FSM built at startup") {
+			lexerType = LEXER_FSM;
+		}
+		ARG(0, "lexer=parallel", "Use the lexer tables on several threads for large files") {
+			lexerType = LEXER_PARALLEL;
+		}
 		ARG(0, "parser=rdp", "Use the recursive descent parser (default)") {
 			parserType = PARSER_RDP;
 		}
+		ARG(0, "parser=parallel", "Use the recursive descent parser on several threads for large files") {
+			parserType = PARSER_PARALLEL;
+		}
 		ARG(0, "parser=bison", "Use the Bison-generated parser") {
 #if WITH_BISON
 			parserType = PARSER_BISON;
@@ -122,6 +179,39 @@ int main(int argc, char* argv[]) {
 		return EXIT_FAILURE;
 	}
 	
+	if((opts & OPT_PROFILE_GEN) && HAS_ANY_FLAGS(opts, OPT_SKIP_COMPILE | OPT_SKIP_RUN | OPT_PIPELINE | OPT_WATCH)) {
+		printf("The --profile-generate option has to compile and run the program, writing the block map and profile files\n");
+		return EXIT_FAILURE;
+	}
+	
+	if((opts & OPT_PROFILE_USE) && HAS_ANY_FLAGS(opts, OPT_SKIP_COMPILE | OPT_WATCH)) {
+		printf("The --profile-use option can't be combined with -r or --watch\n");
+		return EXIT_FAILURE;
+	}
+	
+	if(opts & OPT_PIPELINE) {
+		if(opts & OPT_SKIP_COMPILE) {
+			printf("The -r and --pipeline options cannot be combined because there is no machine code file to run\n");
+			return EXIT_FAILURE;
+		}
+		
+		return run_pipeline(opts, lexerType, parserType, codegenType);
+	}
+	
+	if(opts & OPT_WATCH) {
+		if(opts & OPT_SKIP_COMPILE) {
+			printf("The -r and --watch options cannot be combined because watch mode only compiles\n");
+			return EXIT_FAILURE;
+		}
+		
+		if(parserType != PARSER_RDP) {
+			printf("Watch mode only works with the recursive descent parser\n");
+			return EXIT_FAILURE;
+		}
+		
+		return run_watch(opts, codegenType);
+	}
+	
 	/* Don't run the lexer or compiler when told to run only */
 	if(!(opts & OPT_SKIP_COMPILE)) {
 		/* Create an object used to store the lexer's files */
@@ -134,10 +224,13 @@ int main(int argc, char* argv[]) {
 			/* Duplicate token list to stdout */
 			lexerFiles->tokenlist = ftee(lexerFiles->tokenlist, stdout);
 		}
+		if(opts & OPT_BINARY_TOKENS) {
+			lexerFiles->tokenbin = fopen_ff(tokenlist_bin, "wb");
+		}
 		lexerFiles->graph = fopen_ff(lexer_dot, "w");
 		
 		/* Run the lexer */
-		err = run_lexer(lexerFiles);
+		err = run_lexer(lexerFiles, lexerType);
 		
 		/* Close all the lexer's files */
 		release(&lexerFiles);
@@ -147,9 +240,22 @@ int main(int argc, char* argv[]) {
 			return err;
 		}
 		
+		/* Read the profile before the block map it goes with gets replaced */
+		Profile* profile = NULL;
+		if(opts & OPT_PROFILE_USE) {
+			profile = loadProfile();
+			if(profile == NULL) {
+				return EXIT_FAILURE;
+			}
+		}
+		
 		/* Create an object to store the file pointers needed by the compiler */
 		CompilerFiles* compilerFiles = CompilerFiles_new();
+		compilerFiles->profile = profile;
 		compilerFiles->tokenlist = fopen_ff(tokenlist_txt, "r");
+		if(opts & OPT_BINARY_TOKENS) {
+			compilerFiles->tokenbin = fopen_ff(tokenlist_bin, "rb");
+		}
 		compilerFiles->symtab = fopen_ff(symboltable_txt, "w");
 		if(opts & OPT_TEE_SYMTAB) {
 			/* Duplicate symbol table to stdout */
@@ -165,9 +271,12 @@ int main(int argc, char* argv[]) {
 		compilerFiles->unoptimized_cfg = fopen_ff(unoptimized_cfg_dot, "w");
 #endif
 		compilerFiles->cfg = fopen_ff(cfg_dot, "w");
+		if(opts & OPT_PROFILE_GEN) {
+			compilerFiles->blockmap = fopen_ff(blockmap_txt, "w");
+		}
 		
 		/* Compile the tokens the lexer scanned from the source code into the machine code */
-		err = run_compiler(compilerFiles, parserType, codegenType);
+		err = run_compiler(compilerFiles, lexerType, parserType, codegenType);
 		
 		/* Close all the compiler's files */
 		release(&compilerFiles);
@@ -194,6 +303,9 @@ int main(int argc, char* argv[]) {
 			/* Duplicate the stacktrace file to stdout */
 			vmFiles->stacktrace = ftee(vmFiles->stacktrace, stdout);
 		}
+		if(opts & OPT_PROFILE_GEN) {
+			vmFiles->profile = fopen_ff(profile_txt, "w");
+		}
 		
 		/* Run the VM on the compiled machine code */
 		err = run_vm(vmFiles, !!(opts & OPT_PRETTY), !!(opts & OPT_DEBUGGER));
@@ -204,3 +316,183 @@ int main(int argc, char* argv[]) {
 	
 	return err;
 }
+
+static int run_pipeline(unsigned opts, LEXER_TYPE lexerType, PARSER_TYPE parserType, CODEGEN_TYPE codegenType) {
+	Profile* profile = NULL;
+	if(opts & OPT_PROFILE_USE) {
+		profile = loadProfile();
+		if(profile == NULL) {
+			return EXIT_FAILURE;
+		}
+	}
+	
+	/* Scan the whole source once, keeping its tokens for the parser */
+	LexerFiles* lexerFiles = LexerFiles_new();
+	lexerFiles->input = fopen_ff(input_txt, "r");
+	if(opts & OPT_TEE_TOKLIST) {
+		lexerFiles->tokenlist = stdout;
+	}
+	
+	TokenArray tokens = {0};
+	Lexer* lexer = run_lexer_withTokens(lexerFiles, lexerType, &tokens);
+	release(&lexerFiles);
+	if(lexer == NULL) {
+		array_clear(&tokens);
+		release(&profile);
+		return EXIT_FAILURE;
+	}
+	
+	/* Compile the tokens into an array of instructions */
+	CompilerFiles* compilerFiles = CompilerFiles_new();
+	compilerFiles->profile = profile;
+	if(opts & OPT_TEE_SYMTAB) {
+		compilerFiles->symtab = stdout;
+	}
+	if(opts & OPT_TEE_MCODE) {
+		compilerFiles->mcode = stdout;
+	}
+	
+	InsnArray code = {0};
+	int err = run_compiler_withTokens(compilerFiles, tokens.elems, tokens.count, parserType, codegenType, &code);
+	release(&compilerFiles);
+	
+	/* The lexer owns the text of the tokens, so it can only go away along with them */
+	array_clear(&tokens);
+	release(&lexer);
+	
+	/* Hand the instructions directly to the VM */
+	if(err == 0 && !(opts & OPT_SKIP_RUN)) {
+		VMFiles* vmFiles = VMFiles_new();
+		if(opts & OPT_TEE_DISASM) {
+			vmFiles->acode = stdout;
+		}
+		if((opts & OPT_TEE_TRACE) && !(opts & OPT_NO_STACKTRACE)) {
+			vmFiles->stacktrace = stdout;
+		}
+		
+		err = run_vm_withCode(vmFiles, code.elems, code.count, !!(opts & OPT_PRETTY), !!(opts & OPT_DEBUGGER));
+		release(&vmFiles);
+	}
+	
+	array_clear(&code);
+	return err;
+}
+
+static int run_watch(unsigned opts, CODEGEN_TYPE codegenType) {
+	/* Watching only stops when the process is interrupted, so nothing here is ever cleaned up */
+	EditSession* session = NULL;
+	struct stat last = {0};
+	dynamic_array(char) text = {0};
+	
+	printf("Watching %s for changes, press Ctrl-C to stop\n", input_txt);
+	fflush(stdout);
+	
+	while(true) {
+		/* Editors often save by replacing the file, which changes its inode instead of its time. The
+		 time has nanoseconds so that two saves within the same second aren't mistaken for one
+		 */
+		struct stat st;
+		bool changed = stat(input_txt, &st) == 0 && (
+			session == NULL
+			|| st.st_mtim.tv_sec != last.st_mtim.tv_sec
+			|| st.st_mtim.tv_nsec != last.st_mtim.tv_nsec
+			|| st.st_size != last.st_size
+			|| st.st_ino != last.st_ino
+		);
+		
+		if(changed) {
+			last = st;
+			
+			/* Read the whole file */
+			FILE* fp = fopen_ff(input_txt, "r");
+			text.count = 0;
+			char buf[4096];
+			size_t n;
+			while((n = fread(buf, 1, sizeof(buf), fp)) != 0) {
+				array_extend(&text, buf, n);
+			}
+			fclose(fp);
+			
+			/* Only the tokens and procedures around the change are scanned and parsed again */
+			if(session == NULL) {
+				session = EditSession_initWithText(EditSession_alloc(), text.elems, text.count);
+			}
+			else {
+				EditSession_setText(session, text.elems, text.count);
+			}
+			
+			if(session->program == NULL) {
+				printf("Stopping due to an earlier error, waiting for %s to change\n", input_txt);
+			}
+			else if(compileAST(opts, session->program, codegenType) == 0) {
+				printf("Compiled %s (scanned %zu of %zu tokens, parsed %zu tokens",
+					   input_txt, session->scanned_count, session->tokens.count, session->parsed_count);
+				
+				/* Say which part of the program was parsed again */
+				const char* proc = NULL;
+				if(session->reparsed_proc != AST_NONE) {
+					proc = AST_ident(session->program, session->program->procs.elems[session->reparsed_proc].ident);
+				}
+				if(session->reparsed_stmt) {
+					if(proc != NULL) {
+						printf(" in the body of procedure %s", proc);
+					}
+					else {
+						printf(" in the body of the main block");
+					}
+				}
+				else if(proc != NULL) {
+					printf(" in procedure %s", proc);
+				}
+				printf(")\n");
+			}
+			fflush(stdout);
+		}
+		
+		struct timespec delay = {
+			.tv_sec = WATCH_INTERVAL_MS / 1000,
+			.tv_nsec = (WATCH_INTERVAL_MS % 1000) * 1000000L
+		};
+		nanosleep(&delay, NULL);
+	}
+}
+
+static Profile* loadProfile(void) {
+	FILE* counts = fopen(profile_txt, "r");
+	FILE* blockmap = fopen(blockmap_txt, "r");
+	Profile* profile = NULL;
+	if(counts == NULL || blockmap == NULL) {
+		printf("Couldn't open %s and %s, which are written by running with --profile-generate\n",
+		       profile_txt, blockmap_txt);
+	}
+	else {
+		profile = Profile_initWithFiles(Profile_alloc(), counts, blockmap);
+		if(profile == NULL) {
+			printf("The profile in %s and %s is malformed\n", profile_txt, blockmap_txt);
+		}
+	}
+	
+	fclose_opt(counts);
+	fclose_opt(blockmap);
+	return profile;
+}
+
+static int compileAST(unsigned opts, AST* prog, CODEGEN_TYPE codegenType) {
+	CompilerFiles* compilerFiles = CompilerFiles_new();
+	compilerFiles->symtab = fopen_ff(symboltable_txt, "w");
+	if(opts & OPT_TEE_SYMTAB) {
+		/* Duplicate symbol table to stdout */
+		compilerFiles->symtab = ftee(compilerFiles->symtab, stdout);
+	}
+	compilerFiles->mcode = fopen_ff(mcode_txt, "w");
+	if(opts & OPT_TEE_MCODE) {
+		/* Duplicate machine code to stdout */
+		compilerFiles->mcode = ftee(compilerFiles->mcode, stdout);
+	}
+	compilerFiles->ast = fopen_ff(ast_dot, "w");
+	compilerFiles->cfg = fopen_ff(cfg_dot, "w");
+	
+	int err = run_compiler_withAST(compilerFiles, prog, codegenType, NULL);
+	release(&compilerFiles);
+	return err;
+}
@@ -0,0 +1,56 @@
+//
+//  slice.h
+//  PL/0
+//
+
+#ifndef PL0_SLICE_H
+#define PL0_SLICE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "macros.h"
+
+/*! Non-owning view of a run of characters, which is not necessarily null-terminated */
+typedef struct Slice {
+	/*! Pointer to the first character in the slice */
+	const char* text;
+	
+	/*! Number of characters in the slice */
+	size_t length;
+} Slice;
+
+/*! Build a slice from a pointer and a length */
+#define SLICE(text, length) ((Slice){(text), (length)})
+
+/*! printf format specifier for printing a slice, use along with SLICE_ARG */
+#define PRIslice ".*s"
+
+/*! Expands to the printf arguments that match PRIslice */
+#define SLICE_ARG(slice) (int)(slice).length, (slice).text
+
+/*! Build a slice that views an entire null-terminated string */
+static inline Slice slice_fromCString(const char* cstr) {
+	return SLICE(cstr, strlen(cstr));
+}
+
+/*! Determine whether two slices hold the same characters */
+static inline bool slice_equals(Slice a, Slice b) {
+	return a.length == b.length && memcmp(a.text, b.text, a.length) == 0;
+}
+
+/*! Parse a slice holding only decimal digits as an unsigned number */
+static inline unsigned long slice_toULong(Slice slice) {
+	unsigned long value = 0;
+	for(size_t i = 0; i < slice.length; i++) {
+		value = value * 10 + (slice.text[i] - '0');
+	}
+	return value;
+}
+
+/*! Copy the contents of a slice into a newly allocated null-terminated string */
+static inline char* slice_dup(Slice slice) {
+	return strndup_ff(slice.text, slice.length);
+}
+
+#endif /* PL0_SLICE_H */
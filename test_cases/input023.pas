@@ -0,0 +1,21 @@
+var width, height;
+
+procedure Area();
+	var sum;
+	procedure AddSquare();
+		sum := sum + (width + height) * (width + height);
+	begin
+		sum := width * height;
+		call AddSquare();
+		write sum;
+		write width * height + width * height - (width * height) * 2;
+		return := sum
+	end;
+
+begin
+	width := 3;
+	height := 4;
+	write call Area();
+	height := height + 1;
+	write (width + height) * (width + height);
+end.
@@ -0,0 +1,31 @@
+var total, i;
+
+procedure Max(a, b);
+	begin
+		if a > b then return := a else return := b
+	end;
+
+procedure Square(n);
+	var sq;
+	begin
+		sq := n * n;
+		return := sq
+	end;
+
+procedure Report();
+	begin
+		write total;
+		total := 0
+	end;
+
+begin
+	total := 0;
+	i := 1;
+	while call Max(i, 2) < 5 do
+	begin
+		total := total + call Square(i);
+		i := i + 1
+	end;
+	call Report();
+	write call Max(call Square(3), call Square(-4)) + call Square(2);
+end.
@@ -0,0 +1,49 @@
+var width, height, x, y, sum, scale;
+
+procedure Grow();
+	begin
+		scale := scale + 1
+	end;
+
+procedure Area(w, h);
+	var i, total;
+	begin
+		i := 0;
+		total := 0;
+		while i < w * h do
+		begin
+			total := total + (w + h) * 2;
+			i := i + 1
+		end;
+		return := total
+	end;
+
+begin
+	width := 3;
+	height := 4;
+	scale := 1;
+	sum := 0;
+	y := 0;
+	while y < height do
+	begin
+		x := 0;
+		while x < width * 2 do
+		begin
+			sum := sum + width * height + x;
+			x := x + 1
+		end;
+		y := y + 1
+	end;
+	write sum;
+	
+	sum := 0;
+	x := 0;
+	while x < 3 do
+	begin
+		sum := sum + scale * 10;
+		call Grow();
+		x := x + 1
+	end;
+	write sum;
+	write call Area(width, height);
+end.
@@ -0,0 +1,14 @@
+const step = 2, count = 2;
+var x;
+procedure unused();
+	begin
+		write 5 % 0 /* Never called, so this never runs */
+	end;
+begin
+	x := 0;
+	if 0 = 1 then write 1 / 0;
+	while x = 1 do write 1 / 0;
+	if x > 100 then write x / (step - count);
+	write 9;
+	write x / (step - count) /* Dividing by a constant that folds to zero gets a warning, and is reported when it runs */
+end.
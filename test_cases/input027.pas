@@ -0,0 +1,52 @@
+var g;
+
+/* Procedures that declare their own procedures are never inlined, so these stay real calls */
+procedure Seven(n);
+	procedure Bump();
+		g := g + 1;
+	begin
+		call Bump();
+		return := n + 4
+	end;
+
+procedure Peek();
+	procedure Bump();
+		g := g + 1;
+	begin
+		call Bump();
+		write return; /* Always 0 when a procedure starts */
+		return := 2
+	end;
+
+procedure Ignore(n);
+	procedure Set();
+		g := n;
+	begin
+		call Set();
+		call Seven(n) /* The result isn't returned from here */
+	end;
+
+procedure Keep();
+	procedure Set();
+		g := 5;
+	begin
+		call Set();
+		return := 9;
+		call Peek()
+	end;
+
+procedure Pass();
+	procedure Set();
+		g := 6;
+	begin
+		call Set();
+		return := 9;
+		return := call Peek()
+	end;
+
+begin
+	write call Ignore(3);
+	write call Keep();
+	write call Pass();
+	write g
+end.
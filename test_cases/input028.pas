@@ -0,0 +1,46 @@
+var g;
+
+/* Procedures that declare their own procedures are never inlined, so these stay real calls */
+procedure Four(a, b);
+	procedure Bump();
+		g := g + 1;
+	begin
+		call Bump();
+		return := a + b
+	end;
+
+procedure Five();
+	procedure Bump();
+		g := g + 1;
+	begin
+		call Bump();
+		write return; /* Always 0 when a procedure starts */
+		return := 5
+	end;
+
+procedure Store();
+	var v;
+	procedure Set();
+		g := 10;
+	begin
+		call Set();
+		call Four(3, 4);
+		v := 5 /* Nothing reads this, so the call is left at the end */
+	end;
+
+procedure Scale(i);
+	var a;
+	procedure Set();
+		g := 20;
+	begin
+		call Set();
+		return := 1;
+		a := i * (call Five() * 100) /* Only the call is needed */
+	end;
+
+begin
+	write call Store();
+	write g;
+	write call Scale(2);
+	write g
+end.
@@ -0,0 +1,17 @@
+var x;
+
+procedure A();
+begin
+	return := 8
+end;
+
+procedure B();
+begin
+	write return /* Always 0 when a procedure starts, even inlined into the same slots as A */
+end;
+
+begin
+	x := call A();
+	call B;
+	write x
+end.
@@ -9,19 +9,48 @@
 #include "token.h"
 #include <stdlib.h>
 #include <string.h>
+#include "macros.h"
 
 
-Destroyer(Token) {
-	destroy(&self->lexeme);
-}
-DEF(Token);
+static const char* const token_spellings[] = {
+	[nulsym]       = "EOF",
+	[plussym]      = "+",
+	[minussym]     = "-",
+	[multsym]      = "*",
+	[slashsym]     = "/",
+	[oddsym]       = "odd",
+	[eqsym]        = "=",
+	[neqsym]       = "<>",
+	[lessym]       = "<",
+	[leqsym]       = "<=",
+	[gtrsym]       = ">",
+	[geqsym]       = ">=",
+	[lparentsym]   = "(",
+	[rparentsym]   = ")",
+	[commasym]     = ",",
+	[semicolonsym] = ";",
+	[periodsym]    = ".",
+	[becomessym]   = ":=",
+	[beginsym]     = "begin",
+	[endsym]       = "end",
+	[ifsym]        = "if",
+	[thensym]      = "then",
+	[whilesym]     = "while",
+	[dosym]        = "do",
+	[callsym]      = "call",
+	[constsym]     = "const",
+	[varsym]       = "var",
+	[procsym]      = "procedure",
+	[writesym]     = "write",
+	[readsym]      = "read",
+	[elsesym]      = "else",
+	[percentsym]   = "%",
+};
 
-Token* Token_initWithType(Token* self, token_type type, const char* lexeme, size_t line_number) {
-	if((self = Token_init(self))) {
-		self->type = type;
-		self->lexeme = strdup_ff(lexeme);
-		self->line_number = line_number;
+const char* token_spelling(token_type type) {
+	if((size_t)type >= ARRAY_COUNT(token_spellings)) {
+		return NULL;
 	}
 	
-	return self;
+	return token_spellings[type];
 }
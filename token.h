@@ -17,6 +17,7 @@ typedef enum token_type token_type;
 typedef struct Token Token;
 
 #include "object.h"
+#include "slice.h"
 
 enum token_type {
 	nulsym = 1,    /*!< End of file */
@@ -55,27 +56,39 @@ enum token_type {
 	percentsym     /*!< The modulus operator, "%" */
 };
 
+/*! Tokens are small values that are copied around rather than allocated. The lexeme either
+ views the memory-mapped source directly or storage owned by whatever produced the token.
+ Identifier lexemes are always interned (see intern.h) and null-terminated.
+ */
 struct Token {
-	OBJECT_BASE;
-	
 	/*! Type of token */
 	token_type type;
 	
 	/*! Raw text that comprises the token */
-	char* lexeme;
+	Slice lexeme;
 	
 	/*! Source line number where the token came from */
 	size_t line_number;
 };
-DECL(Token);
+
+/*! Growable array of tokens, used to hand a whole program from the lexer to the parser */
+typedef dynamic_array(Token) TokenArray;
 
 
-/*! Base token object initializer
+/*! Build a token value
  @param type Type of the token to create
  @param lexeme Raw text that comprises the token
  @param line_number Source line number where the token came from
  */
-Token* Token_initWithType(Token* self, token_type type, const char* lexeme, size_t line_number);
+static inline Token Token_make(token_type type, Slice lexeme, size_t line_number) {
+	return (Token){type, lexeme, line_number};
+}
+
+/*! Get the fixed spelling of a token type
+ @param type Type of token
+ @return Text of the token, or NULL for types whose text varies (identifiers and numbers)
+ */
+const char* token_spelling(token_type type);
 
 
 #endif /* PL0_TOKEN_H */
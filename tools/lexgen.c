@@ -0,0 +1,330 @@
+//
+//  lexgen.c
+//  PL/0
+//
+
+/****************************************************************************************\
+ * Build-time generator for the PL/0 lexer's tables. It builds the lexer's FSM from the *
+ * token specification in lexer/pl0spec.c exactly like the FSM lexer does at runtime,   *
+ * then flattens it into the static tables that the table lexer scans with. It also     *
+ * places the reserved words from lexer/keywords.c into keyword_lookup's hash table.    *
+\****************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "macros.h"
+#include "lexer/lexer.h"
+#include "lexer/pl0spec.h"
+#include "lexer/keywords.h"
+#include "graphviz.h"
+
+
+/* Number of distinct values a char can take */
+#define CHAR_COUNT 256
+
+typedef dynamic_array(State*) StateArray;
+
+/* lexgen never scans any text, so the acceptors it links against look reserved words up in this
+ empty table while it generates the real one */
+const uint8_t PL0_keywordTable[KEYWORD_TABLE_SIZE];
+
+/*! Place every reserved word in its slot of the keyword hash table
+ @param prog Name of the program, for error messages
+ @param table Hash table to fill in, which must start out zeroed
+ @return True on success, or false if two reserved words hash to the same slot
+ */
+static bool hash_keywords(const char* prog, uint8_t table[KEYWORD_TABLE_SIZE]);
+
+/*! Find every state reachable from the initial state, which will be the first state
+ @param states Array to fill with all of the states, in breadth-first order
+ */
+static void collect_states(State* start, StateArray* states);
+
+/*! Find the index of a state within the array of all states
+ @return Index of the state, or LEXTABLE_NO_STATE if state is NULL
+ */
+static uint8_t state_index(StateArray* states, State* state);
+
+/*! Find the index of an acceptor function within PL0_acceptors
+ @return Index of the acceptor function, or -1 if acceptfn is NULL
+ */
+static int acceptor_index(Acceptor* acceptfn);
+
+/*! Get the name of the enum constant for a scan kind */
+static const char* scan_name(ScanKind scan);
+
+/*! Name a state's Graphviz node after its index rather than its address, so that the
+ generated graph is reproducible. Used as a StateNamer, with the array of all states as cookie
+ */
+static void name_state(void* cookie, State* state, char* name, size_t size);
+
+/*! Draw the FSM and capture the DOT statements that were drawn for it
+ @param states Array of all states, with the initial state first
+ @return Newly allocated string holding the DOT statements
+ */
+static char* draw_fsm(StateArray* states);
+
+/*! Write a string as a C string literal, splitting it onto a new line after each newline */
+static void write_string_literal(FILE* fp, const char* str);
+
+
+int main(int argc, char* argv[]) {
+	if(argc != 2) {
+		fprintf(stderr, "Usage: %s output.c\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	
+	/* Build the FSM from PL/0's token specification, just like the FSM lexer does */
+	Lexer* lexer = Lexer_new();
+	lexer->fsm = State_new();
+	PL0_addTokens(lexer);
+	
+	StateArray states = {};
+	collect_states(lexer->fsm, &states);
+	if(states.count >= LEXTABLE_NO_STATE) {
+		fprintf(stderr, "%s: Too many lexer states (%zu)\n", argv[0], states.count);
+		return EXIT_FAILURE;
+	}
+	
+	/* Fill in the full transition table with one column per character */
+	uint8_t (*next)[CHAR_COUNT] = calloc_ff(states.count, sizeof(*next));
+	enumerate(&states, i, pstate) {
+		for(int c = 0; c < CHAR_COUNT; c++) {
+			next[i][c] = state_index(&states, State_transition(*pstate, (char)c));
+		}
+	}
+	
+	/* Characters whose columns are identical go into the same character class */
+	uint8_t char_class[CHAR_COUNT];
+	int class_char[CHAR_COUNT];
+	size_t class_count = 0;
+	for(int c = 0; c < CHAR_COUNT; c++) {
+		size_t cls;
+		for(cls = 0; cls < class_count; cls++) {
+			int rep = class_char[cls];
+			size_t i;
+			for(i = 0; i < states.count && next[i][rep] == next[i][c]; i++) {
+				/* Keep comparing */
+			}
+			if(i == states.count) {
+				break;
+			}
+		}
+		
+		if(cls == class_count) {
+			class_char[class_count++] = c;
+		}
+		char_class[c] = (uint8_t)cls;
+	}
+	
+	uint8_t keyword_table[KEYWORD_TABLE_SIZE] = {};
+	if(!hash_keywords(argv[0], keyword_table)) {
+		return EXIT_FAILURE;
+	}
+	
+	FILE* fp = fopen(argv[1], "w");
+	if(fp == NULL) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	
+	fprintf(fp, "/* Generated by tools/lexgen from PL0_addTokens in lexer/pl0spec.c. Do not edit! */\n\n");
+	fprintf(fp, "#include \"lexer/pl0spec.h\"\n");
+	fprintf(fp, "#include \"lexer/keywords.h\"\n\n");
+	
+	/* Reserved word hash table for keyword_lookup */
+	fprintf(fp, "const uint8_t PL0_keywordTable[KEYWORD_TABLE_SIZE] = {");
+	for(int slot = 0; slot < KEYWORD_TABLE_SIZE; slot++) {
+		fprintf(fp, "%s%u,", slot % 16 == 0 ? "\n\t" : " ", keyword_table[slot]);
+	}
+	fprintf(fp, "\n};\n\n");
+	
+	/* Character class table */
+	fprintf(fp, "static const uint8_t char_class[%d] = {", CHAR_COUNT);
+	for(int c = 0; c < CHAR_COUNT; c++) {
+		fprintf(fp, "%s%u,", c % 16 == 0 ? "\n\t" : " ", char_class[c]);
+	}
+	fprintf(fp, "\n};\n\n");
+	
+	/* Transition table, one row per state */
+	fprintf(fp, "static const uint8_t next[%zu * %zu] = {\n", states.count, class_count);
+	for(size_t i = 0; i < states.count; i++) {
+		fprintf(fp, "\t/* %2zu */", i);
+		for(size_t cls = 0; cls < class_count; cls++) {
+			fprintf(fp, " %3u,", next[i][class_char[cls]]);
+		}
+		fprintf(fp, "\n");
+	}
+	fprintf(fp, "};\n\n");
+	
+	/* State information */
+	fprintf(fp, "static const LexTableState states[%zu] = {\n", states.count);
+	enumerate(&states, i, pstate) {
+		State* state = *pstate;
+		int acceptfn = acceptor_index(state->acceptfn);
+		if(acceptfn == -2) {
+			fprintf(stderr, "%s: State %zu uses an acceptor that is missing from PL0_acceptors\n", argv[0], i);
+			return EXIT_FAILURE;
+		}
+		
+		fprintf(fp, "\t/* %2zu */ {%s, %d, %d, %s},\n",
+			i, state->acceptor ? "true" : "false", acceptfn, state->simple_type, scan_name(state->scan));
+	}
+	fprintf(fp, "};\n\n");
+	
+	/* Graph of the FSM for lexer.dot */
+	char* graph = draw_fsm(&states);
+	fprintf(fp, "static const char graph[] =\n");
+	write_string_literal(fp, graph);
+	fprintf(fp, ";\n\n");
+	destroy(&graph);
+	
+	fprintf(fp, "const LexTable PL0_lexTable = {\n");
+	fprintf(fp, "\t.state_count = %zu,\n", states.count);
+	fprintf(fp, "\t.class_count = %zu,\n", class_count);
+	fprintf(fp, "\t.char_class = char_class,\n");
+	fprintf(fp, "\t.next = next,\n");
+	fprintf(fp, "\t.states = states,\n");
+	fprintf(fp, "\t.acceptors = PL0_acceptors,\n");
+	fprintf(fp, "\t.graph = graph\n");
+	fprintf(fp, "};\n");
+	
+	if(fclose(fp) != 0) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	
+	free(next);
+	array_clear(&states);
+	release(&lexer);
+	return EXIT_SUCCESS;
+}
+
+static bool hash_keywords(const char* prog, uint8_t table[KEYWORD_TABLE_SIZE]) {
+	for(size_t i = 0; i < PL0_KEYWORD_COUNT; i++) {
+		const Keyword* keyword = &PL0_keywords[i];
+		if(keyword->length < KEYWORD_MIN_LENGTH || keyword->length > KEYWORD_MAX_LENGTH) {
+			fprintf(stderr, "%s: Reserved word \"%s\" is not between %d and %d characters long\n",
+			        prog, keyword->text, KEYWORD_MIN_LENGTH, KEYWORD_MAX_LENGTH);
+			return false;
+		}
+		
+		const unsigned char* text = (const unsigned char*)keyword->text;
+		size_t slot = KEYWORD_HASH(text, keyword->length);
+		if(table[slot] != 0) {
+			fprintf(stderr, "%s: Reserved words \"%s\" and \"%s\" have the same hash\n",
+			        prog, PL0_keywords[table[slot] - 1].text, keyword->text);
+			return false;
+		}
+		
+		table[slot] = (uint8_t)(i + 1);
+	}
+	
+	return true;
+}
+
+static void collect_states(State* start, StateArray* states) {
+	array_append(states, start);
+	
+	/* The array doubles as the BFS queue */
+	for(size_t i = 0; i < states->count; i++) {
+		foreach(&states->elems[i]->transitions, ptrans) {
+			State* target = (*ptrans)->state;
+			if(state_index(states, target) == LEXTABLE_NO_STATE) {
+				array_append(states, target);
+			}
+		}
+	}
+}
+
+static uint8_t state_index(StateArray* states, State* state) {
+	enumerate(states, i, pstate) {
+		if(*pstate == state) {
+			return (uint8_t)i;
+		}
+	}
+	
+	return LEXTABLE_NO_STATE;
+}
+
+static int acceptor_index(Acceptor* acceptfn) {
+	if(acceptfn == NULL) {
+		return -1;
+	}
+	
+	for(int i = 0; i < PL0_ACCEPTOR_COUNT; i++) {
+		if(PL0_acceptors[i] == acceptfn) {
+			return i;
+		}
+	}
+	
+	/* Not found */
+	return -2;
+}
+
+static const char* scan_name(ScanKind scan) {
+	switch(scan) {
+		case SCAN_NONE:   return "SCAN_NONE";
+		case SCAN_ALNUM:  return "SCAN_ALNUM";
+		case SCAN_DIGITS: return "SCAN_DIGITS";
+		
+		default:
+			ASSERT(!"Unknown scan kind");
+	}
+}
+
+static void name_state(void* cookie, State* state, char* name, size_t size) {
+	snprintf(name, size, "<s%u>", state_index(cookie, state));
+}
+
+static char* draw_fsm(StateArray* states) {
+	FILE* tmp = tmpfile();
+	ASSERT(tmp != NULL);
+	
+	/* Only capture what is drawn between the graph's header and its closing brace */
+	Graphviz* gv = Graphviz_initWithFile(Graphviz_alloc(), tmp, "Lexer");
+	long begin = ftell(tmp);
+	State_drawGraph(states->elems[0], gv, &name_state, states);
+	long end = ftell(tmp);
+	release(&gv);
+	
+	char* text = malloc_ff(end - begin + 1);
+	fseek(tmp, begin, SEEK_SET);
+	size_t length = fread(text, 1, end - begin, tmp);
+	text[length] = '\0';
+	fclose(tmp);
+	return text;
+}
+
+static void write_string_literal(FILE* fp, const char* str) {
+	fprintf(fp, "\t\"");
+	for(const char* p = str; *p != '\0'; p++) {
+		switch(*p) {
+			case '\\': fprintf(fp, "\\\\"); break;
+			case '"':  fprintf(fp, "\\\""); break;
+			case '\t': fprintf(fp, "\\t"); break;
+			case '\n':
+				fprintf(fp, "\\n\"");
+				if(p[1] != '\0') {
+					fprintf(fp, "\n\t\"");
+				}
+				continue;
+			
+			default:
+				if((unsigned char)*p < ' ' || (unsigned char)*p >= 0x7f) {
+					/* Octal escapes can't be mistaken as continuing into the next character */
+					fprintf(fp, "\\%03o", (unsigned char)*p);
+				}
+				else {
+					fputc(*p, fp);
+				}
+				break;
+		}
+	}
+	
+	/* Close the literal unless the string ended with a newline, which already closed it */
+	if(str[0] == '\0' || str[strlen(str) - 1] != '\n') {
+		fprintf(fp, "\"");
+	}
+}
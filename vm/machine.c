@@ -18,6 +18,7 @@
 static void interrupt_handler(int sig);
 static void enable_interrupt_handler(void);
 static void disable_interrupt_handler(void);
+static bool Machine_disassemble(Machine* self);
 static bool Machine_fetch(Machine* self);
 static void Machine_readChunk(Machine* self);
 static bool Machine_readIntString(Machine* self, dynamic_string* intstr);
@@ -172,6 +173,10 @@ void Machine_enableMarkdown(Machine* self) {
 	Machine_setSeparator(self, "|");
 }
 
+void Machine_enableProfiling(Machine* self) {
+	self->profiling = true;
+}
+
 void Machine_setLogFile(Machine* self, FILE* flog) {
 	self->flog = flog;
 }
@@ -183,6 +188,22 @@ bool Machine_loadCode(Machine* self, FILE* fp) {
 		return false;
 	}
 	
+	return Machine_disassemble(self);
+}
+
+bool Machine_loadInsns(Machine* self, const Insn* code, size_t count) {
+	/* Copy as much of the program as fits into code memory, just like read_program() */
+	if(count >= MAX_CODE_LENGTH) {
+		fprintf(stderr, "Completely filled code array\n");
+		count = MAX_CODE_LENGTH;
+	}
+	memcpy(&self->codemem[0], code, count * sizeof(*code));
+	self->insn_count = (Word)count;
+	
+	return Machine_disassemble(self);
+}
+
+static bool Machine_disassemble(Machine* self) {
 	/* Create string for table column headers */
 	snprintf(&self->codelines[0][0], DIS_LINE_LENGTH,
 			 /*           |      Insn|        OP|         L|         M| */
@@ -234,6 +255,15 @@ void Machine_printDisassembly(Machine* self, FILE* fp) {
 	fprintf(fp, "\n");
 }
 
+void Machine_writeProfile(Machine* self, FILE* fp) {
+	for(Word addr = 0; addr < self->insn_count; addr++) {
+		if(self->exec_counts[addr] != 0) {
+			fprintf(fp, "%"PRIdWORD" %"PRIu64" %"PRIu64"\n",
+				addr, self->exec_counts[addr], self->taken_counts[addr]);
+		}
+	}
+}
+
 static void Machine_readChunk(Machine* self) {
 	if(interrupted) {
 		return;
@@ -571,6 +601,11 @@ static bool Machine_execALU(Machine* self) {
 			TOP = (TOP >= POPPED);
 			break;
 			
+		case ALU_DUP:
+			++SP;
+			TOP = STACK(SP - 1);
+			break;
+			
 		default:
 			runtimeError("Unknown OPR instruction: OPR %"PRIdWORD, IR.imm);
 			self->status = STATUS_ERROR;
@@ -604,6 +639,7 @@ static bool Machine_runOne(Machine* self) {
 	}
 	
 	/* Increment program counter after we know we don't need to break */
+	Word addr = PC;
 	++PC;
 	
 	/* Execute cycle */
@@ -613,6 +649,14 @@ static bool Machine_runOne(Machine* self) {
 		--PC;
 	}
 	
+	/* Count the instruction, and whether it jumped if it's a JPC, only when writing a profile */
+	if(self->profiling) {
+		++self->exec_counts[addr];
+		if(success && IR.op == OP_JPC && POPPED == 0) {
+			++self->taken_counts[addr];
+		}
+	}
+	
 	return success;
 }
 
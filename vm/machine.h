@@ -101,6 +101,15 @@ struct Machine {
 	/*! The data stack */
 	Word stack[MAX_STACK_HEIGHT];
 	
+	/*! Whether to count how often each instruction runs */
+	bool profiling;
+	
+	/*! Number of times the instruction at each code address was executed */
+	uint64_t exec_counts[MAX_CODE_LENGTH];
+	
+	/*! Number of times the JPC instruction at each code address jumped */
+	uint64_t taken_counts[MAX_CODE_LENGTH];
+	
 	/*! Array of breakpoints set */
 	dynamic_array(Breakpoint) bps;
 	
@@ -128,6 +137,9 @@ void Machine_setSeparator(Machine* self, const char* sep);
 /*! Instructs the machine to enable markdown formatted output */
 void Machine_enableMarkdown(Machine* self);
 
+/*! Instructs the machine to count how often each instruction runs, for Machine_writeProfile */
+void Machine_enableProfiling(Machine* self);
+
 /*! Set the output file stream where stacktrace info will be logged */
 void Machine_setLogFile(Machine* self, FILE* flog);
 
@@ -137,6 +149,13 @@ void Machine_setLogFile(Machine* self, FILE* flog);
  */
 bool Machine_loadCode(Machine* self, FILE* fp);
 
+/*! Loads a machine code program that is already in memory
+ @param code Array of instructions to copy into code memory
+ @param count Number of instructions in @p code
+ @return True on success, or false on error
+ */
+bool Machine_loadInsns(Machine* self, const Insn* code, size_t count);
+
 /*! Writes the disassembled code in table format to the given file
  @param fp Output file stream to pring the disassembly table
  */
@@ -196,5 +215,12 @@ void Machine_printStack(Machine* self, FILE* fp);
 /*! Prints the stack and registers to the specified file stream */
 void Machine_printState(Machine* self, FILE* fp);
 
+/*! Writes how many times each instruction was executed to the specified file stream. Each line
+ has the code address, its execution count, and how many times it jumped if it's a JPC. Addresses
+ that never ran are left out. Nothing is counted unless profiling was enabled before running.
+ @param fp Output file stream to write the profile to
+ */
+void Machine_writeProfile(Machine* self, FILE* fp);
+
 
 #endif /* PL0_MACHINE_H */
@@ -15,14 +15,46 @@
 
 
 Destroyer(VMFiles) {
-	fclose(self->mcode);
-	fclose(self->acode);
-	fclose(self->stacktrace);
+	fclose_opt(self->mcode);
+	fclose_opt(self->acode);
+	fclose_opt(self->stacktrace);
+	fclose_opt(self->profile);
 }
 DEF(VMFiles);
 
 
+/* Create a virtual machine that reads and writes the standard streams */
+static Machine* createMachine(bool markdown);
+
+/* Run a machine whose code has already been loaded */
+static int runMachine(Machine* cpu, VMFiles* files, bool debug);
+
+
 int run_vm(VMFiles* files, bool markdown, bool debug) {
+	Machine* cpu = createMachine(markdown);
+	
+	/* Load the code from the specified file into code memory (and disassemble it) */
+	if(!Machine_loadCode(cpu, files->mcode)) {
+		release(&cpu);
+		return EXIT_FAILURE;
+	}
+	
+	return runMachine(cpu, files, debug);
+}
+
+int run_vm_withCode(VMFiles* files, const Insn* code, size_t count, bool markdown, bool debug) {
+	Machine* cpu = createMachine(markdown);
+	
+	/* Copy the compiled code into code memory (and disassemble it) */
+	if(!Machine_loadInsns(cpu, code, count)) {
+		release(&cpu);
+		return EXIT_FAILURE;
+	}
+	
+	return runMachine(cpu, files, debug);
+}
+
+static Machine* createMachine(bool markdown) {
 	/* Create virtual machine */
 	Machine* cpu = Machine_initWithPorts(Machine_alloc(), stdin, stdout);
 	
@@ -31,19 +63,24 @@ int run_vm(VMFiles* files, bool markdown, bool debug) {
 		Machine_enableMarkdown(cpu);
 	}
 	
-	/* Load the code from the specified file into code memory (and disassemble it) */
-	if(!Machine_loadCode(cpu, files->mcode)) {
-		release(&cpu);
-		return EXIT_FAILURE;
-	}
-	
+	return cpu;
+}
+
+static int runMachine(Machine* cpu, VMFiles* files, bool debug) {
 	/* Write disassembly table to the stacktrace file */
-	Machine_printDisassembly(cpu, files->acode);
-	fflush(files->acode);
+	if(files->acode != NULL) {
+		Machine_printDisassembly(cpu, files->acode);
+		fflush(files->acode);
+	}
 	
 	/* Enable logging to the stacktrace file */
 	Machine_setLogFile(cpu, files->stacktrace);
 	
+	/* Only count instructions when there's a profile to write them to */
+	if(files->profile != NULL) {
+		Machine_enableProfiling(cpu);
+	}
+	
 	bool success;
 	if(debug) {
 		/* Create and run the debugger */
@@ -55,6 +92,12 @@ int run_vm(VMFiles* files, bool markdown, bool debug) {
 		success = Machine_run(cpu);
 	}
 	
+	/* Write how often each instruction ran, which the compiler can use to optimize the program */
+	if(files->profile != NULL) {
+		Machine_writeProfile(cpu, files->profile);
+		fflush(files->profile);
+	}
+	
 	/* Clean up resources and exit */
 	release(&cpu);
 	return success ? EXIT_SUCCESS : EXIT_FAILURE;
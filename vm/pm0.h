@@ -15,6 +15,7 @@
 typedef struct VMFiles VMFiles;
 
 #include "object.h"
+#include "instruction.h"
 
 struct VMFiles {
 	OBJECT_BASE;
@@ -22,17 +23,29 @@ struct VMFiles {
 	FILE* mcode;
 	FILE* acode;
 	FILE* stacktrace;
+	FILE* profile;
 };
 DECL(VMFiles);
 
 
 /*! Runs the PM/0 vm using the given file streams with optional settings
- @param files Open file streams used by the vm
+ @param files Open file streams used by the vm. The stacktrace and profile may be NULL to skip writing them
  @param markdown True if the stacktrace and disassembly should be in markdown format
  @param debug True if the PM/0 debugger should be used when running the program
  @return Zero on success, or nonzero on error
  */
 int run_vm(VMFiles* files, bool markdown, bool debug);
 
+/*! Runs the PM/0 vm on a program that is already in memory. The mcode file isn't used, and
+ the other files may be NULL to skip writing them.
+ @param files Open file streams used by the vm
+ @param code Array of instructions that make up the program
+ @param count Number of instructions in @p code
+ @param markdown True if the stacktrace and disassembly should be in markdown format
+ @param debug True if the PM/0 debugger should be used when running the program
+ @return Zero on success, or nonzero on error
+ */
+int run_vm_withCode(VMFiles* files, const Insn* code, size_t count, bool markdown, bool debug);
+
 
 #endif /* PL0_PM0_H */